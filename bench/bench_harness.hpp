@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perf_counters.hpp"
+#include "simple_json.hpp"
+
+namespace fgd_converter::bench {
+
+/**
+ * @brief 計測の設定
+ */
+struct Options {
+    int repetitions{10};        // 統計を取る繰り返し回数
+    double min_time_ms{50.0};   // 1回の繰り返しの最短計測時間 (反復回数をこれに合わせて決める)
+    std::string filter;         // 名前にこの文字列を含むケースのみ実行 (空なら全件)
+    bool perf_counters{false};  // ハードウェアカウンターも計測する (Linuxのみ)
+};
+
+/**
+ * @brief 1反復あたりの時間 (ナノ秒) の統計
+ */
+struct Stats {
+    double min{};
+    double median{};
+    double mean{};
+    double stddev{};
+};
+
+/**
+ * @brief 1ケースの計測結果
+ */
+struct Result {
+    std::string name;
+    size_t bytes{};                         // 1反復で処理する入力バイト数
+    size_t values{};                        // 1反復で処理する値 (標高点・画素) の数
+    size_t iterations{};                    // 1回の繰り返しあたりの反復回数
+    std::vector<double> samples_ns;         // 繰り返しごとの1反復あたり時間
+    Stats stats;
+    std::optional<CounterValues> counters;  // 全繰り返しを通した1反復あたりのイベント数
+
+    // スループットは中央値から計算 (外れ値に引きずられないように)
+    [[nodiscard]] double mb_per_s() const {
+        return stats.median > 0 ? static_cast<double>(bytes) / stats.median * 1e9 / 1e6 : 0.0;
+    }
+    [[nodiscard]] double values_per_s() const {
+        return stats.median > 0 ? static_cast<double>(values) / stats.median * 1e9 : 0.0;
+    }
+
+    /**
+     * @brief 入力1バイトあたりのイベント数
+     */
+    [[nodiscard]] auto per_byte(HwEvent event) const -> std::optional<double> {
+        auto count = counters ? counters->get(event) : std::nullopt;
+        if (!count || bytes == 0)
+            return std::nullopt;
+        return *count / static_cast<double>(bytes);
+    }
+
+    /**
+     * @brief 値 (標高点・画素) 1つあたりのイベント数
+     */
+    [[nodiscard]] auto per_value(HwEvent event) const -> std::optional<double> {
+        auto count = counters ? counters->get(event) : std::nullopt;
+        if (!count || values == 0)
+            return std::nullopt;
+        return *count / static_cast<double>(values);
+    }
+};
+
+/**
+ * @brief 最適化で計算結果が消されないようにする
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+[[nodiscard]] inline auto compute_stats(std::vector<double> samples) -> Stats {
+    if (samples.empty())
+        return {};
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+    double variance = 0.0;
+    for (double s : samples) {
+        variance += (s - mean) * (s - mean);
+    }
+    return Stats{.min = samples.front(),
+                 .median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2,
+                 .mean = mean,
+                 .stddev = n > 1 ? std::sqrt(variance / (n - 1)) : 0.0};
+}
+
+/**
+ * @brief マイクロベンチマークの実行と結果の出力
+ *
+ * 各ケースはウォームアップ1回の後、min_time_ms 以上かかる反復回数を求め、
+ * その反復回数で repetitions 回計測する。perf_counters が有効な場合は
+ * repetitions 回の計測全体をハードウェアカウンターで囲む。
+ */
+class Runner {
+   public:
+    explicit Runner(Options options) : options_(std::move(options)) {
+        if (options_.perf_counters) {
+            counters_ = std::make_unique<PerfCounters>();
+        }
+    }
+
+    /**
+     * @brief ハードウェアカウンターを計測中か
+     */
+    [[nodiscard]] bool counters_available() const {
+        return counters_ && counters_->available();
+    }
+
+    /**
+     * @brief ハードウェアカウンターの状態 ("enabled" / "disabled" / 使用できない理由)
+     */
+    [[nodiscard]] std::string counters_status() const {
+        if (!counters_)
+            return "disabled";
+        return counters_->available() ? "enabled" : counters_->error();
+    }
+
+    /**
+     * @brief ケースが実行対象か (重い前準備を省くために事前に確認できる)
+     */
+    [[nodiscard]] bool enabled(std::string_view name) const {
+        return options_.filter.empty() || name.find(options_.filter) != std::string_view::npos;
+    }
+
+    /**
+     * @param fn 1反復分の処理 (呼び出しごとに同じ仕事をすること)
+     */
+    template <typename Fn>
+    void run(std::string name, size_t bytes, size_t values, Fn&& fn) {
+        if (!enabled(name))
+            return;
+        using clock = std::chrono::steady_clock;
+
+        fn();  // ウォームアップ (キャッシュ・遅延初期化)
+
+        size_t iterations = 1;
+        for (;;) {
+            auto start = clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                fn();
+            }
+            double elapsed_ms =
+                std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            if (elapsed_ms >= options_.min_time_ms || iterations >= (size_t{1} << 30))
+                break;
+            // 目標時間に届くまで反復回数を増やす (一度に最大10倍)
+            double scale = elapsed_ms > 0 ? options_.min_time_ms / elapsed_ms * 1.2 : 10.0;
+            iterations = static_cast<size_t>(
+                std::ceil(iterations * std::clamp(scale, 1.5, 10.0)));
+        }
+
+        Result result{.name = std::move(name),
+                      .bytes = bytes,
+                      .values = values,
+                      .iterations = iterations,
+                      .samples_ns = {},
+                      .stats = {},
+                      .counters = std::nullopt};
+        const bool count_events = counters_available();
+        if (count_events)
+            counters_->start();
+        for (int r = 0; r < std::max(options_.repetitions, 1); ++r) {
+            auto start = clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                fn();
+            }
+            double elapsed_ns =
+                std::chrono::duration<double, std::nano>(clock::now() - start).count();
+            result.samples_ns.push_back(elapsed_ns / static_cast<double>(iterations));
+        }
+        if (count_events) {
+            counters_->stop();
+            result.counters = counters_->read(static_cast<double>(iterations) *
+                                              static_cast<double>(result.samples_ns.size()));
+        }
+        result.stats = compute_stats(result.samples_ns);
+        results_.push_back(std::move(result));
+    }
+
+    [[nodiscard]] auto results() const -> const std::vector<Result>& { return results_; }
+
+    /**
+     * @brief 結果を表形式で出力
+     */
+    void print_table(std::ostream& out) const {
+        out << std::left << std::setw(28) << "benchmark" << std::right << std::setw(14)
+            << "median" << std::setw(10) << "+/-" << std::setw(12) << "MB/s" << std::setw(14)
+            << "Mvalues/s" << "\n";
+        for (const auto& r : results_) {
+            const double rel = r.stats.mean > 0 ? r.stats.stddev / r.stats.mean * 100.0 : 0.0;
+            out << std::left << std::setw(28) << r.name << std::right << std::setw(14)
+                << format_time(r.stats.median) << std::setw(9) << std::fixed
+                << std::setprecision(1) << rel << "%" << std::setw(12) << std::setprecision(1)
+                << r.mb_per_s() << std::setw(14) << std::setprecision(2)
+                << r.values_per_s() / 1e6 << "\n";
+        }
+        if (counters_available())
+            print_counter_table(out);
+        out << std::defaultfloat;
+    }
+
+    /**
+     * @brief 結果をJSONで出力 (コミット間の比較用)
+     *
+     * @param context 任意の付加情報 (キーと文字列値の組)
+     */
+    void write_json(std::ostream& out,
+                    const std::vector<std::pair<std::string, std::string>>& context) const {
+        out << std::setprecision(10);
+        out << "{\n  \"context\": {";
+        for (size_t i = 0; i < context.size(); ++i) {
+            out << (i ? ", " : "") << json::quote(context[i].first) << ": "
+                << json::quote(context[i].second);
+        }
+        out << "},\n  \"options\": {\"repetitions\": " << options_.repetitions
+            << ", \"min_time_ms\": " << options_.min_time_ms << "},\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& r = results_[i];
+            out << (i ? "," : "") << "\n    {\"name\": " << json::quote(r.name)
+                << ", \"iterations\": " << r.iterations
+                << ", \"repetitions\": " << r.samples_ns.size()
+                << ", \"bytes_per_iteration\": " << r.bytes
+                << ", \"values_per_iteration\": " << r.values
+                << ",\n     \"ns_per_iteration\": {\"min\": " << r.stats.min
+                << ", \"median\": " << r.stats.median << ", \"mean\": " << r.stats.mean
+                << ", \"stddev\": " << r.stats.stddev << "}"
+                << ",\n     \"mb_per_s\": " << r.mb_per_s()
+                << ", \"values_per_s\": " << r.values_per_s();
+            if (r.counters) {
+                write_counters_json(out, r);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+   private:
+    /**
+     * @brief ハードウェアカウンターの表 (IPCと、バイト・値あたりのイベント数)
+     */
+    void print_counter_table(std::ostream& out) const {
+        auto cell = [&](std::optional<double> value, int width, int precision) {
+            if (value) {
+                out << std::setw(width) << std::fixed << std::setprecision(precision) << *value;
+            } else {
+                out << std::setw(width) << "-";
+            }
+        };
+        out << "\n" << std::left << std::setw(28) << "benchmark" << std::right << std::setw(8)
+            << "IPC" << std::setw(10) << "cyc/B" << std::setw(12) << "cyc/value"
+            << std::setw(12) << "L1D/value" << std::setw(12) << "LLC/value" << std::setw(12)
+            << "brmiss/val" << "\n";
+        for (const auto& r : results_) {
+            if (!r.counters)
+                continue;
+            out << std::left << std::setw(28) << r.name << std::right;
+            cell(r.counters->ipc(), 8, 2);
+            cell(r.per_byte(HwEvent::Cycles), 10, 2);
+            cell(r.per_value(HwEvent::Cycles), 12, 2);
+            cell(r.per_value(HwEvent::L1dMisses), 12, 4);
+            cell(r.per_value(HwEvent::LlcMisses), 12, 4);
+            cell(r.per_value(HwEvent::BranchMisses), 12, 4);
+            out << "\n";
+        }
+    }
+
+    static void write_counters_json(std::ostream& out, const Result& r) {
+        out << ",\n     \"counters\": {";
+        bool first = true;
+        for (size_t i = 0; i < HW_EVENT_COUNT; ++i) {
+            const auto event = static_cast<HwEvent>(i);
+            auto count = r.counters->get(event);
+            if (!count)
+                continue;
+            out << (first ? "" : ", ") << json::quote(HW_EVENT_NAMES[i])
+                << ": {\"per_iteration\": " << *count;
+            if (auto v = r.per_byte(event))
+                out << ", \"per_byte\": " << *v;
+            if (auto v = r.per_value(event))
+                out << ", \"per_value\": " << *v;
+            out << "}";
+            first = false;
+        }
+        if (auto ipc = r.counters->ipc())
+            out << (first ? "" : ", ") << "\"ipc\": " << *ipc;
+        out << "}";
+    }
+
+    static std::string format_time(double ns) {
+        char buffer[32];
+        if (ns >= 1e9)
+            std::snprintf(buffer, sizeof(buffer), "%.3f s", ns / 1e9);
+        else if (ns >= 1e6)
+            std::snprintf(buffer, sizeof(buffer), "%.3f ms", ns / 1e6);
+        else if (ns >= 1e3)
+            std::snprintf(buffer, sizeof(buffer), "%.3f us", ns / 1e3);
+        else
+            std::snprintf(buffer, sizeof(buffer), "%.1f ns", ns);
+        return buffer;
+    }
+
+    Options options_;
+    std::unique_ptr<PerfCounters> counters_;  // perf_counters 指定時のみ
+    std::vector<Result> results_;
+};
+
+/**
+ * @brief ISO 8601形式の現在時刻 (UTC)
+ */
+[[nodiscard]] inline std::string utc_timestamp() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &now);
+#else
+    gmtime_r(&now, &tm);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buffer;
+}
+
+}  // namespace fgd_converter::bench
@@ -0,0 +1,308 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <zlib.h>
+
+#include <cmath>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_harness.hpp"
+#include "cpu_features.hpp"
+#include "dem.hpp"
+#include "fast_fgd_parser.hpp"
+#include "fgd_synth.hpp"
+#include "mosaic.hpp"
+#include "png_writer.hpp"
+#include "raster_kernels.hpp"
+#include "simd_utils.hpp"
+
+using namespace fgd_converter;
+
+namespace {
+
+constexpr int TILE_SIZE = 256;
+
+/**
+ * @brief 合成データから作る計測用の入力一式
+ */
+struct Workload {
+    std::vector<std::string> xmls;  // メッシュごとのFGD XML
+    std::string tuple_list;         // 先頭メッシュのtupleList要素のみ
+    std::string whitespace;         // 空白の連続と非空白が交互に並ぶテキスト
+    Mosaic mosaic;                  // 全メッシュを結合したラスター
+    std::vector<float> mosaic_f32;  // mosaicのfloat版 (行優先)
+    size_t xml_bytes{};
+    size_t points{};
+};
+
+auto make_workload(int mesh_count, uint64_t seed) -> Workload {
+    synth::SynthConfig config{.dem_type = "5A",
+                              .mesh_count = mesh_count,
+                              .origin_lat = 35.0,
+                              .origin_lng = 139.0,
+                              .seed = seed,
+                              .sea_ratio = 0.15,
+                              .nodata_ratio = 0.05,
+                              .partial_ratio = 0.25,
+                              .date = "20240101"};
+    Workload w;
+    for (const auto& code : synth::mesh_codes(config)) {
+        auto xml = synth::make_fgd_xml(code, config);
+        if (!xml)
+            throw std::runtime_error("合成XMLの生成に失敗: " + code);
+        w.xml_bytes += xml->size();
+        w.xmls.push_back(std::move(*xml));
+    }
+    if (w.xmls.empty())
+        throw std::runtime_error("合成XMLの生成に失敗");
+
+    const auto& first = w.xmls.front();
+    const size_t begin = first.find("<gml:tupleList>");
+    const size_t end = first.find("</gml:tupleList>");
+    w.tuple_list = first.substr(begin, end + 16 - begin);
+
+    // XMLのインデント相当 (長短の空白の連続)
+    for (int i = 0; i < 200000; ++i) {
+        w.whitespace.append(static_cast<size_t>(i % 13), i % 3 ? ' ' : '\t');
+        w.whitespace += i % 5 ? "x" : "\n<";
+    }
+
+    Dem dem(w.xmls);
+    for (const auto& grid : dem.get_np_array_list()) {
+        for (const auto& row : grid) {
+            w.points += row.size();
+        }
+    }
+    w.mosaic = build_mosaic(dem.get_metadata_list(), dem.get_np_array_list(),
+                            dem.get_bounds_latlng(), dem.get_mask_list());
+    w.mosaic_f32.reserve(static_cast<size_t>(w.mosaic.x_length) * w.mosaic.y_length);
+    for (const auto& row : w.mosaic.data) {
+        w.mosaic_f32.insert(w.mosaic_f32.end(), row.begin(), row.end());
+    }
+    return w;
+}
+
+void run_benchmarks(bench::Runner& runner, const Workload& w) {
+    const std::string& xml = w.xmls.front();
+    const size_t xml_points = xml::FastFGDParser::parse_all(xml)->elevation_list.size();
+
+    // XMLパース
+    runner.run("parse_all", xml.size(), xml_points, [&] {
+        auto data = xml::FastFGDParser::parse_all(xml);
+        bench::do_not_optimize(data->elevation_list.data());
+    });
+    // parse_tuple_list は非公開のため、tupleList要素のみの文書を parse_all に通して計測
+    runner.run("parse_tuple_list", w.tuple_list.size(), xml_points, [&] {
+        auto data = xml::FastFGDParser::parse_all(w.tuple_list);
+        bench::do_not_optimize(data->elevation_list.data());
+    });
+
+    // SIMDユーティリティ
+    runner.run("simd_find_char", xml.size(), 0, [&] {
+        const char* p = xml.data();
+        const char* end = xml.data() + xml.size();
+        size_t lines = 0;
+        while ((p = simd::find_char_simd(p, end, '\n')) != nullptr) {
+            ++lines;
+            ++p;
+        }
+        bench::do_not_optimize(lines);
+    });
+    runner.run("simd_skip_whitespace", w.whitespace.size(), 0, [&] {
+        const char* p = w.whitespace.data();
+        const char* end = p + w.whitespace.size();
+        size_t tokens = 0;
+        while (p < end) {
+            p = simd::skip_whitespace_simd(p, end) + 1;
+            ++tokens;
+        }
+        bench::do_not_optimize(tokens);
+    });
+
+    // XML群からのメッシュ配列化 (パース + 配置)
+    runner.run("dem_from_xml", w.xml_bytes, w.points, [&] {
+        Dem dem(w.xmls);
+        bench::do_not_optimize(dem.get_np_array_list().data());
+    });
+
+    // メッシュ結合 (結合済みの標高リストから一括で結合する build_mosaic)
+    if (runner.enabled("build_mosaic")) {
+        Dem dem(w.xmls);
+        const size_t pixels = static_cast<size_t>(w.mosaic.x_length) * w.mosaic.y_length;
+        runner.run("build_mosaic", pixels * sizeof(double), pixels, [&] {
+            auto mosaic = build_mosaic(dem.get_metadata_list(), dem.get_np_array_list(),
+                                       dem.get_bounds_latlng(), dem.get_mask_list());
+            bench::do_not_optimize(mosaic.data.data());
+        });
+    }
+
+    // Terrain-RGBエンコード
+    const size_t pixels = w.mosaic_f32.size();
+    std::vector<double> heights_f64(w.mosaic_f32.begin(), w.mosaic_f32.end());
+    std::vector<uint8_t> rgb(pixels * 3 + kernels::RGB_PADDING);
+    runner.run("encode_rgb_f64", pixels * sizeof(double), pixels, [&] {
+        kernels::encode_rgb(heights_f64.data(), pixels, RgbEncoding::Mapbox, rgb.data());
+        bench::do_not_optimize(rgb.data());
+    });
+    runner.run("encode_rgb_f32", pixels * sizeof(float), pixels, [&] {
+        kernels::encode_rgb(w.mosaic_f32.data(), pixels, RgbEncoding::Terrarium, rgb.data());
+        bench::do_not_optimize(rgb.data());
+    });
+
+    // GeoTIFFのRGBタイル: 行をタイルへ詰めてエンコードし、Deflate圧縮 (write_rgb_tiles と同じ手順)
+    const int width = w.mosaic.x_length;
+    const int height = w.mosaic.y_length;
+    const int tile_w = std::min(TILE_SIZE, width);
+    const int tile_h = std::min(TILE_SIZE, height);
+    const size_t tile_pixels = static_cast<size_t>(TILE_SIZE) * TILE_SIZE;
+    std::vector<uint8_t> tile(tile_pixels * 3 + kernels::RGB_PADDING);
+    std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(tile_pixels * 3)));
+    runner.run("rgb_tile_deflate", tile_pixels * 3, tile_pixels, [&] {
+        std::fill(tile.begin(), tile.end(), 0);
+        for (int row = 0; row < tile_h; ++row) {
+            kernels::encode_rgb(w.mosaic.data[row].data(), static_cast<size_t>(tile_w),
+                                RgbEncoding::Mapbox,
+                                tile.data() + static_cast<size_t>(row) * TILE_SIZE * 3);
+        }
+        uLongf size = static_cast<uLongf>(compressed.size());
+        compress2(compressed.data(), &size, tile.data(), static_cast<uLong>(tile_pixels * 3),
+                  Z_DEFAULT_COMPRESSION);
+        bench::do_not_optimize(size);
+    });
+    runner.run("png_encode_tile", tile_pixels * 3, tile_pixels, [&] {
+        std::vector<uint8_t> png;
+        std::error_code ec;
+        bool ok = encode_png_rgb(tile.data(), TILE_SIZE, TILE_SIZE, png, ec);
+        bench::do_not_optimize(ok);
+    });
+
+    // 再投影の補間ループ: わずかに回転・縮小した座標 (事前計算) で全画素を標本化
+    std::vector<double> cols(pixels);
+    std::vector<double> rows(pixels);
+    const double angle = 0.02;
+    for (int r = 0; r < height; ++r) {
+        for (int c = 0; c < width; ++c) {
+            const size_t i = static_cast<size_t>(r) * width + c;
+            cols[i] = c * std::cos(angle) * 0.97 - r * std::sin(angle) + 4.0;
+            rows[i] = c * std::sin(angle) + r * std::cos(angle) * 0.97;
+        }
+    }
+    std::vector<float> resampled(pixels, -9999.0f);
+    runner.run("resample_bilinear", pixels * sizeof(float), pixels, [&] {
+        for (int r = 0; r < height; ++r) {
+            const size_t offset = static_cast<size_t>(r) * width;
+            kernels::resample_bilinear_row(w.mosaic_f32.data(), width, height,
+                                           cols.data() + offset, rows.data() + offset,
+                                           static_cast<size_t>(width), true, -9999.0f,
+                                           resampled.data() + offset);
+        }
+        bench::do_not_optimize(resampled.data());
+    });
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    // Windowsコンソール出力をUTF-8に設定
+    SetConsoleOutputCP(CP_UTF8);
+#endif
+
+    cxxopts::Options options("fgd_dem_bench", "パーサー・結合・エンコードのマイクロベンチマーク");
+    options.add_options()("r,repetitions", "統計を取る繰り返し回数",
+                          cxxopts::value<int>()->default_value("10"))(
+        "min-time", "1回の繰り返しの最短計測時間 (ミリ秒)",
+        cxxopts::value<double>()->default_value("50"))(
+        "f,filter", "名前にこの文字列を含むケースのみ実行",
+        cxxopts::value<std::string>()->default_value(""))(
+        "n,meshes", "合成する5Aメッシュ数 (結合・エンコードの入力サイズ)",
+        cxxopts::value<int>()->default_value("16"))(
+        "seed", "合成データの乱数シード", cxxopts::value<uint64_t>()->default_value("1"))(
+        "json", "結果をJSONで出力するファイル (- は標準出力)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "label", "JSONに記録する任意のラベル (コミットIDなど)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "perf-counters", "ハードウェアカウンター (IPC・キャッシュミス・分岐予測ミス) も計測 (Linux)",
+        cxxopts::value<bool>()->default_value("false"))(
+        "cpu-features", "SIMDカーネルの命令セット (auto, scalar, sse4.2, avx2, avx512)",
+        cxxopts::value<std::string>()->default_value("auto"))("h,help", "ヘルプを表示する");
+
+    try {
+        auto result = options.parse(argc, argv);
+        if (result.count("help")) {
+            std::cout << options.help() << std::endl;
+            return 0;
+        }
+
+        if (std::string cpu_level = result["cpu-features"].as<std::string>();
+            cpu_level != "auto") {
+            auto level = cpu::parse_level(cpu_level);
+            std::error_code ec;
+            if (!level || !cpu::select(*level, ec)) {
+                std::cerr << "エラー: 命令セット " << cpu_level << " は使用できません\n";
+                return 1;
+            }
+        }
+
+        const int meshes = result["meshes"].as<int>();
+        std::cerr << "合成データを準備中 (" << meshes << " メッシュ)...\n";
+        Workload workload = make_workload(meshes, result["seed"].as<uint64_t>());
+
+        bench::Runner runner({.repetitions = result["repetitions"].as<int>(),
+                              .min_time_ms = result["min-time"].as<double>(),
+                              .filter = result["filter"].as<std::string>(),
+                              .perf_counters = result["perf-counters"].as<bool>()});
+        if (result["perf-counters"].as<bool>() && !runner.counters_available()) {
+            std::cerr << "警告: ハードウェアカウンターを使用できません (時間のみ計測します): "
+                      << runner.counters_status() << "\n";
+        }
+        run_benchmarks(runner, workload);
+
+        std::string json_path = result["json"].as<std::string>();
+        // JSONを標準出力に出す場合、表は標準エラーへ
+        runner.print_table(json_path == "-" ? std::cerr : std::cout);
+
+        if (!json_path.empty()) {
+            const std::vector<std::pair<std::string, std::string>> context = {
+                {"label", result["label"].as<std::string>()},
+                {"timestamp", bench::utc_timestamp()},
+                {"meshes", std::to_string(meshes)},
+                {"perf_counters", runner.counters_status()},
+                {"cpu_features", std::string(cpu::level_name(cpu::active()))},
+                {"mosaic", std::to_string(workload.mosaic.x_length) + "x" +
+                               std::to_string(workload.mosaic.y_length)},
+#if defined(__clang__)
+                {"compiler", "clang " __clang_version__},
+#elif defined(__GNUC__)
+                {"compiler", "gcc " __VERSION__},
+#else
+                {"compiler", "unknown"},
+#endif
+            };
+            if (json_path == "-") {
+                runner.write_json(std::cout, context);
+            } else {
+                std::ofstream file(json_path);
+                runner.write_json(file, context);
+                if (!file) {
+                    std::cerr << "JSONの書き込みに失敗: " << json_path << "\n";
+                    return 1;
+                }
+            }
+        }
+
+    } catch (const cxxopts::exceptions::exception& e) {
+        std::cerr << "オプション解析エラー: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "エラー: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,449 @@
+// CLIのエンドツーエンド性能回帰テスト (POSIX専用: fork/exec と wait4 で子プロセスを計測)
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cxxopts.hpp>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "simple_json.hpp"
+
+namespace fs = std::filesystem;
+using namespace fgd_converter;
+
+namespace {
+
+// ctestのSKIP_RETURN_CODE (ベースライン未記録)
+constexpr int EXIT_SKIPPED = 77;
+
+/**
+ * @brief 1段階分のCLI呼び出し
+ */
+struct StageSpec {
+    std::string name;
+    std::vector<std::string> args;  // CLIへの引数 (実行ファイル名を除く)
+    std::vector<fs::path> clean;    // 実行前に削除するパス (作業ディレクトリ相対)
+    fs::path cwd{"."};              // CLIを実行するディレクトリ (作業ディレクトリ相対)
+};
+
+/**
+ * @brief 1段階の計測値
+ */
+struct StageMetrics {
+    std::string stage;
+    double wall_s{};         // 経過時間
+    double cpu_s{};          // ユーザー + システムCPU時間 (全スレッド合計)
+    double peak_rss_mib{};   // 最大常駐メモリ
+    double bytes_written{};  // 作業ディレクトリの増加バイト数
+};
+
+/**
+ * @brief 比較する指標 (すべて小さいほど良い)
+ *
+ * 短い段階は計測誤差が比率では大きく出るため、許容幅に絶対値の下駄を加える。
+ */
+struct MetricSpec {
+    const char* key;
+    double slack;
+    double StageMetrics::*value;
+};
+
+constexpr MetricSpec METRICS[] = {
+    {"wall_s", 0.05, &StageMetrics::wall_s},
+    {"cpu_s", 0.05, &StageMetrics::cpu_s},
+    {"peak_rss_mib", 8.0, &StageMetrics::peak_rss_mib},
+    {"bytes_written", 0.0, &StageMetrics::bytes_written},
+};
+
+/**
+ * @brief 子プロセスの終了状態と資源使用量
+ */
+struct ProcessUsage {
+    int exit_code{};
+    double wall_s{};
+    double cpu_s{};
+    double peak_rss_mib{};
+};
+
+/**
+ * @brief プログラムを cwd で実行し、終了まで待って資源使用量を返す
+ *
+ * 標準出力・標準エラーは log に書き出す。wait4 はその子プロセス自身 (全スレッド) の
+ * rusage のみを返すため、計測にランナー側の処理は含まれない。
+ */
+auto run_process(const fs::path& program, const std::vector<std::string>& args,
+                 const fs::path& cwd, const fs::path& log,
+                 std::error_code& ec) -> std::optional<ProcessUsage> {
+    std::vector<std::string> argv_storage;
+    argv_storage.push_back(program.string());
+    argv_storage.insert(argv_storage.end(), args.begin(), args.end());
+    std::vector<char*> argv;
+    for (auto& arg : argv_storage) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        ec = std::error_code(errno, std::generic_category());
+        return std::nullopt;
+    }
+    if (pid == 0) {
+        // 子プロセス: exec 失敗時は127で終了 (シェルと同じ慣習)
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || chdir(cwd.c_str()) != 0)
+            _exit(127);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    while (wait4(pid, &status, 0, &usage) < 0) {
+        if (errno != EINTR) {
+            ec = std::error_code(errno, std::generic_category());
+            return std::nullopt;
+        }
+    }
+    auto seconds = [](const timeval& tv) { return tv.tv_sec + tv.tv_usec / 1e6; };
+#ifdef __APPLE__
+    const double rss_bytes = static_cast<double>(usage.ru_maxrss);  // macOSはバイト単位
+#else
+    const double rss_bytes = static_cast<double>(usage.ru_maxrss) * 1024.0;  // LinuxはKiB単位
+#endif
+    return ProcessUsage{
+        .exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status),
+        .wall_s = std::chrono::duration<double>(clock::now() - start).count(),
+        .cpu_s = seconds(usage.ru_utime) + seconds(usage.ru_stime),
+        .peak_rss_mib = rss_bytes / (1024.0 * 1024.0)};
+}
+
+/**
+ * @brief ディレクトリ以下の通常ファイルの合計サイズ
+ */
+auto directory_size(const fs::path& dir) -> uint64_t {
+    uint64_t total = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(dir, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            total += it->file_size(ec);
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief ログの末尾を標準エラーへ出す (失敗時の手がかり)
+ */
+void print_log_tail(const fs::path& log, size_t lines) {
+    std::ifstream file(log);
+    std::deque<std::string> tail;
+    for (std::string line; std::getline(file, line);) {
+        tail.push_back(line);
+        if (tail.size() > lines)
+            tail.pop_front();
+    }
+    for (const auto& line : tail) {
+        std::cerr << "  | " << line << "\n";
+    }
+}
+
+/**
+ * @brief CLIの各段階の呼び出しを組み立てる
+ *
+ * 作業ディレクトリは <work>/run。CLIは展開先を ./extracted に固定しているため、
+ * 作業ディレクトリを基準に実行する。merge は convert の出力を入力とする。
+ */
+auto make_stages(const std::vector<std::string>& names, const std::string& dem_type,
+                 int max_zoom) -> std::optional<std::vector<StageSpec>> {
+    std::vector<StageSpec> stages;
+    for (const auto& name : names) {
+        if (name == "extract") {
+            stages.push_back({name, {"-i", "../data", "-o", "output", "-x"}, {"extracted"}, "."});
+        } else if (name == "convert") {
+            stages.push_back(
+                {name, {"-i", "../data", "-o", "output"}, {"extracted", "output"}, "."});
+        } else if (name == "merge") {
+            // マージ結果はカレントディレクトリに出力されるため、merged/ で実行する
+            stages.push_back({name, {"-M", "-m", dem_type, "-d", "../output"}, {"merged"},
+                              "merged"});
+        } else if (name == "xyz") {
+            stages.push_back({name,
+                              {"-i", "../data", "--xyz-tiles", "tiles", "--max-zoom",
+                               std::to_string(max_zoom)},
+                              {"extracted", "tiles"},
+                              "."});
+        } else {
+            return std::nullopt;
+        }
+    }
+    return stages;
+}
+
+auto split(const std::string& text, char delimiter) -> std::vector<std::string> {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    for (std::string item; std::getline(ss, item, delimiter);) {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+/**
+ * @brief 計測結果をフラットなJSON ("<段階>.<指標>": 値) で書き出す
+ */
+bool write_metrics(const fs::path& path, const std::vector<StageMetrics>& metrics,
+                   double tolerance, const std::string& label) {
+    std::ofstream file(path);
+    file << std::setprecision(10) << "{\n  \"label\": " << json::quote(label)
+         << ",\n  \"tolerance\": " << tolerance;
+    for (const auto& m : metrics) {
+        for (const auto& spec : METRICS) {
+            file << ",\n  " << json::quote(m.stage + "." + spec.key) << ": " << m.*spec.value;
+        }
+    }
+    file << "\n}\n";
+    return static_cast<bool>(file);
+}
+
+/**
+ * @brief ベースラインと比較して結果表を出力
+ *
+ * @return 許容幅を超えて悪化した指標の数
+ */
+int compare_with_baseline(const std::vector<StageMetrics>& metrics,
+                          const json::Object& baseline, double tolerance) {
+    int regressions = 0;
+    std::cout << std::left << std::setw(22) << "metric" << std::right << std::setw(16)
+              << "current" << std::setw(16) << "baseline" << std::setw(10) << "ratio"
+              << "  status\n";
+    for (const auto& m : metrics) {
+        for (const auto& spec : METRICS) {
+            const std::string key = m.stage + "." + spec.key;
+            const double value = m.*spec.value;
+            auto base = json::get_number(baseline, key);
+            std::cout << std::left << std::setw(22) << key << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(16) << value << std::setw(16);
+            if (!base) {
+                std::cout << "-" << std::setw(10) << "-" << "  (no baseline)\n";
+                continue;
+            }
+            const double limit = *base * (1.0 + tolerance) + spec.slack;
+            const bool regressed = value > limit;
+            regressions += regressed ? 1 : 0;
+            std::cout << *base << std::setw(10) << std::setprecision(2)
+                      << (*base > 0 ? value / *base : 0.0) << "  "
+                      << (regressed ? "REGRESSED" : "ok") << "\n";
+        }
+    }
+    std::cout << std::defaultfloat;
+    return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    cxxopts::Options options("fgd_dem_perf",
+                             "合成データセットでCLI全体を実行し、段階ごとの性能をベースラインと比較");
+    options.add_options()("cli", "convert_fgd_dem_cpp 実行ファイル", cxxopts::value<std::string>())(
+        "synth", "fgd_dem_synth 実行ファイル", cxxopts::value<std::string>())(
+        "n,meshes", "合成する5Aメッシュ数", cxxopts::value<int>()->default_value("1"))(
+        "t,type", "DEM種別", cxxopts::value<std::string>()->default_value("5A"))(
+        "seed", "合成データの乱数シード", cxxopts::value<uint64_t>()->default_value("1"))(
+        "case", "ケース名 (ベースラインファイル名、既定は meshes_<メッシュ数>)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "w,work-dir", "作業ディレクトリ (合成データ・出力・ログ)",
+        cxxopts::value<std::string>()->default_value("./perf"))(
+        "baseline-dir", "ベースラインJSONのディレクトリ",
+        cxxopts::value<std::string>()->default_value("./bench/perf_baseline"))(
+        "stages", "計測する段階 (extract, convert, merge, xyz をカンマ区切り)",
+        cxxopts::value<std::string>()->default_value("extract,convert,merge,xyz"))(
+        "max-zoom", "xyz段階の最大ズーム", cxxopts::value<int>()->default_value("14"))(
+        "r,repetitions", "繰り返し回数 (時間は最小値、メモリは最大値を採用)",
+        cxxopts::value<int>()->default_value("1"))(
+        "tolerance", "許容する悪化率 (既定はベースラインの値、なければ0.25)",
+        cxxopts::value<double>())(
+        "record", "結果をベースラインとして保存 (環境変数 FGD_DEM_PERF_RECORD=1 でも可)",
+        cxxopts::value<bool>()->default_value("false"))(
+        "label", "記録する任意のラベル (コミットIDなど)",
+        cxxopts::value<std::string>()->default_value(""))("h,help", "ヘルプを表示する");
+
+    try {
+        auto result = options.parse(argc, argv);
+        if (result.count("help") || !result.count("cli") || !result.count("synth")) {
+            std::cout << options.help() << std::endl;
+            return result.count("help") ? 0 : 1;
+        }
+
+        const fs::path cli = fs::absolute(result["cli"].as<std::string>());
+        const fs::path synth = fs::absolute(result["synth"].as<std::string>());
+        const int meshes = result["meshes"].as<int>();
+        const std::string dem_type = result["type"].as<std::string>();
+        const uint64_t seed = result["seed"].as<uint64_t>();
+        std::string case_name = result["case"].as<std::string>();
+        if (case_name.empty())
+            case_name = "meshes_" + std::to_string(meshes);
+        const fs::path work_dir = fs::absolute(result["work-dir"].as<std::string>());
+        const fs::path baseline_path =
+            fs::absolute(result["baseline-dir"].as<std::string>()) / (case_name + ".json");
+        const char* record_env = std::getenv("FGD_DEM_PERF_RECORD");
+        const bool record = result["record"].as<bool>() ||
+                            (record_env != nullptr && std::string(record_env) == "1");
+
+        auto stages = make_stages(split(result["stages"].as<std::string>(), ','), dem_type,
+                                  result["max-zoom"].as<int>());
+        if (!stages) {
+            std::cerr << "エラー: --stages は extract, convert, merge, xyz から指定してください\n";
+            return 1;
+        }
+
+        const fs::path data_dir = work_dir / "data";
+        const fs::path run_dir = work_dir / "run";
+        const fs::path log_dir = work_dir / "logs";
+        fs::create_directories(run_dir);
+        fs::create_directories(log_dir);
+
+        // 合成データは決定的なので、同じ設定で生成済みなら再利用する
+        const std::string stamp = dem_type + " " + std::to_string(meshes) + " " +
+                                  std::to_string(seed);
+        const fs::path stamp_path = work_dir / "data.stamp";
+        std::string existing;
+        std::getline(std::ifstream(stamp_path), existing);
+        if (existing != stamp || !fs::exists(data_dir)) {
+            fs::remove_all(data_dir);
+            std::cout << "合成データを生成中 (" << meshes << " メッシュ)...\n";
+            std::error_code ec;
+            auto usage = run_process(synth,
+                                     {"-o", data_dir.string(), "-t", dem_type, "-n",
+                                      std::to_string(meshes), "--seed", std::to_string(seed)},
+                                     work_dir, log_dir / "synth.log", ec);
+            if (!usage || usage->exit_code != 0) {
+                std::cerr << "合成データの生成に失敗: "
+                          << (usage ? "終了コード " + std::to_string(usage->exit_code)
+                                    : ec.message())
+                          << "\n";
+                print_log_tail(log_dir / "synth.log", 20);
+                return 1;
+            }
+            std::ofstream(stamp_path) << stamp << "\n";
+        }
+
+        const int repetitions = std::max(result["repetitions"].as<int>(), 1);
+        std::vector<StageMetrics> metrics;
+        for (const auto& stage : *stages) {
+            metrics.push_back({.stage = stage.name,
+                               .wall_s = 1e300,
+                               .cpu_s = 1e300,
+                               .peak_rss_mib = 0.0,
+                               .bytes_written = 0.0});
+        }
+        for (int rep = 0; rep < repetitions; ++rep) {
+            for (size_t i = 0; i < stages->size(); ++i) {
+                const auto& stage = (*stages)[i];
+                for (const auto& path : stage.clean) {
+                    fs::remove_all(run_dir / path);
+                }
+                const fs::path cwd = (run_dir / stage.cwd).lexically_normal();
+                fs::create_directories(cwd);
+
+                const uint64_t before = directory_size(run_dir);
+                const fs::path log = log_dir / (stage.name + ".log");
+                std::error_code ec;
+                auto usage = run_process(cli, stage.args, cwd, log, ec);
+                if (!usage || usage->exit_code != 0) {
+                    std::cerr << stage.name << " 段階の実行に失敗: "
+                              << (usage ? "終了コード " + std::to_string(usage->exit_code)
+                                        : ec.message())
+                              << " (ログ: " << log.string() << ")\n";
+                    print_log_tail(log, 20);
+                    return 1;
+                }
+                const uint64_t after = directory_size(run_dir);
+
+                auto& m = metrics[i];
+                m.wall_s = std::min(m.wall_s, usage->wall_s);
+                m.cpu_s = std::min(m.cpu_s, usage->cpu_s);
+                m.peak_rss_mib = std::max(m.peak_rss_mib, usage->peak_rss_mib);
+                m.bytes_written = static_cast<double>(after > before ? after - before : 0);
+            }
+        }
+
+        const std::string label = result["label"].as<std::string>();
+        std::optional<json::Object> baseline;
+        if (std::ifstream file(baseline_path); file) {
+            std::stringstream ss;
+            ss << file.rdbuf();
+            baseline = json::parse_flat_object(ss.str());
+            if (!baseline) {
+                std::cerr << "ベースラインの書式が不正です: " << baseline_path.string() << "\n";
+                return 1;
+            }
+        }
+        double tolerance = 0.25;
+        if (result.count("tolerance")) {
+            tolerance = result["tolerance"].as<double>();
+        } else if (baseline) {
+            tolerance = json::get_number(*baseline, "tolerance").value_or(tolerance);
+        }
+
+        if (!write_metrics(work_dir / "results.json", metrics, tolerance, label)) {
+            std::cerr << "結果の書き込みに失敗: " << (work_dir / "results.json").string() << "\n";
+            return 1;
+        }
+
+        std::cout << "[" << case_name << "] " << meshes << " メッシュ, 許容悪化率 "
+                  << tolerance * 100.0 << "%\n";
+        if (record) {
+            fs::create_directories(baseline_path.parent_path());
+            if (!write_metrics(baseline_path, metrics, tolerance, label)) {
+                std::cerr << "ベースラインの書き込みに失敗: " << baseline_path.string() << "\n";
+                return 1;
+            }
+            compare_with_baseline(metrics, {}, tolerance);
+            std::cout << "ベースラインを記録しました: " << baseline_path.string() << "\n";
+            return 0;
+        }
+        if (!baseline) {
+            compare_with_baseline(metrics, {}, tolerance);
+            std::cout << "ベースラインがありません (--record で記録): " << baseline_path.string()
+                      << "\n";
+            return EXIT_SKIPPED;
+        }
+
+        int regressions = compare_with_baseline(metrics, *baseline, tolerance);
+        if (regressions > 0) {
+            std::cerr << regressions << " 個の指標がベースラインから悪化しました\n";
+            return 1;
+        }
+
+    } catch (const cxxopts::exceptions::exception& e) {
+        std::cerr << "オプション解析エラー: " << e.what() << std::endl;
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << "エラー: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fgd_converter::bench {
+
+/**
+ * @brief 計測するハードウェアイベント
+ */
+enum class HwEvent : uint8_t {
+    Cycles,        // CPUサイクル
+    Instructions,  // 実行命令数
+    L1dMisses,     // L1データキャッシュの読み込みミス
+    LlcMisses,     // 最終レベルキャッシュのミス
+    BranchMisses,  // 分岐予測ミス
+    Count,
+};
+
+inline constexpr size_t HW_EVENT_COUNT = static_cast<size_t>(HwEvent::Count);
+
+inline constexpr std::array<std::string_view, HW_EVENT_COUNT> HW_EVENT_NAMES = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+/**
+ * @brief 1反復あたりのイベント数 (取得できなかったイベントはstd::nullopt)
+ */
+struct CounterValues {
+    std::array<std::optional<double>, HW_EVENT_COUNT> per_iteration{};
+
+    [[nodiscard]] auto get(HwEvent event) const -> std::optional<double> {
+        return per_iteration[static_cast<size_t>(event)];
+    }
+
+    /**
+     * @brief 1サイクルあたりの命令数
+     */
+    [[nodiscard]] auto ipc() const -> std::optional<double> {
+        auto cycles = get(HwEvent::Cycles);
+        auto instructions = get(HwEvent::Instructions);
+        if (!cycles || !instructions || *cycles <= 0)
+            return std::nullopt;
+        return *instructions / *cycles;
+    }
+};
+
+/**
+ * @brief Linux の perf_event_open によるハードウェアカウンター
+ *
+ * 計測スレッド (ユーザー空間のみ) のイベントを数える。TBBのワーカースレッドは含まないため、
+ * 並列に処理するケースの値は計測スレッドの分のみとなる。
+ * カウンターが多重化された場合は有効時間と実行時間の比で補正する。
+ * 権限がない (perf_event_paranoid) 、仮想環境で未対応、Linux以外の場合は available() が false
+ * となり、計測は時間のみで続行する。取得できないイベントは個別に除外する。
+ */
+class PerfCounters {
+   public:
+    PerfCounters() {
+        fds_.fill(-1);
+#if defined(__linux__)
+        int first_errno = 0;
+        for (size_t i = 0; i < HW_EVENT_COUNT; ++i) {
+            fds_[i] = open_event(static_cast<HwEvent>(i));
+            if (fds_[i] < 0 && first_errno == 0) {
+                first_errno = errno;
+            }
+        }
+        if (!available()) {
+            if (first_errno == EACCES || first_errno == EPERM) {
+                error_ = "perf_event_open が許可されていません "
+                         "(/proc/sys/kernel/perf_event_paranoid を確認)";
+            } else if (first_errno == ENOENT || first_errno == EOPNOTSUPP) {
+                error_ = "この環境のCPU (仮想環境など) はハードウェアカウンターに未対応";
+            } else {
+                error_ = std::string("perf_event_open に失敗: ") + std::strerror(first_errno);
+            }
+        }
+#else
+        error_ = "ハードウェアカウンターはLinuxのみ対応";
+#endif
+    }
+
+    ~PerfCounters() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief 1つ以上のイベントを計測できるか
+     */
+    [[nodiscard]] bool available() const {
+        for (int fd : fds_) {
+            if (fd >= 0)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 計測できない理由 (available() が false の場合)
+     */
+    [[nodiscard]] auto error() const -> const std::string& { return error_; }
+
+    /**
+     * @brief カウンターを0に戻して計測を開始
+     */
+    void start() noexcept {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop() noexcept {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief start() から stop() までのイベント数を反復回数で割って取得
+     */
+    [[nodiscard]] auto read(double iterations) const -> CounterValues {
+        CounterValues result;
+#if defined(__linux__)
+        for (size_t i = 0; i < HW_EVENT_COUNT; ++i) {
+            if (fds_[i] < 0)
+                continue;
+            // PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING の形式
+            uint64_t data[3] = {};
+            if (::read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)))
+                continue;
+            if (data[2] == 0)
+                continue;  // 一度もPMUに載らなかった
+            const double scaled = static_cast<double>(data[0]) * static_cast<double>(data[1]) /
+                                  static_cast<double>(data[2]);
+            result.per_iteration[i] = scaled / iterations;
+        }
+#else
+        (void)iterations;
+#endif
+        return result;
+    }
+
+   private:
+#if defined(__linux__)
+    static int open_event(HwEvent event) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        switch (event) {
+            case HwEvent::Cycles:
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case HwEvent::Instructions:
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case HwEvent::L1dMisses:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case HwEvent::LlcMisses:
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            case HwEvent::BranchMisses:
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case HwEvent::Count:
+                return -1;
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;  // perf_event_paranoid=2 でも開けるようにユーザー空間のみ
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+
+    std::array<int, HW_EVENT_COUNT> fds_{};
+    std::string error_;
+};
+
+}  // namespace fgd_converter::bench
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -8,40 +9,87 @@
 #include <system_error>
 
 #include "dem.hpp"
+#include "raster_kernels.hpp"
+#include "terrain.hpp"
 
 namespace fgd_converter {
 
+/**
+ * @brief 標高ラスターの出力形式
+ */
+enum class OutputFormat {
+    GeoTiff,  // <出力名>.tif
+    Zarr,     // <出力名>.zarr (Zarr v2、EPSG:4326)
+};
+
+/**
+ * @brief 出力形式名 ("geotiff", "zarr") を解析
+ */
+[[nodiscard]] auto parse_output_format(std::string_view name) -> std::optional<OutputFormat>;
+
 class Converter {
    public:
     struct Config {
         std::filesystem::path import_path;
         std::filesystem::path output_path;
         std::string output_epsg{"EPSG:4326"};
+        OutputFormat output_format{OutputFormat::GeoTiff};
         std::optional<std::string> file_name;
         bool rgbify{false};
+        RgbEncoding rgb_encoding{RgbEncoding::Mapbox};
         bool sea_at_zero{true};
+        // 地形派生バンド (<出力名>_slope.tif などのサイドカーとして出力)
+        TerrainConfig terrain{};
+        // 地表面種別バンド (<出力名>_class.tif、SurfaceClassの8bit値)
+        bool surface_class{false};
+        // パース済みメッシュのキャッシュ (nullptrの場合は毎回XMLをパース)
+        std::shared_ptr<const MeshCache> mesh_cache;
+        // 処理するXMLエントリ (カタログから取得、std::nulloptの場合はアーカイブ内のすべて)
+        std::optional<std::vector<zip::EntryInfo>> entries;
+        // 処理段階の通知 ("parse", "combine", "write", "resample", "terrain", "class")
+        std::function<void(std::string_view stage)> on_progress;
     };
 
     explicit Converter(Config config);
 
     [[nodiscard]] bool run(std::error_code& ec);
 
-   private:
-    [[nodiscard]] auto calc_image_size(span<const Metadata> meta_data_list) const noexcept
-        -> std::pair<int, int>;
-
-    [[nodiscard]] auto combine_meta_data_and_contents(
-        span<const Metadata> meta_data_list,
-        span<const std::vector<std::vector<double>>> np_array_list) const
-        -> std::tuple<std::vector<std::vector<double>>, int, int>;
+    /**
+     * @brief run() が書き出した標高ラスター (GeoTIFFまたはZarr) のパス (run() 前は空)
+     */
+    [[nodiscard]] auto output_file() const noexcept -> const std::filesystem::path& {
+        return output_file_;
+    }
 
+   private:
     [[nodiscard]] bool make_data_for_geotiff(std::vector<std::vector<double>>& np_array,
                                              std::array<double, 6>& geo_transform, int& x_length,
-                                             int& y_length, std::error_code& ec);
+                                             int& y_length, ValidityMask& valid,
+                                             std::vector<uint8_t>& classes, std::error_code& ec);
+
+    [[nodiscard]] bool write_geotiff(const std::vector<std::vector<double>>& np_array,
+                                     const std::array<double, 6>& geo_transform, int x_length,
+                                     int y_length, const ValidityMask& valid,
+                                     const std::filesystem::path& output_file,
+                                     std::error_code& ec) const;
+
+    [[nodiscard]] bool write_terrain_bands(const std::vector<std::vector<double>>& np_array,
+                                           const std::array<double, 6>& geo_transform,
+                                           int x_length, int y_length, const ValidityMask& valid,
+                                           const std::filesystem::path& output_file,
+                                           std::error_code& ec) const;
+
+    [[nodiscard]] bool write_class_band(const std::vector<uint8_t>& classes,
+                                        const std::array<double, 6>& geo_transform, int x_length,
+                                        int y_length, const std::filesystem::path& output_file,
+                                        std::error_code& ec) const;
+
+    void report_progress(std::string_view stage) const;
 
     Config config_;
     std::unique_ptr<Dem> dem_;
     bool process_interrupted_{false};
+    std::filesystem::path output_file_;
 };
 
 }  // namespace fgd_converter
\ No newline at end of file
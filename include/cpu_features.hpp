@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+
+namespace fgd_converter::cpu {
+
+/**
+ * @brief SIMDカーネルの命令セット (下位の命令セットを包含する順)
+ */
+enum class Level : uint8_t {
+    Scalar,  // SIMDなし (x86_64以外を含む)
+    Sse42,   // SSE4.2 (SSSE3・SSE4.1を含む)
+    Avx2,    // AVX2 + FMA
+    Avx512,  // AVX-512 F/BW/VL/DQ
+};
+
+/**
+ * @brief 命令セット名 ("scalar", "sse4.2", "avx2", "avx512")
+ */
+[[nodiscard]] auto level_name(Level level) noexcept -> std::string_view;
+
+/**
+ * @brief 命令セット名を解析
+ */
+[[nodiscard]] auto parse_level(std::string_view name) -> std::optional<Level>;
+
+/**
+ * @brief CPUとOSが対応する最上位の命令セット (起動後1回だけcpuidで判定)
+ *
+ * AVX/AVX-512はOSがレジスタ状態を保存する場合 (XGETBV) のみ対応とみなす。
+ */
+[[nodiscard]] auto detect() noexcept -> Level;
+
+/**
+ * @brief カーネルが使用する命令セット (select() で指定がなければ detect() の値)
+ *
+ * カーネルは呼び出しごとにこの値で実装を選ぶ (relaxed load 1回)。
+ */
+[[nodiscard]] auto active() noexcept -> Level;
+
+/**
+ * @brief 使用する命令セットを指定 (比較・不具合の切り分け用)
+ *
+ * CPUが対応しない命令セットは指定できない。
+ */
+[[nodiscard]] bool select(Level level, std::error_code& ec) noexcept;
+
+/**
+ * @brief 判定結果と使用する命令セットを出力 (--cpu-features list)
+ */
+void describe(std::ostream& out);
+
+}  // namespace fgd_converter::cpu
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -9,6 +10,11 @@
 #include <string_view>
 #include <vector>
 
+#include "generator.hpp"
+#include "stats.hpp"
+#include "validity_mask.hpp"
+#include "zip_handler.hpp"
+
 namespace fgd_converter {
 
 template <typename T>
@@ -52,13 +58,61 @@ struct BoundsLatLng {
     double max_lng{};
 };
 
+/**
+ * @brief Dem::meshes() が返す1メッシュ分のデータ (次のメッシュへ進むまで有効)
+ */
+struct MeshView {
+    const Metadata& metadata;
+    span<const std::vector<double>> grid;  // 行ごとの標高 (未取得は-9999)
+    const ValidityMask& valid;             // grid の有効ピクセル
+    span<const uint8_t> classes;           // 種別配列 (surface_classes を指定した場合のみ)
+};
+
+class MeshCache;
+
 class Dem {
    public:
-    explicit Dem(std::filesystem::path import_path, bool sea_at_zero = true);
+    /**
+     * @param mesh_cache 指定した場合、ZIPのXMLエントリはキャッシュから読み込み、
+     *                   キャッシュにないものだけを展開・パースして保存する
+     * @param entries 処理するXMLエントリ (カタログから取得したもの)。指定した場合は
+     *                セントラルディレクトリを読まず、これらのエントリのみをメモリ上に展開する
+     * @param surface_classes 標高配列と同じ配置の種別配列 (get_class_array_list) も作成する。
+     *                        キャッシュは種別を持たないため、指定した場合はXMLをパースする
+     */
+    explicit Dem(std::filesystem::path import_path, bool sea_at_zero = true,
+                 std::shared_ptr<const MeshCache> mesh_cache = nullptr,
+                 std::optional<std::vector<zip::EntryInfo>> entries = std::nullopt,
+                 bool surface_classes = false);
+
+    /**
+     * @brief メモリ上のXMLコンテンツから構築 (ファイル展開を行わない)
+     *
+     * 構築時にメタデータと標高配列を作成するため、get_xml_content()の呼び出しは不要。
+     */
+    explicit Dem(std::vector<std::string> xml_contents, bool sea_at_zero = true,
+                 bool surface_classes = false);
 
     [[nodiscard]] auto contents_to_array() const -> std::vector<std::vector<double>>;
     void get_xml_content();
 
+    /**
+     * @brief 各XMLのヘッダー部分 (tupleListより前) のみからメタデータと範囲を作成
+     *
+     * 標高配列は作成しない。startPoint はtupleListの後にあるため0のままとなる。
+     * get_metadata_list / get_bounds_latlng で結合後の画像サイズを事前に求める場合に使う。
+     */
+    void scan_headers();
+
+    /**
+     * @brief メッシュを1つずつ展開・パースして返す (範囲forで列挙する)
+     *
+     * CPUコア数ずつ並列にパースし、返したメッシュは次のまとまりへ進む時点で解放するため、
+     * メッシュ数によらず一定のメモリで処理できる。get_xml_content() 後、またはメモリ上の
+     * XMLから構築した場合は読み込み済みの配列を返す。列挙中はDemを破棄しないこと。
+     */
+    [[nodiscard]] auto meshes() -> Generator<MeshView>;
+
     [[nodiscard]] auto get_metadata_list() const noexcept -> span<const Metadata> {
         return span<const Metadata>(meta_data_list.data(), meta_data_list.size());
     }
@@ -67,6 +121,20 @@ class Dem {
         return span<const std::vector<std::vector<double>>>(np_array_list.data(),
                                                             np_array_list.size());
     }
+    /**
+     * @brief メッシュごとの有効ピクセルのマスク (get_np_array_list と同順・同寸法)
+     */
+    [[nodiscard]] auto get_mask_list() const noexcept -> span<const ValidityMask> {
+        return span<const ValidityMask>(mask_list.data(), mask_list.size());
+    }
+    /**
+     * @brief メッシュごとの種別配列 (SurfaceClass、行優先でy_length×x_length)
+     *
+     * 構築時に surface_classes を指定しない場合は空。
+     */
+    [[nodiscard]] auto get_class_array_list() const noexcept -> span<const std::vector<uint8_t>> {
+        return span<const std::vector<uint8_t>>(class_array_list.data(), class_array_list.size());
+    }
     [[nodiscard]] auto get_bounds_latlng() const noexcept -> const BoundsLatLng& {
         return bounds_latlng;
     }
@@ -75,14 +143,25 @@ class Dem {
     }
 
    private:
+    struct StreamedMesh;
+
     void unzip_dem();
     [[nodiscard]] auto get_xml_paths() -> std::vector<std::filesystem::path>;
     [[nodiscard]] auto format_metadata(std::string_view xml_content,
                                        std::string_view mesh_code) -> Metadata;
     void check_mesh_codes();
+    void warn_duplicate_mesh_codes() const;
+    [[nodiscard]] bool load_entries();
+    [[nodiscard]] auto list_xml_entries(const zip::ZipHandler& handler)
+        -> std::optional<std::vector<zip::EntryInfo>>;
+    void resolve_stream_sources();
+    [[nodiscard]] auto decode_mesh(std::string_view xml_content) -> std::optional<StreamedMesh>;
+    void decode_batch(size_t first, std::vector<std::optional<StreamedMesh>>& batch);
+    void process_contents();
     void populate_metadata_list();
     void store_bounds_latlng();
-    [[nodiscard]] auto get_np_array(std::string_view xml_content)
+    [[nodiscard]] auto get_np_array(std::string_view xml_content, ValidityMask& valid,
+                                    std::vector<uint8_t>* classes = nullptr)
         -> std::vector<std::vector<double>>;
     void store_np_array_list();
 
@@ -92,8 +171,17 @@ class Dem {
     std::vector<std::string> mesh_code_list;
     std::vector<Metadata> meta_data_list;
     bool sea_at_zero;
+    bool surface_classes;
+    std::shared_ptr<const MeshCache> mesh_cache;
+    std::optional<std::vector<zip::EntryInfo>> entries;
+    bool stream_from_zip{false};  // meshes() の読み込み元 (trueはentries、falseはxml_paths)
+    bool stream_resolved{false};
     std::vector<std::vector<std::vector<double>>> np_array_list;
+    std::vector<ValidityMask> mask_list;
+    std::vector<std::vector<uint8_t>> class_array_list;
     BoundsLatLng bounds_latlng{};
+    stats::MemoryCharge xml_buffers_charge;  // all_content_list の確保量 (--stats)
+    stats::MemoryCharge mesh_grids_charge;   // np_array_list の確保量 (--stats)
 };
 
 }  // namespace fgd_converter
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <charconv>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <optional>
@@ -10,6 +13,8 @@
 #include <vector>
 
 #include "simd_utils.hpp"
+#include "stats.hpp"
+#include "surface_class.hpp"
 
 namespace fgd_converter::xml {
 
@@ -17,6 +22,146 @@ struct TuplePoint;
 struct GridEnvelope;
 struct StartPoint;
 
+namespace tags {
+
+/**
+ * @brief パーサーが処理するタグ
+ */
+enum class Tag : uint8_t {
+    LowerCorner,
+    UpperCorner,
+    Low,
+    High,
+    StartPoint,
+    Mesh,
+    Type,
+    TupleList,
+    RangeParameters,  // 値を含まない部分木 (閉じタグまで読み飛ばす)
+};
+
+struct TagName {
+    std::string_view name;  // '<' の直後から '>' まで
+    Tag tag;
+};
+
+inline constexpr std::array<TagName, 9> TAGS = {{
+    {"gml:lowerCorner>", Tag::LowerCorner},
+    {"gml:upperCorner>", Tag::UpperCorner},
+    {"gml:low>", Tag::Low},
+    {"gml:high>", Tag::High},
+    {"gml:startPoint>", Tag::StartPoint},
+    {"mesh>", Tag::Mesh},
+    {"type>", Tag::Type},
+    {"gml:tupleList>", Tag::TupleList},
+    {"gml:rangeParameters>", Tag::RangeParameters},
+}};
+
+inline constexpr int SLOT_BITS = 4;  // 16スロット
+inline constexpr uint8_t EMPTY_SLOT = 0xFF;
+
+/**
+ * @brief 先頭8バイトをリトルエンディアンの整数として読み込む (足りない分は0)
+ */
+constexpr uint64_t load_word(const char* ptr, size_t available) noexcept {
+    uint64_t word = 0;
+    const size_t n = std::min<size_t>(available, 8);
+    for (size_t i = 0; i < n; ++i) {
+        word |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[i])) << (8 * i);
+    }
+    return word;
+}
+
+/**
+ * @brief 8バイト内の最初の '>' より後ろを0にしたキー (名前が8バイト未満のタグを区別する)
+ */
+constexpr uint64_t tag_key(uint64_t word) noexcept {
+    constexpr uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t x = word ^ (ones * '>');
+    const uint64_t found = (x - ones) & ~x & (ones * 0x80);  // 最下位の検出位置は正確
+    if (found == 0)
+        return word;
+    const int bits = std::countr_zero(found) + 1;  // '>' のバイトの最上位ビットまで
+    return bits == 64 ? word : word & ((uint64_t{1} << bits) - 1);
+}
+
+constexpr uint64_t name_key(std::string_view name) noexcept {
+    return tag_key(load_word(name.data(), name.size()));
+}
+
+constexpr size_t slot_of(uint64_t key, uint64_t multiplier) noexcept {
+    return static_cast<size_t>((key * multiplier) >> (64 - SLOT_BITS));
+}
+
+/**
+ * @brief TAGSのキーが衝突しない乗数を探す (コンパイル時)
+ */
+constexpr uint64_t find_multiplier() noexcept {
+    uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    for (int attempt = 0; attempt < 10000; ++attempt) {
+        std::array<bool, size_t{1} << SLOT_BITS> used{};
+        bool collision = false;
+        for (const TagName& t : TAGS) {
+            const size_t slot = slot_of(name_key(t.name), multiplier);
+            collision = collision || used[slot];
+            used[slot] = true;
+        }
+        if (!collision)
+            return multiplier;
+        multiplier = (multiplier * 6364136223846793005ULL + 1442695040888963407ULL) | 1;
+    }
+    return 0;
+}
+
+inline constexpr uint64_t MULTIPLIER = find_multiplier();
+static_assert(MULTIPLIER != 0, "タグ名の完全ハッシュが見つからない");
+
+struct Slot {
+    uint64_t key;
+    uint8_t index;  // TAGSの添字 (空きはEMPTY_SLOT)
+};
+
+constexpr auto make_slots() noexcept {
+    std::array<Slot, size_t{1} << SLOT_BITS> slots{};
+    for (Slot& s : slots) {
+        s = {.key = 0, .index = EMPTY_SLOT};
+    }
+    for (size_t i = 0; i < TAGS.size(); ++i) {
+        const uint64_t key = name_key(TAGS[i].name);
+        slots[slot_of(key, MULTIPLIER)] = {.key = key, .index = static_cast<uint8_t>(i)};
+    }
+    return slots;
+}
+
+inline constexpr auto SLOTS = make_slots();
+
+/**
+ * @brief '<' の直後から始まるタグを判定
+ *
+ * 先頭8バイトのキーをスロットと1回比較するだけで大半のタグを除外し、
+ * 8バイトを超える名前は一致した場合のみ残りを比較する。
+ * @return 対象外のタグはnullptr
+ */
+inline const TagName* lookup(const char* ptr, const char* end) noexcept {
+    const size_t available = static_cast<size_t>(end - ptr);
+    uint64_t word;
+    if (std::endian::native == std::endian::little && available >= 8) {
+        std::memcpy(&word, ptr, 8);  // 1回のロードにまとめる
+    } else {
+        word = load_word(ptr, available);
+    }
+    const uint64_t key = tag_key(word);
+    const Slot& slot = SLOTS[slot_of(key, MULTIPLIER)];
+    if (slot.key != key || slot.index == EMPTY_SLOT)
+        return nullptr;
+    const TagName& t = TAGS[slot.index];
+    if (t.name.size() > 8 &&
+        (available < t.name.size() || std::memcmp(ptr + 8, t.name.data() + 8, t.name.size() - 8)))
+        return nullptr;
+    return &t;
+}
+
+}  // namespace tags
+
 class FastFGDParser {
    public:
     struct ParsedData {
@@ -33,6 +178,7 @@ class FastFGDParser {
         std::string mesh_code;
         std::string dem_type;
         std::vector<double> elevation_list;
+        std::vector<uint8_t> surface_classes;  // 各行の SurfaceClass (with_classes の場合のみ)
 
         // 見つかったものを追跡するフラグ
         bool has_lower_corner = false;
@@ -49,13 +195,14 @@ class FastFGDParser {
      *
      * @param xml 完全なXMLコンテンツ
      * @param sea_at_zero -9999の海域値を0に変換
+     * @param with_classes 各行の種別を surface_classes に格納
      * @return パースされたデータ、または重大なエラー時にstd::nullopt
      */
-    static auto parse_all(std::string_view xml,
-                          bool sea_at_zero = true) -> std::optional<ParsedData> {
+    static auto parse_all(std::string_view xml, bool sea_at_zero = true,
+                          bool with_classes = false) -> std::optional<ParsedData> {
+        stats::ScopedTimer timer(stats::Stage::Parse);
         ParsedData data;
 
-        const char* ptr = xml.data();
         const char* end = xml.data() + xml.size();
 
         // パフォーマンス向上のため標高リストサイズを事前推定
@@ -63,8 +210,38 @@ class FastFGDParser {
             size_t estimated_lines = count_newlines_in_range(
                 xml.data() + tuple_start, std::min(xml.data() + tuple_start + 100000, end));
             data.elevation_list.reserve(estimated_lines);
+            if (with_classes) {
+                data.surface_classes.reserve(estimated_lines);
+            }
         }
 
+        scan(xml, data, sea_at_zero, with_classes, false);
+
+        stats::add(stats::Counter::ValuesParsed, data.elevation_list.size());
+        return data;
+    }
+
+    /**
+     * @brief tupleListより前のヘッダー部分 (範囲・格子・メッシュコード・種別) のみをパース
+     *
+     * 標高値は読まないため、エントリの先頭数KBだけを展開したバッファにも使える。
+     * startPointはtupleListの後にあるため取得されない。
+     */
+    static auto parse_header(std::string_view xml) -> ParsedData {
+        ParsedData data;
+        scan(xml, data, false, false, true);
+        return data;
+    }
+
+   private:
+    /**
+     * @brief タグを順に走査して値を取り出す (header_only の場合はtupleListの手前で終了)
+     */
+    static void scan(std::string_view xml, ParsedData& data, bool sea_at_zero, bool with_classes,
+                     bool header_only) {
+        const char* ptr = xml.data();
+        const char* end = xml.data() + xml.size();
+
         // SIMD最適化検索を使用してXMLを1パスで処理
         while (ptr < end) {
             // SIMDを使用して次の'<'文字を検索
@@ -74,48 +251,65 @@ class FastFGDParser {
 
             ++ptr;  // '<'をスキップ
 
-            // 見つかったタグを確認
-            if (starts_with(ptr, end, "gml:lowerCorner>")) {
-                ptr = parse_double_pair(ptr + 16, end, data.lower_corner_x, data.lower_corner_y);
-                data.has_lower_corner = true;
-            } else if (starts_with(ptr, end, "gml:upperCorner>")) {
-                ptr = parse_double_pair(ptr + 16, end, data.upper_corner_x, data.upper_corner_y);
-                data.has_upper_corner = true;
-            } else if (starts_with(ptr, end, "gml:low>")) {
-                ptr = parse_int_pair(ptr + 8, end, data.grid_low_x, data.grid_low_y);
-            } else if (starts_with(ptr, end, "gml:high>")) {
-                ptr = parse_int_pair(ptr + 9, end, data.grid_high_x, data.grid_high_y);
-                data.has_grid_envelope = true;  // lowとhighの両方が揃った後に設定
-            } else if (starts_with(ptr, end, "gml:startPoint>")) {
-                ptr = parse_double_pair(ptr + 15, end, data.start_x, data.start_y);
-                data.has_start_point = true;
-            } else if (starts_with(ptr, end, "mesh>")) {
-                ptr = parse_simple_text(ptr + 5, end, data.mesh_code);
-                data.has_mesh_code = true;
-            } else if (starts_with(ptr, end, "type>")) {
-                ptr = parse_simple_text(ptr + 5, end, data.dem_type);
-                data.has_dem_type = true;
-            } else if (starts_with(ptr, end, "gml:tupleList>")) {
-                ptr = parse_tuple_list(ptr + 14, end, data.elevation_list, sea_at_zero);
-                data.has_tuple_list = true;
-                // tupleListは通常最後なので、すべて揃っていれば早期終了可能
-                if (data.has_lower_corner && data.has_upper_corner && data.has_grid_envelope &&
-                    data.has_start_point) {
+            // 見つかったタグを確認 (対象外のタグは1回の比較で除外)
+            const tags::TagName* tag = tags::lookup(ptr, end);
+            if (!tag)
+                continue;
+            ptr += tag->name.size();
+
+            switch (tag->tag) {
+                case tags::Tag::LowerCorner:
+                    ptr = parse_double_pair(ptr, end, data.lower_corner_x, data.lower_corner_y);
+                    data.has_lower_corner = true;
+                    break;
+                case tags::Tag::UpperCorner:
+                    ptr = parse_double_pair(ptr, end, data.upper_corner_x, data.upper_corner_y);
+                    data.has_upper_corner = true;
+                    break;
+                case tags::Tag::Low:
+                    ptr = parse_int_pair(ptr, end, data.grid_low_x, data.grid_low_y);
+                    break;
+                case tags::Tag::High:
+                    ptr = parse_int_pair(ptr, end, data.grid_high_x, data.grid_high_y);
+                    data.has_grid_envelope = true;  // lowとhighの両方が揃った後に設定
+                    break;
+                case tags::Tag::StartPoint:
+                    ptr = parse_double_pair(ptr, end, data.start_x, data.start_y);
+                    data.has_start_point = true;
+                    break;
+                case tags::Tag::Mesh:
+                    ptr = parse_simple_text(ptr, end, data.mesh_code);
+                    data.has_mesh_code = true;
+                    break;
+                case tags::Tag::Type:
+                    ptr = parse_simple_text(ptr, end, data.dem_type);
+                    data.has_dem_type = true;
+                    break;
+                case tags::Tag::RangeParameters:
+                    ptr = skip_subtree(ptr, end, "</gml:rangeParameters>");
+                    break;
+                case tags::Tag::TupleList:
+                    if (header_only)
+                        return;
+                    ptr = parse_tuple_list(ptr, end, data.elevation_list, sea_at_zero,
+                                           with_classes ? &data.surface_classes : nullptr);
+                    data.has_tuple_list = true;
+                    // tupleListは通常最後なので、すべて揃っていれば早期終了可能
+                    if (data.has_lower_corner && data.has_upper_corner &&
+                        data.has_grid_envelope && data.has_start_point) {
+                        return;
+                    }
                     break;
-                }
             }
         }
-
-        return data;
     }
 
-   private:
     /**
-     * @brief ptrがpatternで始まるか確認
+     * @brief 値を含まない部分木を閉じタグの直後まで読み飛ばす (閉じタグがなければ終端)
      */
-    static bool starts_with(const char* ptr, const char* end, const char* pattern) {
-        size_t len = std::strlen(pattern);
-        return static_cast<size_t>(end - ptr) >= len && std::memcmp(ptr, pattern, len) == 0;
+    static const char* skip_subtree(const char* ptr, const char* end, std::string_view close) {
+        const size_t pos = std::string_view(ptr, end - ptr).find(close);
+        return pos == std::string_view::npos ? end : ptr + pos + close.size();
     }
 
     /**
@@ -236,7 +430,8 @@ class FastFGDParser {
      * フォーマット: "地表面,586.18\n地表面,587.37\n..."
      */
     static const char* parse_tuple_list(const char* ptr, const char* end,
-                                        std::vector<double>& elevation_list, bool sea_at_zero) {
+                                        std::vector<double>& elevation_list, bool sea_at_zero,
+                                        std::vector<uint8_t>* surface_classes) {
         // 先頭の空白/改行をスキップ
         while (ptr < end && (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t')) {
             ++ptr;
@@ -253,8 +448,11 @@ class FastFGDParser {
             if (!comma || comma >= end)
                 break;
 
-            // 海域判定用に種別を抽出
-            std::string_view type(ptr, comma - ptr);
+            // 種別を分類 (海域・データなしの判定と種別バンド用)
+            const SurfaceClass surface_class = classify_surface(std::string_view(ptr, comma - ptr));
+            if (surface_classes) {
+                surface_classes->push_back(static_cast<uint8_t>(surface_class));
+            }
 
             // カンマの次へ移動
             const char* value_start = comma + 1;
@@ -280,12 +478,7 @@ class FastFGDParser {
 #endif
 
             if (parse_ok) {
-                // 必要に応じて海域ポイントを処理
-                if (sea_at_zero && value <= -9999.0 && is_sea_type(type)) {
-                    elevation_list.push_back(0.0);
-                } else {
-                    elevation_list.push_back(value);
-                }
+                elevation_list.push_back(surface_elevation(surface_class, value, sea_at_zero));
             } else {
                 // パースエラー - デフォルト値をプッシュ
                 elevation_list.push_back(-9999.0);
@@ -301,13 +494,6 @@ class FastFGDParser {
         return ptr;
     }
 
-    /**
-     * @brief 種別が海域ポイントを示すか確認
-     */
-    static bool is_sea_type(std::string_view type) {
-        return type == "海水面" || type == "海水底面";
-    }
-
     /**
      * @brief より良い事前割り当てのために改行数をカウント
      */
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "rgb_encoding.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief メモリ上変換APIのオプション
+ */
+struct ConvertOptions {
+    std::string epsg{"EPSG:4326"};  // convert_to_geotiffの出力座標系
+    bool rgbify{false};             // Terrain-RGBでエンコード (convert_to_geotiffのみ)
+    RgbEncoding rgb_encoding{RgbEncoding::Mapbox};
+    bool sea_at_zero{true};         // 海面 (-9999) を0mとして扱う
+};
+
+/**
+ * @brief 結合済みの標高ラスター (EPSG:4326、行優先)
+ */
+struct Raster {
+    std::vector<float> data;
+    int width{};
+    int height{};
+    std::array<double, 6> geo_transform{};  // [左上X, ピクセル幅, 0, 左上Y, 0, -ピクセル高さ]
+    float nodata{-9999.0f};
+};
+
+/**
+ * @brief FGD DEM (ZIPまたはXML) をメモリ上で標高ラスターへ変換
+ *
+ * 入力がZIP (PKシグネチャ) の場合は内包するXMLを読み込み、ネストしたZIPも再帰的に展開する。
+ * それ以外は単一のXML文書として扱う。一時ファイルは作成しない。
+ *
+ * @param input ZIPまたはXMLのバイト列
+ * @return 変換結果、失敗時はstd::nullopt (ecに理由を設定)
+ */
+[[nodiscard]] auto convert_to_raster(std::span<const uint8_t> input, const ConvertOptions& options,
+                                     std::error_code& ec) -> std::optional<Raster>;
+
+/**
+ * @brief FGD DEM (ZIPまたはXML) をメモリ上でGeoTIFFへ変換
+ *
+ * @return GeoTIFFのバイト列、失敗時はstd::nullopt (ecに理由を設定)
+ */
+[[nodiscard]] auto convert_to_geotiff(std::span<const uint8_t> input, const ConvertOptions& options,
+                                      std::error_code& ec) -> std::optional<std::vector<uint8_t>>;
+
+}  // namespace fgd_converter
@@ -0,0 +1,45 @@
+#ifndef FGD_DEM_C_H
+#define FGD_DEM_C_H
+
+/*
+ * fgd_dem C API
+ *
+ * C++以外の言語 (Python ctypes, Rust FFI など) から呼び出すための薄いラッパー。
+ * 戻り値は成功時0、失敗時はstd::error_codeの値 (errno相当)。
+ * 出力バッファはfgd_dem_free()で解放すること。
+ * 出力が0バイトの場合は成功 (0) を返し、バッファはNULLとなる (fgd_dem_free(NULL)は何もしない)。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct fgd_dem_options {
+    const char* epsg; /* NULLの場合は"EPSG:4326" */
+    int rgbify;       /* 0以外でTerrain-RGBエンコード */
+    int sea_at_zero;  /* 0以外で海面を0mとして扱う */
+} fgd_dem_options;
+
+/* ZIPまたはXMLのバイト列をGeoTIFFへ変換 */
+int fgd_dem_convert_to_geotiff(const uint8_t* input, size_t input_size,
+                               const fgd_dem_options* options, uint8_t** out, size_t* out_size);
+
+/* ZIPまたはXMLのバイト列をfloat標高ラスター (EPSG:4326、行優先、nodata=-9999) へ変換 */
+int fgd_dem_convert_to_raster(const uint8_t* input, size_t input_size,
+                              const fgd_dem_options* options, float** data, int* width,
+                              int* height, double geo_transform[6]);
+
+/* 変換関数が確保したバッファを解放 */
+void fgd_dem_free(void* ptr);
+
+/* エラーコードの説明文 (静的領域、スレッドローカル) */
+const char* fgd_dem_error_message(int code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FGD_DEM_C_H */
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace fgd_converter::synth {
+
+/**
+ * @brief 合成FGD DEMデータセットの設定
+ *
+ * 同じ設定からは常に同じXML・ZIPが生成される (乱数は seed とメッシュコードのみから決まる)。
+ */
+struct SynthConfig {
+    std::string dem_type{"5A"};    // 5A / 5B (3次メッシュ単位)、10A / 10B (2次メッシュ単位)
+    int mesh_count{1};             // 生成するメッシュ数
+    double origin_lat{35.0};       // 南西端のメッシュを含む緯度
+    double origin_lng{139.0};      // 南西端のメッシュを含む経度
+    uint64_t seed{1};              // 地形・欠測域の乱数シード
+    double sea_ratio{0.15};        // 海域になる面積のおおよその割合 (0-1)
+    double nodata_ratio{0.05};     // 測量範囲外 (データなし) のおおよその割合 (0-1)
+    double partial_ratio{0.25};    // 北西側が測量範囲外で startPoint が0以外になるメッシュの割合
+    std::string date{"20240101"};  // ファイル名に付ける8桁の日付
+};
+
+/**
+ * @brief 書き出したデータセットの概要
+ */
+struct SynthSummary {
+    size_t mesh_count{};                          // XMLファイル数
+    size_t inner_archive_count{};                 // 内側ZIPの数
+    size_t xml_bytes{};                           // XMLの合計サイズ (非圧縮)
+    std::vector<std::filesystem::path> archives;  // 書き出した外側ZIP
+};
+
+/**
+ * @brief DEM種別ごとの格子サイズ (列数, 行数)
+ *
+ * 5A/5B は3次メッシュを 225×150、10A/10B は2次メッシュを 1125×750 で覆う。
+ * @return 未対応の種別はstd::nullopt
+ */
+[[nodiscard]] auto grid_shape(std::string_view dem_type) -> std::optional<std::pair<int, int>>;
+
+/**
+ * @brief 生成対象のメッシュコードを列挙
+ *
+ * origin を含むメッシュから東へ並べ、ほぼ正方形になるよう北へ折り返す。
+ * メッシュ体系の範囲外に出るものは含めない。
+ */
+[[nodiscard]] auto mesh_codes(const SynthConfig& config) -> std::vector<std::string>;
+
+/**
+ * @brief 1メッシュ分のFGD DEM XMLを生成
+ *
+ * 標高は経緯度の関数 (fBmノイズ) として計算するため、隣接メッシュの境界で連続する。
+ * 0m未満の領域は「海水面,-9999.」、測量範囲外は「データなし,-9999.」として出力し、
+ * 先頭と末尾のデータなしは実データと同様に tupleList から省いて startPoint で位置を示す。
+ * partial_ratio > 0 の場合、南西端のメッシュは必ず北西側が欠けた (startPoint が0以外の) 形になる。
+ *
+ * @return メッシュコードまたは種別が不正な場合はstd::nullopt
+ */
+[[nodiscard]] auto make_fgd_xml(std::string_view mesh_code,
+                                const SynthConfig& config) -> std::optional<std::string>;
+
+/**
+ * @brief 合成データセットを基盤地図情報のダウンロード形式 (二重ZIP) で書き出す
+ *
+ * 1次メッシュごとの外側ZIP "PackDLMap-<1次メッシュ>-DEM<種別>.zip" の中に内側ZIP
+ * (5mは2次メッシュ単位 "FG-GML-533945-DEM5A-20240101.zip"、10mは1次メッシュ単位) を格納し、
+ * その中に各メッシュのXMLを置く。内側ZIPの作成 (XML生成とDeflate圧縮) はTBBで並列に行い、
+ * 外側ZIPへはメッシュコード順に書き込むため、出力はスレッド数によらず同一になる。
+ *
+ * @param output_dir 出力先ディレクトリ (存在しなければ作成)
+ */
+[[nodiscard]] auto write_dataset(const std::filesystem::path& output_dir,
+                                 const SynthConfig& config,
+                                 std::error_code& ec) -> std::optional<SynthSummary>;
+
+}  // namespace fgd_converter::synth
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace fgd_converter {
+
+/**
+ * @brief 値を1つずつ生成するC++20コルーチン (範囲forで列挙する)
+ *
+ * co_yield した値への参照を次の要素へ進むまで保持するだけで、値のコピーや蓄積は行わない。
+ * コルーチン内の例外は begin() または ++ の呼び出し元へ再送出する。
+ */
+template <typename T>
+class Generator {
+   public:
+    struct promise_type {
+        const T* current = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object() noexcept {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        // co_yield の一時オブジェクトは再開されるまで生存する
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = std::addressof(value);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+
+        // co_await は使用しない
+        template <typename U>
+        std::suspend_never await_transform(U&&) = delete;
+    };
+
+    class iterator {
+       public:
+        using iterator_category = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = T;
+
+        iterator() noexcept = default;
+        explicit iterator(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+        const T& operator*() const noexcept { return *handle_.promise().current; }
+        const T* operator->() const noexcept { return handle_.promise().current; }
+
+        iterator& operator++() {
+            advance(handle_);
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        friend bool operator==(const iterator& it, std::default_sentinel_t) noexcept {
+            return !it.handle_ || it.handle_.done();
+        }
+
+       private:
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    Generator(Generator&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    ~Generator() { destroy(); }
+
+    /**
+     * @brief 最初の要素まで実行 (1回のみ呼び出せる)
+     */
+    [[nodiscard]] iterator begin() {
+        advance(handle_);
+        return iterator(handle_);
+    }
+    [[nodiscard]] std::default_sentinel_t end() const noexcept { return {}; }
+
+   private:
+    explicit Generator(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    static void advance(std::coroutine_handle<promise_type> handle) {
+        if (!handle || handle.done())
+            return;
+        handle.resume();
+        if (handle.promise().exception) {
+            std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+        }
+    }
+
+    void destroy() noexcept {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+}  // namespace fgd_converter
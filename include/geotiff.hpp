@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <span>
@@ -8,6 +9,9 @@
 #include <system_error>
 #include <vector>
 
+#include "raster_kernels.hpp"
+#include "validity_mask.hpp"
+
 namespace fgd_converter {
 
 class GeoTiff {
@@ -18,6 +22,9 @@ class GeoTiff {
         int x_length;
         int y_length;
         std::filesystem::path output_path;
+        RgbEncoding rgb_encoding{RgbEncoding::Mapbox};  // rgbify時のエンコード方式
+        // np_array の有効ピクセル (再投影でデータなしの行を飛ばす)。nullptrなら値から求める
+        const ValidityMask* valid{nullptr};
     };
 
     explicit GeoTiff(Config config);
@@ -32,6 +39,14 @@ class GeoTiff {
     [[nodiscard]] bool create(std::string_view output_epsg, bool rgbify, std::error_code& ec);
     [[nodiscard]] bool resampling(std::string_view output_epsg, std::error_code& ec);
 
+    /**
+     * @brief ファイルを介さずGeoTIFFをメモリ上に生成 (出力CRSへの再投影を含む)
+     *
+     * @param out 生成したGeoTIFFのバイト列
+     */
+    [[nodiscard]] bool encode(std::string_view output_epsg, bool rgbify, std::vector<uint8_t>& out,
+                              std::error_code& ec);
+
    private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
@@ -45,8 +60,33 @@ struct MergeConfig {
     std::string dem_type;               // "1A", "5A", "5B", "5C", "10A", "10B" など
     double resolution;                  // 出力解像度（メートル）
     std::filesystem::path output_file;  // 空の場合は自動生成
+    // マージするTIFファイル (カタログから作成)。空の場合は input_folder を走査する
+    std::vector<std::filesystem::path> input_files;
 };
 
 [[nodiscard]] bool merge_tif_files(const MergeConfig& config, std::error_code& ec);
 
+/**
+ * @brief float単バンドのラスター (EPSG:4326) をGeoTIFFとして書き出す (必要に応じて再投影)
+ *
+ * 傾斜・陰影起伏などの派生バンドを、標高GeoTIFFと同じ出力CRSでサイドカー出力する際に使用する。
+ *
+ * @param nearest 最近傍で再投影する (斜面方位のように補間すると意味が変わる値の場合)
+ */
+[[nodiscard]] bool write_float_geotiff(const std::filesystem::path& path,
+                                       std::span<const float> data, int width, int height,
+                                       const std::array<double, 6>& geo_transform, float nodata,
+                                       std::string_view output_epsg, std::error_code& ec,
+                                       bool nearest = false);
+
+/**
+ * @brief 種別ラスター (SurfaceClass、EPSG:4326) を8bitのGeoTIFFとして書き出す
+ *
+ * 再投影は最近傍で行い、NODATA値は SURFACE_CLASS_NODATA (0)。
+ */
+[[nodiscard]] bool write_class_geotiff(const std::filesystem::path& path,
+                                       std::span<const uint8_t> data, int width, int height,
+                                       const std::array<double, 6>& geo_transform,
+                                       std::string_view output_epsg, std::error_code& ec);
+
 }  // namespace fgd_converter
\ No newline at end of file
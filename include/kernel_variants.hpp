@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "raster_kernels.hpp"
+
+/**
+ * 命令セット別のカーネル実装 (ライブラリ内部用)
+ *
+ * 各名前空間の関数は対応する命令セットを有効にした翻訳単位 (raster_kernels_<isa>.cpp) で
+ * コンパイルされ、raster_kernels.cpp・terrain.cpp が cpu::active() に応じて呼び分ける。
+ * ベクトル化した関数は処理した要素数 (またはx座標) を返し、端数は呼び出し側のスカラー処理が扱う。
+ * x86_64以外では定義されないため、呼び出しは FGD_DEM_X86_KERNELS が1の場合に限る。
+ *
+ * 命令セット別の翻訳単位では標準ライブラリ等のインライン関数を使わないこと
+ * (リンカーが拡張命令でコンパイルされた実体を全体で共有し、非対応CPUで不正命令になるため)。
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define FGD_DEM_X86_KERNELS 1
+#else
+#    define FGD_DEM_X86_KERNELS 0
+#endif
+
+namespace fgd_converter::kernels {
+
+inline constexpr double NO_DATA = -9999.0;        // データなし (RGBは-9999以下を標高0mとする)
+inline constexpr int32_t RGB_MAX_VALUE = 0xFFFFFF;
+inline constexpr double RGB_SCALED_LIMIT = 16777216.0;  // int32変換前の範囲制限 (2^24)
+
+/**
+ * @brief エンコード方式ごとの固定小数点化パラメータ
+ *
+ * 24bit値 q = 整数化(height * scale) + offset を R = q >> 16, G = (q >> 8) & 0xFF,
+ * B = q & 0xFF に分解する。両方式とも同じ分解で表せるため、カーネルは共通。
+ */
+struct EncodingParams {
+    double scale;
+    int32_t offset;
+    bool use_floor;  // Terrariumは床関数、Mapboxは従来どおり0方向への切り捨て
+};
+
+constexpr EncodingParams params_for(RgbEncoding encoding) {
+    return encoding == RgbEncoding::Terrarium ? EncodingParams{256.0, 32768 * 256, true}
+                                              : EncodingParams{10.0, 100000, false};
+}
+
+/**
+ * @brief 陰影起伏の光源パラメータ (事前計算)
+ */
+struct Illumination {
+    double cos_zenith;
+    double sin_zenith;
+    double cos_azimuth;
+    double sin_azimuth;
+};
+
+namespace sse42 {
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+}  // namespace sse42
+
+namespace avx2 {
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+
+/**
+ * @brief resample_bilinear_row の4画素ずつのギャザー版 (入力が2^31画素以上の場合は0を返す)
+ */
+size_t resample_bilinear_row(const float* src, int src_width, int src_height,
+                             const double* src_cols, const double* src_rows, size_t count,
+                             bool has_nodata, float nodata, float* dst) noexcept;
+
+/**
+ * @brief Horn法の勾配を x から4画素ずつ計算 (右端の1画素は含めない)
+ * @return 次に処理するx座標
+ */
+int row_gradients(const double* up, const double* mid, const double* down, int x, int width,
+                  double inv_8dx, double inv_8dy, double* gx, double* gy,
+                  uint8_t* valid) noexcept;
+
+/**
+ * @brief 陰影起伏を4画素ずつ計算 (valid[x]==0の画素はTerrainBands::NO_DATA)
+ * @return 次に処理するx座標
+ */
+int row_hillshade(const double* gx, const double* gy, const uint8_t* valid, int width,
+                  const Illumination& light, float* out) noexcept;
+}  // namespace avx2
+
+namespace avx512 {
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept;
+}  // namespace avx512
+
+}  // namespace fgd_converter::kernels
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+#include "dem.hpp"
+#include "zip_handler.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief キャッシュから読み込んだパース済みメッシュ
+ */
+struct CachedMesh {
+    Metadata metadata;
+    std::vector<std::vector<double>> grid;  // Dem::get_np_array と同じ配置 (-9999.0はデータなし)
+};
+
+/**
+ * @brief パース済みメッシュのバイナリキャッシュ
+ *
+ * ZIPエントリのCRC-32と展開後サイズをキーに、メタデータと標高格子を1ファイルに保存する。
+ * 2回目以降の実行ではXMLの展開・パースを行わずにメモリマップで読み込む。
+ *
+ * ファイル形式 (リトルエンディアン、`<crc32>-<size>.fgdmesh`):
+ * - 128バイトの固定ヘッダー (マジック・版・フラグ・キー・メタデータ・格子の形状と符号化)
+ * - メッシュコード・DEM種別の文字列 (8バイト境界まで0埋め)
+ * - 標高格子 (int16 / float32 / float64、任意でzlib圧縮)
+ *
+ * 格子は値が元の倍精度値へ完全に戻る最小の型で保存する (int16は0.01m・0.1m・1m単位の整数差分、
+ * データなしは-32768)。そのため出力はXMLからパースした場合と一致する。
+ * 壊れたファイル・版の異なるファイルはキャッシュミスとして扱い、次の保存で上書きする。
+ */
+class MeshCache {
+   public:
+    struct Config {
+        std::filesystem::path directory;
+        bool compress{false};  // 標高格子をzlibで圧縮する
+    };
+
+    /**
+     * @brief キャッシュディレクトリを開く (存在しない場合は作成)
+     */
+    explicit MeshCache(Config config);
+
+    /**
+     * @brief エントリに対応するキャッシュファイルのパス
+     */
+    [[nodiscard]] auto path_for(const zip::EntryInfo& entry) const -> std::filesystem::path;
+
+    /**
+     * @brief キャッシュからメッシュを読み込む
+     *
+     * @return キャッシュがない・キーが一致しない・壊れている場合はstd::nullopt
+     */
+    [[nodiscard]] auto load(const zip::EntryInfo& entry, bool sea_at_zero) const
+        -> std::optional<CachedMesh>;
+
+    /**
+     * @brief パース済みメッシュを保存 (一時ファイルへ書き込んでから置き換える)
+     */
+    [[nodiscard]] bool store(const zip::EntryInfo& entry, bool sea_at_zero,
+                             const Metadata& metadata,
+                             const std::vector<std::vector<double>>& grid,
+                             std::error_code& ec) const;
+
+    [[nodiscard]] auto directory() const noexcept -> const std::filesystem::path& {
+        return config_.directory;
+    }
+
+   private:
+    Config config_;
+};
+
+}  // namespace fgd_converter
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "dem.hpp"
+#include "zip_handler.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief カタログの1レコード (XMLエントリ1つ分、ファイル上の配置そのもの)
+ *
+ * 文字列は文字列表のオフセットで参照する (0は空文字列)。
+ */
+struct CatalogRecord {
+    uint64_t offset{};               // ローカルヘッダーのオフセット (ZIP外のXMLは0)
+    uint64_t compressed_size{};      // 圧縮後のバイト数
+    uint64_t uncompressed_size{};    // 展開後のバイト数
+    BoundsLatLng bounds{};           // XMLヘッダーの範囲 (読めない場合はメッシュコードから算出)
+    uint32_t mesh_code{};            // メッシュコードの数値 (例: 53394500)
+    uint32_t date{};                 // 測量日 YYYYMMDD (ファイル名に日付がない場合は0)
+    uint32_t crc32{};                // 展開後データのCRC-32 (ZIP外のXMLは0)
+    uint32_t archive{};              // 入力のZIPまたはXMLファイルのパス
+    uint32_t nested{};               // ネストしたZIPのエントリ名 (直下の場合は空)
+    uint32_t entry{};                // XMLのエントリ名 (入力自体がXMLの場合は空)
+    uint8_t mesh_digits{};           // メッシュコードの桁数 (4/6/8)
+    std::array<char, 7> dem_type{};  // DEM種別 (例: "5A"、残りは0埋め)
+};
+
+static_assert(sizeof(CatalogRecord) == 88);
+static_assert(std::is_trivially_copyable_v<CatalogRecord>);
+
+/**
+ * @brief 同じZIP (ネストしたZIPを含む) に属するレコードのまとまり
+ */
+struct CatalogSource {
+    std::filesystem::path archive;              // 入力のZIPまたはXMLファイル
+    std::string nested;                         // ネストしたZIPのエントリ名 (直下の場合は空)
+    std::vector<const CatalogRecord*> records;  // エントリ名順
+};
+
+/**
+ * @brief 全入力アーカイブのメッシュ索引
+ *
+ * ZIPのセントラルディレクトリと、各XMLの先頭数KBだけを展開したヘッダーから作成する。
+ * 変換・地点検索・範囲指定 (--bbox)・マージは索引を参照し、フォルダやアーカイブを走査しない。
+ *
+ * ファイル形式 (リトルエンディアン、`.fgdcat`):
+ * - 64バイトの固定ヘッダー (マジック・版・レコードサイズ・レコード数・文字列表のサイズ)
+ * - CatalogRecord の配列 (メッシュコード→DEM種別→日付の新しい順)
+ * - 文字列表 (0終端の文字列の連結、先頭は空文字列)
+ *
+ * 読み込みはメモリマップとヘッダーの検証のみで、レコードはマップした領域を直接参照する。
+ */
+class MeshCatalog {
+   public:
+    /**
+     * @brief 入力 (ZIP・XMLファイルまたはそれらを含むフォルダ) を走査してカタログを作成
+     *
+     * ネストしたZIPはメモリ上に読み込んでセントラルディレクトリを取得する。
+     * 読み込めないアーカイブは警告を出して除外する。
+     * @return FGD DEMのXMLが1つもない場合はstd::nullopt
+     */
+    [[nodiscard]] static auto build(std::span<const std::filesystem::path> inputs,
+                                    std::error_code& ec) -> std::optional<MeshCatalog>;
+
+    /**
+     * @brief カタログファイルをメモリマップで開く (形式が不正な場合は例外)
+     */
+    explicit MeshCatalog(const std::filesystem::path& path);
+    ~MeshCatalog();
+
+    MeshCatalog(const MeshCatalog&) = delete;
+    MeshCatalog& operator=(const MeshCatalog&) = delete;
+    MeshCatalog(MeshCatalog&&) noexcept;
+    MeshCatalog& operator=(MeshCatalog&&) noexcept;
+
+    /**
+     * @brief カタログをファイルに保存 (一時ファイルへ書き込んでから置き換える)
+     */
+    [[nodiscard]] bool save(const std::filesystem::path& path, std::error_code& ec) const;
+
+    [[nodiscard]] auto records() const noexcept -> std::span<const CatalogRecord>;
+
+    /**
+     * @brief メッシュコードが一致するレコード (DEM種別→日付の新しい順)
+     */
+    [[nodiscard]] auto find(std::string_view mesh_code) const -> std::span<const CatalogRecord>;
+
+    /**
+     * @brief 範囲と重なるレコードを選択 (std::nulloptの場合は全レコード)
+     */
+    [[nodiscard]] auto select(const std::optional<BoundsLatLng>& bounds = std::nullopt) const
+        -> std::vector<const CatalogRecord*>;
+
+    /**
+     * @brief 同じメッシュ・DEM種別のレコードのうち最新版 (日付が最大) のみを残す
+     *
+     * 日付も同じ場合はアーカイブのパス順で先のものを残す。結果は入力順。
+     */
+    [[nodiscard]] auto latest(std::span<const CatalogRecord* const> records) const
+        -> std::vector<const CatalogRecord*>;
+
+    /**
+     * @brief レコードを所属するZIPごとにまとめる (アーカイブのパス→ネストしたZIPの名前順)
+     */
+    [[nodiscard]] auto sources(std::span<const CatalogRecord* const> records) const
+        -> std::vector<CatalogSource>;
+
+    [[nodiscard]] auto archive_path(const CatalogRecord& record) const -> std::filesystem::path;
+    [[nodiscard]] auto nested_name(const CatalogRecord& record) const -> std::string_view;
+    [[nodiscard]] auto entry_name(const CatalogRecord& record) const -> std::string_view;
+
+    /**
+     * @brief レコードをZIPエントリ情報に変換 (Dem・MeshCacheへ渡す用)
+     */
+    [[nodiscard]] auto entry_info(const CatalogRecord& record) const -> zip::EntryInfo;
+
+    /**
+     * @brief 桁数を保った10進のメッシュコード (例: "53394500")
+     */
+    [[nodiscard]] static auto mesh_code(const CatalogRecord& record) -> std::string;
+    [[nodiscard]] static auto dem_type(const CatalogRecord& record) -> std::string_view;
+
+   private:
+    MeshCatalog();
+
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+}  // namespace fgd_converter
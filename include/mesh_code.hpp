@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "dem.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief 標準地域メッシュ (JIS X 0410) の計算ユーティリティ
+ *
+ * - 1次メッシュ: 緯度40分 × 経度1度 (4桁: 緯度×1.5, 経度-100)
+ * - 2次メッシュ: 1次メッシュを8×8分割 (6桁、10m DEMの単位)
+ * - 3次メッシュ: 2次メッシュを10×10分割 (8桁、5m DEMの単位)
+ */
+namespace mesh {
+
+inline constexpr double LAT_1ST = 2.0 / 3.0;
+inline constexpr double LNG_1ST = 1.0;
+inline constexpr double LAT_2ND = LAT_1ST / 8.0;
+inline constexpr double LNG_2ND = LNG_1ST / 8.0;
+inline constexpr double LAT_3RD = LAT_2ND / 10.0;
+inline constexpr double LNG_3RD = LNG_2ND / 10.0;
+
+/**
+ * @brief 緯度経度を含むメッシュコードを計算
+ *
+ * @param level 2 (6桁) または 3 (8桁)
+ * @return メッシュコード、範囲外 (日本のメッシュ体系外) の場合はstd::nullopt
+ */
+[[nodiscard]] inline auto from_latlng(double lat, double lng,
+                                      int level) -> std::optional<std::string> {
+    if (level < 1 || level > 3 || !std::isfinite(lat) || !std::isfinite(lng))
+        return std::nullopt;
+
+    // 浮動小数点誤差で境界上の点が隣接メッシュに落ちないよう微小値を加算
+    constexpr double eps = 1e-9;
+    double lat15 = lat * 1.5 + eps;
+    double lng100 = lng - 100.0 + eps;
+
+    int p = static_cast<int>(std::floor(lat15));
+    int u = static_cast<int>(std::floor(lng100));
+    if (p < 0 || p > 99 || u < 0 || u > 99)
+        return std::nullopt;
+
+    std::string code;
+    code.reserve(8);
+    code += static_cast<char>('0' + p / 10);
+    code += static_cast<char>('0' + p % 10);
+    code += static_cast<char>('0' + u / 10);
+    code += static_cast<char>('0' + u % 10);
+    if (level == 1)
+        return code;
+
+    double lat_rem = (lat15 - p) * 8.0;
+    double lng_rem = (lng100 - u) * 8.0;
+    int q = std::min(static_cast<int>(std::floor(lat_rem)), 7);
+    int v = std::min(static_cast<int>(std::floor(lng_rem)), 7);
+    code += static_cast<char>('0' + q);
+    code += static_cast<char>('0' + v);
+    if (level == 2)
+        return code;
+
+    int r = std::min(static_cast<int>(std::floor((lat_rem - q) * 10.0)), 9);
+    int w = std::min(static_cast<int>(std::floor((lng_rem - v) * 10.0)), 9);
+    code += static_cast<char>('0' + r);
+    code += static_cast<char>('0' + w);
+    return code;
+}
+
+/**
+ * @brief メッシュコード (4/6/8桁) の緯度経度範囲を計算
+ */
+[[nodiscard]] inline auto bounds(std::string_view code) -> std::optional<BoundsLatLng> {
+    if (code.size() != 4 && code.size() != 6 && code.size() != 8)
+        return std::nullopt;
+    for (char c : code) {
+        if (c < '0' || c > '9')
+            return std::nullopt;
+    }
+    auto digit = [&](size_t i) { return code[i] - '0'; };
+
+    double lat = (digit(0) * 10 + digit(1)) * LAT_1ST;
+    double lng = (digit(2) * 10 + digit(3)) + 100.0;
+    double lat_size = LAT_1ST;
+    double lng_size = LNG_1ST;
+
+    if (code.size() >= 6) {
+        if (digit(4) > 7 || digit(5) > 7)
+            return std::nullopt;
+        lat += digit(4) * LAT_2ND;
+        lng += digit(5) * LNG_2ND;
+        lat_size = LAT_2ND;
+        lng_size = LNG_2ND;
+    }
+    if (code.size() == 8) {
+        lat += digit(6) * LAT_3RD;
+        lng += digit(7) * LNG_3RD;
+        lat_size = LAT_3RD;
+        lng_size = LNG_3RD;
+    }
+
+    return BoundsLatLng{
+        .min_lat = lat, .max_lat = lat + lat_size, .min_lng = lng, .max_lng = lng + lng_size};
+}
+
+/**
+ * @brief FGDファイル名から読み取れる識別情報
+ */
+struct FgdFileName {
+    std::string mesh_code;  // 区切りを除いた数字 (例: "53394500")
+    std::string dem_type;   // 大文字、"DEM"接頭辞なし (例: "5A", "10B")
+    std::string date;       // 8桁の日付 (存在しない場合は空)
+};
+
+/**
+ * @brief FGDのファイル名を解析
+ *
+ * 例: "FG-GML-5339-45-00-DEM5A-20161001.xml", "FG-GML-533945-DEM5A-20161001.zip"
+ * パスの区切りを含む場合はファイル名部分のみを対象とする。
+ */
+[[nodiscard]] inline auto parse_file_name(std::string_view name) -> std::optional<FgdFileName> {
+    if (auto slash = name.find_last_of("/\\"); slash != std::string_view::npos)
+        name.remove_prefix(slash + 1);
+
+    constexpr std::string_view prefix = "FG-GML-";
+    if (name.substr(0, prefix.size()) != prefix)
+        return std::nullopt;
+    name.remove_prefix(prefix.size());
+
+    FgdFileName result;
+    size_t i = 0;
+    while (i < name.size() && ((name[i] >= '0' && name[i] <= '9') || name[i] == '-')) {
+        if (name[i] != '-')
+            result.mesh_code += name[i];
+        ++i;
+    }
+    if (result.mesh_code.size() != 4 && result.mesh_code.size() != 6 &&
+        result.mesh_code.size() != 8)
+        return std::nullopt;
+
+    // 種別 ("DEM5A" / "dem10b")
+    if (name.size() - i < 4)
+        return std::nullopt;
+    auto upper = [](char c) {
+        return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+    };
+    if (upper(name[i]) != 'D' || upper(name[i + 1]) != 'E' || upper(name[i + 2]) != 'M')
+        return std::nullopt;
+    i += 3;
+    while (i < name.size() && name[i] != '-' && name[i] != '.') {
+        result.dem_type += upper(name[i]);
+        ++i;
+    }
+    if (result.dem_type.empty())
+        return std::nullopt;
+
+    // 日付 (任意)
+    if (i < name.size() && name[i] == '-') {
+        ++i;
+        size_t start = i;
+        while (i < name.size() && name[i] >= '0' && name[i] <= '9')
+            ++i;
+        if (i - start == 8)
+            result.date = std::string(name.substr(start, 8));
+    }
+    return result;
+}
+
+/**
+ * @brief DEM種別の優先順位 (解像度が細かいほど小さい値)
+ *
+ * 5A < 5B < 5C < 10A < 10B の順で比較できるよう、数値部分×32 + 英字オフセットを返す。
+ */
+[[nodiscard]] inline int type_rank(std::string_view dem_type) noexcept {
+    int number = 0;
+    size_t i = 0;
+    while (i < dem_type.size() && dem_type[i] >= '0' && dem_type[i] <= '9') {
+        number = number * 10 + (dem_type[i] - '0');
+        ++i;
+    }
+    int letter = (i < dem_type.size() && dem_type[i] >= 'A' && dem_type[i] <= 'Z')
+                     ? dem_type[i] - 'A'
+                     : 0;
+    return number * 32 + letter;
+}
+
+/**
+ * @brief 同じメッシュ・DEM種別の版が複数ある場合に、最新版 (日付が最大) のみを残す
+ *
+ * 展開前にファイル名だけで判定するため、古い版は展開・パース・出力されない。
+ * 日付も同じ場合は名前順で先のものを残し、入力の順序に結果が依存しないようにする。
+ * FGDのファイル名として解析できない要素はそのまま残す。
+ *
+ * @param name_of 要素からファイル名 (パスを含んでもよい) を取り出す関数
+ * @return 残した要素 (入力順)
+ */
+template <typename T, typename NameOf>
+[[nodiscard]] auto latest_versions(std::vector<T> items, NameOf name_of) -> std::vector<T> {
+    struct Best {
+        size_t index;
+        std::string date;
+        std::string name;
+    };
+    std::map<std::string, Best> best;
+    std::vector<bool> keep(items.size(), true);
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::string name(name_of(items[i]));
+        auto parsed = parse_file_name(name);
+        if (!parsed)
+            continue;
+        auto key = parsed->mesh_code + "/" + parsed->dem_type;
+        auto [it, inserted] = best.try_emplace(key, Best{i, parsed->date, name});
+        if (inserted)
+            continue;
+        auto& current = it->second;
+        if (std::tie(parsed->date, current.name) > std::tie(current.date, name)) {
+            keep[current.index] = false;
+            current = Best{i, parsed->date, std::move(name)};
+        } else {
+            keep[i] = false;
+        }
+    }
+
+    std::vector<T> kept;
+    kept.reserve(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (keep[i])
+            kept.push_back(std::move(items[i]));
+    }
+    return kept;
+}
+
+}  // namespace mesh
+
+}  // namespace fgd_converter
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "dem.hpp"
+#include "validity_mask.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief 複数メッシュを1枚に結合した標高ラスター (EPSG:4326)
+ */
+struct Mosaic {
+    std::vector<std::vector<double>> data;  // 行優先、未取得ピクセルは-9999
+    ValidityMask valid;                     // data の有効ピクセル
+    int x_length{};
+    int y_length{};
+    std::array<double, 6> geo_transform{};  // [左上X, ピクセル幅, 0, 左上Y, 0, -ピクセル高さ]
+};
+
+/**
+ * @brief メタデータ一覧から結合後の画像サイズを計算
+ * @return {x_length, y_length}
+ */
+[[nodiscard]] auto calc_mosaic_size(span<const Metadata> meta_data_list,
+                                    const BoundsLatLng& bounds) noexcept -> std::pair<int, int>;
+
+/**
+ * @brief メッシュを1つずつ結合ラスターへ配置 (Dem::meshes() と組み合わせて使う)
+ *
+ * 画像サイズはメタデータ一覧 (Dem::scan_headers で作成したものでよい) から事前に求めるため、
+ * 配置済みのメッシュは呼び出し側ですぐに解放できる。
+ */
+class MosaicBuilder {
+   public:
+    /**
+     * @param meta_data_list 全メッシュのメタデータ (画像サイズとピクセルサイズの計算用)
+     * @param bounds 全メッシュを包含する緯度経度範囲
+     * @param with_classes 種別ラスター (take_classes) も作成する
+     */
+    MosaicBuilder(span<const Metadata> meta_data_list, const BoundsLatLng& bounds,
+                  bool with_classes = false);
+
+    /**
+     * @brief 1メッシュを配置
+     *
+     * @param mask メッシュの有効ピクセル。ビット単位で複製し、nullptr (または寸法が合わない)
+     *             の場合は配置した値から作成する
+     * @param classes メッシュの種別配列 (with_classes の場合のみ使用)
+     */
+    void place(const Metadata& metadata, span<const std::vector<double>> grid,
+               const ValidityMask* mask = nullptr, span<const uint8_t> classes = {});
+    void place(const MeshView& mesh) {
+        place(mesh.metadata, mesh.grid, &mesh.valid, mesh.classes);
+    }
+
+    /**
+     * @brief 結合したラスターを取り出す (以降の place は行わないこと)
+     */
+    [[nodiscard]] auto finish() -> Mosaic;
+
+    /**
+     * @brief 行優先の種別ラスターを取り出す (未取得ピクセルは SURFACE_CLASS_NODATA)
+     */
+    [[nodiscard]] auto take_classes() -> std::vector<uint8_t>;
+
+   private:
+    BoundsLatLng bounds_;
+    bool with_classes_;
+    int total_x_{};
+    int total_y_{};
+    double pixel_size_x_{};
+    double pixel_size_y_{};
+    std::vector<std::vector<double>> data_;
+    ValidityMask valid_;
+    std::vector<uint8_t> classes_;
+};
+
+/**
+ * @brief 各メッシュの標高配列を境界に従って1枚のラスターへ配置
+ *
+ * @param meta_data_list メッシュごとのメタデータ
+ * @param np_array_list メッシュごとの標高配列 (meta_data_listと同順)
+ * @param bounds 全メッシュを包含する緯度経度範囲
+ * @param mask_list メッシュごとの有効ピクセル (Dem::get_mask_list)。ビット単位で複製し、
+ *                  指定がない (または寸法が合わない) メッシュは配置した値から作成する
+ */
+[[nodiscard]] auto build_mosaic(span<const Metadata> meta_data_list,
+                                span<const std::vector<std::vector<double>>> np_array_list,
+                                const BoundsLatLng& bounds,
+                                span<const ValidityMask> mask_list = {}) -> Mosaic;
+
+/**
+ * @brief 各メッシュの種別配列 (Dem::get_class_array_list) を build_mosaic と同じ位置に配置
+ *
+ * @return 行優先の種別ラスター (未取得ピクセルは SURFACE_CLASS_NODATA)
+ */
+[[nodiscard]] auto build_class_mosaic(span<const Metadata> meta_data_list,
+                                      span<const std::vector<uint8_t>> class_array_list,
+                                      const BoundsLatLng& bounds) -> std::vector<uint8_t>;
+
+/**
+ * @brief 緯度経度の標高をバイリニア補間で取得
+ *
+ * 周囲4ピクセル中心から補間し、近傍にデータなしを含む場合は最近傍の値を返す。
+ * @return 標高、範囲外またはデータなしの場合は-9999
+ */
+[[nodiscard]] float sample_mosaic(const Mosaic& mosaic, double lat, double lng) noexcept;
+
+}  // namespace fgd_converter
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "xyz_tiles.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief PMTiles v3 単一ファイルアーカイブへ書き出すTileWriter
+ *
+ * タイルの内容はハッシュで重複排除し (全面海域などの同一タイルは1つに集約)、
+ * ハッシュが一致した場合は一時ファイルから読み戻したバイト列と比較してから共有する。
+ * 同じ内容が連続するタイルIDは run_length でまとめる。
+ * タイル本体は到着順に一時ファイルへ追記し、finish() でヒルベルト曲線順の
+ * ディレクトリ (ルートに収まらない場合はリーフディレクトリ) とともに本ファイルを組み立てる。
+ *
+ * write() はエンコード済みタイルを受け取るだけで、追記はミューテックスで直列化する
+ * (エンコードは呼び出し側で並列に行う)。タイル種別はPNG固定。
+ */
+class PmtilesWriter final : public TileWriter {
+   public:
+    /**
+     * @param output_path 出力する .pmtiles ファイル
+     * @param metadata_json アーカイブに格納するメタデータ (JSONオブジェクト)
+     * @throws std::runtime_error 一時ファイルを作成できない場合
+     */
+    PmtilesWriter(std::filesystem::path output_path, std::string metadata_json);
+    ~PmtilesWriter() override;
+
+    PmtilesWriter(const PmtilesWriter&) = delete;
+    PmtilesWriter& operator=(const PmtilesWriter&) = delete;
+
+    [[nodiscard]] bool write(int z, uint32_t x, uint32_t y, std::span<const uint8_t> data,
+                             std::error_code& ec) override;
+
+    [[nodiscard]] bool finish(std::error_code& ec) override;
+
+    /**
+     * @brief ズーム・タイル座標からPMTilesのタイルID (ヒルベルト曲線順) を計算
+     */
+    [[nodiscard]] static uint64_t tile_id(int z, uint32_t x, uint32_t y) noexcept;
+
+    struct Entry {
+        uint64_t tile_id{};
+        uint64_t offset{};
+        uint32_t length{};
+        uint32_t run_length{};  // 0はリーフディレクトリを指す
+    };
+
+   private:
+    struct Content {
+        uint64_t offset{};
+        uint32_t length{};
+    };
+
+    /**
+     * @brief 格納済みの内容が data と同一か (一時ファイルから読み戻して比較)
+     */
+    [[nodiscard]] bool same_content(const Content& content, std::span<const uint8_t> data);
+
+    std::filesystem::path output_path_;
+    std::filesystem::path data_path_;  // タイル本体の一時ファイル
+    std::string metadata_json_;
+
+    std::mutex mutex_;
+    std::fstream data_file_;
+    uint64_t data_size_{0};
+    std::vector<Entry> entries_;
+    std::unordered_multimap<uint64_t, Content> contents_;  // (内容ハッシュ) → 格納位置
+
+    int min_zoom_{255};
+    int max_zoom_{-1};
+    double min_lng_{180.0}, min_lat_{90.0}, max_lng_{-180.0}, max_lat_{-90.0};
+    bool finished_{false};
+};
+
+}  // namespace fgd_converter
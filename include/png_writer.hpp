@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+namespace fgd_converter {
+
+/**
+ * @brief 8bit RGB画像 (R, G, B の順に3バイト/画素、行優先) をPNGへエンコード
+ *
+ * 行ごとに5種類のフィルタ (None, Sub, Up, Average, Paeth) を試し、フィルタ後の
+ * 符号付きバイトの絶対値和が最小のものを選ぶ (libpngと同じ経験則)。圧縮はzlib。
+ *
+ * @param out エンコード結果 (既存の内容は破棄)
+ * @return 成功時true、失敗時はecに理由を設定
+ */
+[[nodiscard]] bool encode_png_rgb(const uint8_t* rgb, int width, int height,
+                                  std::vector<uint8_t>& out, std::error_code& ec);
+
+}  // namespace fgd_converter
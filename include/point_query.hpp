@@ -0,0 +1,147 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "dem.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief サンプリング時の補間方法
+ */
+enum class Interpolation {
+    Nearest,   // 地点を含むピクセルの値
+    Bilinear,  // 周囲4ピクセル中心からの双線形補間
+};
+
+/**
+ * @brief 1メッシュ分の復号済み標高グリッド (北が上、行優先、未取得は-9999)
+ */
+struct MeshGrid {
+    static constexpr float NO_DATA = -9999.0f;
+
+    std::string mesh_code;
+    std::string dem_type;
+    BoundsLatLng bounds{};
+    int x_length{};
+    int y_length{};
+    std::vector<float> values;
+
+    [[nodiscard]] float at(int row, int col) const noexcept {
+        return values[static_cast<size_t>(row) * x_length + col];
+    }
+    [[nodiscard]] double pixel_width() const noexcept {
+        return (bounds.max_lng - bounds.min_lng) / x_length;
+    }
+    [[nodiscard]] double pixel_height() const noexcept {
+        return (bounds.max_lat - bounds.min_lat) / y_length;
+    }
+
+    /**
+     * @brief 緯度経度を含むピクセルの値 (最近傍)
+     */
+    [[nodiscard]] float nearest(double lat, double lng) const noexcept;
+
+    /**
+     * @brief 周囲4ピクセル中心から双線形補間 (近傍にデータなしを含む場合は最近傍)
+     *
+     * メッシュ境界付近では隣接メッシュを参照せず、端のピクセルで打ち切る。
+     */
+    [[nodiscard]] float bilinear(double lat, double lng) const noexcept;
+
+    [[nodiscard]] float sample(double lat, double lng, Interpolation interpolation) const noexcept {
+        return interpolation == Interpolation::Bilinear ? bilinear(lat, lng) : nearest(lat, lng);
+    }
+};
+
+/**
+ * @brief FGD DEM XMLを1メッシュ分のグリッドに復号 (FastFGDParserによる1パス解析)
+ *
+ * @param dem_type 呼び出し側が把握している種別 (ファイル名由来、例: "5A")
+ */
+[[nodiscard]] auto decode_mesh(std::string_view xml, std::string_view dem_type,
+                               bool sea_at_zero) -> std::optional<MeshGrid>;
+
+class MeshCatalog;
+
+/**
+ * @brief FGD ZIPアーカイブから直接、地点標高を返す検索エンジン
+ *
+ * 緯度経度からメッシュコードを算出し、エントリ名から作成した索引で該当XMLを特定して
+ * そのメッシュのみを解析する。復号済みグリッドはLRUキャッシュに保持する。
+ * ネストしたZIP (FG-GML-533945-DEM5A-*.zip) は必要になった時点で索引に追加する。
+ * query()は複数スレッドから同時に呼び出せる。
+ */
+class PointQueryEngine {
+   public:
+    struct Config {
+        std::vector<std::filesystem::path> inputs;  // ZIP・XMLファイルまたはそれらを含むフォルダ
+        size_t cache_capacity{64};                  // 保持する復号済みメッシュ数
+        bool sea_at_zero{true};                     // 海面 (-9999) を0mとして扱う
+        // 指定した場合は inputs を走査せず、カタログのレコードから索引を作成する
+        std::shared_ptr<const MeshCatalog> catalog;
+    };
+
+    struct Result {
+        double lat{};
+        double lng{};
+        std::optional<double> elevation;  // データなし・範囲外の場合はstd::nullopt
+        std::string mesh_code;
+        std::string dem_type;
+    };
+
+    /**
+     * @brief 入力またはカタログから索引を作成 (該当するFGDファイルが1つもない場合は例外)
+     */
+    explicit PointQueryEngine(Config config);
+    ~PointQueryEngine();
+
+    PointQueryEngine(const PointQueryEngine&) = delete;
+    PointQueryEngine& operator=(const PointQueryEngine&) = delete;
+
+    /**
+     * @brief 地点の標高を検索 (5m→10mの順に、値のある最も細かいメッシュを採用)
+     */
+    [[nodiscard]] auto query(double lat, double lng) -> Result;
+
+    /**
+     * @brief メッシュコードと種別を指定して復号済みグリッドを取得 (キャッシュ経由)
+     *
+     * @param dem_type 空の場合は最も解像度の細かい種別
+     */
+    [[nodiscard]] auto load_grid(std::string_view mesh_code, std::string_view dem_type,
+                                 std::error_code& ec) -> std::shared_ptr<const MeshGrid>;
+
+    /**
+     * @brief 地点を含む索引済みメッシュの候補 (優先順、{メッシュコード, 種別})
+     */
+    [[nodiscard]] auto candidates(double lat, double lng)
+        -> std::vector<std::pair<std::string, std::string>>;
+
+    /**
+     * @brief 大量の地点を一括サンプリング (結果は入力順)
+     *
+     * 地点をメッシュコード→メッシュ内の行→列の順に並べ替えてメッシュ単位のバッチに分け、
+     * バッチをTBBで並列処理する。各メッシュはバッチごとに1回だけ取得・復号される。
+     *
+     * @param points {緯度, 経度} の配列
+     * @return 各地点の標高 (データなし・範囲外はstd::nullopt)
+     */
+    [[nodiscard]] auto sample(std::span<const std::pair<double, double>> points,
+                              Interpolation interpolation) -> std::vector<std::optional<double>>;
+
+    [[nodiscard]] size_t indexed_mesh_count() const;
+
+   private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+}  // namespace fgd_converter
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "mosaic.hpp"
+#include "xyz_tiles.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief quantized-mesh (Cesium地形) 出力の設定
+ */
+struct QuantizedMeshConfig {
+    int min_zoom{0};
+    int max_zoom{14};
+    int grid_size{257};      // タイルあたりの標本格子 (2^k + 1)
+    double max_error{1.0};  // 最大ズームでの許容幾何誤差 (m)、1段低いズームごとに2倍
+};
+
+/**
+ * @brief 出力済みタイルの範囲 (layer.json の available 要素)
+ */
+struct TileRange {
+    uint32_t start_x{};
+    uint32_t start_y{};
+    uint32_t end_x{};
+    uint32_t end_y{};
+};
+
+/**
+ * @brief quantized-mesh 出力の結果
+ */
+struct QuantizedMeshLayer {
+    size_t tile_count{};
+    std::vector<std::vector<TileRange>> available;  // ズーム0から最大ズームまで
+};
+
+/**
+ * @brief 1タイル分の標高格子をquantized-mesh 1.0形式へエンコード
+ *
+ * RTIN (Martini) で誤差がmax_error以下となる適応的な三角形分割を作り、
+ * 頂点 (u, v, 高さ) をジグザグ差分、インデックスをハイウォーターマーク方式で符号化する。
+ *
+ * @param heights 北西端から行優先の grid_size × grid_size 標高 (m)
+ * @param west,south,east,north タイル範囲 (度)
+ */
+[[nodiscard]] auto encode_quantized_mesh(std::span<const float> heights, int grid_size,
+                                         double max_error, double west, double south,
+                                         double east, double north) -> std::vector<uint8_t>;
+
+/**
+ * @brief 結合済み標高ラスター群からquantized-meshタイル (地理座標TMS) を作成
+ *
+ * ズームzのタイルは経度方向 2^(z+1)、緯度方向 2^z 枚で、yは南から数える。
+ * 入力ラスターと重なるタイル (とズーム0の2枚) をすべて出力し、タイルごとに
+ * 入力を直接標本化してTBBで並列に処理する。データなしは標高0mとして扱う。
+ *
+ * @return 出力結果、失敗時はstd::nullopt (ecに理由を設定)
+ */
+[[nodiscard]] auto write_quantized_mesh(std::span<const Mosaic> sources,
+                                        const QuantizedMeshConfig& config, TileWriter& writer,
+                                        std::error_code& ec) -> std::optional<QuantizedMeshLayer>;
+
+/**
+ * @brief Cesium用の layer.json を生成
+ */
+[[nodiscard]] auto make_layer_json(const QuantizedMeshLayer& layer,
+                                   const QuantizedMeshConfig& config) -> std::string;
+
+}  // namespace fgd_converter
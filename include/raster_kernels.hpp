@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rgb_encoding.hpp"
+
+namespace fgd_converter {
+
+namespace kernels {
+
+/**
+ * @brief SIMD版が出力バッファ末尾を超えて書き込む最大バイト数
+ *
+ * 4画素 (12バイト) ごとに16バイトをストアするため、バッファは count * 3 + RGB_PADDING
+ * バイト以上確保すること。超過分には0が書き込まれる。
+ */
+inline constexpr size_t RGB_PADDING = 16;
+
+/**
+ * @brief 標高の並びをRGB (R, G, B の順に3バイト/画素) へエンコード
+ *
+ * -9999以下はデータなしとして標高0mと同じ値を出力する。
+ * 実行中のCPUの命令セット (cpu::active()) に応じて、SSE4.2/AVX2は4画素、AVX-512は8画素ずつ
+ * 変換・整数化・バイト並べ替えをベクトル化する。
+ */
+void encode_rgb(const double* heights, size_t count, RgbEncoding encoding, uint8_t* out) noexcept;
+void encode_rgb(const float* heights, size_t count, RgbEncoding encoding, uint8_t* out) noexcept;
+
+/**
+ * @brief 再投影の1行分をバイリニア補間で標本化
+ *
+ * src_cols / src_rows は出力画素ごとの入力画素座標 (画素中心を整数とする座標)。
+ * 4近傍が入力範囲外、またはhas_nodataで4近傍のいずれかがnodataの画素は書き換えない。
+ * AVX2以上のCPUでは4近傍をギャザーで読み込み、4画素ずつ補間する。
+ */
+void resample_bilinear_row(const float* src, int src_width, int src_height,
+                           const double* src_cols, const double* src_rows, size_t count,
+                           bool has_nodata, float nodata, float* dst) noexcept;
+
+}  // namespace kernels
+
+}  // namespace fgd_converter
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace fgd_converter {
+
+/**
+ * @brief 標高のRGBエンコード方式
+ */
+enum class RgbEncoding {
+    Mapbox,     // height = -10000 + (R * 65536 + G * 256 + B) * 0.1
+    Terrarium,  // height = (R * 256 + G + B / 256) - 32768
+};
+
+/**
+ * @brief エンコード方式名 ("mapbox", "terrarium") を解析
+ */
+[[nodiscard]] auto parse_rgb_encoding(std::string_view name) -> std::optional<RgbEncoding>;
+
+}  // namespace fgd_converter
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgd_converter {
+
+/**
+ * @brief RTIN (Right-Triangulated Irregular Network) の三角形座標表
+ *
+ * 格子サイズごとに1度だけ作成し、全タイルで共有する (mapbox/martini と同じ構成)。
+ * 三角形 i の斜辺の両端 (ax, ay), (bx, by) を保持し、子は番号 2i+2, 2i+3 に対応する。
+ */
+struct Rtin {
+    int grid_size;
+    size_t num_triangles;
+    size_t num_parent_triangles;
+    std::vector<uint16_t> coords;
+
+    explicit Rtin(int size) : grid_size(size) {
+        const size_t tile = static_cast<size_t>(size - 1);
+        num_triangles = tile * tile * 2 - 2;
+        num_parent_triangles = num_triangles - tile * tile;
+        coords.resize(num_triangles * 4);
+
+        for (size_t i = 0; i < num_triangles; ++i) {
+            size_t id = i + 2;
+            int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+            if (id & 1) {
+                bx = by = cx = static_cast<int>(tile);  // 左下の三角形
+            } else {
+                ax = ay = cy = static_cast<int>(tile);  // 右上の三角形
+            }
+            while ((id >>= 1) > 1) {
+                const int mx = (ax + bx) >> 1;
+                const int my = (ay + by) >> 1;
+                if (id & 1) {
+                    bx = ax;
+                    by = ay;
+                    ax = cx;
+                    ay = cy;
+                } else {
+                    ax = bx;
+                    ay = by;
+                    bx = cx;
+                    by = cy;
+                }
+                cx = mx;
+                cy = my;
+            }
+            coords[i * 4] = static_cast<uint16_t>(ax);
+            coords[i * 4 + 1] = static_cast<uint16_t>(ay);
+            coords[i * 4 + 2] = static_cast<uint16_t>(bx);
+            coords[i * 4 + 3] = static_cast<uint16_t>(by);
+        }
+    }
+
+    /**
+     * @brief 各格子点を分割点とする三角形の誤差 (子孫の最大値を含む) を計算
+     */
+    [[nodiscard]] std::vector<float> compute_errors(std::span<const float> heights) const {
+        const size_t size = static_cast<size_t>(grid_size);
+        std::vector<float> errors(size * size, 0.0f);
+
+        for (size_t i = num_triangles; i-- > 0;) {
+            const int ax = coords[i * 4];
+            const int ay = coords[i * 4 + 1];
+            const int bx = coords[i * 4 + 2];
+            const int by = coords[i * 4 + 3];
+            const int mx = (ax + bx) >> 1;
+            const int my = (ay + by) >> 1;
+            const int cx = mx + my - ay;
+            const int cy = my + ax - mx;
+
+            const float interpolated = (heights[ay * size + ax] + heights[by * size + bx]) / 2.0f;
+            const size_t middle = my * size + mx;
+            float error = std::max(errors[middle], std::abs(interpolated - heights[middle]));
+
+            if (i < num_parent_triangles) {
+                const size_t left = ((ay + cy) >> 1) * size + ((ax + cx) >> 1);
+                const size_t right = ((by + cy) >> 1) * size + ((bx + cx) >> 1);
+                error = std::max({error, errors[left], errors[right]});
+            }
+            errors[middle] = error;
+        }
+        return errors;
+    }
+};
+
+}  // namespace fgd_converter
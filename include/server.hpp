@@ -0,0 +1,60 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+
+namespace fgd_converter {
+
+class MeshCache;
+
+/**
+ * @brief 常駐変換デーモン (Unixドメインソケット)
+ *
+ * プロセスを常駐させ、TBBスレッドプール・PROJ変換キャッシュを温めたまま
+ * 変換ジョブを受け付ける。プロトコルは改行区切りのJSON (1行1ジョブ):
+ *
+ * @code
+ * → {"id": "job-1", "input": "/data/FG-GML-533945-DEM5A.zip", "output": "/out",
+ *    "epsg": "EPSG:3857", "rgbify": false, "sea_at_zero": false}
+ * ← {"id": "job-1", "event": "accepted"}
+ * ← {"id": "job-1", "event": "progress", "stage": "parse"}
+ * ← {"id": "job-1", "event": "done", "output": "/out/FG-GML-533945-DEM5A.tif",
+ *    "elapsed_ms": 42.1}
+ * @endcode
+ *
+ * 制御コマンド: {"command": "ping"}, {"command": "shutdown"}
+ */
+class ConversionServer {
+   public:
+    struct Config {
+        std::filesystem::path socket_path;
+        std::filesystem::path default_output_path{"./output"};
+        std::string default_epsg{"EPSG:3857"};
+        std::shared_ptr<const MeshCache> mesh_cache;  // 全ジョブで共有するメッシュキャッシュ
+    };
+
+    explicit ConversionServer(Config config);
+    ~ConversionServer();
+
+    // コピー・ムーブ禁止 (受付スレッドがthisを参照するため)
+    ConversionServer(const ConversionServer&) = delete;
+    ConversionServer& operator=(const ConversionServer&) = delete;
+
+    /**
+     * @brief ソケットを開いてジョブを受け付ける (stop()またはshutdownまでブロック)
+     */
+    [[nodiscard]] bool run(std::error_code& ec);
+
+    /**
+     * @brief 受付ループの停止を要求 (シグナルハンドラから呼び出し可能)
+     */
+    void stop() noexcept;
+
+   private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
+
+}  // namespace fgd_converter
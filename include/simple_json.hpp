@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace fgd_converter::json {
+
+/**
+ * @brief フラットなJSONオブジェクトの値 (文字列・数値・真偽値・null)
+ *
+ * ジョブ記述やレポート程度の用途に限定した軽量表現。
+ * ネストしたオブジェクトや配列は扱わない。
+ */
+using Value = std::variant<std::nullptr_t, bool, double, std::string>;
+using Object = std::map<std::string, Value, std::less<>>;
+
+/**
+ * @brief JSON文字列リテラル用にエスケープ (前後の引用符は含まない)
+ */
+inline std::string escape(std::string_view text) {
+    std::string out;
+    out.reserve(text.size() + 8);
+    for (char c : text) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                    out += buf;
+                } else {
+                    out += c;  // UTF-8はそのまま出力
+                }
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief 引用符付きのJSON文字列を生成
+ */
+inline std::string quote(std::string_view text) { return "\"" + escape(text) + "\""; }
+
+namespace detail {
+
+inline void skip_ws(std::string_view s, size_t& i) {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) {
+        ++i;
+    }
+}
+
+inline std::optional<std::string> parse_string(std::string_view s, size_t& i) {
+    if (i >= s.size() || s[i] != '"')
+        return std::nullopt;
+    ++i;
+
+    std::string out;
+    while (i < s.size()) {
+        char c = s[i++];
+        if (c == '"')
+            return out;
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (i >= s.size())
+            return std::nullopt;
+        char e = s[i++];
+        switch (e) {
+            case '"':
+            case '\\':
+            case '/':
+                out += e;
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u': {
+                if (i + 4 > s.size())
+                    return std::nullopt;
+                unsigned code = 0;
+                for (int k = 0; k < 4; ++k) {
+                    char h = s[i++];
+                    code <<= 4;
+                    if (h >= '0' && h <= '9')
+                        code |= static_cast<unsigned>(h - '0');
+                    else if (h >= 'a' && h <= 'f')
+                        code |= static_cast<unsigned>(h - 'a' + 10);
+                    else if (h >= 'A' && h <= 'F')
+                        code |= static_cast<unsigned>(h - 'A' + 10);
+                    else
+                        return std::nullopt;
+                }
+                // BMP範囲のみUTF-8へ変換 (サロゲートペアは非対応)
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xC0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                } else {
+                    out += static_cast<char>(0xE0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace detail
+
+/**
+ * @brief 1階層のJSONオブジェクトをパース
+ *
+ * @param text 例: {"input": "a.zip", "rgbify": true, "level": 6}
+ * @return パース結果、または書式エラー時にstd::nullopt
+ */
+inline std::optional<Object> parse_flat_object(std::string_view text) {
+    size_t i = 0;
+    detail::skip_ws(text, i);
+    if (i >= text.size() || text[i] != '{')
+        return std::nullopt;
+    ++i;
+
+    Object object;
+    detail::skip_ws(text, i);
+    if (i < text.size() && text[i] == '}')
+        return object;
+
+    while (i < text.size()) {
+        detail::skip_ws(text, i);
+        auto key = detail::parse_string(text, i);
+        if (!key)
+            return std::nullopt;
+
+        detail::skip_ws(text, i);
+        if (i >= text.size() || text[i] != ':')
+            return std::nullopt;
+        ++i;
+        detail::skip_ws(text, i);
+        if (i >= text.size())
+            return std::nullopt;
+
+        if (text[i] == '"') {
+            auto value = detail::parse_string(text, i);
+            if (!value)
+                return std::nullopt;
+            object[*key] = std::move(*value);
+        } else if (text.substr(i, 4) == "true") {
+            object[*key] = true;
+            i += 4;
+        } else if (text.substr(i, 5) == "false") {
+            object[*key] = false;
+            i += 5;
+        } else if (text.substr(i, 4) == "null") {
+            object[*key] = nullptr;
+            i += 4;
+        } else {
+            size_t start = i;
+            while (i < text.size() && (text[i] == '-' || text[i] == '+' || text[i] == '.' ||
+                                       text[i] == 'e' || text[i] == 'E' ||
+                                       (text[i] >= '0' && text[i] <= '9'))) {
+                ++i;
+            }
+            if (start == i)
+                return std::nullopt;
+            std::string number(text.substr(start, i - start));
+            char* end_ptr = nullptr;
+            double value = std::strtod(number.c_str(), &end_ptr);
+            if (end_ptr == number.c_str())
+                return std::nullopt;
+            object[*key] = value;
+        }
+
+        detail::skip_ws(text, i);
+        if (i < text.size() && text[i] == ',') {
+            ++i;
+            continue;
+        }
+        if (i < text.size() && text[i] == '}')
+            return object;
+        return std::nullopt;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief 文字列値を取得 (型が異なる・存在しない場合はstd::nullopt)
+ */
+inline std::optional<std::string> get_string(const Object& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end())
+        return std::nullopt;
+    if (const auto* s = std::get_if<std::string>(&it->second))
+        return *s;
+    return std::nullopt;
+}
+
+/**
+ * @brief 真偽値を取得 ("true"/"false"文字列も受け付ける)
+ */
+inline std::optional<bool> get_bool(const Object& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end())
+        return std::nullopt;
+    if (const auto* b = std::get_if<bool>(&it->second))
+        return *b;
+    if (const auto* s = std::get_if<std::string>(&it->second)) {
+        if (*s == "true")
+            return true;
+        if (*s == "false")
+            return false;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief 数値を取得
+ */
+inline std::optional<double> get_number(const Object& object, std::string_view key) {
+    auto it = object.find(key);
+    if (it == object.end())
+        return std::nullopt;
+    if (const auto* d = std::get_if<double>(&it->second))
+        return *d;
+    return std::nullopt;
+}
+
+}  // namespace fgd_converter::json
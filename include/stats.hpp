@@ -0,0 +1,325 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fgd_converter::stats {
+
+/**
+ * @brief 時間を計測する処理段階
+ */
+enum class Stage : uint8_t {
+    Unzip,      // ZIPエントリの展開 (ZipHandler)
+    ReadXml,    // 展開済みXMLの読み込み (Dem)
+    Parse,      // XMLのパース (FastFGDParser::parse_all)
+    Placement,  // 標高値のメッシュ格子への配置 (Dem)
+    Combine,    // メッシュ結合 (Converter)
+    Encode,     // GeoTIFFタイルのエンコード・圧縮・書き込み (GeoTiff)
+    Resample,   // 出力CRSへの再投影 (GeoTiff)
+    Count,
+};
+
+/**
+ * @brief 集計するカウンター
+ */
+enum class Counter : uint8_t {
+    ZipEntries,       // 展開したZIPエントリ数
+    BytesInflated,    // 展開後のバイト数
+    XmlFiles,         // 読み込んだXMLファイル数
+    XmlBytes,         // 読み込んだXMLのバイト数
+    ValuesParsed,     // パースした標高値の数
+    MeshesPlaced,     // 格子に配置したメッシュ数
+    TilesEncoded,     // エンコードしたGeoTIFFタイル数
+    ProjCalls,        // PROJによる座標変換の回数
+    BytesWritten,     // 出力ファイル (メモリ出力を含む) のバイト数
+    MeshCacheHits,    // メッシュキャッシュから読み込んだXMLエントリ数
+    MeshCacheMisses,  // キャッシュになくパースしたXMLエントリ数
+    Superseded,       // 新しい版があるため展開せずに除外したエントリ数
+    Count,
+};
+
+/**
+ * @brief 使用量を集計する大きなバッファの種類
+ */
+enum class Memory : uint8_t {
+    XmlBuffers,      // 読み込んだXML文字列 (Dem)
+    ElevationList,   // パース結果の標高値リスト (XmlParser)
+    MeshGrids,       // メッシュごとの標高格子 (Dem)
+    Mosaic,          // 結合済みラスター (Converter)
+    GeoTiffCopy,     // GeoTIFF出力用の配列コピー (GeoTiff)
+    ResampleSource,  // 再投影の入力ラスター (GeoTiff)
+    ResampleDest,    // 再投影の出力ラスター (GeoTiff)
+    Count,
+};
+
+inline constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::Count);
+inline constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+inline constexpr size_t MEMORY_COUNT = static_cast<size_t>(Memory::Count);
+
+[[nodiscard]] auto stage_name(Stage stage) noexcept -> std::string_view;
+[[nodiscard]] auto counter_name(Counter counter) noexcept -> std::string_view;
+[[nodiscard]] auto memory_name(Memory memory) noexcept -> std::string_view;
+
+struct ArchiveRecord;
+
+namespace detail {
+// 計測機能ごとの有効フラグ。無効時の計測点はこの値の relaxed load 1回のみで戻る
+inline constexpr uint32_t FLAG_STATS = 1u << 0;  // 段階時間・カウンター (--stats)
+inline constexpr uint32_t FLAG_TRACE = 1u << 1;  // タイムライン (--trace, trace.hpp)
+inline std::atomic<uint32_t> g_flags{0};
+
+[[nodiscard]] inline uint32_t flags() noexcept { return g_flags.load(std::memory_order_relaxed); }
+void set_flag(uint32_t flag, bool value) noexcept;
+
+/**
+ * @brief 段階の終了を記録 (有効な機能に応じて段階時間の加算・タイムラインへの追加を行う)
+ */
+void finish_stage(Stage stage, uint64_t start_ns, uint64_t end_ns) noexcept;
+void add_counter(Counter counter, uint64_t value) noexcept;
+void charge_memory(Memory memory, ArchiveRecord* archive, int64_t delta) noexcept;
+
+[[nodiscard]] inline uint64_t now_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+}  // namespace detail
+
+/**
+ * @brief 計測が有効か
+ */
+[[nodiscard]] inline bool enabled() noexcept { return (detail::flags() & detail::FLAG_STATS) != 0; }
+
+/**
+ * @brief 計測を有効化・無効化 (有効化時に経過時間の起点を記録する)
+ */
+void set_enabled(bool value) noexcept;
+
+/**
+ * @brief 集計値をすべて0に戻し、アーカイブごとの記録を破棄
+ *
+ * 計測中のArchiveScopeがない状態で呼び出すこと。
+ */
+void reset();
+
+/**
+ * @brief カウンターに加算 (全体と、現在のスレッドに関連付けられたアーカイブの両方)
+ */
+inline void add(Counter counter, uint64_t value) noexcept {
+    if (enabled()) {
+        detail::add_counter(counter, value);
+    }
+}
+
+/**
+ * @brief スコープの経過時間を段階に加算するRAIIタイマー
+ *
+ * 段階の時間はスレッドごとの経過時間の合計のため、並列区間では実時間より大きくなる。
+ * タイムライン出力 (--trace) が有効な場合は同じ区間をスパンとしても記録する。
+ */
+class ScopedTimer {
+   public:
+    explicit ScopedTimer(Stage stage) noexcept
+        : stage_(stage), start_(detail::flags() != 0 ? detail::now_ns() : 0) {}
+    ~ScopedTimer() {
+        if (start_ != 0) {
+            detail::finish_stage(stage_, start_, detail::now_ns());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    Stage stage_;
+    uint64_t start_;
+};
+
+/**
+ * @brief 現在のスレッドに関連付けられたアーカイブ (なければnullptr)
+ *
+ * ArchiveRecord はアーカイブごとの集計先 (不透明ハンドル)。
+ */
+[[nodiscard]] auto current_archive() noexcept -> ArchiveRecord*;
+
+/**
+ * @brief アーカイブ名 (reset() まで有効)
+ */
+[[nodiscard]] auto archive_name(const ArchiveRecord* record) noexcept -> std::string_view;
+
+/**
+ * @brief スコープ内の計測を1つのアーカイブに帰属させるRAIIオブジェクト
+ *
+ * 生成したスレッドにアーカイブを関連付け、破棄時にアーカイブの経過時間を記録する
+ * (タイムライン出力が有効な場合はアーカイブ全体のスパンも記録する)。
+ * 計測・タイムライン出力とも無効な場合は何もしない。
+ */
+class ArchiveScope {
+   public:
+    explicit ArchiveScope(std::string_view name);
+    ~ArchiveScope();
+
+    ArchiveScope(const ArchiveScope&) = delete;
+    ArchiveScope& operator=(const ArchiveScope&) = delete;
+
+   private:
+    ArchiveRecord* record_{nullptr};
+    ArchiveRecord* previous_{nullptr};
+    uint64_t start_{0};
+};
+
+/**
+ * @brief 並列タスクを実行するスレッドを、タスクを作成したスレッドのアーカイブに関連付ける
+ *
+ * TBBのワーカーは別アーカイブのタスクを横取りして実行するため、
+ * タスク本体の先頭で current_archive() の値 (タスク作成時に取得したもの) を渡す。
+ */
+class ArchiveBinding {
+   public:
+    explicit ArchiveBinding(ArchiveRecord* record) noexcept;
+    ~ArchiveBinding();
+
+    ArchiveBinding(const ArchiveBinding&) = delete;
+    ArchiveBinding& operator=(const ArchiveBinding&) = delete;
+
+   private:
+    ArchiveRecord* previous_;
+};
+
+/**
+ * @brief バッファの確保量を種類とアーカイブに計上するRAIIオブジェクト
+ *
+ * バッファを所有するオブジェクトのメンバーまたはローカル変数として置き、
+ * 所有者と同じ寿命で計上する。計上先のアーカイブは assign 時のスレッドのものに固定され、
+ * 解放は別スレッドで行ってもよい。計測が無効な場合は何もしない。
+ * 計上中に reset() を呼び出さないこと。
+ */
+class MemoryCharge {
+   public:
+    MemoryCharge() noexcept = default;
+    MemoryCharge(Memory memory, uint64_t bytes) noexcept { assign(memory, bytes); }
+    ~MemoryCharge() { release(); }
+
+    MemoryCharge(MemoryCharge&& other) noexcept
+        : memory_(other.memory_), bytes_(other.bytes_), archive_(other.archive_) {
+        other.bytes_ = 0;
+    }
+    MemoryCharge& operator=(MemoryCharge&& other) noexcept {
+        if (this != &other) {
+            release();
+            memory_ = other.memory_;
+            bytes_ = other.bytes_;
+            archive_ = other.archive_;
+            other.bytes_ = 0;
+        }
+        return *this;
+    }
+
+    /**
+     * @brief 計上量を置き換える (以前の計上は解放)
+     */
+    void assign(Memory memory, uint64_t bytes) noexcept {
+        release();
+        if (!enabled() || bytes == 0)
+            return;
+        memory_ = memory;
+        bytes_ = bytes;
+        archive_ = current_archive();
+        detail::charge_memory(memory_, archive_, static_cast<int64_t>(bytes_));
+    }
+
+    void release() noexcept {
+        if (bytes_ != 0) {
+            detail::charge_memory(memory_, archive_, -static_cast<int64_t>(bytes_));
+            bytes_ = 0;
+        }
+    }
+
+   private:
+    Memory memory_{Memory::XmlBuffers};
+    uint64_t bytes_{0};
+    ArchiveRecord* archive_{nullptr};
+};
+
+/**
+ * @brief 配列の確保済みバイト数 (容量ベース、計上量の算出用)
+ */
+template <typename T>
+[[nodiscard]] uint64_t bytes_of(const std::vector<T>& values) noexcept {
+    return static_cast<uint64_t>(values.capacity()) * sizeof(T);
+}
+
+template <typename T>
+[[nodiscard]] uint64_t bytes_of(const std::vector<std::vector<T>>& rows) noexcept {
+    uint64_t bytes = static_cast<uint64_t>(rows.capacity()) * sizeof(std::vector<T>);
+    for (const auto& row : rows) {
+        bytes += bytes_of(row);
+    }
+    return bytes;
+}
+
+/**
+ * @brief プロセスの常駐メモリ
+ */
+struct ProcessMemory {
+    uint64_t rss_bytes{};       // 現在の常駐メモリ (取得できない環境では0)
+    uint64_t peak_rss_bytes{};  // 最大常駐メモリ
+};
+
+/**
+ * @brief プロセスの常駐メモリを取得
+ *
+ * Linuxは /proc/self/status の VmRSS / VmHWM、その他のPOSIX環境は getrusage の最大値のみ。
+ * @return 取得できない環境ではstd::nullopt
+ */
+[[nodiscard]] auto process_memory() -> std::optional<ProcessMemory>;
+
+/**
+ * @brief 段階の時間・呼び出し回数、カウンターの値、バッファ確保量の最大値
+ */
+struct Totals {
+    std::array<uint64_t, STAGE_COUNT> stage_ns{};
+    std::array<uint64_t, STAGE_COUNT> stage_calls{};
+    std::array<uint64_t, COUNTER_COUNT> counters{};
+    std::array<uint64_t, MEMORY_COUNT> memory_peak{};  // 種類ごとの同時確保量の最大値
+    uint64_t memory_peak_total{};                      // 全種類の合計の最大値
+};
+
+struct ArchiveReport {
+    std::string name;
+    uint64_t wall_ns{};    // ArchiveScope の生存期間
+    uint64_t rss_bytes{};  // ArchiveScope 終了時のプロセスの常駐メモリ
+    Totals totals;
+};
+
+/**
+ * @brief 集計結果のスナップショット
+ */
+struct Report {
+    uint64_t wall_ns{};  // 計測を有効化してからの経過時間
+    ProcessMemory process;
+    Totals global;
+    std::vector<ArchiveReport> archives;  // 計測開始順
+};
+
+[[nodiscard]] auto snapshot() -> Report;
+
+/**
+ * @brief 集計結果を表形式で出力
+ */
+void write_text(std::ostream& out, const Report& report);
+
+/**
+ * @brief 集計結果をJSONで出力
+ */
+void write_json(std::ostream& out, const Report& report);
+
+}  // namespace fgd_converter::stats
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace fgd_converter {
+
+/**
+ * @brief tupleListの各行の種別 (地表面種別バンドの値)
+ *
+ * 0は未取得 (tupleListの範囲外) または不明な種別で、種別バンドのNODATA値を兼ねる。
+ */
+enum class SurfaceClass : uint8_t {
+    None,         // 未取得・不明な種別
+    Ground,       // 地表面
+    Surface,      // 表層面
+    SeaSurface,   // 海水面
+    SeaFloor,     // 海水底面
+    InlandWater,  // 内水面
+    NoData,       // データなし
+    Other,        // その他
+};
+
+inline constexpr uint8_t SURFACE_CLASS_NODATA = static_cast<uint8_t>(SurfaceClass::None);
+
+namespace surface_detail {
+
+struct Label {
+    std::string_view text;  // UTF-8 (いずれも9バイト以上)
+    SurfaceClass surface_class;
+};
+
+inline constexpr std::array<Label, 7> LABELS = {{
+    {"地表面", SurfaceClass::Ground},
+    {"表層面", SurfaceClass::Surface},
+    {"海水面", SurfaceClass::SeaSurface},
+    {"海水底面", SurfaceClass::SeaFloor},
+    {"内水面", SurfaceClass::InlandWater},
+    {"データなし", SurfaceClass::NoData},
+    {"その他", SurfaceClass::Other},
+}};
+
+/**
+ * @brief 先頭8バイトをリトルエンディアンの整数として読み込む
+ */
+constexpr uint64_t prefix_word(std::string_view text) noexcept {
+    uint64_t word = 0;
+    for (size_t i = 0; i < 8 && i < text.size(); ++i) {
+        word |= static_cast<uint64_t>(static_cast<uint8_t>(text[i])) << (8 * i);
+    }
+    return word;
+}
+
+struct Prefix {
+    uint64_t word;
+    uint8_t length;
+};
+
+constexpr auto make_prefixes() noexcept {
+    std::array<Prefix, LABELS.size()> prefixes{};
+    for (size_t i = 0; i < LABELS.size(); ++i) {
+        prefixes[i] = {.word = prefix_word(LABELS[i].text),
+                       .length = static_cast<uint8_t>(LABELS[i].text.size())};
+    }
+    return prefixes;
+}
+
+inline constexpr auto PREFIXES = make_prefixes();
+
+constexpr bool prefixes_unique() noexcept {
+    for (size_t i = 0; i < PREFIXES.size(); ++i) {
+        for (size_t j = i + 1; j < PREFIXES.size(); ++j) {
+            if (PREFIXES[i].word == PREFIXES[j].word)
+                return false;
+        }
+    }
+    return true;
+}
+
+static_assert(prefixes_unique(), "種別名の先頭8バイトが重複している");
+
+}  // namespace surface_detail
+
+/**
+ * @brief tupleListの種別名を分類
+ *
+ * 先頭8バイト (UTF-8で2文字強) を1つの64bit値として各種別と比較し、
+ * 一致した場合のみ残りのバイトを確認する。
+ */
+[[nodiscard]] inline SurfaceClass classify_surface(std::string_view label) noexcept {
+    if (label.size() < 8)
+        return SurfaceClass::None;
+    uint64_t word;
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(&word, label.data(), 8);
+    } else {
+        word = surface_detail::prefix_word(label);
+    }
+    for (size_t i = 0; i < surface_detail::PREFIXES.size(); ++i) {
+        const auto& prefix = surface_detail::PREFIXES[i];
+        if (prefix.word != word)
+            continue;
+        const auto& entry = surface_detail::LABELS[i];
+        if (label.size() == prefix.length &&
+            std::memcmp(label.data() + 8, entry.text.data() + 8, prefix.length - 8) == 0) {
+            return entry.surface_class;
+        }
+        return SurfaceClass::None;
+    }
+    return SurfaceClass::None;
+}
+
+/**
+ * @brief 種別名 ("地表面" など、Noneは空文字列)
+ */
+[[nodiscard]] constexpr std::string_view surface_class_label(SurfaceClass surface_class) noexcept {
+    for (const auto& entry : surface_detail::LABELS) {
+        if (entry.surface_class == surface_class)
+            return entry.text;
+    }
+    return {};
+}
+
+[[nodiscard]] constexpr bool is_sea(SurfaceClass surface_class) noexcept {
+    return surface_class == SurfaceClass::SeaSurface || surface_class == SurfaceClass::SeaFloor;
+}
+
+/**
+ * @brief 種別に応じて標高値を決める (海域・データなしの扱い)
+ *
+ * データなしは値によらず-9999、海域の-9999は sea_at_zero の場合に0mとする。
+ */
+[[nodiscard]] constexpr double surface_elevation(SurfaceClass surface_class, double value,
+                                                 bool sea_at_zero) noexcept {
+    constexpr double NO_DATA = -9999.0;
+    if (surface_class == SurfaceClass::NoData)
+        return NO_DATA;
+    if (sea_at_zero && value <= NO_DATA && is_sea(surface_class))
+        return 0.0;
+    return value;
+}
+
+}  // namespace fgd_converter
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "validity_mask.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief 地形派生バンド (傾斜・斜面方位・陰影起伏) の設定
+ */
+struct TerrainConfig {
+    bool slope{false};      // 傾斜 (度)
+    bool aspect{false};     // 斜面方位 (北から時計回りの度、平坦は-1)
+    bool hillshade{false};  // 陰影起伏 (0-255)
+    double azimuth{315.0};  // 光源の方位 (度)
+    double altitude{45.0};  // 光源の高度 (度)
+    double z_factor{1.0};   // 標高の倍率
+
+    [[nodiscard]] bool any() const noexcept { return slope || aspect || hillshade; }
+};
+
+/**
+ * @brief 地形派生バンドの計算結果 (要求されなかったバンドは空)
+ */
+struct TerrainBands {
+    static constexpr float NO_DATA = -9999.0f;
+
+    std::vector<float> slope;
+    std::vector<float> aspect;
+    std::vector<float> hillshade;
+};
+
+/**
+ * @brief 結合済み標高ラスター (EPSG:4326) から地形派生バンドを計算
+ *
+ * Hornの3×3ステンシルで勾配を求める。ピクセル間隔は行ごとの緯度から
+ * メートルへ換算する (経度方向は cos(緯度) で縮小)。
+ * 行バンド単位でTBB並列化し、各バンドは上下1行のハロー行を共有入力から参照する。
+ * 近傍にデータなし (-9999) を含むピクセルはデータなしとなり、画像端は端の値を複製する。
+ *
+ * @param elevation 行優先の標高配列 (height行 × width列)
+ * @param geo_transform [左上経度, ピクセル幅, 0, 左上緯度, 0, -ピクセル高さ]
+ * @param valid 有効ピクセルのマスク (指定時は近傍がすべてデータなしの64ピクセルを読み飛ばす)
+ */
+[[nodiscard]] auto compute_terrain(const std::vector<std::vector<double>>& elevation, int width,
+                                   int height, const std::array<double, 6>& geo_transform,
+                                   const TerrainConfig& config,
+                                   const ValidityMask* valid = nullptr) -> TerrainBands;
+
+}  // namespace fgd_converter
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "stats.hpp"
+
+namespace fgd_converter::trace {
+
+/**
+ * @brief タイムラインの記録が有効か
+ */
+[[nodiscard]] inline bool enabled() noexcept {
+    return (stats::detail::flags() & stats::detail::FLAG_TRACE) != 0;
+}
+
+/**
+ * @brief 記録を開始 (呼び出し時刻をタイムラインの原点とし、呼び出したスレッドを "main" とする)
+ */
+void start();
+
+/**
+ * @brief 記録を停止 (記録済みのスパンは保持する)
+ */
+void stop() noexcept;
+
+namespace detail {
+/**
+ * @brief 完了したスパンを現在のスレッドのバッファへ追加
+ *
+ * name と category は静的な文字列 (リテラルまたは reset() まで有効なアーカイブ名) であること。
+ * スパンには現在のスレッドに関連付けられたアーカイブ名を付ける。
+ */
+void add_span(std::string_view name, std::string_view category, std::string_view detail,
+              uint64_t start_ns, uint64_t end_ns) noexcept;
+}  // namespace detail
+
+/**
+ * @brief スコープの区間をスパンとして記録するRAIIオブジェクト
+ *
+ * 段階 (stats::Stage) の区間は stats::ScopedTimer が記録するため、
+ * それ以外の単位 (XMLファイル、タイル、出力ファイル) に使う。
+ */
+class Span {
+   public:
+    explicit Span(std::string_view name, std::string_view category = "io") noexcept
+        : name_(name), category_(category), start_(enabled() ? stats::detail::now_ns() : 0) {}
+    ~Span() {
+        if (start_ != 0) {
+            detail::add_span(name_, category_, detail_, start_, stats::detail::now_ns());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    /**
+     * @brief 記録中か (詳細の文字列を作る前に確認する)
+     */
+    [[nodiscard]] bool active() const noexcept { return start_ != 0; }
+
+    /**
+     * @brief スパンの詳細 (ファイル名など) を設定
+     */
+    void set_detail(std::string detail) { detail_ = std::move(detail); }
+
+   private:
+    std::string_view name_;
+    std::string_view category_;
+    std::string detail_;
+    uint64_t start_;
+};
+
+/**
+ * @brief 記録したスパンをChrome trace event形式 (Perfetto / chrome://tracing) で出力
+ *
+ * スレッドごとのバッファを結合して書き出す。並列処理がすべて終わった後に呼び出すこと。
+ */
+void write_json(std::ostream& out);
+
+/**
+ * @brief write_json の結果をファイルへ書き出す
+ */
+[[nodiscard]] bool write_file(const std::filesystem::path& path, std::error_code& ec);
+
+}  // namespace fgd_converter::trace
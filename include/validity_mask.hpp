@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace fgd_converter {
+
+/**
+ * @brief ラスターの有効ピクセル (データあり) のビットマスク
+ *
+ * 1ピクセル1ビットで、各行は64ビットのワード境界から始まる (行末の余りビットは常に0)。
+ * 標高をメッシュに配置する時点で作成し、結合・リサンプリング・マージ・地形計算は
+ * -9999との比較の代わりにワード単位 (64ピクセルずつ) で有効範囲を判定する。
+ */
+class ValidityMask {
+   public:
+    static constexpr int WORD_BITS = 64;
+
+    ValidityMask() = default;
+
+    /**
+     * @brief すべて無効 (データなし) のマスク
+     */
+    ValidityMask(int width, int height)
+        : width_(std::max(width, 0)),
+          height_(std::max(height, 0)),
+          words_per_row_((width_ + WORD_BITS - 1) / WORD_BITS),
+          words_(static_cast<size_t>(words_per_row_) * height_, 0) {}
+
+    /**
+     * @brief 行優先の値の配列から作成 (is_valid(値) がtrueのピクセルを有効とする)
+     */
+    template <typename T, typename IsValid>
+    [[nodiscard]] static auto from_values(std::span<const T> values, int width, int height,
+                                          IsValid is_valid) -> ValidityMask {
+        ValidityMask mask(width, height);
+        for (int y = 0; y < mask.height_; ++y) {
+            mask.assign_row_if(y, 0, values.data() + static_cast<size_t>(y) * width, width,
+                               is_valid);
+        }
+        return mask;
+    }
+
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] bool empty() const noexcept { return words_.empty(); }
+    [[nodiscard]] int words_per_row() const noexcept { return words_per_row_; }
+
+    [[nodiscard]] auto row(int y) const noexcept -> std::span<const uint64_t> {
+        return {words_.data() + static_cast<size_t>(y) * words_per_row_,
+                static_cast<size_t>(words_per_row_)};
+    }
+
+    [[nodiscard]] bool test(int x, int y) const noexcept {
+        return (row(y)[x / WORD_BITS] >> (x % WORD_BITS)) & 1;
+    }
+
+    void set(int x, int y) noexcept { word_at(x, y) |= bit(x); }
+    void reset(int x, int y) noexcept { word_at(x, y) &= ~bit(x); }
+
+    /**
+     * @brief 行yの [x, x+count) を値から設定 (is_valid(値) がtrueのピクセルを有効とする)
+     */
+    template <typename T, typename IsValid>
+    void assign_row_if(int y, int x, const T* values, int count, IsValid is_valid) noexcept {
+        uint64_t* words = row_data(y);
+        int i = 0;
+        while (i < count) {
+            const int pos = x + i;
+            const int shift = pos % WORD_BITS;
+            const int n = std::min(WORD_BITS - shift, count - i);
+            uint64_t bits = 0;
+            for (int k = 0; k < n; ++k) {
+                bits |= static_cast<uint64_t>(is_valid(values[i + k]) ? 1 : 0) << k;
+            }
+            deposit(words[pos / WORD_BITS], shift, n, bits);
+            i += n;
+        }
+    }
+
+    /**
+     * @brief 行yの [x, x+count) を値から設定 (nodataより大きい値を有効とする)
+     */
+    template <typename T>
+    void assign_row(int y, int x, const T* values, int count, T nodata) noexcept {
+        assign_row_if(y, x, values, count, [nodata](T v) { return v > nodata; });
+    }
+
+    /**
+     * @brief 別のマスクの行 src_y の [src_x, src_x+count) を行 dst_y の dst_x へ複製
+     */
+    void copy_bits(const ValidityMask& src, int src_y, int src_x, int dst_y, int dst_x,
+                   int count) noexcept {
+        const uint64_t* from =
+            src.words_.data() + static_cast<size_t>(src_y) * src.words_per_row_;
+        uint64_t* to = row_data(dst_y);
+        int i = 0;
+        while (i < count) {
+            const int pos = dst_x + i;
+            const int shift = pos % WORD_BITS;
+            const int n = std::min(WORD_BITS - shift, count - i);
+            deposit(to[pos / WORD_BITS], shift, n, extract(from, src_x + i, n));
+            i += n;
+        }
+    }
+
+    /**
+     * @brief 有効ピクセル数
+     */
+    [[nodiscard]] size_t count() const noexcept {
+        size_t n = 0;
+        for (uint64_t w : words_) {
+            n += static_cast<size_t>(std::popcount(w));
+        }
+        return n;
+    }
+
+    /**
+     * @brief 行yに有効ピクセルがあるか
+     */
+    [[nodiscard]] bool any(int y) const noexcept {
+        for (uint64_t w : row(y)) {
+            if (w != 0)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief 行のワードkで有効なビット (行末の余りを除いた全ビット)
+     */
+    [[nodiscard]] uint64_t full_word(int k) const noexcept {
+        const int bits = std::min(WORD_BITS, width_ - k * WORD_BITS);
+        return bits >= WORD_BITS ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+    }
+
+   private:
+    static constexpr uint64_t bit(int x) noexcept { return uint64_t{1} << (x % WORD_BITS); }
+
+    uint64_t* row_data(int y) noexcept {
+        return words_.data() + static_cast<size_t>(y) * words_per_row_;
+    }
+    uint64_t& word_at(int x, int y) noexcept { return row_data(y)[x / WORD_BITS]; }
+
+    /**
+     * @brief ワードの [shift, shift+n) ビットを bits の下位nビットで置き換える
+     */
+    static void deposit(uint64_t& word, int shift, int n, uint64_t bits) noexcept {
+        const uint64_t mask = (n >= WORD_BITS ? ~uint64_t{0} : (uint64_t{1} << n) - 1) << shift;
+        word = (word & ~mask) | ((bits << shift) & mask);
+    }
+
+    /**
+     * @brief 行の先頭から pos ビット目以降のnビット (n <= 64) を取り出す
+     */
+    static uint64_t extract(const uint64_t* words, int pos, int n) noexcept {
+        const int index = pos / WORD_BITS;
+        const int shift = pos % WORD_BITS;
+        uint64_t bits = words[index] >> shift;
+        if (shift != 0 && shift + n > WORD_BITS) {
+            bits |= words[index + 1] << (WORD_BITS - shift);
+        }
+        return n >= WORD_BITS ? bits : bits & ((uint64_t{1} << n) - 1);
+    }
+
+    int width_{};
+    int height_{};
+    int words_per_row_{};
+    std::vector<uint64_t> words_;
+};
+
+}  // namespace fgd_converter
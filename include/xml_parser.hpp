@@ -11,6 +11,8 @@
 #include <system_error>
 #include <vector>
 
+#include "surface_class.hpp"
+
 namespace fgd_converter::xml {
 
 // XMLパース用コンセプト
@@ -44,7 +46,12 @@ struct StartPoint {
 
 class XmlParser {
    public:
-    explicit XmlParser(std::string_view xml_content);
+    /**
+     * @param sea_at_zero 海域の-9999を0mとして扱う
+     * @param surface_classes 各行の種別を保持する (get_surface_classes)
+     */
+    explicit XmlParser(std::string_view xml_content, bool sea_at_zero = true,
+                       bool surface_classes = false);
     ~XmlParser();
 
     // ムーブのみ可能な型
@@ -62,6 +69,11 @@ class XmlParser {
     [[nodiscard]] auto get_mesh_code() const -> std::optional<std::string>;
     [[nodiscard]] auto get_dem_type() const -> std::optional<std::string>;
 
+    /**
+     * @brief tupleListの各行の種別 (SurfaceClass、構築時に surface_classes を指定した場合のみ)
+     */
+    [[nodiscard]] auto get_surface_classes() const -> std::optional<std::vector<uint8_t>>;
+
     [[nodiscard]] static auto extract_file_name(std::string_view xml_path) -> std::string;
     [[nodiscard]] static auto validate_xml(std::string_view xml_content) -> bool;
 
@@ -110,8 +122,8 @@ class FastTupleListParser {
             if (comma >= end)
                 break;
 
-            // 種別を抽出 (海域判定用)
-            std::string_view type(ptr, comma - ptr);
+            // 種別を分類 (海域・データなしの判定用)
+            const SurfaceClass surface_class = classify_surface(std::string_view(ptr, comma - ptr));
 
             // カンマの次へ移動
             const char* value_start = comma + 1;
@@ -138,12 +150,7 @@ class FastTupleListParser {
 #endif
 
             if (parse_ok) {
-                // 必要に応じて海域ポイントを処理
-                if (sea_at_zero && value <= -9999.0 && is_sea_type(type)) {
-                    elevation_list.push_back(0.0);
-                } else {
-                    elevation_list.push_back(value);
-                }
+                elevation_list.push_back(surface_elevation(surface_class, value, sea_at_zero));
             } else {
                 // パースエラー - デフォルト値をプッシュ
                 elevation_list.push_back(-9999.0);
@@ -160,14 +167,6 @@ class FastTupleListParser {
     }
 
    private:
-    /**
-     * @brief 種別が海域ポイントを示すか確認
-     */
-    static bool is_sea_type(std::string_view type) {
-        // FGD DEMの一般的な海域種別
-        return type == "海水面" || type == "海水底面";
-    }
-
     /**
      * @brief より良い事前割り当てのために改行数をカウント
      */
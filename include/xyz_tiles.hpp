@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+
+#include "mosaic.hpp"
+#include "raster_kernels.hpp"
+
+namespace fgd_converter {
+
+/**
+ * @brief XYZタイル (Web Mercator) 出力の設定
+ */
+struct XyzTileConfig {
+    int min_zoom{0};
+    int max_zoom{14};
+    int tile_size{256};  // 256 または 512
+    RgbEncoding encoding{RgbEncoding::Mapbox};
+};
+
+/**
+ * @brief エンコード済みタイルの出力先
+ *
+ * write() は複数スレッドから同時に呼ばれるため、実装はスレッドセーフであること。
+ */
+class TileWriter {
+   public:
+    virtual ~TileWriter() = default;
+
+    [[nodiscard]] virtual bool write(int z, uint32_t x, uint32_t y, std::span<const uint8_t> data,
+                                     std::error_code& ec) = 0;
+
+    /**
+     * @brief すべてのタイルの書き込み後に1度だけ呼ばれる
+     */
+    [[nodiscard]] virtual bool finish(std::error_code& ec) {
+        (void)ec;
+        return true;
+    }
+};
+
+/**
+ * @brief <root>/{z}/{x}/{y}.png のディレクトリ構成で書き出すTileWriter
+ */
+class DirectoryTileWriter final : public TileWriter {
+   public:
+    explicit DirectoryTileWriter(std::filesystem::path root, std::string extension = ".png");
+
+    [[nodiscard]] bool write(int z, uint32_t x, uint32_t y, std::span<const uint8_t> data,
+                             std::error_code& ec) override;
+
+   private:
+    std::filesystem::path root_;
+    std::string extension_;
+    std::mutex directory_mutex_;  // ディレクトリ作成の競合を防ぐ
+};
+
+/**
+ * @brief 結合済み標高ラスター群からTerrain-RGBのXYZタイルピラミッドを作成
+ *
+ * 最大ズームのタイルは各ピクセル中心をWeb Mercatorから解析的に緯度経度へ逆変換し、
+ * 入力ラスターを直接バイリニア補間してTBBで並列に描画する。
+ * それより低いズームは1段上のタイル4枚の標高を2×2平均で縮小して作成する
+ * (RGB値ではなく標高を平均する)。GeoTIFFを経由しない。
+ *
+ * 保持するのは処理中のズームとその1段上の標高タイルのみ。
+ * 入力ラスター (x_length == 0 のものは無視) が重なる場合は先に指定したものを優先し、
+ * どのラスターにも値がないタイルは出力しない。
+ *
+ * @return 出力したタイル数、失敗時はstd::nullopt (ecに理由を設定)
+ */
+[[nodiscard]] auto write_xyz_tiles(std::span<const Mosaic> sources, const XyzTileConfig& config,
+                                   TileWriter& writer, std::error_code& ec)
+    -> std::optional<size_t>;
+
+}  // namespace fgd_converter
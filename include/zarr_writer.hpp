@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+namespace fgd_converter {
+
+/**
+ * @brief Zarr v2 出力の設定
+ */
+struct ZarrOptions {
+    int chunk_size{512};        // チャンクの一辺 (ピクセル)
+    int compression_level{5};  // zlib圧縮レベル (1-9)
+};
+
+/**
+ * @brief バイトシャッフル (blosc/numcodecs の shuffle と同じ並べ替え)
+ *
+ * count個の要素 (各element_sizeバイト) を、全要素の第0バイト, 第1バイト, ... の順に並べ替える。
+ * 標高のfloat32では上位バイトがそろうため、後段のDeflate圧縮が効きやすくなる。
+ */
+void byte_shuffle(const uint8_t* src, size_t count, size_t element_size, uint8_t* dst) noexcept;
+
+/**
+ * @brief 結合済み標高ラスターをZarr v2 (ディレクトリ形式) で書き出す
+ *
+ * float32の2次元配列 [height, width] を chunk_size 四方のチャンクに分け、
+ * shuffleフィルタ + zlib圧縮で "<行>.<列>" ファイルとして出力する。
+ * チャンクは互いに独立したファイルのため、書き込みロックなしでTBB並列に処理する。
+ * 全画素がデータなし (-9999) のチャンクは書き出さない (読み込み時はfill_valueになる)。
+ * 座標系はEPSG:4326で、geo_transformは .zattrs に格納する。
+ *
+ * @param store_path 出力するストアのディレクトリ (既存のZarrストアは置き換える)
+ */
+[[nodiscard]] bool write_zarr(const std::filesystem::path& store_path,
+                              const std::vector<std::vector<double>>& data, int width, int height,
+                              const std::array<double, 6>& geo_transform,
+                              const ZarrOptions& options, std::error_code& ec);
+
+}  // namespace fgd_converter
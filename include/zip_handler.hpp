@@ -1,18 +1,45 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <span>
+#include <string>
 #include <string_view>
 #include <system_error>
 #include <vector>
 
 namespace fgd_converter::zip {
 
+/**
+ * @brief メモリ上に展開したエントリ
+ */
+struct FileData {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief セントラルディレクトリから読み取ったエントリ情報 (展開を伴わない)
+ */
+struct EntryInfo {
+    std::string name;
+    uint32_t crc32{};              // 展開後データのCRC-32
+    uint64_t compressed_size{};    // 圧縮後のバイト数
+    uint64_t uncompressed_size{};  // 展開後のバイト数
+    uint64_t offset{};             // ローカルヘッダーのアーカイブ内オフセット
+};
+
 class ZipHandler {
    public:
     explicit ZipHandler(std::filesystem::path zip_path);
+
+    /**
+     * @brief メモリ上のZIPデータを開く (バッファはハンドラより長く生存している必要がある)
+     */
+    explicit ZipHandler(std::span<const uint8_t> buffer);
     ~ZipHandler();
 
     // ムーブのみ可能な型
@@ -31,9 +58,43 @@ class ZipHandler {
     [[nodiscard]] auto list_files(std::error_code& ec) const
         -> std::optional<std::vector<std::string>>;
 
+    /**
+     * @brief ディレクトリを除く全エントリの情報をセントラルディレクトリから取得
+     */
+    [[nodiscard]] auto list_entries(std::error_code& ec) const
+        -> std::optional<std::vector<EntryInfo>>;
+
     [[nodiscard]] auto read_file(std::string_view filename,
                                  std::error_code& ec) const -> std::optional<std::vector<uint8_t>>;
 
+    /**
+     * @brief 条件に一致するエントリを1回の走査でメモリ上に展開
+     *
+     * @param filter エントリ名を受け取り、展開する場合にtrueを返す関数
+     */
+    [[nodiscard]] auto read_all(const std::function<bool(std::string_view)>& filter,
+                                std::error_code& ec) const -> std::optional<std::vector<FileData>>;
+
+    /**
+     * @brief エントリをローカルヘッダーのオフセットから直接展開 (セントラルディレクトリは読まない)
+     *
+     * 無圧縮・deflateのみ対応。ローカルヘッダーの署名やCRC-32が一致しない場合
+     * (カタログ作成後にアーカイブが更新された場合など) は失敗する。
+     *
+     * @param entries list_entries またはカタログから取得したエントリ情報
+     */
+    [[nodiscard]] auto read_entries(std::span<const EntryInfo> entries, std::error_code& ec) const
+        -> std::optional<std::vector<FileData>>;
+
+    /**
+     * @brief 条件に一致するエントリの先頭部分のみを1回の走査で展開 (ヘッダーの解析用)
+     *
+     * @param max_bytes エントリごとに展開する最大バイト数 (残りは展開しない)
+     */
+    [[nodiscard]] auto read_heads(const std::function<bool(std::string_view)>& filter,
+                                  size_t max_bytes, std::error_code& ec) const
+        -> std::optional<std::vector<FileData>>;
+
    private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
@@ -1,28 +1,23 @@
 #include "converter.hpp"
 
-#include <algorithm>
-#include <cmath>
-#include <cstring>  // for memcpy
 #include <iostream>
-#include <numeric>
-#include <set>
 #include <sstream>
 
 #include "geotiff.hpp"
-
-// SIMDイントリンシクスのプラットフォーム検出
-#if defined(__x86_64__) || defined(_M_X64)
-#    if defined(__AVX2__)
-#        define HAS_AVX2 1
-#        include <immintrin.h>
-#    endif
-#elif defined(__aarch64__) || defined(_M_ARM64)
-#    define HAS_NEON 1
-#    include <arm_neon.h>
-#endif
+#include "mosaic.hpp"
+#include "stats.hpp"
+#include "zarr_writer.hpp"
 
 namespace fgd_converter {
 
+auto parse_output_format(std::string_view name) -> std::optional<OutputFormat> {
+    if (name == "geotiff")
+        return OutputFormat::GeoTiff;
+    if (name == "zarr")
+        return OutputFormat::Zarr;
+    return std::nullopt;
+}
+
 Converter::Converter(Config config) : config_(std::move(config)) {
     if (!std::filesystem::exists(config_.import_path)) {
         std::stringstream ss;
@@ -34,183 +29,137 @@ Converter::Converter(Config config) : config_(std::move(config)) {
         std::filesystem::create_directories(config_.output_path);
     }
 
-    dem_ = std::make_unique<Dem>(config_.import_path, config_.sea_at_zero);
-}
-
-auto Converter::calc_image_size(span<const Metadata> meta_data_list) const noexcept
-    -> std::pair<int, int> {
-    if (meta_data_list.empty()) {
-        return {0, 0};
-    }
-
-    auto bounds = dem_->get_bounds_latlng();
-
-    // 最初のメタデータからピクセルサイズを計算
-    double pixel_size_x = (meta_data_list[0].upper_corner_y - meta_data_list[0].lower_corner_y) /
-                          meta_data_list[0].x_length;
-    double pixel_size_y = (meta_data_list[0].lower_corner_x - meta_data_list[0].upper_corner_x) /
-                          meta_data_list[0].y_length;
-
-    // 境界とピクセルサイズに基づいて総画像サイズを計算
-    int x_length =
-        static_cast<int>(std::round(std::abs((bounds.max_lng - bounds.min_lng) / pixel_size_x)));
-    int y_length =
-        static_cast<int>(std::round(std::abs((bounds.max_lat - bounds.min_lat) / pixel_size_y)));
-
-    return {x_length, y_length};
+    dem_ = std::make_unique<Dem>(config_.import_path, config_.sea_at_zero, config_.mesh_cache,
+                                 config_.entries, config_.surface_class);
 }
 
-auto Converter::combine_meta_data_and_contents(
-    span<const Metadata> meta_data_list, span<const std::vector<std::vector<double>>> np_array_list)
-    const -> std::tuple<std::vector<std::vector<double>>, int, int> {
-    auto [total_x, total_y] = calc_image_size(meta_data_list);
-    auto bounds = dem_->get_bounds_latlng();
-
-    // 出力配列を初期化
-    std::vector<std::vector<double>> combined_array(total_y, std::vector<double>(total_x, -9999.0));
-
-    // ピクセルサイズを計算
-    double pixel_size_x = (meta_data_list[0].upper_corner_y - meta_data_list[0].lower_corner_y) /
-                          meta_data_list[0].x_length;
-    double pixel_size_y = (meta_data_list[0].lower_corner_x - meta_data_list[0].upper_corner_x) /
-                          meta_data_list[0].y_length;
-
-    // 各メッシュデータを結合配列に配置
-    for (size_t i = 0; i < meta_data_list.size() && i < np_array_list.size(); ++i) {
-        const auto &metadata = meta_data_list[i];
-        const auto &np_array = np_array_list[i];
-
-        // 左下角からの距離を計算
-        double lat_distance = metadata.lower_corner_x - bounds.min_lat;
-        double lon_distance = metadata.lower_corner_y - bounds.min_lng;
-
-        // 配列上の座標を取得 (誤差除去のため四捨五入)
-        int x_coordinate = static_cast<int>(std::round(lon_distance / pixel_size_x));
-        int y_coordinate = static_cast<int>(std::round(lat_distance / (-pixel_size_y)));
-
-        int x_len = metadata.x_length;
-        int y_len = metadata.y_length;
-
-        // 行と列の位置を計算
-        int row_start = total_y - (y_coordinate + y_len);
-        int column_start = x_coordinate;
-
-        // 配列データをコピー - 最適化版
-        for (int y = 0; y < y_len && y < static_cast<int>(np_array.size()); ++y) {
-            int target_row = row_start + y;
-            if (target_row < 0 || target_row >= total_y)
-                continue;
-
-            // 安全なコピー範囲を計算
-            int src_start = 0;
-            int dst_start = column_start;
-            int copy_len = x_len;
-
-            // コピー先が配列境界より前から始まる場合は調整
-            if (dst_start < 0) {
-                src_start = -dst_start;
-                copy_len += dst_start;
-                dst_start = 0;
-            }
-
-            // コピー先が配列境界を超える場合は調整
-            if (dst_start + copy_len > total_x) {
-                copy_len = total_x - dst_start;
-            }
-
-            // コピー元が利用可能データを超える場合は調整
-            int src_available = static_cast<int>(np_array[y].size()) - src_start;
-            if (copy_len > src_available) {
-                copy_len = src_available;
-            }
-
-            // memcpyを使用した一括コピー (要素ごとより大幅に高速)
-            if (copy_len > 0) {
-                std::memcpy(&combined_array[target_row][dst_start], &np_array[y][src_start],
-                            copy_len * sizeof(double));
-            }
-        }
+void Converter::report_progress(std::string_view stage) const {
+    if (config_.on_progress) {
+        config_.on_progress(stage);
     }
-
-    return {combined_array, total_x, total_y};
 }
 
 bool Converter::make_data_for_geotiff(std::vector<std::vector<double>> &np_array,
                                       std::array<double, 6> &geo_transform, int &x_length,
-                                      int &y_length, std::error_code &ec) {
+                                      int &y_length, ValidityMask &valid,
+                                      std::vector<uint8_t> &classes, std::error_code &ec) {
     if (!dem_) {
         ec = std::make_error_code(std::errc::invalid_argument);
         return false;
     }
 
-    dem_->get_xml_content();
+    // ヘッダーのみから画像サイズを決め、メッシュは1つずつパース・配置して解放する
+    report_progress("parse");
+    dem_->scan_headers();
 
     auto meta_data_list = dem_->get_metadata_list();
-    auto np_array_list = dem_->get_np_array_list();
+    if (meta_data_list.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return false;
+    }
 
-    if (meta_data_list.empty() || np_array_list.empty()) {
+    report_progress("combine");
+    MosaicBuilder builder(meta_data_list, dem_->get_bounds_latlng(), config_.surface_class);
+    size_t placed = 0;
+    for (const auto &mesh : dem_->meshes()) {
+        stats::ScopedTimer timer(stats::Stage::Combine);
+        builder.place(mesh);
+        ++placed;
+    }
+
+    if (placed == 0) {
         ec = std::make_error_code(std::errc::no_such_file_or_directory);
         return false;
     }
 
-    auto [combined_array, combined_x_length, combined_y_length] =
-        combine_meta_data_and_contents(meta_data_list, np_array_list);
+    Mosaic mosaic = builder.finish();
+    if (config_.surface_class) {
+        classes = builder.take_classes();
+    }
 
-    // ジオ変換を計算
-    auto bounds = dem_->get_bounds_latlng();
+    np_array = std::move(mosaic.data);
+    geo_transform = mosaic.geo_transform;
+    x_length = mosaic.x_length;
+    y_length = mosaic.y_length;
+    valid = std::move(mosaic.valid);
 
-    double pixel_width = (bounds.max_lng - bounds.min_lng) / combined_x_length;
-    double pixel_height = -(bounds.max_lat - bounds.min_lat) / combined_y_length;
+    return true;
+}
 
-    geo_transform = {
-        bounds.min_lng,  // 左上X
-        pixel_width,     // ピクセル幅
-        0.0,             // 回転
-        bounds.max_lat,  // 左上Y
-        0.0,             // 回転
-        pixel_height     // ピクセル高さ (負の値)
+bool Converter::write_terrain_bands(const std::vector<std::vector<double>> &np_array,
+                                    const std::array<double, 6> &geo_transform, int x_length,
+                                    int y_length, const ValidityMask &valid,
+                                    const std::filesystem::path &output_file,
+                                    std::error_code &ec) const {
+    // 結合済みの標高配列から直接計算 (出力GeoTIFFの再読み込みは不要)
+    auto bands =
+        compute_terrain(np_array, x_length, y_length, geo_transform, config_.terrain, &valid);
+
+    // 斜面方位は0/360度の境界と平坦 (-1) を補間で混ぜないよう最近傍で再投影する
+    struct BandOutput {
+        const char *suffix;
+        const std::vector<float> *band;
+        bool nearest;
     };
+    const BandOutput outputs[] = {{"_slope", &bands.slope, false},
+                                  {"_aspect", &bands.aspect, true},
+                                  {"_hillshade", &bands.hillshade, false}};
+
+    for (const auto &[suffix, band, nearest] : outputs) {
+        if (band->empty())
+            continue;
 
-    np_array = std::move(combined_array);
-    x_length = combined_x_length;
-    y_length = combined_y_length;
+        std::filesystem::path band_file = output_file;
+        band_file.replace_filename(output_file.stem().string() + suffix + ".tif");
 
+        if (!write_float_geotiff(band_file, *band, x_length, y_length, geo_transform,
+                                 TerrainBands::NO_DATA, config_.output_epsg, ec, nearest)) {
+            return false;
+        }
+        std::cout << "出力先: " << band_file.string() << "\n";
+    }
     return true;
 }
 
-bool Converter::run(std::error_code &ec) {
-    std::vector<std::vector<double>> np_array;
-    std::array<double, 6> geo_transform;
-    int x_length, y_length;
+bool Converter::write_class_band(const std::vector<uint8_t> &classes,
+                                 const std::array<double, 6> &geo_transform, int x_length,
+                                 int y_length, const std::filesystem::path &output_file,
+                                 std::error_code &ec) const {
+    // 種別は標高と同時に MosaicBuilder で配置済み (XMLの再パースは不要)
+    std::filesystem::path class_file = output_file;
+    class_file.replace_filename(output_file.stem().string() + "_class.tif");
 
-    if (!make_data_for_geotiff(np_array, geo_transform, x_length, y_length, ec)) {
+    if (!write_class_geotiff(class_file, classes, x_length, y_length, geo_transform,
+                             config_.output_epsg, ec)) {
         return false;
     }
+    std::cout << "出力先: " << class_file.string() << "\n";
+    return true;
+}
 
-    // 出力ファイル名を決定
-    std::filesystem::path output_file;
-    if (config_.file_name) {
-        output_file = config_.output_path / *config_.file_name;
-    } else {
-        output_file = config_.output_path / config_.import_path.stem();
-        output_file.replace_extension(".tif");
-    }
-
-    // GeoTIFFを作成
+bool Converter::write_geotiff(const std::vector<std::vector<double>> &np_array,
+                              const std::array<double, 6> &geo_transform, int x_length,
+                              int y_length, const ValidityMask &valid,
+                              const std::filesystem::path &output_file,
+                              std::error_code &ec) const {
     GeoTiff::Config geotiff_config{.geo_transform = geo_transform,
                                    .np_array = np_array,
                                    .x_length = x_length,
                                    .y_length = y_length,
-                                   .output_path = output_file};
+                                   .output_path = output_file,
+                                   .rgb_encoding = config_.rgb_encoding,
+                                   .valid = &valid};
 
     GeoTiff geotiff(geotiff_config);
 
+    report_progress("write");
     if (!geotiff.create(config_.output_epsg, config_.rgbify, ec)) {
         return false;
     }
 
     // 必要に応じてリサンプリング
     if (config_.output_epsg != "EPSG:4326") {
+        report_progress("resample");
         std::error_code resample_ec;
         if (!geotiff.resampling(config_.output_epsg, resample_ec)) {
             std::cerr << "警告: リサンプリングに失敗しました\n";
@@ -221,4 +170,67 @@ bool Converter::run(std::error_code &ec) {
     return true;
 }
 
+bool Converter::run(std::error_code &ec) {
+    // 以降の計測 (展開・パース・結合・出力) をこのアーカイブに帰属させる
+    stats::ArchiveScope archive(config_.import_path.filename().string());
+
+    std::vector<std::vector<double>> np_array;
+    std::array<double, 6> geo_transform;
+    int x_length, y_length;
+    ValidityMask valid;
+    std::vector<uint8_t> classes;
+
+    if (!make_data_for_geotiff(np_array, geo_transform, x_length, y_length, valid, classes,
+                               ec)) {
+        return false;
+    }
+    stats::MemoryCharge mosaic_charge(stats::Memory::Mosaic, stats::bytes_of(np_array));
+
+    // 出力ファイル名を決定
+    const bool zarr = config_.output_format == OutputFormat::Zarr;
+    std::filesystem::path output_file;
+    if (config_.file_name) {
+        output_file = config_.output_path / *config_.file_name;
+    } else {
+        output_file = config_.output_path / config_.import_path.stem();
+        output_file.replace_extension(zarr ? ".zarr" : ".tif");
+    }
+
+    if (zarr) {
+        // チャンク配列として結合済み配列から直接出力 (再投影は行わない)
+        if (config_.output_epsg != "EPSG:4326") {
+            std::cerr << "警告: Zarr出力はEPSG:4326で行います (" << config_.output_epsg
+                      << " は無視されます)\n";
+        }
+        report_progress("write");
+        if (!write_zarr(output_file, np_array, x_length, y_length, geo_transform, ZarrOptions{},
+                        ec)) {
+            return false;
+        }
+        std::cout << "出力先: " << output_file.string() << "\n";
+    } else if (!write_geotiff(np_array, geo_transform, x_length, y_length, valid, output_file,
+                              ec)) {
+        return false;
+    }
+    output_file_ = output_file;
+
+    // 地形派生バンドを同じ結合済み配列から出力
+    if (config_.terrain.any()) {
+        report_progress("terrain");
+        if (!write_terrain_bands(np_array, geo_transform, x_length, y_length, valid, output_file,
+                                 ec)) {
+            return false;
+        }
+    }
+
+    if (config_.surface_class) {
+        report_progress("class");
+        if (!write_class_band(classes, geo_transform, x_length, y_length, output_file, ec)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 }  // namespace fgd_converter
\ No newline at end of file
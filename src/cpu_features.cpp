@@ -0,0 +1,145 @@
+#include "cpu_features.hpp"
+
+#include <atomic>
+#include <iomanip>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#    include <immintrin.h>
+#    include <intrin.h>
+#endif
+
+namespace fgd_converter::cpu {
+
+namespace {
+
+struct Features {
+    bool sse42;
+    bool avx2;
+    bool avx512;
+};
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+
+Features query_features() noexcept {
+    // libgccの判定はXGETBVでOSのレジスタ保存も確認する
+    __builtin_cpu_init();
+    return {
+        .sse42 = __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1") &&
+                 __builtin_cpu_supports("sse4.2"),
+        .avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"),
+        .avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                  __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq"),
+    };
+}
+
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+
+Features query_features() noexcept {
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    const bool ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    const bool sse42 = (info[2] & (1 << 20)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    // XCR0: SSE/AVXの状態 (bit 1, 2)、AVX-512の状態 (bit 5-7) をOSが保存するか
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool os_avx = (xcr0 & 0x6) == 0x6;
+    const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+
+    int ext[4] = {};
+    if (max_leaf >= 7) {
+        __cpuidex(ext, 7, 0);
+    }
+    const bool avx2 = (ext[1] & (1 << 5)) != 0;
+    const bool avx512f = (ext[1] & (1 << 16)) != 0;
+    const bool avx512dq = (ext[1] & (1 << 17)) != 0;
+    const bool avx512bw = (ext[1] & (1 << 30)) != 0;
+    const bool avx512vl = (ext[1] & (1 << 31)) != 0;
+
+    return {
+        .sse42 = ssse3 && sse41 && sse42,
+        .avx2 = os_avx && avx2 && fma,
+        .avx512 = os_avx512 && avx512f && avx512dq && avx512bw && avx512vl,
+    };
+}
+
+#else
+
+Features query_features() noexcept { return {.sse42 = false, .avx2 = false, .avx512 = false}; }
+
+#endif
+
+Level detect_once() noexcept {
+    const Features f = query_features();
+    if (f.avx512 && f.avx2)
+        return Level::Avx512;
+    if (f.avx2 && f.sse42)
+        return Level::Avx2;
+    if (f.sse42)
+        return Level::Sse42;
+    return Level::Scalar;
+}
+
+std::atomic<Level>& active_level() noexcept {
+    static std::atomic<Level> level{detect()};
+    return level;
+}
+
+}  // namespace
+
+auto level_name(Level level) noexcept -> std::string_view {
+    switch (level) {
+        case Level::Scalar:
+            return "scalar";
+        case Level::Sse42:
+            return "sse4.2";
+        case Level::Avx2:
+            return "avx2";
+        case Level::Avx512:
+            return "avx512";
+    }
+    return "unknown";
+}
+
+auto parse_level(std::string_view name) -> std::optional<Level> {
+    for (Level level : {Level::Scalar, Level::Sse42, Level::Avx2, Level::Avx512}) {
+        if (name == level_name(level))
+            return level;
+    }
+    if (name == "sse42")
+        return Level::Sse42;
+    return std::nullopt;
+}
+
+auto detect() noexcept -> Level {
+    static const Level detected = detect_once();
+    return detected;
+}
+
+auto active() noexcept -> Level { return active_level().load(std::memory_order_relaxed); }
+
+bool select(Level level, std::error_code& ec) noexcept {
+    if (level > detect()) {
+        ec = std::make_error_code(std::errc::not_supported);
+        return false;
+    }
+    active_level().store(level, std::memory_order_relaxed);
+    return true;
+}
+
+void describe(std::ostream& out) {
+    const Level detected = detect();
+    out << "cpu features\n";
+    for (Level level : {Level::Scalar, Level::Sse42, Level::Avx2, Level::Avx512}) {
+        out << "  " << std::left << std::setw(8) << level_name(level)
+            << (level <= detected ? "対応" : "非対応") << (level == active() ? "  (使用中)" : "")
+            << "\n";
+    }
+}
+
+}  // namespace fgd_converter::cpu
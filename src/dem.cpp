@@ -3,6 +3,7 @@
 #include <tbb/parallel_for_each.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <mutex>
 #include <numeric>
@@ -10,16 +11,100 @@
 #include <sstream>
 #include <thread>
 
+#include "fast_fgd_parser.hpp"
 #include "flat_array_2d.hpp"
 #include "memory_mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_code.hpp"
+#include "stats.hpp"
+#include "surface_class.hpp"
+#include "trace.hpp"
 #include "tbb_pipeline.hpp"
 #include "xml_parser.hpp"
 #include "zip_handler.hpp"
 
 namespace fgd_converter {
 
-Dem::Dem(std::filesystem::path import_path, bool sea_at_zero)
-    : import_path(std::move(import_path)), sea_at_zero(sea_at_zero) {
+/**
+ * @brief meshes() で1つずつ返すためにパースしたメッシュ
+ */
+struct Dem::StreamedMesh {
+    Metadata metadata;
+    std::vector<std::vector<double>> grid;
+    ValidityMask valid;
+    std::vector<uint8_t> classes;
+};
+
+namespace {
+
+// scan_headers で読み込む各XMLの先頭バイト数 (tupleListより前のヘッダー部分)
+constexpr size_t HEADER_BYTES = 8192;
+
+/**
+ * @brief キャッシュから読み込んだ標高配列のマスク (キャッシュは標高のみを持つ)
+ */
+auto grid_mask(const std::vector<std::vector<double>> &grid) -> ValidityMask {
+    const int width = grid.empty() ? 0 : static_cast<int>(grid[0].size());
+    ValidityMask mask(width, static_cast<int>(grid.size()));
+    for (size_t y = 0; y < grid.size(); ++y) {
+        mask.assign_row(static_cast<int>(y), 0, grid[y].data(), width, -9999.0);
+    }
+    return mask;
+}
+
+/**
+ * @brief エントリをローカルヘッダーのオフセットから直接展開 (アーカイブを再走査しない)
+ *
+ * カタログ作成後にアーカイブが更新されオフセットが合わない場合は、名前で走査して展開する。
+ */
+auto read_xml_entries(const zip::ZipHandler &handler, const std::vector<zip::EntryInfo> &targets,
+                      std::error_code &ec) -> std::optional<std::vector<zip::FileData>> {
+    if (auto files = handler.read_entries(targets, ec)) {
+        return files;
+    }
+    ec.clear();
+    std::set<std::string_view> names;
+    for (const auto &target : targets) {
+        names.insert(target.name);
+    }
+    return handler.read_all([&names](std::string_view name) { return names.count(name) > 0; },
+                            ec);
+}
+
+/**
+ * @brief ヘッダーのみのパース結果からメタデータを作成 (format_metadata と同じ項目)
+ */
+auto header_metadata(const xml::FastFGDParser::ParsedData &header) -> Metadata {
+    Metadata metadata;
+    metadata.mesh_code = header.mesh_code;
+    if (header.has_lower_corner) {
+        metadata.lower_corner_x = header.lower_corner_x;
+        metadata.lower_corner_y = header.lower_corner_y;
+    }
+    if (header.has_upper_corner) {
+        metadata.upper_corner_x = header.upper_corner_x;
+        metadata.upper_corner_y = header.upper_corner_y;
+    }
+    if (header.has_grid_envelope) {
+        metadata.x_length = header.grid_high_x - header.grid_low_x + 1;
+        metadata.y_length = header.grid_high_y - header.grid_low_y + 1;
+    }
+    if (header.has_dem_type) {
+        metadata.type = header.dem_type;
+    }
+    return metadata;
+}
+
+}  // namespace
+
+Dem::Dem(std::filesystem::path import_path, bool sea_at_zero,
+         std::shared_ptr<const MeshCache> mesh_cache,
+         std::optional<std::vector<zip::EntryInfo>> entries, bool surface_classes)
+    : import_path(std::move(import_path)),
+      sea_at_zero(sea_at_zero),
+      surface_classes(surface_classes),
+      mesh_cache(std::move(mesh_cache)),
+      entries(std::move(entries)) {
     if (!std::filesystem::exists(this->import_path)) {
         std::stringstream ss;
         ss << "ファイルが見つかりません: " << this->import_path.string();
@@ -27,6 +112,16 @@ Dem::Dem(std::filesystem::path import_path, bool sea_at_zero)
     }
 }
 
+Dem::Dem(std::vector<std::string> xml_contents, bool sea_at_zero, bool surface_classes)
+    : all_content_list(std::move(xml_contents)),
+      sea_at_zero(sea_at_zero),
+      surface_classes(surface_classes) {
+    if (all_content_list.empty()) {
+        throw std::runtime_error("XMLコンテンツが空です");
+    }
+    process_contents();
+}
+
 auto Dem::contents_to_array() const -> std::vector<std::vector<double>> {
     std::vector<std::vector<double>> result;
 
@@ -38,6 +133,14 @@ auto Dem::contents_to_array() const -> std::vector<std::vector<double>> {
 }
 
 void Dem::get_xml_content() {
+    // scan_headers のメタデータは読み直す
+    mesh_code_list.clear();
+    meta_data_list.clear();
+
+    if ((mesh_cache || entries) && zip::is_zip_file(import_path) && load_entries()) {
+        return;
+    }
+
     unzip_dem();
     xml_paths = get_xml_paths();
 
@@ -45,10 +148,29 @@ void Dem::get_xml_content() {
         throw std::runtime_error("アーカイブ内にXMLファイルが見つかりません");
     }
 
-    TBBPipeline<std::string> pipeline(
-        [](std::string_view content) { return std::string(content); });
+    {
+        stats::ScopedTimer timer(stats::Stage::ReadXml);
+        TBBPipeline<std::string> pipeline(
+            [](std::string_view content) { return std::string(content); });
 
-    all_content_list = pipeline.process_files(xml_paths);
+        all_content_list = pipeline.process_files(xml_paths);
+    }
+
+    process_contents();
+}
+
+void Dem::process_contents() {
+    if (stats::enabled()) {
+        size_t bytes = 0;
+        size_t capacity = 0;
+        for (const auto &content : all_content_list) {
+            bytes += content.size();
+            capacity += content.capacity();
+        }
+        stats::add(stats::Counter::XmlFiles, all_content_list.size());
+        stats::add(stats::Counter::XmlBytes, bytes);
+        xml_buffers_charge.assign(stats::Memory::XmlBuffers, capacity);
+    }
 
     check_mesh_codes();
     populate_metadata_list();
@@ -104,6 +226,12 @@ auto Dem::get_xml_paths() -> std::vector<std::filesystem::path> {
         }
     }
 
+    // 同じメッシュの古い版は読み込まない
+    const size_t found = xml_files.size();
+    xml_files = mesh::latest_versions(std::move(xml_files),
+                                      [](const auto &path) { return path.filename().string(); });
+    stats::add(stats::Counter::Superseded, found - xml_files.size());
+
     // ファイル名でソート
     std::sort(xml_files.begin(), xml_files.end(),
               [](const auto &a, const auto &b) { return a.filename() < b.filename(); });
@@ -157,7 +285,10 @@ void Dem::check_mesh_codes() {
         }
     }
 
-    // 重複を確認
+    warn_duplicate_mesh_codes();
+}
+
+void Dem::warn_duplicate_mesh_codes() const {
     auto sorted_codes = mesh_code_list;
     std::sort(sorted_codes.begin(), sorted_codes.end());
     auto last = std::unique(sorted_codes.begin(), sorted_codes.end());
@@ -168,6 +299,397 @@ void Dem::check_mesh_codes() {
     }
 }
 
+auto Dem::list_xml_entries(const zip::ZipHandler &handler)
+    -> std::optional<std::vector<zip::EntryInfo>> {
+    std::error_code ec;
+    std::vector<zip::EntryInfo> xml_entries;
+    if (entries) {
+        xml_entries = *entries;
+    } else {
+        auto listed = handler.list_entries(ec);
+        if (!listed) {
+            return std::nullopt;
+        }
+        for (auto &entry : *listed) {
+            if (zip::is_zip_file(entry.name)) {
+                return std::nullopt;  // ネストしたZIPは従来の展開処理で扱う
+            }
+            if (std::filesystem::path(entry.name).extension() == ".xml") {
+                xml_entries.push_back(std::move(entry));
+            }
+        }
+    }
+    if (xml_entries.empty()) {
+        return std::nullopt;
+    }
+
+    // 同じメッシュの古い版は展開しない
+    const size_t found = xml_entries.size();
+    xml_entries = mesh::latest_versions(std::move(xml_entries),
+                                        [](const auto &entry) { return entry.name; });
+    stats::add(stats::Counter::Superseded, found - xml_entries.size());
+
+    // get_xml_paths と同じくファイル名順
+    std::sort(xml_entries.begin(), xml_entries.end(), [](const auto &a, const auto &b) {
+        return std::filesystem::path(a.name).filename() < std::filesystem::path(b.name).filename();
+    });
+    return xml_entries;
+}
+
+bool Dem::load_entries() {
+    zip::ZipHandler handler(import_path);
+    auto listed = list_xml_entries(handler);
+    if (!listed) {
+        return false;
+    }
+    std::vector<zip::EntryInfo> xml_entries = std::move(*listed);
+    std::error_code ec;
+
+    std::vector<size_t> indices(xml_entries.size());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    std::vector<std::optional<CachedMesh>> meshes(xml_entries.size());
+    std::vector<std::vector<uint8_t>> classes(surface_classes ? xml_entries.size() : 0);
+    std::vector<ValidityMask> masks(xml_entries.size());
+    if (mesh_cache && !surface_classes) {
+        tbb::parallel_for_each(indices, [&, archive = stats::current_archive()](size_t i) {
+            stats::ArchiveBinding binding(archive);
+            meshes[i] = mesh_cache->load(xml_entries[i], sea_at_zero);
+            if (meshes[i]) {
+                masks[i] = grid_mask(meshes[i]->grid);
+            }
+        });
+    }
+
+    std::vector<zip::EntryInfo> missing;
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        if (!meshes[i]) {
+            missing.push_back(xml_entries[i]);
+        }
+    }
+    if (mesh_cache) {
+        stats::add(stats::Counter::MeshCacheHits, xml_entries.size() - missing.size());
+        stats::add(stats::Counter::MeshCacheMisses, missing.size());
+    }
+
+    if (!missing.empty()) {
+        // キャッシュにないエントリのみをメモリ上に展開してパースし、キャッシュへ保存
+        auto files = read_xml_entries(handler, missing, ec);
+        if (!files) {
+            return false;
+        }
+        std::map<std::string, std::string_view> contents;
+        size_t bytes = 0;
+        for (const auto &file : *files) {
+            contents[file.name] = std::string_view(
+                reinterpret_cast<const char *>(file.data.data()), file.data.size());
+            bytes += file.data.size();
+        }
+        stats::add(stats::Counter::XmlFiles, files->size());
+        stats::add(stats::Counter::XmlBytes, bytes);
+
+        std::mutex cerr_mutex;
+        tbb::parallel_for_each(indices, [&, archive = stats::current_archive()](size_t i) {
+            if (meshes[i]) {
+                return;
+            }
+            auto it = contents.find(xml_entries[i].name);
+            if (it == contents.end()) {
+                return;
+            }
+            stats::ArchiveBinding binding(archive);
+            trace::Span span("xml");
+            if (span.active()) {
+                span.set_detail(std::filesystem::path(xml_entries[i].name).filename().string());
+            }
+
+            auto mesh_code = xml::XmlParser(it->second).get_mesh_code();
+            if (!mesh_code) {
+                return;  // check_mesh_codes と同じくメッシュコードのないXMLは除外
+            }
+            CachedMesh mesh{.metadata = format_metadata(it->second, *mesh_code),
+                            .grid = get_np_array(it->second, masks[i],
+                                                 surface_classes ? &classes[i] : nullptr)};
+            std::error_code store_ec;
+            if (mesh_cache && !mesh_cache->store(xml_entries[i], sea_at_zero, mesh.metadata,
+                                                 mesh.grid, store_ec)) {
+                std::lock_guard<std::mutex> lock(cerr_mutex);
+                std::cerr << "警告: メッシュキャッシュに保存できません: " << xml_entries[i].name
+                          << " (" << store_ec.message() << ")\n";
+            }
+            meshes[i] = std::move(mesh);
+        });
+    }
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        auto &mesh = meshes[i];
+        if (!mesh) {
+            continue;
+        }
+        mesh_code_list.push_back(mesh->metadata.mesh_code);
+        meta_data_list.push_back(std::move(mesh->metadata));
+        np_array_list.push_back(std::move(mesh->grid));
+        mask_list.push_back(std::move(masks[i]));
+        if (surface_classes) {
+            class_array_list.push_back(std::move(classes[i]));
+        }
+    }
+
+    warn_duplicate_mesh_codes();
+    store_bounds_latlng();
+    if (stats::enabled()) {
+        uint64_t bytes = 0;
+        for (const auto &array : np_array_list) {
+            bytes += stats::bytes_of(array);
+        }
+        mesh_grids_charge.assign(stats::Memory::MeshGrids, bytes);
+    }
+    return true;
+}
+
+void Dem::resolve_stream_sources() {
+    if (stream_resolved) {
+        return;
+    }
+
+    // ZIP内のXMLエントリをメモリ上に展開できる場合はファイルへ展開しない
+    if (zip::is_zip_file(import_path)) {
+        zip::ZipHandler handler(import_path);
+        if (auto listed = list_xml_entries(handler)) {
+            entries = std::move(*listed);
+            stream_from_zip = true;
+            stream_resolved = true;
+            return;
+        }
+    }
+
+    unzip_dem();
+    xml_paths = get_xml_paths();
+    if (xml_paths.empty()) {
+        throw std::runtime_error("アーカイブ内にXMLファイルが見つかりません");
+    }
+    stream_resolved = true;
+}
+
+void Dem::scan_headers() {
+    if (!meta_data_list.empty() || !all_content_list.empty()) {
+        return;  // 読み込み済み
+    }
+    resolve_stream_sources();
+
+    auto add_header = [this](std::string_view head) {
+        auto header = xml::FastFGDParser::parse_header(head);
+        if (!header.has_mesh_code) {
+            return;  // check_mesh_codes と同じくメッシュコードのないXMLは除外
+        }
+        mesh_code_list.push_back(header.mesh_code);
+        meta_data_list.push_back(header_metadata(header));
+    };
+
+    if (stream_from_zip) {
+        zip::ZipHandler handler(import_path);
+        std::set<std::string> names;
+        for (const auto &entry : *entries) {
+            names.insert(entry.name);
+        }
+        std::error_code ec;
+        auto heads = handler.read_heads(
+            [&names](std::string_view name) { return names.count(std::string(name)) > 0; },
+            HEADER_BYTES, ec);
+        if (!heads) {
+            std::stringstream ss;
+            ss << "展開に失敗しました: " << import_path.string();
+            throw std::runtime_error(ss.str());
+        }
+        std::map<std::string, std::string_view> head_map;
+        for (const auto &file : *heads) {
+            head_map[file.name] = std::string_view(
+                reinterpret_cast<const char *>(file.data.data()), file.data.size());
+        }
+        // get_xml_content と同じくファイル名順
+        for (const auto &entry : *entries) {
+            if (auto it = head_map.find(entry.name); it != head_map.end()) {
+                add_header(it->second);
+            }
+        }
+    } else {
+        for (const auto &path : xml_paths) {
+            MemoryMappedFile mmap(path);
+            if (mmap.is_open()) {
+                add_header(mmap.view().substr(0, HEADER_BYTES));
+            }
+        }
+    }
+
+    warn_duplicate_mesh_codes();
+    store_bounds_latlng();
+}
+
+auto Dem::decode_mesh(std::string_view xml_content) -> std::optional<StreamedMesh> {
+    auto mesh_code = xml::XmlParser(xml_content).get_mesh_code();
+    if (!mesh_code) {
+        return std::nullopt;  // check_mesh_codes と同じくメッシュコードのないXMLは除外
+    }
+    StreamedMesh mesh;
+    mesh.metadata = format_metadata(xml_content, *mesh_code);
+    mesh.grid =
+        get_np_array(xml_content, mesh.valid, surface_classes ? &mesh.classes : nullptr);
+    return mesh;
+}
+
+void Dem::decode_batch(size_t first, std::vector<std::optional<StreamedMesh>> &batch) {
+    std::vector<size_t> indices(batch.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    const auto archive = stats::current_archive();
+
+    if (!stream_from_zip) {
+        // 展開済みのXMLファイルをメモリマップしてパース
+        std::atomic<uint64_t> bytes{0};
+        tbb::parallel_for_each(indices, [&](size_t i) {
+            stats::ArchiveBinding binding(archive);
+            const auto &path = xml_paths[first + i];
+            trace::Span span("xml");
+            if (span.active()) {
+                span.set_detail(path.filename().string());
+            }
+            MemoryMappedFile mmap(path);
+            if (!mmap.is_open()) {
+                return;
+            }
+            bytes.fetch_add(mmap.size(), std::memory_order_relaxed);
+            batch[i] = decode_mesh(mmap.view());
+        });
+        stats::add(stats::Counter::XmlFiles, batch.size());
+        stats::add(stats::Counter::XmlBytes, bytes.load());
+        return;
+    }
+
+    const auto &xml_entries = *entries;
+    if (mesh_cache && !surface_classes) {
+        tbb::parallel_for_each(indices, [&](size_t i) {
+            stats::ArchiveBinding binding(archive);
+            auto cached = mesh_cache->load(xml_entries[first + i], sea_at_zero);
+            if (cached) {
+                ValidityMask valid = grid_mask(cached->grid);
+                batch[i] = StreamedMesh{.metadata = std::move(cached->metadata),
+                                        .grid = std::move(cached->grid),
+                                        .valid = std::move(valid),
+                                        .classes = {}};
+            }
+        });
+    }
+
+    std::vector<zip::EntryInfo> missing;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!batch[i]) {
+            missing.push_back(xml_entries[first + i]);
+        }
+    }
+    if (mesh_cache) {
+        stats::add(stats::Counter::MeshCacheHits, batch.size() - missing.size());
+        stats::add(stats::Counter::MeshCacheMisses, missing.size());
+    }
+    if (missing.empty()) {
+        return;
+    }
+
+    // キャッシュにないエントリのみをメモリ上に展開してパースし、キャッシュへ保存
+    zip::ZipHandler handler(import_path);
+    std::error_code ec;
+    auto files = read_xml_entries(handler, missing, ec);
+    if (!files) {
+        std::stringstream ss;
+        ss << "展開に失敗しました: " << import_path.string();
+        throw std::runtime_error(ss.str());
+    }
+    std::map<std::string, std::string_view> contents;
+    size_t bytes = 0;
+    for (const auto &file : *files) {
+        contents[file.name] =
+            std::string_view(reinterpret_cast<const char *>(file.data.data()), file.data.size());
+        bytes += file.data.size();
+    }
+    stats::add(stats::Counter::XmlFiles, files->size());
+    stats::add(stats::Counter::XmlBytes, bytes);
+
+    std::mutex cerr_mutex;
+    tbb::parallel_for_each(indices, [&](size_t i) {
+        const auto &entry = xml_entries[first + i];
+        auto it = batch[i] ? contents.end() : contents.find(entry.name);
+        if (it == contents.end()) {
+            return;
+        }
+        stats::ArchiveBinding binding(archive);
+        trace::Span span("xml");
+        if (span.active()) {
+            span.set_detail(std::filesystem::path(entry.name).filename().string());
+        }
+
+        batch[i] = decode_mesh(it->second);
+        std::error_code store_ec;
+        if (batch[i] && mesh_cache &&
+            !mesh_cache->store(entry, sea_at_zero, batch[i]->metadata, batch[i]->grid,
+                               store_ec)) {
+            std::lock_guard<std::mutex> lock(cerr_mutex);
+            std::cerr << "警告: メッシュキャッシュに保存できません: " << entry.name << " ("
+                      << store_ec.message() << ")\n";
+        }
+    });
+}
+
+auto Dem::meshes() -> Generator<MeshView> {
+    // 読み込み済みの配列をそのまま返す
+    if (!np_array_list.empty() || !all_content_list.empty()) {
+        for (size_t i = 0; i < meta_data_list.size() && i < np_array_list.size(); ++i) {
+            const auto &grid = np_array_list[i];
+            span<const uint8_t> classes;
+            if (i < class_array_list.size()) {
+                classes = span<const uint8_t>(class_array_list[i].data(),
+                                              class_array_list[i].size());
+            }
+            co_yield MeshView{.metadata = meta_data_list[i],
+                              .grid = span<const std::vector<double>>(grid.data(), grid.size()),
+                              .valid = mask_list[i],
+                              .classes = classes};
+        }
+        co_return;
+    }
+
+    resolve_stream_sources();
+    const size_t count = stream_from_zip ? entries->size() : xml_paths.size();
+    const size_t batch_size = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    // まとまりごとに並列にパースし、返し終えたまとまりは次のパースの前に解放する
+    std::vector<std::optional<StreamedMesh>> batch;
+    stats::MemoryCharge grids_charge;
+    for (size_t first = 0; first < count; first += batch_size) {
+        batch.clear();
+        batch.resize(std::min(batch_size, count - first));
+        decode_batch(first, batch);
+
+        if (stats::enabled()) {
+            uint64_t bytes = 0;
+            for (const auto &mesh : batch) {
+                if (mesh) {
+                    bytes += stats::bytes_of(mesh->grid);
+                }
+            }
+            grids_charge.assign(stats::Memory::MeshGrids, bytes);
+        }
+
+        for (const auto &mesh : batch) {
+            if (!mesh) {
+                continue;
+            }
+            co_yield MeshView{
+                .metadata = mesh->metadata,
+                .grid = span<const std::vector<double>>(mesh->grid.data(), mesh->grid.size()),
+                .valid = mesh->valid,
+                .classes = span<const uint8_t>(mesh->classes.data(), mesh->classes.size())};
+        }
+    }
+}
+
 void Dem::populate_metadata_list() {
     // スレッドセーフな並列アクセスのため事前割り当て
     size_t size = std::min(all_content_list.size(), mesh_code_list.size());
@@ -177,7 +699,8 @@ void Dem::populate_metadata_list() {
     std::vector<size_t> indices(size);
     std::iota(indices.begin(), indices.end(), 0);
 
-    tbb::parallel_for_each(indices, [this](size_t i) {
+    tbb::parallel_for_each(indices, [this, archive = stats::current_archive()](size_t i) {
+        stats::ArchiveBinding binding(archive);
         meta_data_list[i] = format_metadata(all_content_list[i], mesh_code_list[i]);
     });
 }
@@ -199,8 +722,9 @@ void Dem::store_bounds_latlng() {
     }
 }
 
-auto Dem::get_np_array(std::string_view xml_content) -> std::vector<std::vector<double>> {
-    xml::XmlParser parser(xml_content);
+auto Dem::get_np_array(std::string_view xml_content, ValidityMask &valid,
+                       std::vector<uint8_t> *classes) -> std::vector<std::vector<double>> {
+    xml::XmlParser parser(xml_content, sea_at_zero, classes != nullptr);
 
     std::error_code ec;
     auto tuple_result = parser.get_tuple_list(ec);
@@ -209,6 +733,7 @@ auto Dem::get_np_array(std::string_view xml_content) -> std::vector<std::vector<
     }
 
     const auto &elevation = (*tuple_result)[0];
+    stats::MemoryCharge elevation_charge(stats::Memory::ElevationList, stats::bytes_of(elevation));
 
     // グリッド寸法と開始点を取得
     auto envelope = parser.get_grid_envelope();
@@ -218,24 +743,47 @@ auto Dem::get_np_array(std::string_view xml_content) -> std::vector<std::vector<
         return {};
     }
 
+    stats::ScopedTimer timer(stats::Stage::Placement);
     int x_length = envelope->high_x - envelope->low_x + 1;
     int y_length = envelope->high_y - envelope->low_y + 1;
     int start_x = start->x;
     int start_y = start->y;
 
     FlatArray2D<double> array(y_length, x_length, -9999.0);
+    stats::MemoryCharge grid_charge(
+        stats::Memory::MeshGrids,
+        static_cast<uint64_t>(y_length) * static_cast<uint64_t>(x_length) * sizeof(double));
+
+    // 種別は標高と同じ位置に配置 (範囲外は SURFACE_CLASS_NODATA)
+    std::optional<std::vector<uint8_t>> line_classes;
+    if (classes) {
+        line_classes = parser.get_surface_classes();
+        classes->assign(static_cast<size_t>(y_length) * static_cast<size_t>(x_length),
+                        SURFACE_CLASS_NODATA);
+    }
+
+    valid = ValidityMask(x_length, y_length);
 
     size_t index = 0;
     int current_start_x = start_x;
 
     for (int y = start_y; y < y_length && index < elevation.size(); ++y) {
+        const size_t row_start = index;
         for (int x = current_start_x; x < x_length && index < elevation.size(); ++x) {
             array(y, x) = elevation[index];
+            if (line_classes && index < line_classes->size()) {
+                (*classes)[static_cast<size_t>(y) * x_length + x] = (*line_classes)[index];
+            }
             ++index;
         }
+        // 配置した範囲のみマスクを設定 (範囲外は無効のまま)
+        valid.assign_row(y, current_start_x, elevation.data() + row_start,
+                         static_cast<int>(index - row_start), -9999.0);
         current_start_x = 0;  // 最初の行の後はx=0から開始
     }
 
+    stats::add(stats::Counter::MeshesPlaced, 1);
+
     // 互換性のためvector<vector<double>>に変換
     return array.to_2d_vector();
 }
@@ -243,13 +791,34 @@ auto Dem::get_np_array(std::string_view xml_content) -> std::vector<std::vector<
 void Dem::store_np_array_list() {
     // スレッドセーフな並列アクセスのため事前割り当て
     np_array_list.resize(all_content_list.size());
+    mask_list.resize(all_content_list.size());
+    if (surface_classes) {
+        class_array_list.resize(all_content_list.size());
+    }
 
     // TBBを使用して配列を並列処理 (クロスプラットフォーム)
     std::vector<size_t> indices(all_content_list.size());
     std::iota(indices.begin(), indices.end(), 0);
 
-    tbb::parallel_for_each(
-        indices, [this](size_t i) { np_array_list[i] = get_np_array(all_content_list[i]); });
+    tbb::parallel_for_each(indices, [this, archive = stats::current_archive()](size_t i) {
+        stats::ArchiveBinding binding(archive);
+        trace::Span span("xml");
+        if (span.active() && i < xml_paths.size()) {
+            span.set_detail(xml_paths[i].filename().string());
+        } else if (span.active() && i < mesh_code_list.size()) {
+            span.set_detail(mesh_code_list[i]);  // メモリ上のXML (ファイル名なし)
+        }
+        np_array_list[i] = get_np_array(all_content_list[i], mask_list[i],
+                                        surface_classes ? &class_array_list[i] : nullptr);
+    });
+
+    if (stats::enabled()) {
+        uint64_t bytes = 0;
+        for (const auto &array : np_array_list) {
+            bytes += stats::bytes_of(array);
+        }
+        mesh_grids_charge.assign(stats::Memory::MeshGrids, bytes);
+    }
 }
 
 }  // namespace fgd_converter
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "fgd_dem.hpp"
+
+#include <cstring>
+#include <exception>
+#include <string_view>
+
+#include "dem.hpp"
+#include "geotiff.hpp"
+#include "mosaic.hpp"
+#include "zip_handler.hpp"
+
+namespace fgd_converter {
+
+namespace {
+
+bool ends_with_icase(std::string_view name, std::string_view suffix) {
+    if (name.size() < suffix.size())
+        return false;
+    auto tail = name.substr(name.size() - suffix.size());
+    for (size_t i = 0; i < suffix.size(); ++i) {
+        char c = tail[i];
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+        if (c != suffix[i])
+            return false;
+    }
+    return true;
+}
+
+bool is_zip(std::span<const uint8_t> input) {
+    return input.size() >= 4 && std::memcmp(input.data(), "PK\x03\x04", 4) == 0;
+}
+
+/**
+ * @brief ZIP内のXMLを収集 (ネストしたZIPは再帰的に展開)
+ */
+bool collect_xml_contents(std::span<const uint8_t> zip_data, std::vector<std::string>& contents,
+                          std::error_code& ec) {
+    zip::ZipHandler handler(zip_data);
+    auto entries = handler.read_all(
+        [](std::string_view name) {
+            return ends_with_icase(name, ".xml") || ends_with_icase(name, ".zip");
+        },
+        ec);
+    if (!entries)
+        return false;
+
+    for (auto& entry : *entries) {
+        if (ends_with_icase(entry.name, ".zip")) {
+            if (!collect_xml_contents(entry.data, contents, ec))
+                return false;
+        } else {
+            contents.emplace_back(entry.data.begin(), entry.data.end());
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 入力バイト列からDEMを構築し、1枚のモザイクへ結合
+ */
+std::optional<Mosaic> load_mosaic(std::span<const uint8_t> input, const ConvertOptions& options,
+                                  std::error_code& ec) {
+    if (input.empty()) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return std::nullopt;
+    }
+
+    std::vector<std::string> xml_contents;
+    if (is_zip(input)) {
+        if (!collect_xml_contents(input, xml_contents, ec))
+            return std::nullopt;
+    } else {
+        xml_contents.emplace_back(input.begin(), input.end());
+    }
+
+    if (xml_contents.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return std::nullopt;
+    }
+
+    try {
+        Dem dem(std::move(xml_contents), options.sea_at_zero);
+        return build_mosaic(dem.get_metadata_list(), dem.get_np_array_list(),
+                            dem.get_bounds_latlng(), dem.get_mask_list());
+    } catch (const std::exception&) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return std::nullopt;
+    }
+}
+
+}  // namespace
+
+auto convert_to_raster(std::span<const uint8_t> input, const ConvertOptions& options,
+                       std::error_code& ec) -> std::optional<Raster> {
+    auto mosaic = load_mosaic(input, options, ec);
+    if (!mosaic)
+        return std::nullopt;
+
+    Raster raster;
+    raster.width = mosaic->x_length;
+    raster.height = mosaic->y_length;
+    raster.geo_transform = mosaic->geo_transform;
+    raster.data.resize(static_cast<size_t>(raster.width) * raster.height);
+    for (int row = 0; row < raster.height; ++row) {
+        const auto& src_row = mosaic->data[row];
+        float* dst_row = raster.data.data() + static_cast<size_t>(row) * raster.width;
+        for (int col = 0; col < raster.width; ++col) {
+            dst_row[col] = static_cast<float>(src_row[col]);
+        }
+    }
+    return raster;
+}
+
+auto convert_to_geotiff(std::span<const uint8_t> input, const ConvertOptions& options,
+                        std::error_code& ec) -> std::optional<std::vector<uint8_t>> {
+    auto mosaic = load_mosaic(input, options, ec);
+    if (!mosaic)
+        return std::nullopt;
+
+    GeoTiff geotiff(GeoTiff::Config{.geo_transform = mosaic->geo_transform,
+                                    .np_array = mosaic->data,
+                                    .x_length = mosaic->x_length,
+                                    .y_length = mosaic->y_length,
+                                    .output_path = {},
+                                    .rgb_encoding = options.rgb_encoding,
+                                    .valid = &mosaic->valid});
+
+    std::vector<uint8_t> out;
+    if (!geotiff.encode(options.epsg, options.rgbify, out, ec))
+        return std::nullopt;
+    return out;
+}
+
+}  // namespace fgd_converter
@@ -0,0 +1,112 @@
+#include "fgd_dem_c.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "fgd_dem.hpp"
+
+namespace {
+
+fgd_converter::ConvertOptions to_options(const fgd_dem_options* options) {
+    fgd_converter::ConvertOptions result;
+    if (options) {
+        if (options->epsg)
+            result.epsg = options->epsg;
+        result.rgbify = options->rgbify != 0;
+        result.sea_at_zero = options->sea_at_zero != 0;
+    }
+    return result;
+}
+
+int to_status(const std::error_code& ec) {
+    if (!ec)
+        return static_cast<int>(std::errc::io_error);
+    return ec.value();
+}
+
+/**
+ * @brief 呼び出し元へ返すバッファを確保してコピー (0バイトの場合はNULLで成功とする)
+ *
+ * malloc(0) はNULLを返しうるため、メモリ不足と区別できるよう0バイトは確保しない。
+ */
+bool copy_out(const void* src, size_t bytes, void** dst) {
+    if (bytes == 0) {
+        *dst = nullptr;
+        return true;
+    }
+    void* buffer = std::malloc(bytes);
+    if (!buffer)
+        return false;
+    std::memcpy(buffer, src, bytes);
+    *dst = buffer;
+    return true;
+}
+
+}  // namespace
+
+extern "C" {
+
+int fgd_dem_convert_to_geotiff(const uint8_t* input, size_t input_size,
+                               const fgd_dem_options* options, uint8_t** out, size_t* out_size) {
+    if (!input || !out || !out_size)
+        return static_cast<int>(std::errc::invalid_argument);
+
+    try {
+        std::error_code ec;
+        auto tiff = fgd_converter::convert_to_geotiff({input, input_size}, to_options(options), ec);
+        if (!tiff)
+            return to_status(ec);
+
+        void* buffer = nullptr;
+        if (!copy_out(tiff->data(), tiff->size(), &buffer))
+            return static_cast<int>(std::errc::not_enough_memory);
+        *out = static_cast<uint8_t*>(buffer);
+        *out_size = tiff->size();
+        return 0;
+    } catch (const std::bad_alloc&) {
+        return static_cast<int>(std::errc::not_enough_memory);
+    } catch (...) {
+        return static_cast<int>(std::errc::io_error);
+    }
+}
+
+int fgd_dem_convert_to_raster(const uint8_t* input, size_t input_size,
+                              const fgd_dem_options* options, float** data, int* width,
+                              int* height, double geo_transform[6]) {
+    if (!input || !data || !width || !height || !geo_transform)
+        return static_cast<int>(std::errc::invalid_argument);
+
+    try {
+        std::error_code ec;
+        auto raster =
+            fgd_converter::convert_to_raster({input, input_size}, to_options(options), ec);
+        if (!raster)
+            return to_status(ec);
+
+        void* buffer = nullptr;
+        if (!copy_out(raster->data.data(), raster->data.size() * sizeof(float), &buffer))
+            return static_cast<int>(std::errc::not_enough_memory);
+        *data = static_cast<float*>(buffer);
+        *width = raster->width;
+        *height = raster->height;
+        std::copy(raster->geo_transform.begin(), raster->geo_transform.end(), geo_transform);
+        return 0;
+    } catch (const std::bad_alloc&) {
+        return static_cast<int>(std::errc::not_enough_memory);
+    } catch (...) {
+        return static_cast<int>(std::errc::io_error);
+    }
+}
+
+void fgd_dem_free(void* ptr) { std::free(ptr); }
+
+const char* fgd_dem_error_message(int code) {
+    thread_local std::string message;
+    message = code == 0 ? std::string("success")
+                        : std::generic_category().message(code);
+    return message.c_str();
+}
+
+}  // extern "C"
@@ -0,0 +1,712 @@
+#include "fgd_synth.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_pipeline.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <span>
+#include <thread>
+
+#include "mesh_code.hpp"
+
+namespace fgd_converter::synth {
+
+namespace {
+
+constexpr double KM_PER_DEG_LAT = 111.0;
+constexpr double KM_PER_DEG_LNG = 91.0;  // 北緯35度付近の値 (地形の縮尺にのみ使用)
+constexpr int CALIBRATION_SAMPLES = 4096;
+constexpr int MAX_OCTAVES = 14;
+constexpr uint32_t ZIP_LIMIT = std::numeric_limits<uint32_t>::max();
+
+/**
+ * @brief splitmix64の最終混合 (整数ハッシュ)
+ */
+constexpr uint64_t mix64(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief 64ビットハッシュを [0, 1) の実数へ変換
+ */
+constexpr double unit(uint64_t h) noexcept {
+    return static_cast<double>(h >> 11) * 0x1.0p-53;
+}
+
+uint64_t hash_text(std::string_view text) noexcept {
+    uint64_t h = 0xCBF29CE484222325ULL;  // FNV-1a
+    for (char c : text) {
+        h = (h ^ static_cast<uint8_t>(c)) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief 格子点に乱数値を置いたバリューノイズ (出力は概ね [-1, 1])
+ */
+double value_noise(uint64_t seed, double x, double y) noexcept {
+    const double fx = std::floor(x);
+    const double fy = std::floor(y);
+    const auto ix = static_cast<int64_t>(fx);
+    const auto iy = static_cast<int64_t>(fy);
+
+    auto lattice = [seed](int64_t gx, int64_t gy) {
+        uint64_t h = mix64(seed ^ mix64(static_cast<uint64_t>(gx) * 0x9E3779B97F4A7C15ULL ^
+                                        static_cast<uint64_t>(gy)));
+        return unit(h) * 2.0 - 1.0;
+    };
+    auto fade = [](double t) { return t * t * t * (t * (t * 6.0 - 15.0) + 10.0); };
+
+    const double tx = fade(x - fx);
+    const double ty = fade(y - fy);
+    const double top = lattice(ix, iy) + (lattice(ix + 1, iy) - lattice(ix, iy)) * tx;
+    const double bottom =
+        lattice(ix, iy + 1) + (lattice(ix + 1, iy + 1) - lattice(ix, iy + 1)) * tx;
+    return top + (bottom - top) * ty;
+}
+
+/**
+ * @brief fBm (オクターブごとに周波数2倍・振幅1/2のノイズの和)
+ */
+struct Fbm {
+    uint64_t seed;
+    double frequency;  // 1/km
+    int octaves;
+
+    [[nodiscard]] double sample(double x_km, double y_km) const noexcept {
+        double sum = 0.0;
+        double amplitude = 1.0;
+        double total = 0.0;
+        double f = frequency;
+        for (int o = 0; o < octaves; ++o) {
+            sum += amplitude * value_noise(seed + static_cast<uint64_t>(o), x_km * f, y_km * f);
+            total += amplitude;
+            amplitude *= 0.5;
+            f *= 2.0;
+        }
+        return sum / total;
+    }
+};
+
+/**
+ * @brief メッシュの並べ方 (origin から東へ columns 個、北へ rows 段)
+ */
+struct Layout {
+    int level{};  // 3: 5m (3次メッシュ)、2: 10m (2次メッシュ)
+    int columns{};
+    int rows{};
+    double min_lat{};
+    double min_lng{};
+    double lat_size{};
+    double lng_size{};
+    std::string origin_code;  // 南西端のメッシュ
+};
+
+auto mesh_level(std::string_view dem_type) -> int {
+    return dem_type.starts_with("10") ? 2 : 3;
+}
+
+auto make_layout(const SynthConfig& config) -> std::optional<Layout> {
+    const int level = mesh_level(config.dem_type);
+    auto origin = mesh::from_latlng(config.origin_lat, config.origin_lng, level);
+    if (!origin)
+        return std::nullopt;
+    auto bounds = mesh::bounds(*origin);
+    if (!bounds)
+        return std::nullopt;
+
+    const int n = std::max(config.mesh_count, 1);
+    const int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(n))));
+    return Layout{.level = level,
+                  .columns = columns,
+                  .rows = (n + columns - 1) / columns,
+                  .min_lat = bounds->min_lat,
+                  .min_lng = bounds->min_lng,
+                  .lat_size = bounds->max_lat - bounds->min_lat,
+                  .lng_size = bounds->max_lng - bounds->min_lng,
+                  .origin_code = *origin};
+}
+
+bool validate(const SynthConfig& config, std::error_code& ec) {
+    auto in_unit = [](double r) { return r >= 0.0 && r <= 1.0; };
+    bool date_ok = config.date.size() == 8 &&
+                   std::all_of(config.date.begin(), config.date.end(),
+                               [](char c) { return c >= '0' && c <= '9'; });
+    if (!grid_shape(config.dem_type) || config.mesh_count < 1 || !date_ok ||
+        !in_unit(config.sea_ratio) || !in_unit(config.nodata_ratio) ||
+        !in_unit(config.partial_ratio)) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 点の種別 (tupleListの種別列に対応)
+ */
+enum class CellKind : uint8_t { Ground, Sea, NoData };
+
+/**
+ * @brief データセット全体で共通の地形関数
+ *
+ * 地形の基本波長はデータセットの広がりに合わせるため、1メッシュでも全国規模でも
+ * 陸・海・欠測が混在する。しきい値は範囲内の標本点から分位点として求める。
+ */
+class Terrain {
+   public:
+    Terrain(const SynthConfig& config, const Layout& layout) {
+        const double cell_km =
+            layout.lat_size * KM_PER_DEG_LAT / grid_shape(config.dem_type)->second;
+        const double extent_km = std::max({layout.columns * layout.lng_size * KM_PER_DEG_LNG,
+                                           layout.rows * layout.lat_size * KM_PER_DEG_LAT, 0.5});
+        const int octaves = std::clamp(
+            static_cast<int>(std::ceil(std::log2(extent_km / (4.0 * cell_km)))), 4, MAX_OCTAVES);
+
+        elevation_ = Fbm{.seed = mix64(config.seed), .frequency = 1.0 / extent_km,
+                         .octaves = octaves};
+        coverage_ = Fbm{.seed = mix64(config.seed ^ 0xC0FFEEULL),
+                        .frequency = 2.0 / extent_km,
+                        .octaves = std::min(octaves, 5)};
+        relief_ = std::min(3000.0, 50.0 + 150.0 * std::sqrt(extent_km));
+
+        // 分位点の推定 (乱数は seed のみから決まる)
+        std::vector<double> heights(CALIBRATION_SAMPLES);
+        std::vector<double> covers(CALIBRATION_SAMPLES);
+        uint64_t state = mix64(config.seed ^ 0x5EEDULL);
+        auto next_unit = [&state]() { return unit(state = mix64(state + 1)); };
+        for (int i = 0; i < CALIBRATION_SAMPLES; ++i) {
+            const double lat = layout.min_lat + layout.rows * layout.lat_size * next_unit();
+            const double lng = layout.min_lng + layout.columns * layout.lng_size * next_unit();
+            heights[i] = elevation_.sample(lng * KM_PER_DEG_LNG, lat * KM_PER_DEG_LAT);
+            covers[i] = coverage_.sample(lng * KM_PER_DEG_LNG, lat * KM_PER_DEG_LAT);
+        }
+        std::sort(heights.begin(), heights.end());
+        std::sort(covers.begin(), covers.end());
+
+        sea_level_ = threshold(heights, config.sea_ratio);
+        land_floor_ = quantile(heights, config.sea_ratio);
+        land_top_ = std::max(quantile(heights, 0.999), land_floor_ + 1e-6);
+        coverage_limit_ = threshold(covers, config.nodata_ratio);
+    }
+
+    [[nodiscard]] auto sample(double lat, double lng, double& elevation) const noexcept
+        -> CellKind {
+        const double x = lng * KM_PER_DEG_LNG;
+        const double y = lat * KM_PER_DEG_LAT;
+        const double e = elevation_.sample(x, y);
+        if (e < sea_level_)
+            return CellKind::Sea;
+        if (coverage_.sample(x, y) < coverage_limit_)
+            return CellKind::NoData;
+        const double t = std::max(0.0, (e - land_floor_) / (land_top_ - land_floor_));
+        elevation = 0.1 + relief_ * std::pow(t, 1.6);
+        return CellKind::Ground;
+    }
+
+   private:
+    static double quantile(const std::vector<double>& sorted, double ratio) {
+        const auto index = static_cast<size_t>(ratio * static_cast<double>(sorted.size() - 1));
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // ratioの割合が下回るしきい値 (0なら該当なし、1ならすべて該当)
+    static double threshold(const std::vector<double>& sorted, double ratio) {
+        if (ratio <= 0.0)
+            return -std::numeric_limits<double>::infinity();
+        if (ratio >= 1.0)
+            return std::numeric_limits<double>::infinity();
+        return quantile(sorted, ratio);
+    }
+
+    Fbm elevation_{};
+    Fbm coverage_{};
+    double relief_{};
+    double sea_level_{};
+    double land_floor_{};
+    double land_top_{};
+    double coverage_limit_{};
+};
+
+void append_double(std::string& out, double value, std::chars_format format, int precision) {
+    char buffer[64];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value, format, precision);
+    out.append(buffer, ec == std::errc{} ? end : buffer);
+}
+
+auto type_label(std::string_view dem_type) -> std::string_view {
+    return mesh_level(dem_type) == 2 ? "10mメッシュ（標高）" : "5mメッシュ（標高）";
+}
+
+/**
+ * @brief 1メッシュ分のXMLを生成 (Terrainはデータセット内で共有)
+ */
+auto generate_xml(std::string_view mesh_code, const SynthConfig& config, const Layout& layout,
+                  const Terrain& terrain) -> std::optional<std::string> {
+    auto shape = grid_shape(config.dem_type);
+    auto bounds = mesh::bounds(mesh_code);
+    if (!shape || !bounds || static_cast<int>(mesh_code.size()) !=
+                                 (mesh_level(config.dem_type) == 2 ? 6 : 8))
+        return std::nullopt;
+    const auto [width, height] = *shape;
+    const double dlat = (bounds->max_lat - bounds->min_lat) / height;
+    const double dlng = (bounds->max_lng - bounds->min_lng) / width;
+
+    // 北西側を測量範囲外とするメッシュ (対角線で切り落とす)
+    // 1メッシュだけのデータセットでも startPoint の処理を通るよう、南西端のメッシュは常に対象にする
+    const uint64_t mesh_hash = mix64(config.seed ^ hash_text(mesh_code));
+    const bool partial = config.partial_ratio > 0.0 && (unit(mesh_hash) < config.partial_ratio ||
+                                                        mesh_code == layout.origin_code);
+    const double cut = 0.15 + 0.5 * unit(mix64(mesh_hash));
+
+    std::vector<CellKind> kinds(static_cast<size_t>(width) * height);
+    std::vector<double> values(kinds.size(), -9999.0);
+    for (int y = 0; y < height; ++y) {
+        const double lat = bounds->max_lat - (y + 0.5) * dlat;  // 北から南へ
+        for (int x = 0; x < width; ++x) {
+            const size_t i = static_cast<size_t>(y) * width + x;
+            if (partial && (x + 0.5) / width + (y + 0.5) / height < cut) {
+                kinds[i] = CellKind::NoData;
+                continue;
+            }
+            kinds[i] = terrain.sample(lat, bounds->min_lng + (x + 0.5) * dlng, values[i]);
+        }
+    }
+
+    // 先頭と末尾のデータなしは省略し、開始位置を startPoint で示す
+    size_t first = 0;
+    size_t last = kinds.size();
+    while (first < last && kinds[first] == CellKind::NoData)
+        ++first;
+    while (last > first && kinds[last - 1] == CellKind::NoData)
+        --last;
+    if (first == last) {
+        first = 0;  // 全点データなしの場合は省略せずに出力
+        last = kinds.size();
+    }
+
+    std::string xml;
+    xml.reserve((last - first) * 20 + 4096);
+    const std::string code(mesh_code);
+    xml += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+           "<Dataset xsi:schemaLocation=\"http://fgd.gsi.go.jp/spec/2008/FGD_GMLSchema "
+           "FGD_GMLSchema.xsd\" xmlns:gml=\"http://www.opengis.net/gml/3.2\" "
+           "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+           "xmlns:xlink=\"http://www.w3.org/1999/xlink\" "
+           "xmlns=\"http://fgd.gsi.go.jp/spec/2008/FGD_GMLSchema\" gml:id=\"Dataset1\">\n"
+           "<gml:description>基盤地図情報メタデータ ID=fmdid:synthetic</gml:description>\n"
+           "<gml:name>基盤地図情報ダウンロードデータ（GML版）</gml:name>\n"
+           "<DEM gml:id=\"DEM001\">\n"
+           "<fid>fgoid:10-00100-15-60101-";
+    xml += code;
+    xml += "</fid>\n<type>";
+    xml += type_label(config.dem_type);
+    xml += "</type>\n<mesh>";
+    xml += code;
+    xml += "</mesh>\n<coverage gml:id=\"DEM001-3\">\n<gml:boundedBy>\n"
+           "<gml:Envelope srsName=\"fguuid:jgd2011.bl\">\n<gml:lowerCorner>";
+    append_double(xml, bounds->min_lat, std::chars_format::general, 12);
+    xml += ' ';
+    append_double(xml, bounds->min_lng, std::chars_format::general, 12);
+    xml += "</gml:lowerCorner>\n<gml:upperCorner>";
+    append_double(xml, bounds->max_lat, std::chars_format::general, 12);
+    xml += ' ';
+    append_double(xml, bounds->max_lng, std::chars_format::general, 12);
+    xml += "</gml:upperCorner>\n</gml:Envelope>\n</gml:boundedBy>\n<gml:gridDomain>\n"
+           "<gml:Grid gml:id=\"DEM001-4\" dimension=\"2\">\n<gml:limits>\n<gml:GridEnvelope>\n"
+           "<gml:low>0 0</gml:low>\n<gml:high>";
+    xml += std::to_string(width - 1) + " " + std::to_string(height - 1);
+    xml += "</gml:high>\n</gml:GridEnvelope>\n</gml:limits>\n"
+           "<gml:axisLabels>x y</gml:axisLabels>\n</gml:Grid>\n</gml:gridDomain>\n"
+           "<gml:rangeSet>\n<gml:DataBlock>\n<gml:rangeParameters>\n"
+           "<gml:QuantityList uom=\"DEM構成点\"></gml:QuantityList>\n"
+           "</gml:rangeParameters>\n<gml:tupleList>\n";
+    for (size_t i = first; i < last; ++i) {
+        switch (kinds[i]) {
+            case CellKind::Ground:
+                xml += "地表面,";
+                append_double(xml, values[i], std::chars_format::fixed, 2);
+                xml += '\n';
+                break;
+            case CellKind::Sea:
+                xml += "海水面,-9999.\n";
+                break;
+            case CellKind::NoData:
+                xml += "データなし,-9999.\n";
+                break;
+        }
+    }
+    xml += "</gml:tupleList>\n</gml:DataBlock>\n</gml:rangeSet>\n<gml:coverageFunction>\n"
+           "<gml:GridFunction>\n<gml:sequenceRule order=\"+x-y\">Linear</gml:sequenceRule>\n"
+           "<gml:startPoint>";
+    xml += std::to_string(first % width) + " " + std::to_string(first / width);
+    xml += "</gml:startPoint>\n</gml:GridFunction>\n</gml:coverageFunction>\n</coverage>\n"
+           "</DEM>\n</Dataset>\n";
+    return xml;
+}
+
+/**
+ * @brief ZIPに格納する1エントリ (圧縮済み)
+ */
+struct ZipEntry {
+    std::string name;
+    uint32_t crc{};
+    uint32_t size{};
+    uint16_t method{};  // 0: 無圧縮、8: Deflate
+    std::vector<uint8_t> data;
+};
+
+auto make_entry(std::string name, std::span<const uint8_t> bytes,
+                bool compress) -> std::optional<ZipEntry> {
+    if (bytes.size() >= ZIP_LIMIT)
+        return std::nullopt;
+    ZipEntry entry{.name = std::move(name),
+                   .crc = static_cast<uint32_t>(
+                       crc32(0L, bytes.data(), static_cast<uInt>(bytes.size()))),
+                   .size = static_cast<uint32_t>(bytes.size()),
+                   .method = static_cast<uint16_t>(compress ? 8 : 0),
+                   .data = {}};
+    if (!compress) {
+        entry.data.assign(bytes.begin(), bytes.end());
+        return entry;
+    }
+
+    // ZIPのDeflateはzlibヘッダなしの生ストリーム (windowBits < 0)
+    z_stream stream{};
+    if (deflateInit2(&stream, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return std::nullopt;
+    entry.data.resize(deflateBound(&stream, static_cast<uLong>(bytes.size())));
+    stream.next_in = const_cast<Bytef*>(bytes.data());
+    stream.avail_in = static_cast<uInt>(bytes.size());
+    stream.next_out = entry.data.data();
+    stream.avail_out = static_cast<uInt>(entry.data.size());
+    const int rc = deflate(&stream, Z_FINISH);
+    entry.data.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (rc != Z_STREAM_END)
+        return std::nullopt;
+    return entry;
+}
+
+/**
+ * @brief 最小限のZIPライタ (ZIP64なし、日時は固定)
+ */
+class ZipWriter {
+   public:
+    ZipWriter(std::ostream& out, uint16_t dos_date) : out_(out), dos_date_(dos_date) {}
+
+    bool add(const ZipEntry& entry) {
+        if (entries_.size() >= 0xFFFF || offset_ + 30 + entry.name.size() + entry.data.size() >=
+                                             ZIP_LIMIT)
+            return false;
+        std::string header;
+        put32(header, 0x04034B50);
+        put16(header, 20);
+        put16(header, 0);
+        put16(header, entry.method);
+        put16(header, 0);
+        put16(header, dos_date_);
+        put32(header, entry.crc);
+        put32(header, static_cast<uint32_t>(entry.data.size()));
+        put32(header, entry.size);
+        put16(header, static_cast<uint16_t>(entry.name.size()));
+        put16(header, 0);
+        header += entry.name;
+        out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out_.write(reinterpret_cast<const char*>(entry.data.data()),
+                   static_cast<std::streamsize>(entry.data.size()));
+
+        entries_.push_back({.name = entry.name,
+                            .crc = entry.crc,
+                            .compressed = static_cast<uint32_t>(entry.data.size()),
+                            .size = entry.size,
+                            .method = entry.method,
+                            .offset = static_cast<uint32_t>(offset_)});
+        offset_ += header.size() + entry.data.size();
+        return static_cast<bool>(out_);
+    }
+
+    bool finish() {
+        std::string directory;
+        for (const auto& e : entries_) {
+            put32(directory, 0x02014B50);
+            put16(directory, 20);
+            put16(directory, 20);
+            put16(directory, 0);
+            put16(directory, e.method);
+            put16(directory, 0);
+            put16(directory, dos_date_);
+            put32(directory, e.crc);
+            put32(directory, e.compressed);
+            put32(directory, e.size);
+            put16(directory, static_cast<uint16_t>(e.name.size()));
+            put16(directory, 0);  // 拡張フィールド長
+            put16(directory, 0);  // コメント長
+            put16(directory, 0);  // ディスク番号
+            put16(directory, 0);  // 内部属性
+            put32(directory, 0);  // 外部属性
+            put32(directory, e.offset);
+            directory += e.name;
+        }
+        const size_t directory_size = directory.size();
+        if (offset_ + directory_size >= ZIP_LIMIT)
+            return false;
+        put32(directory, 0x06054B50);
+        put16(directory, 0);
+        put16(directory, 0);
+        put16(directory, static_cast<uint16_t>(entries_.size()));
+        put16(directory, static_cast<uint16_t>(entries_.size()));
+        put32(directory, static_cast<uint32_t>(directory_size));
+        put32(directory, static_cast<uint32_t>(offset_));
+        put16(directory, 0);
+        out_.write(directory.data(), static_cast<std::streamsize>(directory.size()));
+        out_.flush();
+        return static_cast<bool>(out_);
+    }
+
+   private:
+    struct Record {
+        std::string name;
+        uint32_t crc;
+        uint32_t compressed;
+        uint32_t size;
+        uint16_t method;
+        uint32_t offset;
+    };
+
+    static void put16(std::string& out, uint16_t v) {
+        out += static_cast<char>(v & 0xFF);
+        out += static_cast<char>(v >> 8);
+    }
+    static void put32(std::string& out, uint32_t v) {
+        put16(out, static_cast<uint16_t>(v & 0xFFFF));
+        put16(out, static_cast<uint16_t>(v >> 16));
+    }
+
+    std::ostream& out_;
+    uint16_t dos_date_;
+    uint64_t offset_{};
+    std::vector<Record> entries_;
+};
+
+/**
+ * @brief "YYYYMMDD" をMS-DOS形式の日付へ変換
+ */
+uint16_t dos_date(std::string_view date) {
+    auto number = [&](size_t pos, size_t len) {
+        int v = 0;
+        std::from_chars(date.data() + pos, date.data() + pos + len, v);
+        return v;
+    };
+    const int year = std::clamp(number(0, 4), 1980, 2107);
+    return static_cast<uint16_t>(((year - 1980) << 9) | (number(4, 2) << 5) | number(6, 2));
+}
+
+auto xml_file_name(std::string_view code, const SynthConfig& config) -> std::string {
+    std::string name = "FG-GML-" + std::string(code.substr(0, 4)) + "-" +
+                       std::string(code.substr(4, 2));
+    if (code.size() == 8)
+        name += "-" + std::string(code.substr(6, 2));
+    return name + "-DEM" + config.dem_type + "-" + config.date + ".xml";
+}
+
+/**
+ * @brief 内側ZIP 1個分の作成結果
+ */
+struct InnerArchive {
+    std::string outer_key;  // 1次メッシュコード
+    std::optional<ZipEntry> entry;
+    size_t mesh_count{};
+    size_t xml_bytes{};
+};
+
+auto build_inner_archive(const std::string& key, const std::vector<std::string>& codes,
+                         const SynthConfig& config, const Layout& layout,
+                         const Terrain& terrain) -> InnerArchive {
+    InnerArchive result{.outer_key = key.substr(0, 4),
+                        .entry = std::nullopt,
+                        .mesh_count = codes.size(),
+                        .xml_bytes = 0};
+
+    // メッシュ単位でXML生成とDeflate圧縮を並列化
+    std::vector<std::optional<ZipEntry>> entries(codes.size());
+    std::vector<size_t> sizes(codes.size());
+    tbb::parallel_for(size_t{0}, codes.size(), [&](size_t i) {
+        auto xml = generate_xml(codes[i], config, layout, terrain);
+        if (!xml)
+            return;
+        sizes[i] = xml->size();
+        entries[i] = make_entry(xml_file_name(codes[i], config),
+                                {reinterpret_cast<const uint8_t*>(xml->data()), xml->size()},
+                                true);
+    });
+
+    std::ostringstream buffer;
+    ZipWriter zip(buffer, dos_date(config.date));
+    for (size_t i = 0; i < codes.size(); ++i) {
+        if (!entries[i] || !zip.add(*entries[i]))
+            return result;
+        result.xml_bytes += sizes[i];
+    }
+    if (!zip.finish())
+        return result;
+
+    const std::string bytes = std::move(buffer).str();
+    // 内側ZIPは圧縮済みのため外側ZIPには無圧縮で格納する
+    result.entry = make_entry("FG-GML-" + key + "-DEM" + config.dem_type + "-" + config.date +
+                                  ".zip",
+                              {reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()},
+                              false);
+    return result;
+}
+
+}  // namespace
+
+auto grid_shape(std::string_view dem_type) -> std::optional<std::pair<int, int>> {
+    if (dem_type == "5A" || dem_type == "5B" || dem_type == "5C")
+        return std::pair{225, 150};
+    if (dem_type == "10A" || dem_type == "10B")
+        return std::pair{1125, 750};
+    return std::nullopt;
+}
+
+auto mesh_codes(const SynthConfig& config) -> std::vector<std::string> {
+    std::vector<std::string> codes;
+    auto layout = make_layout(config);
+    if (!layout || config.mesh_count < 1)
+        return codes;
+
+    codes.reserve(static_cast<size_t>(config.mesh_count));
+    for (int i = 0; i < config.mesh_count; ++i) {
+        const int row = i / layout->columns;
+        const int col = i % layout->columns;
+        const double lat = layout->min_lat + (row + 0.5) * layout->lat_size;
+        const double lng = layout->min_lng + (col + 0.5) * layout->lng_size;
+        if (auto code = mesh::from_latlng(lat, lng, layout->level))
+            codes.push_back(std::move(*code));
+    }
+    return codes;
+}
+
+auto make_fgd_xml(std::string_view mesh_code,
+                  const SynthConfig& config) -> std::optional<std::string> {
+    std::error_code ec;
+    auto layout = make_layout(config);
+    if (!validate(config, ec) || !layout)
+        return std::nullopt;
+    return generate_xml(mesh_code, config, *layout, Terrain(config, *layout));
+}
+
+auto write_dataset(const std::filesystem::path& output_dir, const SynthConfig& config,
+                   std::error_code& ec) -> std::optional<SynthSummary> {
+    if (!validate(config, ec))
+        return std::nullopt;
+    auto layout = make_layout(config);
+    if (!layout) {
+        ec = std::make_error_code(std::errc::argument_out_of_domain);
+        return std::nullopt;
+    }
+    std::filesystem::create_directories(output_dir, ec);
+    if (ec)
+        return std::nullopt;
+
+    // 内側ZIPの単位 (5mは2次メッシュ、10mは1次メッシュ) でまとめる
+    const size_t key_length = layout->level == 3 ? 6 : 4;
+    std::map<std::string, std::vector<std::string>> grouped;
+    for (auto& code : mesh_codes(config)) {
+        grouped[code.substr(0, key_length)].push_back(std::move(code));
+    }
+    std::vector<std::pair<std::string, std::vector<std::string>>> groups(
+        std::make_move_iterator(grouped.begin()), std::make_move_iterator(grouped.end()));
+    for (auto& [key, codes] : groups) {
+        std::sort(codes.begin(), codes.end());
+    }
+
+    const Terrain terrain(config, *layout);
+    SynthSummary summary;
+    std::ofstream outer_file;
+    std::optional<ZipWriter> outer;
+    std::string current_key;
+
+    auto close_outer = [&]() {
+        if (outer && !outer->finish() && !ec)
+            ec = std::make_error_code(std::errc::file_too_large);
+        outer.reset();
+        outer_file.close();
+    };
+
+    // 入力 (順序どおり) → 内側ZIP作成 (並列) → 外側ZIPへ追記 (順序どおり)
+    // ecは出力段のみが書き込み、入力段は failed フラグで打ち切りを判断する
+    std::atomic<bool> failed{false};
+    size_t next = 0;
+    const size_t tokens = std::max(2u, std::thread::hardware_concurrency()) * 2;
+    tbb::parallel_pipeline(
+        tokens,
+        tbb::make_filter<void, size_t>(tbb::filter_mode::serial_in_order,
+                                       [&](tbb::flow_control& fc) -> size_t {
+                                           if (next >= groups.size() ||
+                                               failed.load(std::memory_order_relaxed)) {
+                                               fc.stop();
+                                               return 0;
+                                           }
+                                           return next++;
+                                       }) &
+            tbb::make_filter<size_t, InnerArchive>(
+                tbb::filter_mode::parallel,
+                [&](size_t i) {
+                    return build_inner_archive(groups[i].first, groups[i].second, config,
+                                               *layout, terrain);
+                }) &
+            tbb::make_filter<InnerArchive, void>(
+                tbb::filter_mode::serial_in_order, [&](InnerArchive archive) {
+                    if (ec)
+                        return;
+                    if (!archive.entry) {
+                        ec = std::make_error_code(std::errc::io_error);
+                        failed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    if (!outer || archive.outer_key != current_key) {
+                        close_outer();
+                        current_key = archive.outer_key;
+                        auto path = output_dir / ("PackDLMap-" + current_key + "-DEM" +
+                                                  config.dem_type + ".zip");
+                        outer_file.open(path, std::ios::binary | std::ios::trunc);
+                        if (!outer_file) {
+                            ec = std::make_error_code(std::errc::io_error);
+                            failed.store(true, std::memory_order_relaxed);
+                            return;
+                        }
+                        outer.emplace(outer_file, dos_date(config.date));
+                        summary.archives.push_back(std::move(path));
+                    }
+                    if (!outer->add(*archive.entry)) {
+                        ec = std::make_error_code(std::errc::file_too_large);
+                        failed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    summary.mesh_count += archive.mesh_count;
+                    summary.inner_archive_count += 1;
+                    summary.xml_bytes += archive.xml_bytes;
+                }));
+    close_outer();
+
+    if (ec)
+        return std::nullopt;
+    return summary;
+}
+
+}  // namespace fgd_converter::synth
@@ -5,16 +5,29 @@
 #include <geo_normalize.h>
 #include <geo_tiffp.h>
 #include <proj.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tiffio.h>
 #include <xtiffio.h>
+#include <zlib.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include "stats.hpp"
+#include "surface_class.hpp"
+#include "trace.hpp"
+#include "validity_mask.hpp"
+
 // SIMDイントリンシクスのプラットフォーム検出
 #if defined(__x86_64__) || defined(_M_X64)
 #    if defined(__AVX2__)
@@ -53,6 +66,173 @@ static void register_gdal_nodata_tag() {
     }
 }
 
+// RGBタイルの並列エンコード・圧縮を行う単位 (保持する圧縮済みタイル数の上限)
+constexpr size_t RGB_TILE_BATCH = 256;
+
+/**
+ * @brief 書き出したファイルのサイズを統計に加算
+ */
+static void count_bytes_written(const std::filesystem::path& path) {
+    if (stats::enabled()) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        if (!ec) {
+            stats::add(stats::Counter::BytesWritten, size);
+        }
+    }
+}
+
+/**
+ * @brief width × height の画像を覆うタイル数を統計に加算
+ */
+static void count_tiles(uint32_t width, uint32_t height, uint32_t tile_width,
+                        uint32_t tile_height) {
+    stats::add(stats::Counter::TilesEncoded,
+               static_cast<uint64_t>((width + tile_width - 1) / tile_width) *
+                   ((height + tile_height - 1) / tile_height));
+}
+
+/**
+ * @brief RGBタイルを並列にエンコード・Deflate圧縮し、TIFFへ順に書き込む
+ *
+ * タイルのエンコード (SIMDカーネル) とzlib圧縮はタイルごとに独立しているためTBBで並列化し、
+ * libtiffへの書き込み (TIFFWriteRawTile) のみ直列に行う。
+ * 呼び出し前にTIFFTAG_COMPRESSIONへCOMPRESSION_ADOBE_DEFLATEを設定しておくこと。
+ *
+ * @param row_at 行番号から行先頭のポインタ (double* または float*) を返す関数
+ */
+template <typename RowAt>
+static bool write_rgb_tiles(TIFF* tif, uint32_t width, uint32_t height, uint32_t tile_width,
+                            uint32_t tile_height, RgbEncoding encoding, RowAt row_at) {
+    const uint32_t tiles_x = (width + tile_width - 1) / tile_width;
+    const uint32_t tiles_y = (height + tile_height - 1) / tile_height;
+    const size_t tile_count = static_cast<size_t>(tiles_x) * tiles_y;
+    const size_t tile_bytes = static_cast<size_t>(tile_width) * tile_height * 3;
+
+    std::vector<std::vector<uint8_t>> compressed(std::min(tile_count, RGB_TILE_BATCH));
+
+    for (size_t batch_begin = 0; batch_begin < tile_count; batch_begin += RGB_TILE_BATCH) {
+        const size_t batch_end = std::min(tile_count, batch_begin + RGB_TILE_BATCH);
+        std::atomic<bool> failed{false};
+
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(batch_begin, batch_end),
+            [&, archive = stats::current_archive()](const tbb::blocked_range<size_t>& range) {
+                stats::ArchiveBinding binding(archive);
+                // SIMDカーネルの末尾書き込み分を確保
+                std::vector<uint8_t> tile(tile_bytes + kernels::RGB_PADDING);
+
+                for (size_t t = range.begin(); t != range.end(); ++t) {
+                    const uint32_t tx = static_cast<uint32_t>(t % tiles_x) * tile_width;
+                    const uint32_t ty = static_cast<uint32_t>(t / tiles_x) * tile_height;
+                    const uint32_t actual_tile_width = std::min(tile_width, width - tx);
+                    const uint32_t actual_tile_height = std::min(tile_height, height - ty);
+                    trace::Span span("tile_encode", "tile");
+
+                    std::fill(tile.begin(), tile.end(), 0);
+                    for (uint32_t row = 0; row < actual_tile_height; ++row) {
+                        uint8_t* dst = tile.data() + static_cast<size_t>(row) * tile_width * 3;
+                        kernels::encode_rgb(row_at(ty + row) + tx, actual_tile_width, encoding,
+                                            dst);
+                    }
+
+                    auto& out = compressed[t - batch_begin];
+                    uLongf out_size = compressBound(static_cast<uLong>(tile_bytes));
+                    out.resize(out_size);
+                    if (compress2(out.data(), &out_size, tile.data(),
+                                  static_cast<uLong>(tile_bytes),
+                                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+                        failed.store(true, std::memory_order_relaxed);
+                        continue;
+                    }
+                    out.resize(out_size);
+                }
+            });
+
+        if (failed.load()) {
+            return false;
+        }
+
+        for (size_t t = batch_begin; t < batch_end; ++t) {
+            const uint32_t tx = static_cast<uint32_t>(t % tiles_x) * tile_width;
+            const uint32_t ty = static_cast<uint32_t>(t / tiles_x) * tile_height;
+            auto& out = compressed[t - batch_begin];
+            if (TIFFWriteRawTile(tif, TIFFComputeTile(tif, tx, ty, 0, 0), out.data(),
+                                 static_cast<tmsize_t>(out.size())) < 0) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief メモリ上のTIFF出力先 (TIFFClientOpen用ストリーム)
+ */
+struct MemoryTiffStream {
+    std::vector<uint8_t> data;
+    uint64_t pos = 0;
+};
+
+static tmsize_t memory_tiff_read(thandle_t handle, void* buf, tmsize_t size) {
+    auto* stream = static_cast<MemoryTiffStream*>(handle);
+    if (stream->pos >= stream->data.size())
+        return 0;
+    size_t n = std::min<size_t>(static_cast<size_t>(size), stream->data.size() - stream->pos);
+    std::memcpy(buf, stream->data.data() + stream->pos, n);
+    stream->pos += n;
+    return static_cast<tmsize_t>(n);
+}
+
+static tmsize_t memory_tiff_write(thandle_t handle, void* buf, tmsize_t size) {
+    auto* stream = static_cast<MemoryTiffStream*>(handle);
+    size_t n = static_cast<size_t>(size);
+    if (stream->pos + n > stream->data.size()) {
+        stream->data.resize(stream->pos + n);
+    }
+    std::memcpy(stream->data.data() + stream->pos, buf, n);
+    stream->pos += n;
+    return size;
+}
+
+static toff_t memory_tiff_seek(thandle_t handle, toff_t offset, int whence) {
+    auto* stream = static_cast<MemoryTiffStream*>(handle);
+    switch (whence) {
+        case SEEK_SET:
+            stream->pos = offset;
+            break;
+        case SEEK_CUR:
+            stream->pos += offset;
+            break;
+        case SEEK_END:
+            stream->pos = stream->data.size() + offset;
+            break;
+        default:
+            return static_cast<toff_t>(-1);
+    }
+    return stream->pos;
+}
+
+static int memory_tiff_close(thandle_t) { return 0; }
+
+static toff_t memory_tiff_size(thandle_t handle) {
+    return static_cast<MemoryTiffStream*>(handle)->data.size();
+}
+
+static int memory_tiff_map(thandle_t, void**, toff_t*) { return 0; }
+
+static void memory_tiff_unmap(thandle_t, void*, toff_t) {}
+
+/**
+ * @brief メモリストリームへ書き込むTIFFハンドルを開く
+ */
+static TIFF* open_memory_tiff(MemoryTiffStream& stream) {
+    return XTIFFClientOpen("memory", "w", &stream, memory_tiff_read, memory_tiff_write,
+                           memory_tiff_seek, memory_tiff_close, memory_tiff_size, memory_tiff_map,
+                           memory_tiff_unmap);
+}
+
 class GeoTiff::Impl {
    public:
     explicit Impl(const Config& config)
@@ -60,13 +240,121 @@ class GeoTiff::Impl {
           np_array(config.np_array.begin(), config.np_array.end()),
           x_length(config.x_length),
           y_length(config.y_length),
-          output_path(config.output_path) {}
+          output_path(config.output_path),
+          rgb_encoding(config.rgb_encoding),
+          valid(config.valid),
+          np_array_charge(stats::Memory::GeoTiffCopy, stats::bytes_of(np_array)) {}
+
+    /**
+     * @brief タグ・ジオキー・タイルデータを開いたTIFFへ書き込む (ファイル/メモリ共通)
+     */
+    bool write_to(TIFF* tif, bool rgbify) {
+        stats::ScopedTimer timer(stats::Stage::Encode);
+        const int nx = x_length;
+        const int ny = y_length;
+
+        // 基本TIFFタグを設定
+        TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(nx));
+        TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(ny));
+
+        if (rgbify) {
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 3);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+        } else {
+            TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+            TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
+            TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+            TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+        }
+
+        TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+
+        // タイル形式で圧縮
+        const uint32_t tile_width = 256;
+        const uint32_t tile_height = 256;
+        TIFFSetField(tif, TIFFTAG_TILEWIDTH, tile_width);
+        TIFFSetField(tif, TIFFTAG_TILELENGTH, tile_height);
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+
+        // GeoTIFFハンドルを取得
+        GTIF* gtif = GTIFNew(tif);
+        if (!gtif) {
+            return false;
+        }
+
+        // geo_transform: [origin_x, pixel_width, 0, origin_y, 0, -pixel_height]
+        double origin_x = geo_transform[0];
+        double pixel_width = geo_transform[1];
+        double origin_y = geo_transform[3];
+        double pixel_height = -geo_transform[5];  // 負の値を正に
+
+        // ModelPixelScaleTag: [ScaleX, ScaleY, ScaleZ]
+        double pixel_scale[3] = {pixel_width, pixel_height, 0.0};
+        TIFFSetField(tif, GTIFF_PIXELSCALE, 3, pixel_scale);
+
+        // ModelTiepointTag: [I, J, K, X, Y, Z]
+        double tiepoint[6] = {0.0, 0.0, 0.0, origin_x, origin_y, 0.0};
+        TIFFSetField(tif, GTIFF_TIEPOINTS, 6, tiepoint);
+
+        // GeoTIFFキーを設定 (EPSG:4326 = WGS84地理座標系)
+        GTIFKeySet(gtif, GTModelTypeGeoKey, TYPE_SHORT, 1, ModelTypeGeographic);
+        GTIFKeySet(gtif, GTRasterTypeGeoKey, TYPE_SHORT, 1, RasterPixelIsArea);
+        GTIFKeySet(gtif, GeographicTypeGeoKey, TYPE_SHORT, 1, 4326);
+
+        // GeoTIFFキーを書き込み
+        GTIFWriteKeys(gtif);
+        GTIFFree(gtif);
+
+        // NODATA値タグを設定
+        constexpr float NODATA_VALUE = -9999.0f;
+        if (!rgbify) {
+            std::string nodata_str = std::to_string(NODATA_VALUE);
+            TIFFSetField(tif, TIFFTAG_GDAL_NODATA, nodata_str.c_str());
+        }
+
+        // タイルデータを書き込み
+        count_tiles(static_cast<uint32_t>(nx), static_cast<uint32_t>(ny), tile_width, tile_height);
+        if (rgbify) {
+            return write_rgb_tiles(tif, static_cast<uint32_t>(nx), static_cast<uint32_t>(ny),
+                                   tile_width, tile_height, rgb_encoding,
+                                   [this](uint32_t row) { return np_array[row].data(); });
+        } else {
+            // Float32データ
+            std::vector<float> tile_buffer(tile_width * tile_height);
+
+            for (uint32_t ty = 0; ty < static_cast<uint32_t>(ny); ty += tile_height) {
+                for (uint32_t tx = 0; tx < static_cast<uint32_t>(nx); tx += tile_width) {
+                    std::fill(tile_buffer.begin(), tile_buffer.end(), NODATA_VALUE);
+
+                    uint32_t actual_tile_width = std::min(tile_width, static_cast<uint32_t>(nx) - tx);
+                    uint32_t actual_tile_height = std::min(tile_height, static_cast<uint32_t>(ny) - ty);
+
+                    for (uint32_t row = 0; row < actual_tile_height; ++row) {
+                        for (uint32_t col = 0; col < actual_tile_width; ++col) {
+                            size_t dst_idx = static_cast<size_t>(row) * tile_width + col;
+                            tile_buffer[dst_idx] = static_cast<float>(np_array[ty + row][tx + col]);
+                        }
+                    }
+
+                    if (TIFFWriteTile(tif, tile_buffer.data(), tx, ty, 0, 0) < 0) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
 
     std::array<double, 6> geo_transform;
     std::vector<std::vector<double>> np_array;
     int x_length;
     int y_length;
     std::filesystem::path output_path;
+    RgbEncoding rgb_encoding;
+    const ValidityMask* valid;  // np_array の有効ピクセル (呼び出し元が所有、nullptr可)
+    stats::MemoryCharge np_array_charge;  // np_array の確保量 (--stats)
 };
 
 GeoTiff::GeoTiff(Config config) : pImpl(std::make_unique<Impl>(config)) {
@@ -88,6 +376,11 @@ bool GeoTiff::create(std::string_view output_epsg, bool rgbify, std::error_code&
         std::filesystem::create_directories(pImpl->output_path.parent_path());
     }
 
+    trace::Span span("write");
+    if (span.active()) {
+        span.set_detail(pImpl->output_path.filename().string());
+    }
+
     // TIFFファイルを作成
     TIFF* tif = XTIFFOpen(pImpl->output_path.string().c_str(), "w");
     if (!tif) {
@@ -95,167 +388,162 @@ bool GeoTiff::create(std::string_view output_epsg, bool rgbify, std::error_code&
         return false;
     }
 
-    const int nx = pImpl->x_length;
-    const int ny = pImpl->y_length;
-
-    // 基本TIFFタグを設定
-    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(nx));
-    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(ny));
-
-    if (rgbify) {
-        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 3);
-        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
-        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-    } else {
-        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
-        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
-        TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
-        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
-    }
-
-    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-
-    // タイル形式で圧縮
-    const uint32_t tile_width = 256;
-    const uint32_t tile_height = 256;
-    TIFFSetField(tif, TIFFTAG_TILEWIDTH, tile_width);
-    TIFFSetField(tif, TIFFTAG_TILELENGTH, tile_height);
-    TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
-
-    // GeoTIFFハンドルを取得
-    GTIF* gtif = GTIFNew(tif);
-    if (!gtif) {
+    if (!pImpl->write_to(tif, rgbify)) {
         XTIFFClose(tif);
         ec = std::make_error_code(std::errc::io_error);
         return false;
     }
 
-    // geo_transform: [origin_x, pixel_width, 0, origin_y, 0, -pixel_height]
-    double origin_x = pImpl->geo_transform[0];
-    double pixel_width = pImpl->geo_transform[1];
-    double origin_y = pImpl->geo_transform[3];
-    double pixel_height = -pImpl->geo_transform[5];  // 負の値を正に
-
-    // ModelPixelScaleTag: [ScaleX, ScaleY, ScaleZ]
-    double pixel_scale[3] = {pixel_width, pixel_height, 0.0};
-    TIFFSetField(tif, GTIFF_PIXELSCALE, 3, pixel_scale);
+    XTIFFClose(tif);
+    count_bytes_written(pImpl->output_path);
 
-    // ModelTiepointTag: [I, J, K, X, Y, Z]
-    double tiepoint[6] = {0.0, 0.0, 0.0, origin_x, origin_y, 0.0};
-    TIFFSetField(tif, GTIFF_TIEPOINTS, 6, tiepoint);
+    pImpl->np_array.clear();
+    pImpl->np_array.shrink_to_fit();
+    pImpl->np_array_charge.release();
 
-    // GeoTIFFキーを設定 (EPSG:4326 = WGS84地理座標系)
-    GTIFKeySet(gtif, GTModelTypeGeoKey, TYPE_SHORT, 1, ModelTypeGeographic);
-    GTIFKeySet(gtif, GTRasterTypeGeoKey, TYPE_SHORT, 1, RasterPixelIsArea);
-    GTIFKeySet(gtif, GeographicTypeGeoKey, TYPE_SHORT, 1, 4326);
+    return true;
+}
 
-    // GeoTIFFキーを書き込み
-    GTIFWriteKeys(gtif);
-    GTIFFree(gtif);
+/**
+ * @brief プロセス共有のPROJ座標変換プール (出力CRSごと)
+ *
+ * PROJコンテキストと変換オブジェクトの生成はproj.dbの参照を伴い高コストなため、
+ * 一括変換や常駐モードで繰り返し変換する場合に再利用する。常駐モードの接続ごとの
+ * スレッドが終了しても生成済みの変換はプールに残る。
+ * PJオブジェクトとコンテキストは複数スレッドから同時に使えないため、変換は1つずつ貸し出し、
+ * 同じCRSへ同時に変換する場合は追加で生成する。
+ */
+class ProjTransformPool {
+   public:
+    struct Entry {
+        PJ_CONTEXT* ctx = nullptr;
+        PJ* forward = nullptr;    // EPSG:4326 → 出力CRS
+        PJ* inverse = nullptr;    // 出力CRS → EPSG:4326
+        bool identity = false;    // 変換不要 (同一CRS)
+        bool geographic = false;  // 出力CRSが地理座標系 (緯度経度)
+
+        Entry() = default;
+        ~Entry() {
+            if (forward)
+                proj_destroy(forward);
+            if (inverse)
+                proj_destroy(inverse);
+            if (ctx)
+                proj_context_destroy(ctx);
+        }
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+    };
+
+    /**
+     * @brief 貸し出し中の変換 (破棄時にプールへ返却する)
+     */
+    class Lease {
+       public:
+        Lease() = default;
+        Lease(ProjTransformPool* pool, std::string crs, std::unique_ptr<Entry> entry)
+            : pool_(pool), crs_(std::move(crs)), entry_(std::move(entry)) {}
+        ~Lease() {
+            if (entry_)
+                pool_->release(std::move(crs_), std::move(entry_));
+        }
+        Lease(Lease&&) noexcept = default;
+        Lease& operator=(Lease&&) = delete;
 
-    // NODATA値タグを設定
-    constexpr float NODATA_VALUE = -9999.0f;
-    if (!rgbify) {
-        std::string nodata_str = std::to_string(NODATA_VALUE);
-        TIFFSetField(tif, TIFFTAG_GDAL_NODATA, nodata_str.c_str());
-    }
+        explicit operator bool() const noexcept { return entry_ != nullptr; }
+        const Entry* operator->() const noexcept { return entry_.get(); }
 
-    // タイルデータを書き込み
-    if (rgbify) {
-        // Terrain RGB変換 (Mapbox形式)
-        constexpr double NO_DATA_VALUE = -9999.0;
-        constexpr int R_MIN_HEIGHT = 65536;
-        constexpr int G_MIN_HEIGHT = 256;
-
-        auto convert_height_to_R = [](double height) -> uint8_t {
-            if (height <= NO_DATA_VALUE) {
-                return 1;
-            }
-            int offset_height = static_cast<int>(height * 10) + 100000;
-            return static_cast<uint8_t>(offset_height / R_MIN_HEIGHT);
-        };
+       private:
+        ProjTransformPool* pool_ = nullptr;
+        std::string crs_;
+        std::unique_ptr<Entry> entry_;
+    };
 
-        auto convert_height_to_G = [](double height, uint8_t r_value) -> uint8_t {
-            if (height <= NO_DATA_VALUE) {
-                return 134;
-            }
-            int offset_height = static_cast<int>(height * 10) + 100000;
-            return static_cast<uint8_t>((offset_height - r_value * R_MIN_HEIGHT) / G_MIN_HEIGHT);
-        };
+    static ProjTransformPool& instance() {
+        static ProjTransformPool pool;
+        return pool;
+    }
 
-        auto convert_height_to_B = [](double height, uint8_t r_value, uint8_t g_value) -> uint8_t {
-            if (height <= NO_DATA_VALUE) {
-                return 160;
+    ProjTransformPool(const ProjTransformPool&) = delete;
+    ProjTransformPool& operator=(const ProjTransformPool&) = delete;
+
+    /**
+     * @brief 出力CRSへの変換を借りる (空きがなければ生成)
+     * @return 変換の貸し出し、CRSが不正な場合は空
+     */
+    Lease acquire(const std::string& dst_crs) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto it = idle_.find(dst_crs); it != idle_.end() && !it->second.empty()) {
+                auto entry = std::move(it->second.back());
+                it->second.pop_back();
+                return Lease(this, dst_crs, std::move(entry));
             }
-            int offset_height = static_cast<int>(height * 10) + 100000;
-            return static_cast<uint8_t>(offset_height - r_value * R_MIN_HEIGHT -
-                                        g_value * G_MIN_HEIGHT);
-        };
-
-        std::vector<uint8_t> tile_buffer(tile_width * tile_height * 3);
+        }
 
-        for (uint32_t ty = 0; ty < static_cast<uint32_t>(ny); ty += tile_height) {
-            for (uint32_t tx = 0; tx < static_cast<uint32_t>(nx); tx += tile_width) {
-                std::fill(tile_buffer.begin(), tile_buffer.end(), 0);
+        // proj.dbの参照を伴うためロックの外で生成する
+        auto entry = create(dst_crs);
+        if (!entry)
+            return {};
+        return Lease(this, dst_crs, std::move(entry));
+    }
 
-                uint32_t actual_tile_width = std::min(tile_width, static_cast<uint32_t>(nx) - tx);
-                uint32_t actual_tile_height = std::min(tile_height, static_cast<uint32_t>(ny) - ty);
+   private:
+    ProjTransformPool() = default;
 
-                for (uint32_t row = 0; row < actual_tile_height; ++row) {
-                    for (uint32_t col = 0; col < actual_tile_width; ++col) {
-                        double height = pImpl->np_array[ty + row][tx + col];
-                        uint8_t r = convert_height_to_R(height);
-                        uint8_t g = convert_height_to_G(height, r);
-                        uint8_t b = convert_height_to_B(height, r, g);
-
-                        size_t dst_idx = (static_cast<size_t>(row) * tile_width + col) * 3;
-                        tile_buffer[dst_idx] = r;
-                        tile_buffer[dst_idx + 1] = g;
-                        tile_buffer[dst_idx + 2] = b;
-                    }
-                }
+    void release(std::string crs, std::unique_ptr<Entry> entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_[std::move(crs)].push_back(std::move(entry));
+    }
 
-                if (TIFFWriteTile(tif, tile_buffer.data(), tx, ty, 0, 0) < 0) {
-                    XTIFFClose(tif);
-                    ec = std::make_error_code(std::errc::io_error);
-                    return false;
-                }
-            }
+    static std::unique_ptr<Entry> create(const std::string& dst_crs) {
+        auto entry = std::make_unique<Entry>();
+        entry->ctx = proj_context_create();
+        if (!entry->ctx)
+            return nullptr;
+
+        const char* src_crs = "EPSG:4326";
+        PJ* src_pj = proj_create(entry->ctx, src_crs);
+        PJ* dst_pj = proj_create(entry->ctx, dst_crs.c_str());
+        if (!src_pj || !dst_pj) {
+            if (src_pj) proj_destroy(src_pj);
+            if (dst_pj) proj_destroy(dst_pj);
+            return nullptr;
         }
-    } else {
-        // Float32データ
-        std::vector<float> tile_buffer(tile_width * tile_height);
-
-        for (uint32_t ty = 0; ty < static_cast<uint32_t>(ny); ty += tile_height) {
-            for (uint32_t tx = 0; tx < static_cast<uint32_t>(nx); tx += tile_width) {
-                std::fill(tile_buffer.begin(), tile_buffer.end(), NODATA_VALUE);
-
-                uint32_t actual_tile_width = std::min(tile_width, static_cast<uint32_t>(nx) - tx);
-                uint32_t actual_tile_height = std::min(tile_height, static_cast<uint32_t>(ny) - ty);
 
-                for (uint32_t row = 0; row < actual_tile_height; ++row) {
-                    for (uint32_t col = 0; col < actual_tile_width; ++col) {
-                        size_t dst_idx = static_cast<size_t>(row) * tile_width + col;
-                        tile_buffer[dst_idx] = static_cast<float>(pImpl->np_array[ty + row][tx + col]);
-                    }
-                }
+        entry->identity = proj_is_equivalent_to(src_pj, dst_pj, PJ_COMP_EQUIVALENT);
+        const PJ_TYPE dst_type = proj_get_type(dst_pj);
+        entry->geographic = dst_type == PJ_TYPE_GEOGRAPHIC_2D_CRS ||
+                            dst_type == PJ_TYPE_GEOGRAPHIC_3D_CRS ||
+                            dst_type == PJ_TYPE_GEOGRAPHIC_CRS;
+        proj_destroy(src_pj);
+        proj_destroy(dst_pj);
 
-                if (TIFFWriteTile(tif, tile_buffer.data(), tx, ty, 0, 0) < 0) {
-                    XTIFFClose(tif);
-                    ec = std::make_error_code(std::errc::io_error);
-                    return false;
-                }
-            }
+        if (!entry->identity) {
+            entry->forward = create_normalized(entry->ctx, src_crs, dst_crs.c_str());
+            entry->inverse = create_normalized(entry->ctx, dst_crs.c_str(), src_crs);
+            if (!entry->forward || !entry->inverse)
+                return nullptr;
         }
+        return entry;
     }
 
-    XTIFFClose(tif);
-
-    pImpl->np_array.clear();
-    pImpl->np_array.shrink_to_fit();
+    // 可視化用に正規化された (経度, 緯度順の) 変換を生成
+    static PJ* create_normalized(PJ_CONTEXT* ctx, const char* from, const char* to) {
+        PJ* transform = proj_create_crs_to_crs(ctx, from, to, nullptr);
+        if (!transform)
+            return nullptr;
+        PJ* norm = proj_normalize_for_visualization(ctx, transform);
+        if (norm) {
+            proj_destroy(transform);
+            return norm;
+        }
+        return transform;
+    }
 
-    return true;
-}
+    std::mutex mutex_;
+    std::map<std::string, std::vector<std::unique_ptr<Entry>>> idle_;  // 返却済みの変換
+};
 
 // GeoTIFFデータ構造体
 struct GeoTiffData {
@@ -264,8 +552,12 @@ struct GeoTiffData {
     int height;
     double geo_transform[6];  // [x_origin, pixel_width, 0, y_origin, 0, -pixel_height]
     int epsg;
+    bool geographic = false;  // 地理座標系 (GeoKeyは ModelTypeGeographic + GeographicTypeGeoKey)
     float nodata_value;
     bool has_nodata;
+    bool byte_samples = false;  // 8bit符号なし整数で書き込む (種別バンド)
+    // data の有効ピクセル (結合時のマスク)。nullptrなら再投影時に nodata_value から求める
+    const ValidityMask* valid = nullptr;
 };
 
 // GeoTIFFを読み込むヘルパー関数
@@ -297,6 +589,8 @@ static bool read_geotiff(const std::filesystem::path& path, GeoTiffData& result)
         } else {
             result.epsg = 0;
         }
+        // 旧版が投影座標系のキーで書き込んだEPSG:4326も地理座標系として扱う
+        result.geographic = model_type == ModelTypeGeographic || result.epsg == 4326;
         GTIFFree(gtif);
     }
 
@@ -375,30 +669,38 @@ static bool read_geotiff(const std::filesystem::path& path, GeoTiffData& result)
     return true;
 }
 
-// GeoTIFFを書き込むヘルパー関数
-static bool write_geotiff(const std::filesystem::path& path, const GeoTiffData& data) {
-    TIFF* tif = XTIFFOpen(path.string().c_str(), "w");
-    if (!tif) {
-        return false;
-    }
-
+// 開いたTIFFへ投影座標系のGeoTIFFデータを書き込むヘルパー関数
+static bool write_geotiff_to(TIFF* tif, const GeoTiffData& data, bool rgbify = false,
+                             RgbEncoding rgb_encoding = RgbEncoding::Mapbox) {
+    stats::ScopedTimer timer(stats::Stage::Encode);
     TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(data.width));
     TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(data.height));
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
-    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
-    TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    if (rgbify) {
+        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 3);
+        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    } else if (data.byte_samples) {
+        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
+        TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_UINT);
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    } else {
+        TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 1);
+        TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 32);
+        TIFFSetField(tif, TIFFTAG_SAMPLEFORMAT, SAMPLEFORMAT_IEEEFP);
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+    }
     TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
 
     const uint32_t tile_width = 256;
     const uint32_t tile_height = 256;
     TIFFSetField(tif, TIFFTAG_TILEWIDTH, tile_width);
     TIFFSetField(tif, TIFFTAG_TILELENGTH, tile_height);
-    TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+    // RGBはタイルを並列にDeflate圧縮して書き込むため、圧縮方式をDeflateにする
+    TIFFSetField(tif, TIFFTAG_COMPRESSION, rgbify ? COMPRESSION_ADOBE_DEFLATE : COMPRESSION_LZW);
 
     GTIF* gtif = GTIFNew(tif);
     if (!gtif) {
-        XTIFFClose(tif);
         return false;
     }
 
@@ -408,107 +710,121 @@ static bool write_geotiff(const std::filesystem::path& path, const GeoTiffData&
     double tiepoint[6] = {0.0, 0.0, 0.0, data.geo_transform[0], data.geo_transform[3], 0.0};
     TIFFSetField(tif, GTIFF_TIEPOINTS, 6, tiepoint);
 
-    GTIFKeySet(gtif, GTModelTypeGeoKey, TYPE_SHORT, 1, ModelTypeProjected);
-    GTIFKeySet(gtif, GTRasterTypeGeoKey, TYPE_SHORT, 1, RasterPixelIsArea);
-    if (data.epsg > 0) {
-        GTIFKeySet(gtif, ProjectedCSTypeGeoKey, TYPE_SHORT, 1, data.epsg);
+    // 地理座標系 (EPSG:4326など) は GeographicTypeGeoKey、投影座標系は ProjectedCSTypeGeoKey
+    if (data.geographic) {
+        GTIFKeySet(gtif, GTModelTypeGeoKey, TYPE_SHORT, 1, ModelTypeGeographic);
+        GTIFKeySet(gtif, GTRasterTypeGeoKey, TYPE_SHORT, 1, RasterPixelIsArea);
+        if (data.epsg > 0) {
+            GTIFKeySet(gtif, GeographicTypeGeoKey, TYPE_SHORT, 1, data.epsg);
+        }
+    } else {
+        GTIFKeySet(gtif, GTModelTypeGeoKey, TYPE_SHORT, 1, ModelTypeProjected);
+        GTIFKeySet(gtif, GTRasterTypeGeoKey, TYPE_SHORT, 1, RasterPixelIsArea);
+        if (data.epsg > 0) {
+            GTIFKeySet(gtif, ProjectedCSTypeGeoKey, TYPE_SHORT, 1, data.epsg);
+        }
     }
 
     GTIFWriteKeys(gtif);
     GTIFFree(gtif);
 
-    if (data.has_nodata) {
-        std::string nodata_str = std::to_string(data.nodata_value);
+    if (data.has_nodata && !rgbify) {
+        std::string nodata_str = data.byte_samples
+                                     ? std::to_string(static_cast<int>(data.nodata_value))
+                                     : std::to_string(data.nodata_value);
         TIFFSetField(tif, TIFFTAG_GDAL_NODATA, nodata_str.c_str());
     }
 
-    std::vector<float> tile_buffer(tile_width * tile_height);
-    float fill_value = data.has_nodata ? data.nodata_value : 0.0f;
+    count_tiles(static_cast<uint32_t>(data.width), static_cast<uint32_t>(data.height), tile_width,
+                tile_height);
+    if (rgbify) {
+        return write_rgb_tiles(
+            tif, static_cast<uint32_t>(data.width), static_cast<uint32_t>(data.height), tile_width,
+            tile_height, rgb_encoding, [&data](uint32_t row) {
+                return data.data.data() + static_cast<size_t>(row) * data.width;
+            });
+    }
+
+    // タイル単位で画素をコピーして書き込む (Sampleはfloatまたはuint8_t)
+    auto write_tiles = [&]<typename Sample>(Sample fill_value) {
+        std::vector<Sample> tile_buffer(tile_width * tile_height);
 
-    for (uint32_t ty = 0; ty < static_cast<uint32_t>(data.height); ty += tile_height) {
-        for (uint32_t tx = 0; tx < static_cast<uint32_t>(data.width); tx += tile_width) {
-            std::fill(tile_buffer.begin(), tile_buffer.end(), fill_value);
+        for (uint32_t ty = 0; ty < static_cast<uint32_t>(data.height); ty += tile_height) {
+            for (uint32_t tx = 0; tx < static_cast<uint32_t>(data.width); tx += tile_width) {
+                std::fill(tile_buffer.begin(), tile_buffer.end(), fill_value);
 
-            uint32_t actual_tile_width =
-                std::min(tile_width, static_cast<uint32_t>(data.width) - tx);
-            uint32_t actual_tile_height =
-                std::min(tile_height, static_cast<uint32_t>(data.height) - ty);
+                uint32_t actual_tile_width =
+                    std::min(tile_width, static_cast<uint32_t>(data.width) - tx);
+                uint32_t actual_tile_height =
+                    std::min(tile_height, static_cast<uint32_t>(data.height) - ty);
 
-            for (uint32_t row = 0; row < actual_tile_height; ++row) {
-                for (uint32_t col = 0; col < actual_tile_width; ++col) {
-                    size_t src_idx = static_cast<size_t>(ty + row) * data.width + (tx + col);
-                    size_t dst_idx = static_cast<size_t>(row) * tile_width + col;
-                    tile_buffer[dst_idx] = data.data[src_idx];
+                for (uint32_t row = 0; row < actual_tile_height; ++row) {
+                    for (uint32_t col = 0; col < actual_tile_width; ++col) {
+                        size_t src_idx = static_cast<size_t>(ty + row) * data.width + (tx + col);
+                        size_t dst_idx = static_cast<size_t>(row) * tile_width + col;
+                        tile_buffer[dst_idx] = static_cast<Sample>(data.data[src_idx]);
+                    }
                 }
-            }
 
-            if (TIFFWriteTile(tif, tile_buffer.data(), tx, ty, 0, 0) < 0) {
-                XTIFFClose(tif);
-                return false;
+                if (TIFFWriteTile(tif, tile_buffer.data(), tx, ty, 0, 0) < 0) {
+                    return false;
+                }
             }
         }
-    }
+        return true;
+    };
 
-    XTIFFClose(tif);
-    return true;
+    float fill_value = data.has_nodata ? data.nodata_value : 0.0f;
+    if (data.byte_samples) {
+        return write_tiles(static_cast<uint8_t>(fill_value));
+    }
+    return write_tiles(fill_value);
 }
 
-bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
-    register_gdal_nodata_tag();
-
-    // 入力GeoTIFFを読み込み
-    GeoTiffData src_data;
-    if (!read_geotiff(pImpl->output_path, src_data)) {
-        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+// GeoTIFFファイルを書き込むヘルパー関数
+static bool write_geotiff(const std::filesystem::path& path, const GeoTiffData& data) {
+    trace::Span span("write");
+    if (span.active()) {
+        span.set_detail(path.filename().string());
+    }
+    TIFF* tif = XTIFFOpen(path.string().c_str(), "w");
+    if (!tif) {
         return false;
     }
 
-    // PROJコンテキストを作成
-    PJ_CONTEXT* ctx = proj_context_create();
-    if (!ctx) {
-        ec = std::make_error_code(std::errc::not_enough_memory);
-        return false;
+    bool ok = write_geotiff_to(tif, data);
+    XTIFFClose(tif);
+    if (ok) {
+        count_bytes_written(path);
     }
+    return ok;
+}
 
-    // ソースCRSを構築 (EPSG:4326)
-    std::string src_crs = "EPSG:4326";
+/**
+ * @brief EPSG:4326のラスターを出力CRSへバイリニア補間で再投影
+ *
+ * @param identity 出力CRSがEPSG:4326と同等の場合にtrue (dst_dataは未設定)
+ * @param nearest 最近傍で再投影する (種別など補間できない値の場合)
+ */
+static bool reproject(const GeoTiffData& src_data, std::string_view output_epsg,
+                      GeoTiffData& dst_data, bool& identity, std::error_code& ec,
+                      bool nearest = false) {
+    stats::ScopedTimer timer(stats::Stage::Resample);
     std::string dst_crs = std::string(output_epsg);
 
-    // 座標変換オブジェクトを作成
-    PJ* src_pj = proj_create(ctx, src_crs.c_str());
-    PJ* dst_pj = proj_create(ctx, dst_crs.c_str());
-
-    if (!src_pj || !dst_pj) {
-        if (src_pj) proj_destroy(src_pj);
-        if (dst_pj) proj_destroy(dst_pj);
-        proj_context_destroy(ctx);
+    // プロセス共有のプールから座標変換を借りる (関数の終了時に返却)
+    const ProjTransformPool::Lease entry = ProjTransformPool::instance().acquire(dst_crs);
+    if (!entry) {
         ec = std::make_error_code(std::errc::invalid_argument);
         return false;
     }
 
-    // CRSが同じかチェック
-    if (proj_is_equivalent_to(src_pj, dst_pj, PJ_COMP_EQUIVALENT)) {
-        proj_destroy(src_pj);
-        proj_destroy(dst_pj);
-        proj_context_destroy(ctx);
+    identity = entry->identity;
+    if (identity) {
         return true;  // 変換不要
     }
 
-    PJ* transform = proj_create_crs_to_crs(ctx, src_crs.c_str(), dst_crs.c_str(), nullptr);
-    if (!transform) {
-        proj_destroy(src_pj);
-        proj_destroy(dst_pj);
-        proj_context_destroy(ctx);
-        ec = std::make_error_code(std::errc::invalid_argument);
-        return false;
-    }
-
-    // 正規化された変換を取得
-    PJ* norm_transform = proj_normalize_for_visualization(ctx, transform);
-    if (norm_transform) {
-        proj_destroy(transform);
-        transform = norm_transform;
-    }
+    PJ* transform = entry->forward;
 
     // ソース画像の四隅を変換してバウンディングボックスを計算
     double src_corners[4][2] = {
@@ -550,25 +866,9 @@ bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
     dst_width = std::max(dst_width, 1);
     dst_height = std::max(dst_height, 1);
 
-    // 逆変換を作成
-    PJ* inv_transform = proj_create_crs_to_crs(ctx, dst_crs.c_str(), src_crs.c_str(), nullptr);
-    if (!inv_transform) {
-        proj_destroy(transform);
-        proj_destroy(src_pj);
-        proj_destroy(dst_pj);
-        proj_context_destroy(ctx);
-        ec = std::make_error_code(std::errc::invalid_argument);
-        return false;
-    }
-
-    PJ* norm_inv = proj_normalize_for_visualization(ctx, inv_transform);
-    if (norm_inv) {
-        proj_destroy(inv_transform);
-        inv_transform = norm_inv;
-    }
+    PJ* inv_transform = entry->inverse;
 
     // 出力データを初期化
-    GeoTiffData dst_data;
     dst_data.width = dst_width;
     dst_data.height = dst_height;
     dst_data.data.resize(static_cast<size_t>(dst_width) * dst_height, src_data.nodata_value);
@@ -578,8 +878,10 @@ bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
     dst_data.geo_transform[3] = dst_max_y;
     dst_data.geo_transform[4] = 0.0;
     dst_data.geo_transform[5] = -dst_pixel_height;
+    dst_data.geographic = entry->geographic;
     dst_data.nodata_value = src_data.nodata_value;
     dst_data.has_nodata = src_data.has_nodata;
+    dst_data.byte_samples = src_data.byte_samples;
 
     // 出力CRSからEPSGコードを抽出
     dst_data.epsg = 0;
@@ -587,7 +889,26 @@ bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
         dst_data.epsg = std::stoi(dst_crs.substr(5));
     }
 
-    // バイリニア補間で再投影
+    // 入力行ごとの有効ピクセルの有無 (データなしの行だけを参照する出力行は補間しない)
+    // 結合時のマスクがあればそれを使い、ディスクから読んだ入力などでは値から求める
+    std::vector<uint8_t> src_row_any(static_cast<size_t>(src_data.height), 1);
+    if (src_data.valid) {
+        for (int row = 0; row < src_data.height; ++row) {
+            src_row_any[row] = src_data.valid->any(row) ? 1 : 0;
+        }
+    } else if (src_data.has_nodata) {
+        const float nodata = src_data.nodata_value;
+        const ValidityMask valid = ValidityMask::from_values(
+            std::span<const float>(src_data.data), src_data.width, src_data.height,
+            [nodata](float v) { return v != nodata; });
+        for (int row = 0; row < src_data.height; ++row) {
+            src_row_any[row] = valid.any(row) ? 1 : 0;
+        }
+    }
+
+    // バイリニア補間で再投影 (座標変換は行単位で求め、補間はカーネルで処理)
+    std::vector<double> src_cols(static_cast<size_t>(dst_width));
+    std::vector<double> src_rows(static_cast<size_t>(dst_width));
     for (int dst_row = 0; dst_row < dst_height; ++dst_row) {
         for (int dst_col = 0; dst_col < dst_width; ++dst_col) {
             double dst_x = dst_min_x + (dst_col + 0.5) * dst_pixel_width;
@@ -596,48 +917,74 @@ bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
             PJ_COORD dst_coord = proj_coord(dst_x, dst_y, 0, 0);
             PJ_COORD src_coord = proj_trans(inv_transform, PJ_FWD, dst_coord);
 
-            double src_col_f =
+            src_cols[dst_col] =
                 (src_coord.xy.x - src_data.geo_transform[0]) / src_data.geo_transform[1] - 0.5;
-            double src_row_f =
+            src_rows[dst_col] =
                 (src_data.geo_transform[3] - src_coord.xy.y) / (-src_data.geo_transform[5]) - 0.5;
+        }
 
-            // バイリニア補間
-            int src_col0 = static_cast<int>(std::floor(src_col_f));
-            int src_row0 = static_cast<int>(std::floor(src_row_f));
-            int src_col1 = src_col0 + 1;
-            int src_row1 = src_row0 + 1;
-
-            if (src_col0 >= 0 && src_col1 < src_data.width && src_row0 >= 0 &&
-                src_row1 < src_data.height) {
-                double dx = src_col_f - src_col0;
-                double dy = src_row_f - src_row0;
-
-                float v00 = src_data.data[static_cast<size_t>(src_row0) * src_data.width + src_col0];
-                float v01 = src_data.data[static_cast<size_t>(src_row0) * src_data.width + src_col1];
-                float v10 = src_data.data[static_cast<size_t>(src_row1) * src_data.width + src_col0];
-                float v11 = src_data.data[static_cast<size_t>(src_row1) * src_data.width + src_col1];
-
-                // NODATAチェック
-                if (src_data.has_nodata) {
-                    if (v00 == src_data.nodata_value || v01 == src_data.nodata_value ||
-                        v10 == src_data.nodata_value || v11 == src_data.nodata_value) {
-                        continue;  // NODATAのままにする
-                    }
-                }
+        float* dst = dst_data.data.data() + static_cast<size_t>(dst_row) * dst_width;
+
+        // 参照する入力行 (補間の上下2行) がすべてデータなしなら出力もデータなし
+        const auto [min_row, max_row] = std::minmax_element(src_rows.begin(), src_rows.end());
+        if (std::isfinite(*min_row) && std::isfinite(*max_row)) {
+            const double max_index = src_data.height - 1;
+            const auto first = static_cast<int>(std::clamp(std::floor(*min_row), 0.0, max_index));
+            const auto last =
+                static_cast<int>(std::clamp(std::floor(*max_row) + 1.0, 0.0, max_index));
+            if (std::none_of(src_row_any.begin() + first, src_row_any.begin() + last + 1,
+                             [](uint8_t any) { return any != 0; })) {
+                continue;
+            }
+        }
 
-                float value = static_cast<float>((1 - dx) * (1 - dy) * v00 + dx * (1 - dy) * v01 +
-                                                  (1 - dx) * dy * v10 + dx * dy * v11);
-                dst_data.data[static_cast<size_t>(dst_row) * dst_width + dst_col] = value;
+        if (nearest) {
+            for (int dst_col = 0; dst_col < dst_width; ++dst_col) {
+                const double col = std::round(src_cols[dst_col]);
+                const double row = std::round(src_rows[dst_col]);
+                if (col >= 0 && row >= 0 && col < src_data.width && row < src_data.height) {
+                    dst[dst_col] = src_data.data[static_cast<size_t>(row) * src_data.width +
+                                                 static_cast<size_t>(col)];
+                }
             }
+            continue;
         }
+        kernels::resample_bilinear_row(src_data.data.data(), src_data.width, src_data.height,
+                                       src_cols.data(), src_rows.data(), src_cols.size(),
+                                       src_data.has_nodata, src_data.nodata_value, dst);
     }
 
-    // 変換オブジェクトを解放
-    proj_destroy(transform);
-    proj_destroy(inv_transform);
-    proj_destroy(src_pj);
-    proj_destroy(dst_pj);
-    proj_context_destroy(ctx);
+    // 四隅の順変換と出力画素ごとの逆変換
+    stats::add(stats::Counter::ProjCalls, 4 + static_cast<uint64_t>(dst_width) * dst_height);
+    return true;
+}
+
+bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
+    register_gdal_nodata_tag();
+
+    // 入力GeoTIFFを読み込み
+    GeoTiffData src_data;
+    if (!read_geotiff(pImpl->output_path, src_data)) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return false;
+    }
+    stats::MemoryCharge src_charge(stats::Memory::ResampleSource, stats::bytes_of(src_data.data));
+
+    // 書き込んだ配列と同じ寸法なら結合時のマスクを使う (読み戻した値から求め直さない)
+    if (pImpl->valid && src_data.has_nodata && pImpl->valid->width() == src_data.width &&
+        pImpl->valid->height() == src_data.height) {
+        src_data.valid = pImpl->valid;
+    }
+
+    GeoTiffData dst_data;
+    bool identity = false;
+    if (!reproject(src_data, output_epsg, dst_data, identity, ec)) {
+        return false;
+    }
+    if (identity) {
+        return true;  // 変換不要
+    }
+    stats::MemoryCharge dst_charge(stats::Memory::ResampleDest, stats::bytes_of(dst_data.data));
 
     // 一時ファイルに書き込み
     std::filesystem::path temp_path = pImpl->output_path;
@@ -655,30 +1002,113 @@ bool GeoTiff::resampling(std::string_view output_epsg, std::error_code& ec) {
     return true;
 }
 
+bool GeoTiff::encode(std::string_view output_epsg, bool rgbify, std::vector<uint8_t>& out,
+                     std::error_code& ec) {
+    register_gdal_nodata_tag();
+
+    // 同一CRSかどうかだけを確認する (再投影では reproject が改めて変換を借りる)
+    bool identity = false;
+    {
+        const ProjTransformPool::Lease entry =
+            ProjTransformPool::instance().acquire(std::string(output_epsg));
+        if (!entry) {
+            ec = std::make_error_code(std::errc::invalid_argument);
+            return false;
+        }
+        identity = entry->identity;
+    }
+
+    MemoryTiffStream stream;
+    TIFF* tif = open_memory_tiff(stream);
+    if (!tif) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    bool ok = false;
+    if (identity) {
+        // EPSG:4326のまま書き出し
+        ok = pImpl->write_to(tif, rgbify);
+    } else {
+        // 結合済み配列を直接GeoTiffDataへ変換して再投影 (一時ファイルを経由しない)
+        GeoTiffData src_data;
+        src_data.width = pImpl->x_length;
+        src_data.height = pImpl->y_length;
+        src_data.data.resize(static_cast<size_t>(src_data.width) * src_data.height);
+        for (int row = 0; row < src_data.height; ++row) {
+            const auto& src_row = pImpl->np_array[row];
+            float* dst_row = src_data.data.data() + static_cast<size_t>(row) * src_data.width;
+            for (int col = 0; col < src_data.width; ++col) {
+                dst_row[col] = static_cast<float>(src_row[col]);
+            }
+        }
+        std::copy(pImpl->geo_transform.begin(), pImpl->geo_transform.end(),
+                  src_data.geo_transform);
+        src_data.epsg = 4326;
+        src_data.geographic = true;
+        src_data.nodata_value = -9999.0f;
+        src_data.has_nodata = true;
+        if (pImpl->valid && pImpl->valid->width() == src_data.width &&
+            pImpl->valid->height() == src_data.height) {
+            src_data.valid = pImpl->valid;  // 結合時のマスク (値から求め直さない)
+        }
+        stats::MemoryCharge src_charge(stats::Memory::ResampleSource,
+                                       stats::bytes_of(src_data.data));
+
+        GeoTiffData dst_data;
+        if (!reproject(src_data, output_epsg, dst_data, identity, ec)) {
+            XTIFFClose(tif);
+            return false;
+        }
+        stats::MemoryCharge dst_charge(stats::Memory::ResampleDest,
+                                       stats::bytes_of(dst_data.data));
+        ok = write_geotiff_to(tif, dst_data, rgbify, pImpl->rgb_encoding);
+    }
+
+    XTIFFClose(tif);
+
+    if (!ok) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    out = std::move(stream.data);
+    stats::add(stats::Counter::BytesWritten, out.size());
+    return true;
+}
+
 bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
     register_gdal_nodata_tag();
     namespace fs = std::filesystem;
 
-    if (!fs::exists(config.input_folder)) {
+    if (config.input_files.empty() && !fs::exists(config.input_folder)) {
         ec = std::make_error_code(std::errc::no_such_file_or_directory);
         return false;
     }
 
-    // DEM種別に一致するTIFファイルを収集
+    // DEM種別に一致するTIFファイルを収集 (一覧の指定がない場合はフォルダを走査)
+    std::vector<fs::path> candidates = config.input_files;
+    if (candidates.empty()) {
+        for (const auto& entry : fs::recursive_directory_iterator(config.input_folder)) {
+            if (entry.is_regular_file())
+                candidates.push_back(entry.path());
+        }
+    }
+
     std::vector<std::string> input_files;
     std::string latest_date;
 
     std::string pattern1 = "-DEM" + config.dem_type + ".tif";
     std::string pattern2 = "DEM" + config.dem_type + "-";
 
-    for (const auto& entry : fs::recursive_directory_iterator(config.input_folder)) {
-        if (!entry.is_regular_file())
+    for (const auto& path : candidates) {
+        if (!fs::is_regular_file(path))
             continue;
 
-        std::string filename = entry.path().filename().string();
+        std::string filename = path.filename().string();
         if (filename.find(pattern1) != std::string::npos ||
             filename.find(pattern2) != std::string::npos) {
-            input_files.push_back(entry.path().string());
+            input_files.push_back(path.string());
 
             size_t pos = filename.find(pattern2);
             if (pos != std::string::npos) {
@@ -721,6 +1151,7 @@ bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
     double pixel_width = 0.0;
     double pixel_height = 0.0;
     int epsg = 0;
+    bool geographic = false;
     float nodata_value = -9999.0f;
 
     for (const auto& tiff : input_files) {
@@ -747,6 +1178,7 @@ bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
             pixel_width = data.geo_transform[1];
             pixel_height = -data.geo_transform[5];
             epsg = data.epsg;
+            geographic = data.geographic;
             if (data.has_nodata) {
                 nodata_value = data.nodata_value;
             }
@@ -785,6 +1217,7 @@ bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
     output.geo_transform[4] = 0.0;
     output.geo_transform[5] = -pixel_height;
     output.epsg = epsg;
+    output.geographic = geographic;
     output.nodata_value = nodata_value;
     output.has_nodata = true;
 
@@ -796,17 +1229,57 @@ bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
         int dst_col_start = static_cast<int>(std::round((src_x0 - min_x) / pixel_width));
         int dst_row_start = static_cast<int>(std::round((max_y - src_y0) / pixel_height));
 
+        // 出力範囲に収まる入力列 [col_begin, col_end)
+        const int col_begin = std::max(0, -dst_col_start);
+        const int col_end = std::min(src.width, out_width - dst_col_start);
+        if (col_begin >= col_end)
+            continue;
+
+        // 有効ピクセルを64ピクセル単位で判定し、すべてデータなしのワードは読み飛ばす
+        const float src_nodata = src.nodata_value;
+        const ValidityMask valid =
+            src.has_nodata ? ValidityMask::from_values(std::span<const float>(src.data),
+                                                       src.width, src.height,
+                                                       [src_nodata](float v) {
+                                                           return v != src_nodata;
+                                                       })
+                           : ValidityMask();
+
         for (int row = 0; row < src.height; ++row) {
-            for (int col = 0; col < src.width; ++col) {
-                int dst_row = dst_row_start + row;
-                int dst_col = dst_col_start + col;
+            int dst_row = dst_row_start + row;
+            if (dst_row < 0 || dst_row >= out_height)
+                continue;
 
-                if (dst_row >= 0 && dst_row < out_height && dst_col >= 0 && dst_col < out_width) {
-                    float value = src.data[static_cast<size_t>(row) * src.width + col];
+            const float* src_row = src.data.data() + static_cast<size_t>(row) * src.width;
+            float* dst_line = output.data.data() + static_cast<size_t>(dst_row) * out_width;
 
-                    if (!src.has_nodata || value != src.nodata_value) {
-                        output.data[static_cast<size_t>(dst_row) * out_width + dst_col] = value;
-                    }
+            if (!src.has_nodata) {
+                std::memcpy(dst_line + (dst_col_start + col_begin), src_row + col_begin,
+                            static_cast<size_t>(col_end - col_begin) * sizeof(float));
+                continue;
+            }
+
+            const auto words = valid.row(row);
+            for (int k = col_begin / ValidityMask::WORD_BITS;
+                 k * ValidityMask::WORD_BITS < col_end; ++k) {
+                const int base = k * ValidityMask::WORD_BITS;
+                uint64_t w = words[k];
+                if (base < col_begin)
+                    w &= ~uint64_t{0} << (col_begin - base);
+                if (col_end - base < ValidityMask::WORD_BITS)
+                    w &= (uint64_t{1} << (col_end - base)) - 1;
+
+                if (w == 0)
+                    continue;
+                if (w == ~uint64_t{0}) {
+                    std::memcpy(dst_line + (dst_col_start + base), src_row + base,
+                                ValidityMask::WORD_BITS * sizeof(float));
+                    continue;
+                }
+                while (w != 0) {
+                    const int col = base + std::countr_zero(w);
+                    dst_line[dst_col_start + col] = src_row[col];
+                    w &= w - 1;
                 }
             }
         }
@@ -833,4 +1306,66 @@ bool merge_tif_files(const MergeConfig& config, std::error_code& ec) {
     return true;
 }
 
+bool write_float_geotiff(const std::filesystem::path& path, std::span<const float> data,
+                         int width, int height, const std::array<double, 6>& geo_transform,
+                         float nodata, std::string_view output_epsg, std::error_code& ec,
+                         bool nearest) {
+    register_gdal_nodata_tag();
+
+    GeoTiffData src_data;
+    src_data.data.assign(data.begin(), data.end());
+    src_data.width = width;
+    src_data.height = height;
+    std::copy(geo_transform.begin(), geo_transform.end(), src_data.geo_transform);
+    src_data.epsg = 4326;
+    src_data.geographic = true;
+    src_data.nodata_value = nodata;
+    src_data.has_nodata = true;
+    stats::MemoryCharge src_charge(stats::Memory::ResampleSource, stats::bytes_of(src_data.data));
+
+    GeoTiffData dst_data;
+    bool identity = false;
+    if (!reproject(src_data, output_epsg, dst_data, identity, ec, nearest)) {
+        return false;
+    }
+    stats::MemoryCharge dst_charge(stats::Memory::ResampleDest, stats::bytes_of(dst_data.data));
+
+    if (!write_geotiff(path, identity ? src_data : dst_data)) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+}
+
+bool write_class_geotiff(const std::filesystem::path& path, std::span<const uint8_t> data,
+                         int width, int height, const std::array<double, 6>& geo_transform,
+                         std::string_view output_epsg, std::error_code& ec) {
+    register_gdal_nodata_tag();
+
+    GeoTiffData src_data;
+    src_data.data.assign(data.begin(), data.end());
+    src_data.width = width;
+    src_data.height = height;
+    std::copy(geo_transform.begin(), geo_transform.end(), src_data.geo_transform);
+    src_data.epsg = 4326;
+    src_data.geographic = true;
+    src_data.nodata_value = static_cast<float>(SURFACE_CLASS_NODATA);
+    src_data.has_nodata = true;
+    src_data.byte_samples = true;
+    stats::MemoryCharge src_charge(stats::Memory::ResampleSource, stats::bytes_of(src_data.data));
+
+    GeoTiffData dst_data;
+    bool identity = false;
+    if (!reproject(src_data, output_epsg, dst_data, identity, ec, true)) {
+        return false;
+    }
+    stats::MemoryCharge dst_charge(stats::Memory::ResampleDest, stats::bytes_of(dst_data.data));
+
+    if (!write_geotiff(path, identity ? src_data : dst_data)) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+}
+
 }  // namespace fgd_converter
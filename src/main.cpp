@@ -2,30 +2,81 @@
 #include <windows.h>
 #endif
 
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
 
 #include <algorithm>
+#include <array>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <cxxopts.hpp>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
 #include <sstream>
 
 #include "converter.hpp"
+#include "cpu_features.hpp"
+#include "dem.hpp"
 #include "geotiff.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_catalog.hpp"
+#include "mesh_code.hpp"
+#include "pmtiles_writer.hpp"
+#include "point_query.hpp"
+#include "quantized_mesh.hpp"
+#include "server.hpp"
+#include "simple_json.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "xyz_tiles.hpp"
 #include "zip_handler.hpp"
 
 namespace fs = std::filesystem;
 
+// シグナル受信時に停止させる常駐サーバー
+static fgd_converter::ConversionServer *g_server = nullptr;
+
+extern "C" void handle_stop_signal(int) {
+    if (g_server) {
+        g_server->stop();
+    }
+}
+
+/**
+ * @brief 変換対象の内側ZIP (カタログを使う場合は処理するXMLエントリ付き)
+ */
+struct ArchiveJob {
+    fs::path zip_path;
+    std::optional<std::vector<fgd_converter::zip::EntryInfo>> entries;
+};
+
 void process_zip(const fs::path &zip_path, const fs::path &output_dir,
-                 const std::string &output_epsg, bool rgbify, bool sea_at_zero) {
+                 const std::string &output_epsg, fgd_converter::OutputFormat output_format,
+                 bool rgbify, fgd_converter::RgbEncoding rgb_encoding, bool sea_at_zero,
+                 const fgd_converter::TerrainConfig &terrain, bool surface_class,
+                 std::shared_ptr<const fgd_converter::MeshCache> mesh_cache,
+                 std::optional<std::vector<fgd_converter::zip::EntryInfo>> entries) {
     std::cout << "処理中: " << zip_path.string() << "\n";
 
     fgd_converter::Converter::Config config{.import_path = zip_path,
                                             .output_path = output_dir,
                                             .output_epsg = output_epsg,
+                                            .output_format = output_format,
                                             .file_name = std::nullopt,
                                             .rgbify = rgbify,
-                                            .sea_at_zero = sea_at_zero};
+                                            .rgb_encoding = rgb_encoding,
+                                            .sea_at_zero = sea_at_zero,
+                                            .terrain = terrain,
+                                            .surface_class = surface_class,
+                                            .mesh_cache = std::move(mesh_cache),
+                                            .entries = std::move(entries),
+                                            .on_progress = {}};
 
     fgd_converter::Converter converter(config);
     std::error_code ec;
@@ -52,6 +103,480 @@ void extract_zip(const fs::path &zip_path, const fs::path &extract_to) {
     }
 }
 
+/**
+ * @brief "lat,lng;lat,lng" 形式の地点リストを解析
+ */
+std::vector<std::pair<double, double>> parse_query_points(const std::string &text) {
+    std::vector<std::pair<double, double>> points;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ';')) {
+        if (item.find_first_not_of(" \t") == std::string::npos)
+            continue;
+        auto comma = item.find(',');
+        if (comma == std::string::npos) {
+            throw std::invalid_argument("地点の書式が不正です (lat,lng): " + item);
+        }
+        points.emplace_back(std::stod(item.substr(0, comma)), std::stod(item.substr(comma + 1)));
+    }
+    return points;
+}
+
+/**
+ * @brief "最小経度,最小緯度,最大経度,最大緯度" 形式の範囲を解析
+ */
+fgd_converter::BoundsLatLng parse_bbox(const std::string &text) {
+    std::array<double, 4> values{};
+    std::stringstream ss(text);
+    std::string item;
+    size_t count = 0;
+    while (std::getline(ss, item, ',')) {
+        if (count == values.size()) {
+            count = values.size() + 1;
+            break;
+        }
+        values[count++] = std::stod(item);
+    }
+    if (count != values.size() || values[0] >= values[2] || values[1] >= values[3]) {
+        throw std::invalid_argument("範囲の書式が不正です (最小経度,最小緯度,最大経度,最大緯度): " +
+                                    text);
+    }
+    return {.min_lat = values[1], .max_lat = values[3], .min_lng = values[0], .max_lng = values[2]};
+}
+
+/**
+ * @brief 入力を走査してメッシュカタログを作成・保存 (--build-catalog)
+ */
+int run_build_catalog(const fs::path &input, const fs::path &catalog_path) {
+    std::cout << "カタログを作成中: " << input.string() << "\n";
+    std::error_code ec;
+    auto catalog = fgd_converter::MeshCatalog::build(std::span<const fs::path>(&input, 1), ec);
+    if (!catalog) {
+        std::cerr << "カタログを作成できません: " << ec.message() << "\n";
+        return 1;
+    }
+    if (!catalog->save(catalog_path, ec)) {
+        std::cerr << "カタログの書き込みに失敗: " << catalog_path.string() << " ("
+                  << ec.message() << ")\n";
+        return 1;
+    }
+    auto records = catalog->select();
+    std::cout << records.size() << " 件のメッシュ (" << catalog->sources(records).size()
+              << " 個のZIP) をカタログに登録しました → " << catalog_path.string() << "\n";
+    return 0;
+}
+
+/**
+ * @brief 範囲と重なるレコードのうち、各メッシュ・DEM種別の最新版のみを選択
+ */
+std::vector<const fgd_converter::CatalogRecord *> select_latest(
+    const fgd_converter::MeshCatalog &catalog,
+    const std::optional<fgd_converter::BoundsLatLng> &bbox) {
+    auto records = catalog.select(bbox);
+    auto latest = catalog.latest(records);
+    fgd_converter::stats::add(fgd_converter::stats::Counter::Superseded,
+                              records.size() - latest.size());
+    return latest;
+}
+
+/**
+ * @brief 全ZIPのXMLエントリ名から各メッシュ・DEM種別の最新版を選び、処理するエントリを限定
+ *
+ * セントラルディレクトリのみを読み、XMLは展開しない。最新版を1つも含まないZIPは変換しない。
+ * エントリ一覧を取得できないZIP・ネストしたZIPを含むZIPは従来どおりDemで処理する。
+ */
+void keep_latest_entries(std::vector<ArchiveJob> &jobs) {
+    using fgd_converter::zip::EntryInfo;
+    std::vector<std::optional<std::vector<EntryInfo>>> listed(jobs.size());
+    tbb::parallel_for(size_t{0}, jobs.size(), [&](size_t i) {
+        fgd_converter::zip::ZipHandler handler(jobs[i].zip_path);
+        std::error_code ec;
+        auto entries = handler.list_entries(ec);
+        if (!entries)
+            return;
+        std::vector<EntryInfo> xml_entries;
+        for (auto &entry : *entries) {
+            if (fgd_converter::zip::is_zip_file(entry.name))
+                return;
+            if (fs::path(entry.name).extension() == ".xml")
+                xml_entries.push_back(std::move(entry));
+        }
+        listed[i] = std::move(xml_entries);
+    });
+
+    std::vector<std::pair<size_t, EntryInfo>> candidates;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (listed[i] && listed[i]->empty())
+            listed[i].reset();  // XMLを含まないZIPはDemでエラーとして報告させる
+        if (!listed[i])
+            continue;
+        for (auto &entry : *listed[i]) {
+            candidates.emplace_back(i, std::move(entry));
+        }
+        listed[i]->clear();
+    }
+    const size_t found = candidates.size();
+    candidates = fgd_converter::mesh::latest_versions(
+        std::move(candidates), [](const auto &candidate) { return candidate.second.name; });
+    fgd_converter::stats::add(fgd_converter::stats::Counter::Superseded,
+                              found - candidates.size());
+
+    for (auto &[job, entry] : candidates) {
+        listed[job]->push_back(std::move(entry));
+    }
+    std::vector<ArchiveJob> kept;
+    kept.reserve(jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (listed[i] && listed[i]->empty()) {
+            std::cout << "スキップ (新しい版があります): " << jobs[i].zip_path.filename().string()
+                      << "\n";
+            continue;
+        }
+        jobs[i].entries = std::move(listed[i]);
+        kept.push_back(std::move(jobs[i]));
+    }
+    jobs = std::move(kept);
+}
+
+/**
+ * @brief カタログのレコードから変換対象の内側ZIPを決定
+ *
+ * ネストしたZIPは、対象のレコードを含むものだけを外側のZIPから展開する。
+ * ZIP外のXMLファイルは変換の対象外。
+ */
+std::vector<ArchiveJob> plan_from_catalog(
+    const fgd_converter::MeshCatalog &catalog,
+    std::span<const fgd_converter::CatalogRecord *const> records, const fs::path &extract_folder) {
+    auto sources = catalog.sources(records);
+
+    // 外側のZIPごとに必要なネストZIPの名前をまとめて1回で展開
+    std::map<fs::path, std::vector<std::string_view>> nested_by_archive;
+    for (const auto &source : sources) {
+        if (!source.nested.empty()) {
+            nested_by_archive[source.archive].push_back(source.nested);
+        }
+    }
+    std::vector<std::pair<fs::path, std::vector<std::string_view>>> extractions(
+        nested_by_archive.begin(), nested_by_archive.end());
+    std::cout << extractions.size() << " 個のZIPから "
+              << std::accumulate(extractions.begin(), extractions.end(), size_t{0},
+                                 [](size_t n, const auto &e) { return n + e.second.size(); })
+              << " 個のネストZIPを展開中...\n";
+    tbb::parallel_for_each(extractions, [&](const auto &extraction) {
+        fgd_converter::zip::ZipHandler handler(extraction.first);
+        std::error_code ec;
+        if (!handler.extract_specific(extract_folder, extraction.second, ec)) {
+            std::stringstream ss;
+            ss << "展開失敗 " << extraction.first.string() << ": " << ec.message();
+            std::cerr << ss.str() << "\n";
+        }
+    });
+
+    std::vector<ArchiveJob> jobs;
+    for (const auto &source : sources) {
+        fs::path zip_path = source.nested.empty() ? source.archive : extract_folder / source.nested;
+        if (!fgd_converter::zip::is_zip_file(zip_path) || !fs::exists(zip_path))
+            continue;
+        std::vector<fgd_converter::zip::EntryInfo> entries;
+        entries.reserve(source.records.size());
+        for (const auto *record : source.records) {
+            entries.push_back(catalog.entry_info(*record));
+        }
+        jobs.push_back({.zip_path = std::move(zip_path), .entries = std::move(entries)});
+    }
+    return jobs;
+}
+
+/**
+ * @brief カタログからマージ対象のTIFファイル (変換時の出力名) の一覧を作成
+ */
+std::vector<fs::path> catalog_merge_files(
+    const fgd_converter::MeshCatalog &catalog,
+    std::span<const fgd_converter::CatalogRecord *const> records, const fs::path &merge_dir,
+    std::string_view dem_type) {
+    std::vector<const fgd_converter::CatalogRecord *> matched;
+    for (const auto *record : records) {
+        if (fgd_converter::MeshCatalog::dem_type(*record) == dem_type) {
+            matched.push_back(record);
+        }
+    }
+
+    std::vector<fs::path> files;
+    for (const auto &source : catalog.sources(matched)) {
+        fs::path stem = source.nested.empty() ? source.archive.stem()
+                                              : fs::path(source.nested).filename().stem();
+        files.push_back(merge_dir / (stem.string() + ".tif"));
+    }
+    return files;
+}
+
+int run_query(const fs::path &input, const std::string &query_text, bool sea_at_zero,
+              std::shared_ptr<const fgd_converter::MeshCatalog> catalog) {
+    auto points = parse_query_points(query_text);
+
+    fgd_converter::PointQueryEngine engine({.inputs = {input},
+                                            .cache_capacity = 64,
+                                            .sea_at_zero = sea_at_zero,
+                                            .catalog = std::move(catalog)});
+
+    std::cout << "lat,lng,elevation,mesh_code,dem_type\n";
+    for (const auto &[lat, lng] : points) {
+        auto r = engine.query(lat, lng);
+        std::cout << r.lat << "," << r.lng << ",";
+        if (r.elevation) {
+            std::cout << *r.elevation;
+        }
+        std::cout << "," << r.mesh_code << "," << r.dem_type << "\n";
+    }
+    return 0;
+}
+
+/**
+ * @brief 地点CSV (1列目: 緯度, 2列目: 経度、ヘッダー行は任意) を読み込み
+ */
+std::vector<std::pair<double, double>> read_points_csv(const fs::path &path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("地点ファイルを開けません: " + path.string());
+    }
+
+    std::vector<std::pair<double, double>> points;
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(file, line)) {
+        ++line_no;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        const char *begin = line.c_str();
+        char *end = nullptr;
+        double lat = std::strtod(begin, &end);
+        bool ok = end != begin && *end == ',';
+        double lng = 0.0;
+        if (ok) {
+            const char *lng_begin = end + 1;
+            lng = std::strtod(lng_begin, &end);
+            ok = end != lng_begin;
+        }
+        if (!ok) {
+            // 1行目の数値でない行はヘッダーとして読み飛ばす
+            if (line_no == 1)
+                continue;
+            throw std::runtime_error("地点ファイルの " + std::to_string(line_no) +
+                                     " 行目を解析できません");
+        }
+        points.emplace_back(lat, lng);
+    }
+    return points;
+}
+
+int run_sample(const fs::path &input, const fs::path &points_path, const std::string &output,
+               const std::string &interpolation, bool sea_at_zero,
+               std::shared_ptr<const fgd_converter::MeshCatalog> catalog) {
+    fgd_converter::Interpolation method;
+    if (interpolation == "bilinear") {
+        method = fgd_converter::Interpolation::Bilinear;
+    } else if (interpolation == "nearest") {
+        method = fgd_converter::Interpolation::Nearest;
+    } else {
+        std::cerr << "エラー: --interpolation は bilinear または nearest を指定してください\n";
+        return 1;
+    }
+
+    auto points = read_points_csv(points_path);
+    std::cerr << points.size() << " 地点をサンプリング中...\n";
+
+    fgd_converter::PointQueryEngine engine({.inputs = {input},
+                                            .cache_capacity = 64,
+                                            .sea_at_zero = sea_at_zero,
+                                            .catalog = std::move(catalog)});
+    auto values = engine.sample(points, method);
+
+    std::ofstream file;
+    if (output != "-") {
+        file.open(output);
+        if (!file) {
+            std::cerr << "出力ファイルを開けません: " << output << "\n";
+            return 1;
+        }
+    }
+    std::ostream &out = output == "-" ? std::cout : file;
+
+    // 入力順に書き出し (行ごとのstd::ostream書式化を避けてバッファにまとめる)
+    std::string buffer = "lat,lng,elevation\n";
+    buffer.reserve(points.size() * 32);
+    char line[96];
+    for (size_t i = 0; i < points.size(); ++i) {
+        int len = values[i] ? std::snprintf(line, sizeof(line), "%.9g,%.9g,%.2f\n",
+                                            points[i].first, points[i].second, *values[i])
+                            : std::snprintf(line, sizeof(line), "%.9g,%.9g,\n", points[i].first,
+                                            points[i].second);
+        buffer.append(line, static_cast<size_t>(len));
+    }
+    out << buffer;
+    return 0;
+}
+
+/**
+ * @brief 全ZIPを読み込み、ZIPごとの結合済みラスターを作成
+ *
+ * 読み込めなかったZIPは空のモザイクのまま (タイル化で無視される)。
+ */
+std::vector<fgd_converter::Mosaic> load_mosaics(
+    const std::vector<ArchiveJob> &jobs, bool sea_at_zero,
+    const std::shared_ptr<const fgd_converter::MeshCache> &mesh_cache) {
+    std::vector<fgd_converter::Mosaic> mosaics(jobs.size());
+    std::mutex cerr_mutex;
+
+    tbb::parallel_for(size_t{0}, jobs.size(), [&](size_t i) {
+        fgd_converter::stats::ArchiveScope archive(jobs[i].zip_path.filename().string());
+        try {
+            fgd_converter::Dem dem(jobs[i].zip_path, sea_at_zero, mesh_cache, jobs[i].entries);
+            dem.get_xml_content();
+            mosaics[i] = fgd_converter::build_mosaic(dem.get_metadata_list(),
+                                                     dem.get_np_array_list(),
+                                                     dem.get_bounds_latlng(), dem.get_mask_list());
+        } catch (const std::exception &e) {
+            std::lock_guard<std::mutex> lock(cerr_mutex);
+            std::cerr << "処理エラー " << jobs[i].zip_path.string() << ": " << e.what() << "\n";
+        }
+    });
+    return mosaics;
+}
+
+/**
+ * @brief 全ZIPの結合済みラスターから直接XYZタイルピラミッドを出力
+ *
+ * ZIPごとにGeoTIFFを書き出さず、メモリ上のモザイクをまとめてタイル化するため、
+ * ZIP境界をまたぐタイルも欠けなく作成される。
+ * 出力先が .pmtiles の場合は単一のPMTilesアーカイブ、それ以外は {z}/{x}/{y}.png。
+ */
+int run_xyz_tiles(const std::vector<ArchiveJob> &jobs, const fs::path &tiles_dir,
+                  const fgd_converter::XyzTileConfig &config, bool sea_at_zero,
+                  const std::shared_ptr<const fgd_converter::MeshCache> &mesh_cache) {
+    auto mosaics = load_mosaics(jobs, sea_at_zero, mesh_cache);
+
+    std::cout << "XYZタイルを作成中 (ズーム " << config.min_zoom << "-" << config.max_zoom
+              << ", " << config.tile_size << "px) → " << tiles_dir.string() << "\n";
+
+    std::unique_ptr<fgd_converter::TileWriter> writer;
+    if (tiles_dir.extension() == ".pmtiles") {
+        const char *encoding =
+            config.encoding == fgd_converter::RgbEncoding::Terrarium ? "terrarium" : "mapbox";
+        std::string metadata = "{\"name\":" +
+                               fgd_converter::json::quote(tiles_dir.stem().string()) +
+                               ",\"format\":\"png\",\"type\":\"baselayer\",\"encoding\":\"" +
+                               encoding + "\"}";
+        writer = std::make_unique<fgd_converter::PmtilesWriter>(tiles_dir, std::move(metadata));
+    } else {
+        writer = std::make_unique<fgd_converter::DirectoryTileWriter>(tiles_dir);
+    }
+
+    std::error_code ec;
+    auto count = fgd_converter::write_xyz_tiles(mosaics, config, *writer, ec);
+    if (!count) {
+        std::cerr << "タイル出力に失敗: " << ec.message() << "\n";
+        return 1;
+    }
+    std::cout << *count << " 枚のタイルを出力しました。\n";
+    return 0;
+}
+
+/**
+ * @brief 全ZIPの結合済みラスターからquantized-mesh地形タイルと layer.json を出力
+ */
+int run_quantized_mesh(const std::vector<ArchiveJob> &jobs, const fs::path &mesh_dir,
+                       const fgd_converter::QuantizedMeshConfig &config, bool sea_at_zero,
+                       const std::shared_ptr<const fgd_converter::MeshCache> &mesh_cache) {
+    auto mosaics = load_mosaics(jobs, sea_at_zero, mesh_cache);
+
+    std::cout << "quantized-meshタイルを作成中 (ズーム " << config.min_zoom << "-"
+              << config.max_zoom << ", 最大誤差 " << config.max_error << "m) → "
+              << mesh_dir.string() << "\n";
+
+    fgd_converter::DirectoryTileWriter writer(mesh_dir, ".terrain");
+    std::error_code ec;
+    auto layer = fgd_converter::write_quantized_mesh(mosaics, config, writer, ec);
+    if (!layer) {
+        std::cerr << "タイル出力に失敗: " << ec.message() << "\n";
+        return 1;
+    }
+
+    std::ofstream layer_file(mesh_dir / "layer.json");
+    layer_file << fgd_converter::make_layer_json(*layer, config);
+    if (!layer_file) {
+        std::cerr << "layer.jsonの書き込みに失敗: " << (mesh_dir / "layer.json").string() << "\n";
+        return 1;
+    }
+    std::cout << layer->tile_count << " 枚のタイルを出力しました。\n";
+    return 0;
+}
+
+/**
+ * @brief 終了時に処理統計・タイムラインを出力する (--stats / --stats-json / --trace)
+ *
+ * main のどの経路で戻っても出力されるよう、デストラクタで書き出す。
+ * 表・JSON (--stats-json -) は標準エラーへ出す (標準出力は進捗・検索・サンプリング結果に
+ * 使われるため)。
+ */
+class InstrumentationOutput {
+   public:
+    InstrumentationOutput(bool print_stats, std::string stats_json, std::string trace_path)
+        : print_stats_(print_stats),
+          stats_json_(std::move(stats_json)),
+          trace_path_(std::move(trace_path)) {
+        if (print_stats_ || !stats_json_.empty()) {
+            fgd_converter::stats::set_enabled(true);
+        }
+        if (!trace_path_.empty()) {
+            fgd_converter::trace::start();
+        }
+    }
+
+    ~InstrumentationOutput() {
+        try {
+            write_stats();
+            if (!trace_path_.empty()) {
+                fgd_converter::trace::stop();
+                std::error_code ec;
+                if (!fgd_converter::trace::write_file(trace_path_, ec)) {
+                    std::cerr << "トレースの書き込みに失敗: " << trace_path_ << "\n";
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "統計の出力に失敗: " << e.what() << "\n";
+        }
+    }
+
+    InstrumentationOutput(const InstrumentationOutput &) = delete;
+    InstrumentationOutput &operator=(const InstrumentationOutput &) = delete;
+
+   private:
+    void write_stats() const {
+        if (!print_stats_ && stats_json_.empty())
+            return;
+        auto report = fgd_converter::stats::snapshot();
+        if (print_stats_) {
+            fgd_converter::stats::write_text(std::cerr, report);
+        }
+        if (stats_json_ == "-") {
+            fgd_converter::stats::write_json(std::cerr, report);
+        } else if (!stats_json_.empty()) {
+            std::ofstream file(stats_json_);
+            fgd_converter::stats::write_json(file, report);
+            if (!file) {
+                std::cerr << "統計JSONの書き込みに失敗: " << stats_json_ << "\n";
+            }
+        }
+    }
+
+    bool print_stats_;
+    std::string stats_json_;
+    std::string trace_path_;
+};
+
 int main(int argc, char *argv[]) {
 #ifdef _WIN32
     // Windowsコンソール出力をUTF-8に設定
@@ -65,9 +590,14 @@ int main(int argc, char *argv[]) {
         "o,output", "GeoTIFFファイルの出力フォルダ",
         cxxopts::value<std::string>()->default_value("./output"))(
         "e,epsg", "出力EPSG座標系コード", cxxopts::value<std::string>()->default_value("EPSG:3857"))(
+        "format", "出力形式 (geotiff, zarr)",
+        cxxopts::value<std::string>()->default_value("geotiff"))(
         "r,rgbify", "可視化用RGB変換を有効にする",
         cxxopts::value<bool>()->default_value("false"))(
-        "z,sea-at-zero", "海面レベルを0に設定する", cxxopts::value<bool>()->default_value("false"))(
+        "rgb-encoding", "RGB変換のエンコード方式 (mapbox, terrarium)",
+        cxxopts::value<std::string>()->default_value("mapbox"))(
+        "z,sea-at-zero", "海面レベルを0に設定する (無効にするには --sea-at-zero=false)",
+        cxxopts::value<bool>()->default_value("true"))(
         "x,extract-only", "ZIPファイルの展開のみ実行する", cxxopts::value<bool>()->default_value("false"))(
         "m,merge", "DEM種別を指定してTIFファイルをマージ (例: 5A, 5B, 10A)",
         cxxopts::value<std::string>()->default_value(""))(
@@ -76,29 +606,159 @@ int main(int argc, char *argv[]) {
         "d,merge-dir", "マージ対象のTIFディレクトリ",
         cxxopts::value<std::string>()->default_value("./output"))(
         "t,resolution", "マージ時の出力解像度（メートル）",
-        cxxopts::value<double>()->default_value("10.0"))("h,help", "ヘルプを表示する");
+        cxxopts::value<double>()->default_value("10.0"))(
+        "S,serve", "常駐モード: 指定したUnixソケットでJSON変換ジョブを受け付ける",
+        cxxopts::value<std::string>()->default_value(""))(
+        "q,query", "地点標高の検索 (\"緯度,経度;緯度,経度\"、-i のZIP/フォルダから直接読み込み)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "sample", "地点CSV (緯度,経度) を一括サンプリング (-i のZIP/フォルダから直接読み込み)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "sample-output", "サンプリング結果の出力先CSV (- で標準出力)",
+        cxxopts::value<std::string>()->default_value("-"))(
+        "interpolation", "サンプリングの補間方法 (bilinear, nearest)",
+        cxxopts::value<std::string>()->default_value("bilinear"))(
+        "slope", "傾斜 (度) を <出力名>_slope.tif として出力",
+        cxxopts::value<bool>()->default_value("false"))(
+        "aspect", "斜面方位 (度) を <出力名>_aspect.tif として出力",
+        cxxopts::value<bool>()->default_value("false"))(
+        "hillshade", "陰影起伏 (0-255) を <出力名>_hillshade.tif として出力",
+        cxxopts::value<bool>()->default_value("false"))(
+        "surface-class", "地表面種別 (tupleListの種別、8bit) を <出力名>_class.tif として出力",
+        cxxopts::value<bool>()->default_value("false"))(
+        "xyz-tiles",
+        "GeoTIFFの代わりにTerrain-RGBのXYZタイル (PNG) を指定フォルダ (.pmtilesなら単一ファイル) へ出力",
+        cxxopts::value<std::string>()->default_value(""))(
+        "min-zoom", "XYZタイルの最小ズーム", cxxopts::value<int>()->default_value("0"))(
+        "max-zoom", "XYZタイルの最大ズーム", cxxopts::value<int>()->default_value("14"))(
+        "tile-size", "XYZタイルのピクセルサイズ (256, 512)",
+        cxxopts::value<int>()->default_value("256"))(
+        "quantized-mesh", "GeoTIFFの代わりにCesium用quantized-mesh地形タイルを指定フォルダへ出力",
+        cxxopts::value<std::string>()->default_value(""))(
+        "mesh-max-error", "quantized-meshの最大ズームでの許容誤差 (メートル)",
+        cxxopts::value<double>()->default_value("1.0"))(
+        "stats", "段階別の処理時間・カウンター・メモリ使用量を終了時に標準エラーへ出力",
+        cxxopts::value<bool>()->default_value("false"))(
+        "stats-json", "処理統計をJSONで出力するファイル (- で標準エラー)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "trace", "処理のタイムラインをChrome trace形式 (Perfetto等で表示) で出力するファイル",
+        cxxopts::value<std::string>()->default_value(""))(
+        "mesh-cache", "パース済みメッシュのキャッシュフォルダ (2回目以降はXMLのパースを省略)",
+        cxxopts::value<std::string>()->default_value(""))(
+        "mesh-cache-compress", "メッシュキャッシュの標高格子をzlibで圧縮する",
+        cxxopts::value<bool>()->default_value("false"))(
+        "build-catalog", "入力 (-i) のメッシュカタログを作成して指定ファイルへ保存",
+        cxxopts::value<std::string>()->default_value(""))(
+        "catalog", "メッシュカタログ (--build-catalog で作成) を使用し、入力の走査を省略",
+        cxxopts::value<std::string>()->default_value(""))(
+        "bbox", "範囲 (最小経度,最小緯度,最大経度,最大緯度) と重なるメッシュのみを展開・変換",
+        cxxopts::value<std::string>()->default_value(""))(
+        "cpu-features",
+        "SIMDカーネルの命令セット (auto, scalar, sse4.2, avx2, avx512、list で判定結果を表示)",
+        cxxopts::value<std::string>()->default_value("auto"))("h,help", "ヘルプを表示する");
 
     try {
         auto result = options.parse(argc, argv);
 
         bool merge_only = result["merge-only"].as<bool>();
         std::string merge_dem_type = result["merge"].as<std::string>();
+        std::string serve_socket = result["serve"].as<std::string>();
+        std::string catalog_path = result["catalog"].as<std::string>();
 
-        // ヘルプ表示: -h または (-i なしかつマージのみモードでもない場合)
-        if (result.count("help") || (!result.count("input") && !merge_only)) {
+        // SIMDカーネルの命令セット (既定はCPUの判定結果)
+        if (std::string cpu_level = result["cpu-features"].as<std::string>();
+            cpu_level == "list") {
+            fgd_converter::cpu::describe(std::cout);
+            return 0;
+        } else if (cpu_level != "auto") {
+            auto level = fgd_converter::cpu::parse_level(cpu_level);
+            std::error_code ec;
+            if (!level) {
+                std::cerr << "エラー: --cpu-features は auto, scalar, sse4.2, avx2, avx512, list "
+                             "のいずれかを指定してください\n";
+                return 1;
+            }
+            if (!fgd_converter::cpu::select(*level, ec)) {
+                std::cerr << "エラー: このCPUは " << cpu_level << " に対応していません (対応: "
+                          << fgd_converter::cpu::level_name(fgd_converter::cpu::detect())
+                          << " まで)\n";
+                return 1;
+            }
+        }
+
+        // ヘルプ表示: -h または (-i・カタログなしかつマージのみ・常駐モードでもない場合)
+        if (result.count("help") || (!result.count("input") && catalog_path.empty() &&
+                                     !merge_only && serve_socket.empty())) {
             std::cout << options.help() << std::endl;
             return 0;
         }
 
+        InstrumentationOutput instrumentation(result["stats"].as<bool>(),
+                                              result["stats-json"].as<std::string>(),
+                                              result["trace"].as<std::string>());
+
         // パスを正規化（末尾スラッシュ等を統一）
         fs::path output_folder = fs::path(result["output"].as<std::string>()).lexically_normal();
         fs::path merge_dir = fs::path(result["merge-dir"].as<std::string>()).lexically_normal();
         fs::path extract_folder = fs::path("./extracted").lexically_normal();
         std::string output_epsg = result["epsg"].as<std::string>();
         bool rgbify = result["rgbify"].as<bool>();
+        auto rgb_encoding =
+            fgd_converter::parse_rgb_encoding(result["rgb-encoding"].as<std::string>());
+        if (!rgb_encoding) {
+            std::cerr << "エラー: --rgb-encoding は mapbox または terrarium を指定してください\n";
+            return 1;
+        }
+        auto output_format =
+            fgd_converter::parse_output_format(result["format"].as<std::string>());
+        if (!output_format) {
+            std::cerr << "エラー: --format は geotiff または zarr を指定してください\n";
+            return 1;
+        }
         bool sea_at_zero = result["sea-at-zero"].as<bool>();
         bool extract_only = result["extract-only"].as<bool>();
         double merge_resolution = result["resolution"].as<double>();
+        fgd_converter::TerrainConfig terrain{.slope = result["slope"].as<bool>(),
+                                             .aspect = result["aspect"].as<bool>(),
+                                             .hillshade = result["hillshade"].as<bool>()};
+        bool surface_class = result["surface-class"].as<bool>();
+        std::shared_ptr<const fgd_converter::MeshCache> mesh_cache;
+        if (std::string cache_dir = result["mesh-cache"].as<std::string>(); !cache_dir.empty()) {
+            mesh_cache = std::make_shared<const fgd_converter::MeshCache>(
+                fgd_converter::MeshCache::Config{
+                    .directory = fs::path(cache_dir).lexically_normal(),
+                    .compress = result["mesh-cache-compress"].as<bool>()});
+        }
+        std::shared_ptr<const fgd_converter::MeshCatalog> catalog;
+        if (!catalog_path.empty()) {
+            catalog = std::make_shared<const fgd_converter::MeshCatalog>(
+                fs::path(catalog_path).lexically_normal());
+        }
+        std::optional<fgd_converter::BoundsLatLng> bbox;
+        if (std::string bbox_text = result["bbox"].as<std::string>(); !bbox_text.empty()) {
+            bbox = parse_bbox(bbox_text);
+        }
+
+        // 常駐モード: -S オプションが指定された場合
+        if (!serve_socket.empty()) {
+            fgd_converter::ConversionServer server(
+                {.socket_path = serve_socket,
+                 .default_output_path = output_folder,
+                 .default_epsg = result["epsg"].as<std::string>(),
+                 .mesh_cache = mesh_cache});
+
+            g_server = &server;
+            std::signal(SIGINT, handle_stop_signal);
+            std::signal(SIGTERM, handle_stop_signal);
+
+            std::error_code ec;
+            bool ok = server.run(ec);
+            g_server = nullptr;
+            if (!ok) {
+                std::cerr << "常駐モードの起動に失敗: " << ec.message() << "\n";
+                return 1;
+            }
+            return 0;
+        }
 
         // マージのみモード: -M オプションが指定された場合
         if (merge_only) {
@@ -107,12 +767,24 @@ int main(int argc, char *argv[]) {
                 return 1;
             }
 
+            // カタログがある場合はフォルダを走査せず、カタログのメッシュに対応するTIFをマージ
+            std::vector<fs::path> merge_files;
+            if (catalog) {
+                merge_files = catalog_merge_files(*catalog, select_latest(*catalog, bbox),
+                                                  merge_dir, merge_dem_type);
+                if (merge_files.empty()) {
+                    std::cerr << "エラー: カタログにDEM種別 " << merge_dem_type
+                              << " のメッシュがありません\n";
+                    return 1;
+                }
+            }
+
             fgd_converter::MergeConfig merge_config{
                 .input_folder = merge_dir,  // -d で指定されたフォルダ（デフォルト: ./output）
                 .dem_type = merge_dem_type,
                 .resolution = merge_resolution,
-                .output_file = {}  // 自動生成
-            };
+                .output_file = {},  // 自動生成
+                .input_files = std::move(merge_files)};
 
             std::error_code ec;
             if (!fgd_converter::merge_tif_files(merge_config, ec)) {
@@ -123,35 +795,74 @@ int main(int argc, char *argv[]) {
         }
 
         // パスを正規化（末尾スラッシュ等を統一）
-        fs::path input_folder = fs::path(result["input"].as<std::string>()).lexically_normal();
+        fs::path input_folder;
+        if (result.count("input")) {
+            input_folder = fs::path(result["input"].as<std::string>()).lexically_normal();
+        }
 
-        if (!fs::exists(input_folder)) {
+        // カタログを使う場合は入力フォルダを参照しない
+        if (!catalog && !fs::exists(input_folder)) {
             std::stringstream ss;
             ss << "入力フォルダが存在しません: " << input_folder.string();
             std::cerr << ss.str() << "\n";
             return 1;
         }
 
+        // カタログ作成モード: --build-catalog オプションが指定された場合
+        if (std::string build_path = result["build-catalog"].as<std::string>();
+            !build_path.empty()) {
+            return run_build_catalog(input_folder, fs::path(build_path).lexically_normal());
+        }
+
+        // 範囲指定はカタログで対象メッシュを絞り込む (カタログがない場合は入力を走査して作成)
+        if (bbox && !catalog) {
+            std::error_code ec;
+            auto built =
+                fgd_converter::MeshCatalog::build(std::span<const fs::path>(&input_folder, 1), ec);
+            if (!built) {
+                std::cerr << "カタログを作成できません: " << ec.message() << "\n";
+                return 1;
+            }
+            catalog = std::make_shared<const fgd_converter::MeshCatalog>(std::move(*built));
+        }
+
+        // 地点検索モード: -q オプションが指定された場合 (GeoTIFF変換を行わない)
+        if (std::string query_text = result["query"].as<std::string>(); !query_text.empty()) {
+            return run_query(input_folder, query_text, sea_at_zero, catalog);
+        }
+
+        // 一括サンプリングモード: --sample オプションが指定された場合
+        if (std::string sample_path = result["sample"].as<std::string>(); !sample_path.empty()) {
+            return run_sample(input_folder, sample_path, result["sample-output"].as<std::string>(),
+                              result["interpolation"].as<std::string>(), sea_at_zero, catalog);
+        }
+
         // 出力ディレクトリを作成
         fs::create_directories(output_folder);
         fs::create_directories(extract_folder);
 
-        // 第1パス: すべてのzipファイルを収集
-        std::vector<fs::path> zip_files;
-        for (const auto &entry : fs::recursive_directory_iterator(input_folder)) {
-            if (entry.is_regular_file() && fgd_converter::zip::is_zip_file(entry.path())) {
-                zip_files.push_back(entry.path());
+        std::vector<ArchiveJob> jobs;
+        if (catalog) {
+            // カタログモード: 対象メッシュを含むネストZIPのみを展開し、エントリ一覧もカタログから渡す
+            jobs = plan_from_catalog(*catalog, select_latest(*catalog, bbox), extract_folder);
+        } else {
+            // 第1パス: すべてのzipファイルを収集
+            std::vector<fs::path> zip_files;
+            for (const auto &entry : fs::recursive_directory_iterator(input_folder)) {
+                if (entry.is_regular_file() && fgd_converter::zip::is_zip_file(entry.path())) {
+                    zip_files.push_back(entry.path());
+                }
             }
-        }
 
-        // すべてのzipファイルを並列展開
-        std::cout << zip_files.size() << " 個のZIPファイルを並列展開中...\n";
-        tbb::parallel_for_each(zip_files, [&](const fs::path &zip_path) {
-            std::stringstream ss;
-            ss << "展開中: " << zip_path.string() << " → " << extract_folder.string();
-            std::cout << ss.str() << "\n";
-            extract_zip(zip_path, extract_folder);
-        });
+            // すべてのzipファイルを並列展開
+            std::cout << zip_files.size() << " 個のZIPファイルを並列展開中...\n";
+            tbb::parallel_for_each(zip_files, [&](const fs::path &zip_path) {
+                std::stringstream ss;
+                ss << "展開中: " << zip_path.string() << " → " << extract_folder.string();
+                std::cout << ss.str() << "\n";
+                extract_zip(zip_path, extract_folder);
+            });
+        }
 
         if (extract_only) {
             std::cout << "展開完了。\n";
@@ -159,19 +870,45 @@ int main(int argc, char *argv[]) {
         }
 
         // 第2パス: ネストされたzipを収集して並列処理
-        std::vector<fs::path> nested_zips;
-        for (const auto &entry : fs::recursive_directory_iterator(extract_folder)) {
-            if (entry.is_regular_file() && fgd_converter::zip::is_zip_file(entry.path())) {
-                nested_zips.push_back(entry.path());
+        if (!catalog) {
+            for (const auto &entry : fs::recursive_directory_iterator(extract_folder)) {
+                if (entry.is_regular_file() && fgd_converter::zip::is_zip_file(entry.path())) {
+                    jobs.push_back({.zip_path = entry.path(), .entries = std::nullopt});
+                }
             }
+            // 同じメッシュの古い版は展開・変換しない
+            keep_latest_entries(jobs);
+        }
+
+        // XYZタイルモード: 全ZIPのモザイクからタイルピラミッドを直接作成
+        if (std::string tiles_dir = result["xyz-tiles"].as<std::string>(); !tiles_dir.empty()) {
+            fgd_converter::XyzTileConfig xyz_config{.min_zoom = result["min-zoom"].as<int>(),
+                                                    .max_zoom = result["max-zoom"].as<int>(),
+                                                    .tile_size = result["tile-size"].as<int>(),
+                                                    .encoding = *rgb_encoding};
+            return run_xyz_tiles(jobs, fs::path(tiles_dir).lexically_normal(), xyz_config,
+                                 sea_at_zero, mesh_cache);
+        }
+
+        // quantized-meshモード: 全ZIPのモザイクから地形メッシュタイルを直接作成
+        if (std::string mesh_dir = result["quantized-mesh"].as<std::string>(); !mesh_dir.empty()) {
+            fgd_converter::QuantizedMeshConfig mesh_config{
+                .min_zoom = result["min-zoom"].as<int>(),
+                .max_zoom = result["max-zoom"].as<int>(),
+                .grid_size = 257,
+                .max_error = result["mesh-max-error"].as<double>()};
+            return run_quantized_mesh(jobs, fs::path(mesh_dir).lexically_normal(),
+                                      mesh_config, sea_at_zero, mesh_cache);
         }
 
         // TBBを使用してすべてのzipを並列処理 (クロスプラットフォーム)
         std::mutex cout_mutex;  // std::coutを競合状態から保護
 
-        tbb::parallel_for_each(nested_zips, [&](const fs::path &zip_path) {
+        tbb::parallel_for_each(jobs, [&](const ArchiveJob &job) {
+            const fs::path &zip_path = job.zip_path;
             fs::path output_tif = output_folder / zip_path.stem();
-            output_tif.replace_extension(".tif");
+            output_tif.replace_extension(
+                *output_format == fgd_converter::OutputFormat::Zarr ? ".zarr" : ".tif");
 
             {
                 std::lock_guard<std::mutex> lock(cout_mutex);
@@ -181,7 +918,9 @@ int main(int argc, char *argv[]) {
                 std::cout << ss.str() << "\n";
             }
 
-            process_zip(zip_path, output_folder, output_epsg, rgbify, sea_at_zero);
+            process_zip(zip_path, output_folder, output_epsg, *output_format, rgbify,
+                        *rgb_encoding, sea_at_zero, terrain, surface_class, mesh_cache,
+                        job.entries);
         });
 
         std::cout << "変換完了。\n";
@@ -0,0 +1,429 @@
+#include "mesh_cache.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "memory_mapped_file.hpp"
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC = {'F', 'G', 'D', 'M', 'E', 'S', 'H', '\0'};
+constexpr uint32_t VERSION = 2;  // 2: sea_at_zero=false の海域を-9999のまま保存
+constexpr size_t HEADER_SIZE = 128;
+
+constexpr uint32_t FLAG_SEA_AT_ZERO = 1u << 0;
+constexpr uint32_t FLAG_ZLIB = 1u << 1;
+
+constexpr double NO_DATA = -9999.0;
+constexpr int16_t INT16_NO_DATA = std::numeric_limits<int16_t>::min();
+
+enum class SampleType : uint32_t {
+    Int16 = 0,    // (値 + offset) / divisor
+    Float32 = 1,
+    Float64 = 2,
+};
+
+size_t sample_size(SampleType type) {
+    switch (type) {
+        case SampleType::Int16:
+            return sizeof(int16_t);
+        case SampleType::Float32:
+            return sizeof(float);
+        case SampleType::Float64:
+            return sizeof(double);
+    }
+    return 0;
+}
+
+/**
+ * @brief 固定ヘッダー (ファイル上は各フィールドを下記のオフセットに配置)
+ */
+struct Header {
+    uint32_t version{VERSION};  //   8
+    uint32_t flags{};           //  12
+    uint32_t source_crc32{};    //  16
+    SampleType sample_type{};   //  20
+    uint64_t source_size{};     //  24
+    int32_t rows{};             //  32
+    int32_t cols{};             //  36
+    int32_t int16_offset{};     //  40
+    int32_t int16_divisor{1};   //  44
+    double lower_corner_x{};    //  48
+    double lower_corner_y{};    //  56
+    double upper_corner_x{};    //  64
+    double upper_corner_y{};    //  72
+    int32_t x_length{};         //  80
+    int32_t y_length{};         //  84
+    double start_x{};           //  88
+    double start_y{};           //  96
+    uint64_t payload_size{};    // 104 (ファイル上の格子のバイト数)
+    uint64_t raw_size{};        // 112 (展開後の格子のバイト数)
+    uint16_t mesh_code_size{};  // 120
+    uint16_t type_size{};       // 122
+};
+
+template <typename T>
+void put(std::vector<uint8_t>& out, size_t offset, T value) {
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data, size_t offset) {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+size_t align8(size_t size) { return (size + 7) & ~size_t{7}; }
+
+auto write_header(const Header& h) -> std::vector<uint8_t> {
+    std::vector<uint8_t> out(HEADER_SIZE, 0);
+    std::memcpy(out.data(), MAGIC.data(), MAGIC.size());
+    put(out, 8, h.version);
+    put(out, 12, h.flags);
+    put(out, 16, h.source_crc32);
+    put(out, 20, static_cast<uint32_t>(h.sample_type));
+    put(out, 24, h.source_size);
+    put(out, 32, h.rows);
+    put(out, 36, h.cols);
+    put(out, 40, h.int16_offset);
+    put(out, 44, h.int16_divisor);
+    put(out, 48, h.lower_corner_x);
+    put(out, 56, h.lower_corner_y);
+    put(out, 64, h.upper_corner_x);
+    put(out, 72, h.upper_corner_y);
+    put(out, 80, h.x_length);
+    put(out, 84, h.y_length);
+    put(out, 88, h.start_x);
+    put(out, 96, h.start_y);
+    put(out, 104, h.payload_size);
+    put(out, 112, h.raw_size);
+    put(out, 120, h.mesh_code_size);
+    put(out, 122, h.type_size);
+    return out;
+}
+
+auto read_header(const uint8_t* data, size_t size) -> std::optional<Header> {
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC.data(), MAGIC.size()) != 0)
+        return std::nullopt;
+    Header h;
+    h.version = get<uint32_t>(data, 8);
+    if (h.version != VERSION)
+        return std::nullopt;
+    h.flags = get<uint32_t>(data, 12);
+    h.source_crc32 = get<uint32_t>(data, 16);
+    h.sample_type = static_cast<SampleType>(get<uint32_t>(data, 20));
+    h.source_size = get<uint64_t>(data, 24);
+    h.rows = get<int32_t>(data, 32);
+    h.cols = get<int32_t>(data, 36);
+    h.int16_offset = get<int32_t>(data, 40);
+    h.int16_divisor = get<int32_t>(data, 44);
+    h.lower_corner_x = get<double>(data, 48);
+    h.lower_corner_y = get<double>(data, 56);
+    h.upper_corner_x = get<double>(data, 64);
+    h.upper_corner_y = get<double>(data, 72);
+    h.x_length = get<int32_t>(data, 80);
+    h.y_length = get<int32_t>(data, 84);
+    h.start_x = get<double>(data, 88);
+    h.start_y = get<double>(data, 96);
+    h.payload_size = get<uint64_t>(data, 104);
+    h.raw_size = get<uint64_t>(data, 112);
+    h.mesh_code_size = get<uint16_t>(data, 120);
+    h.type_size = get<uint16_t>(data, 122);
+    if (sample_size(h.sample_type) == 0 || h.rows < 0 || h.cols < 0 || h.int16_divisor <= 0)
+        return std::nullopt;
+    return h;
+}
+
+/**
+ * @brief 全値がint16の整数差分で完全に復元できる場合、その単位と基準値を求める
+ */
+bool choose_int16(const std::vector<std::vector<double>>& grid, int32_t& offset,
+                  int32_t& divisor) {
+    for (int32_t candidate : {1, 10, 100}) {
+        int64_t min_q = std::numeric_limits<int64_t>::max();
+        int64_t max_q = std::numeric_limits<int64_t>::min();
+        bool exact = true;
+        for (const auto& row : grid) {
+            for (double v : row) {
+                if (v == NO_DATA)
+                    continue;
+                const double scaled = v * candidate;
+                if (!(std::abs(scaled) < 1e9)) {
+                    exact = false;
+                    break;
+                }
+                const int64_t q = std::llround(scaled);
+                if (static_cast<double>(q) / candidate != v) {
+                    exact = false;
+                    break;
+                }
+                min_q = std::min(min_q, q);
+                max_q = std::max(max_q, q);
+            }
+            if (!exact)
+                break;
+        }
+        // -32768はデータなしに使うため、-32767..32767 の範囲に収める
+        if (exact && (min_q > max_q || max_q - min_q <= 65534)) {
+            offset = min_q > max_q ? 0 : static_cast<int32_t>(min_q + 32767);
+            divisor = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool fits_float32(const std::vector<std::vector<double>>& grid) {
+    for (const auto& row : grid) {
+        for (double v : row) {
+            if (static_cast<double>(static_cast<float>(v)) != v)
+                return false;
+        }
+    }
+    return true;
+}
+
+auto encode_grid(const std::vector<std::vector<double>>& grid, Header& header)
+    -> std::vector<uint8_t> {
+    const size_t count = static_cast<size_t>(header.rows) * header.cols;
+    std::vector<uint8_t> raw;
+
+    if (choose_int16(grid, header.int16_offset, header.int16_divisor)) {
+        header.sample_type = SampleType::Int16;
+        raw.resize(count * sizeof(int16_t));
+        auto* out = reinterpret_cast<int16_t*>(raw.data());
+        for (const auto& row : grid) {
+            for (double v : row) {
+                *out++ = v == NO_DATA
+                             ? INT16_NO_DATA
+                             : static_cast<int16_t>(std::llround(v * header.int16_divisor) -
+                                                    header.int16_offset);
+            }
+        }
+    } else if (fits_float32(grid)) {
+        header.sample_type = SampleType::Float32;
+        raw.resize(count * sizeof(float));
+        auto* out = reinterpret_cast<float*>(raw.data());
+        for (const auto& row : grid) {
+            for (double v : row) {
+                *out++ = static_cast<float>(v);
+            }
+        }
+    } else {
+        header.sample_type = SampleType::Float64;
+        raw.resize(count * sizeof(double));
+        auto* out = raw.data();
+        for (const auto& row : grid) {
+            std::memcpy(out, row.data(), row.size() * sizeof(double));
+            out += row.size() * sizeof(double);
+        }
+    }
+    return raw;
+}
+
+void decode_grid(const uint8_t* raw, const Header& header,
+                 std::vector<std::vector<double>>& grid) {
+    grid.assign(static_cast<size_t>(header.rows), std::vector<double>(header.cols));
+    const size_t cols = static_cast<size_t>(header.cols);
+    for (size_t r = 0; r < grid.size(); ++r) {
+        double* dst = grid[r].data();
+        switch (header.sample_type) {
+            case SampleType::Int16: {
+                const uint8_t* src = raw + r * cols * sizeof(int16_t);
+                const double divisor = header.int16_divisor;
+                for (size_t c = 0; c < cols; ++c) {
+                    const auto q = get<int16_t>(src, c * sizeof(int16_t));
+                    dst[c] = q == INT16_NO_DATA
+                                 ? NO_DATA
+                                 : static_cast<double>(int64_t{q} + header.int16_offset) /
+                                       divisor;
+                }
+                break;
+            }
+            case SampleType::Float32: {
+                const uint8_t* src = raw + r * cols * sizeof(float);
+                for (size_t c = 0; c < cols; ++c) {
+                    dst[c] = get<float>(src, c * sizeof(float));
+                }
+                break;
+            }
+            case SampleType::Float64:
+                std::memcpy(dst, raw + r * cols * sizeof(double), cols * sizeof(double));
+                break;
+        }
+    }
+}
+
+}  // namespace
+
+MeshCache::MeshCache(Config config) : config_(std::move(config)) {
+    std::error_code ec;
+    std::filesystem::create_directories(config_.directory, ec);
+    if (ec || !std::filesystem::is_directory(config_.directory)) {
+        std::stringstream ss;
+        ss << "メッシュキャッシュのディレクトリを作成できません: " << config_.directory.string();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+auto MeshCache::path_for(const zip::EntryInfo& entry) const -> std::filesystem::path {
+    char name[48];
+    std::snprintf(name, sizeof(name), "%08x-%llx.fgdmesh", entry.crc32,
+                  static_cast<unsigned long long>(entry.uncompressed_size));
+    return config_.directory / name;
+}
+
+auto MeshCache::load(const zip::EntryInfo& entry, bool sea_at_zero) const
+    -> std::optional<CachedMesh> {
+    MemoryMappedFile file(path_for(entry));
+    if (!file.is_open())
+        return std::nullopt;
+
+    const auto* data = static_cast<const uint8_t*>(file.data());
+    const size_t size = file.size();
+    auto header = read_header(data, size);
+    if (!header || header->source_crc32 != entry.crc32 ||
+        header->source_size != entry.uncompressed_size ||
+        ((header->flags & FLAG_SEA_AT_ZERO) != 0) != sea_at_zero) {
+        return std::nullopt;
+    }
+
+    const size_t strings_size = header->mesh_code_size + header->type_size;
+    const size_t payload_offset = HEADER_SIZE + align8(strings_size);
+    const size_t expected_raw = static_cast<size_t>(header->rows) * header->cols *
+                                sample_size(header->sample_type);
+    if (payload_offset > size || header->payload_size > size - payload_offset ||
+        header->raw_size != expected_raw) {
+        return std::nullopt;
+    }
+
+    CachedMesh mesh;
+    const auto* strings = reinterpret_cast<const char*>(data + HEADER_SIZE);
+    mesh.metadata.mesh_code.assign(strings, header->mesh_code_size);
+    mesh.metadata.type.assign(strings + header->mesh_code_size, header->type_size);
+    mesh.metadata.lower_corner_x = header->lower_corner_x;
+    mesh.metadata.lower_corner_y = header->lower_corner_y;
+    mesh.metadata.upper_corner_x = header->upper_corner_x;
+    mesh.metadata.upper_corner_y = header->upper_corner_y;
+    mesh.metadata.x_length = header->x_length;
+    mesh.metadata.y_length = header->y_length;
+    mesh.metadata.start_x = header->start_x;
+    mesh.metadata.start_y = header->start_y;
+
+    const uint8_t* payload = data + payload_offset;
+    if (header->flags & FLAG_ZLIB) {
+        // 圧縮時のみ展開用のバッファを使い、非圧縮時はマップした領域から直接復号する
+        std::vector<uint8_t> raw(header->raw_size);
+        auto raw_size = static_cast<uLongf>(raw.size());
+        if (uncompress(raw.data(), &raw_size, payload, static_cast<uLong>(header->payload_size)) !=
+                Z_OK ||
+            raw_size != raw.size()) {
+            return std::nullopt;
+        }
+        decode_grid(raw.data(), *header, mesh.grid);
+    } else {
+        if (header->payload_size != header->raw_size)
+            return std::nullopt;
+        decode_grid(payload, *header, mesh.grid);
+    }
+    return mesh;
+}
+
+bool MeshCache::store(const zip::EntryInfo& entry, bool sea_at_zero, const Metadata& metadata,
+                      const std::vector<std::vector<double>>& grid, std::error_code& ec) const {
+    const size_t cols = grid.empty() ? 0 : grid.front().size();
+    for (const auto& row : grid) {
+        if (row.size() != cols) {
+            ec = std::make_error_code(std::errc::invalid_argument);
+            return false;
+        }
+    }
+    if (metadata.mesh_code.size() > std::numeric_limits<uint16_t>::max() ||
+        metadata.type.size() > std::numeric_limits<uint16_t>::max() ||
+        grid.size() > static_cast<size_t>(std::numeric_limits<int32_t>::max()) ||
+        cols > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+        ec = std::make_error_code(std::errc::value_too_large);
+        return false;
+    }
+
+    Header header;
+    header.flags = sea_at_zero ? FLAG_SEA_AT_ZERO : 0;
+    header.source_crc32 = entry.crc32;
+    header.source_size = entry.uncompressed_size;
+    header.rows = static_cast<int32_t>(grid.size());
+    header.cols = static_cast<int32_t>(cols);
+    header.lower_corner_x = metadata.lower_corner_x;
+    header.lower_corner_y = metadata.lower_corner_y;
+    header.upper_corner_x = metadata.upper_corner_x;
+    header.upper_corner_y = metadata.upper_corner_y;
+    header.x_length = metadata.x_length;
+    header.y_length = metadata.y_length;
+    header.start_x = metadata.start_x;
+    header.start_y = metadata.start_y;
+    header.mesh_code_size = static_cast<uint16_t>(metadata.mesh_code.size());
+    header.type_size = static_cast<uint16_t>(metadata.type.size());
+
+    std::vector<uint8_t> payload = encode_grid(grid, header);
+    header.raw_size = payload.size();
+    if (config_.compress && !payload.empty()) {
+        std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(payload.size())));
+        auto compressed_size = static_cast<uLongf>(compressed.size());
+        if (compress2(compressed.data(), &compressed_size, payload.data(),
+                      static_cast<uLong>(payload.size()), Z_BEST_SPEED) == Z_OK &&
+            compressed_size < payload.size()) {
+            compressed.resize(compressed_size);
+            payload = std::move(compressed);
+            header.flags |= FLAG_ZLIB;
+        }
+    }
+    header.payload_size = payload.size();
+
+    std::vector<uint8_t> head = write_header(header);
+    head.insert(head.end(), metadata.mesh_code.begin(), metadata.mesh_code.end());
+    head.insert(head.end(), metadata.type.begin(), metadata.type.end());
+    head.resize(HEADER_SIZE + align8(head.size() - HEADER_SIZE), 0);
+
+    // 並行して同じメッシュを保存しても壊れないよう、一意な一時ファイルから置き換える
+    const auto path = path_for(entry);
+    auto temp = path;
+    temp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+            "-" +
+            std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(temp, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(head.data()),
+                   static_cast<std::streamsize>(head.size()));
+        file.write(reinterpret_cast<const char*>(payload.data()),
+                   static_cast<std::streamsize>(payload.size()));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temp, ec);
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temp, ignored);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace fgd_converter
@@ -0,0 +1,510 @@
+#include "mesh_catalog.hpp"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#include "fast_fgd_parser.hpp"
+#include "memory_mapped_file.hpp"
+#include "mesh_code.hpp"
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC = {'F', 'G', 'D', 'C', 'A', 'T', 'L', '\0'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+
+// XMLヘッダー (tupleListの手前まで) を読むために展開する先頭のバイト数
+constexpr size_t HEAD_BYTES = 8192;
+
+template <typename T>
+void put(std::vector<uint8_t>& out, size_t offset, T value) {
+    std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data, size_t offset) {
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+bool has_extension(std::string_view name, std::string_view ext) {
+    if (name.size() < ext.size())
+        return false;
+    auto tail = name.substr(name.size() - ext.size());
+    return std::equal(tail.begin(), tail.end(), ext.begin(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == b;
+    });
+}
+
+uint32_t parse_date(std::string_view date) {
+    uint32_t value = 0;
+    if (date.size() != 8 ||
+        std::from_chars(date.data(), date.data() + date.size(), value).ec != std::errc{}) {
+        return 0;
+    }
+    return value;
+}
+
+/**
+ * @brief 文字列表に入る前のレコード
+ */
+struct PendingRecord {
+    CatalogRecord record;
+    std::string archive;
+    std::string nested;
+    std::string entry;
+};
+
+/**
+ * @brief ファイル名とXMLヘッダーからレコードを作成
+ *
+ * @param fallback_date エントリ名に日付がない場合の日付 (ネストしたZIPの名前から)
+ * @return FGDのファイル名でない場合、範囲が求まらない場合はstd::nullopt
+ */
+auto make_record(std::string_view name, std::string_view head, uint32_t fallback_date)
+    -> std::optional<CatalogRecord> {
+    auto file_name = mesh::parse_file_name(name);
+    if (!file_name)
+        return std::nullopt;
+
+    CatalogRecord record;
+    uint32_t code = 0;
+    std::from_chars(file_name->mesh_code.data(),
+                    file_name->mesh_code.data() + file_name->mesh_code.size(), code);
+    record.mesh_code = code;
+    record.mesh_digits = static_cast<uint8_t>(file_name->mesh_code.size());
+    record.date = file_name->date.empty() ? fallback_date : parse_date(file_name->date);
+    std::copy_n(file_name->dem_type.begin(),
+                std::min(file_name->dem_type.size(), record.dem_type.size() - 1),
+                record.dem_type.begin());
+
+    // lowerCorner/upperCornerは (緯度, 経度) の順
+    auto header = xml::FastFGDParser::parse_header(head);
+    if (header.has_lower_corner && header.has_upper_corner) {
+        record.bounds = BoundsLatLng{.min_lat = header.lower_corner_x,
+                                     .max_lat = header.upper_corner_x,
+                                     .min_lng = header.lower_corner_y,
+                                     .max_lng = header.upper_corner_y};
+    } else if (auto bounds = mesh::bounds(file_name->mesh_code)) {
+        record.bounds = *bounds;
+    } else {
+        return std::nullopt;
+    }
+    return record;
+}
+
+/**
+ * @brief ZIPのXMLエントリをレコードにする (ネストしたZIPはメモリ上で1段だけ展開)
+ */
+void scan_zip(const zip::ZipHandler& handler, const std::string& archive,
+              const std::string& nested, uint32_t nested_date, std::vector<PendingRecord>& out) {
+    std::error_code ec;
+    auto entries = handler.list_entries(ec);
+    if (!entries) {
+        std::cerr << "警告: カタログに追加できません: " << archive
+                  << (nested.empty() ? "" : "!" + nested) << "\n";
+        return;
+    }
+
+    std::set<std::string> xml_names;
+    for (const auto& entry : *entries) {
+        if (has_extension(entry.name, ".xml") && mesh::parse_file_name(entry.name)) {
+            xml_names.insert(entry.name);
+        }
+    }
+
+    std::map<std::string, std::vector<uint8_t>> heads;
+    if (!xml_names.empty()) {
+        auto files = handler.read_heads(
+            [&xml_names](std::string_view name) { return xml_names.count(std::string(name)) > 0; },
+            HEAD_BYTES, ec);
+        if (files) {
+            for (auto& file : *files) {
+                heads[file.name] = std::move(file.data);
+            }
+        }
+    }
+
+    for (const auto& entry : *entries) {
+        if (xml_names.count(entry.name)) {
+            const auto& head = heads[entry.name];
+            auto record = make_record(
+                entry.name,
+                std::string_view(reinterpret_cast<const char*>(head.data()), head.size()),
+                nested_date);
+            if (!record)
+                continue;
+            record->offset = entry.offset;
+            record->compressed_size = entry.compressed_size;
+            record->uncompressed_size = entry.uncompressed_size;
+            record->crc32 = entry.crc32;
+            out.push_back({.record = *record, .archive = archive, .nested = nested,
+                           .entry = entry.name});
+        } else if (nested.empty() && has_extension(entry.name, ".zip")) {
+            auto data = handler.read_file(entry.name, ec);
+            if (!data) {
+                std::cerr << "警告: カタログに追加できません: " << archive << "!" << entry.name
+                          << "\n";
+                continue;
+            }
+            auto name = mesh::parse_file_name(entry.name);
+            zip::ZipHandler inner(std::span<const uint8_t>(data->data(), data->size()));
+            scan_zip(inner, archive, entry.name, name ? parse_date(name->date) : 0, out);
+        }
+    }
+}
+
+/**
+ * @brief ZIP外のXMLファイルをレコードにする (先頭のみ読み込む)
+ */
+void scan_xml_file(const std::filesystem::path& path, std::vector<PendingRecord>& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return;
+    std::string head(HEAD_BYTES, '\0');
+    file.read(head.data(), static_cast<std::streamsize>(head.size()));
+    head.resize(static_cast<size_t>(file.gcount()));
+
+    auto record = make_record(path.filename().string(), head, 0);
+    if (!record)
+        return;
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    record->compressed_size = ec ? 0 : size;
+    record->uncompressed_size = record->compressed_size;
+    out.push_back({.record = *record, .archive = path.string(), .nested = {}, .entry = {}});
+}
+
+bool record_less(const PendingRecord& a, const PendingRecord& b) {
+    const auto& x = a.record;
+    const auto& y = b.record;
+    if (x.mesh_digits != y.mesh_digits)
+        return x.mesh_digits < y.mesh_digits;
+    if (x.mesh_code != y.mesh_code)
+        return x.mesh_code < y.mesh_code;
+    int rank_x = mesh::type_rank(MeshCatalog::dem_type(x));
+    int rank_y = mesh::type_rank(MeshCatalog::dem_type(y));
+    if (rank_x != rank_y)
+        return rank_x < rank_y;
+    if (x.date != y.date)
+        return x.date > y.date;  // 新しい版が先
+    return std::tie(a.archive, a.nested, a.entry) < std::tie(b.archive, b.nested, b.entry);
+}
+
+/**
+ * @brief メッシュコードの比較キー (桁数が少ないものが先)
+ */
+uint64_t code_key(uint8_t digits, uint32_t code) {
+    return (static_cast<uint64_t>(digits) << 32) | code;
+}
+
+}  // namespace
+
+class MeshCatalog::Impl {
+   public:
+    /**
+     * @brief カタログ全体のバイト列を参照する (ヘッダーのみ検証し、レコードは遅延参照)
+     */
+    bool attach(const uint8_t* bytes, size_t size) {
+        if (size < HEADER_SIZE || std::memcmp(bytes, MAGIC.data(), MAGIC.size()) != 0 ||
+            get<uint32_t>(bytes, 8) != VERSION ||
+            get<uint32_t>(bytes, 12) != sizeof(CatalogRecord)) {
+            return false;
+        }
+        const auto count = get<uint64_t>(bytes, 16);
+        const auto strings = get<uint64_t>(bytes, 24);
+        if (count > (size - HEADER_SIZE) / sizeof(CatalogRecord) || strings == 0 ||
+            HEADER_SIZE + count * sizeof(CatalogRecord) + strings != size ||
+            bytes[size - 1] != 0) {
+            return false;
+        }
+        records = std::span<const CatalogRecord>(
+            reinterpret_cast<const CatalogRecord*>(bytes + HEADER_SIZE), count);
+        strings_begin = reinterpret_cast<const char*>(bytes + HEADER_SIZE) +
+                        count * sizeof(CatalogRecord);
+        strings_size = strings;
+        data = bytes;
+        data_size = size;
+        return true;
+    }
+
+    [[nodiscard]] auto string(uint32_t offset) const -> std::string_view {
+        return offset < strings_size ? std::string_view(strings_begin + offset)
+                                     : std::string_view{};
+    }
+
+    std::optional<MemoryMappedFile> file;
+    std::vector<uint8_t> owned;  // build() で作成した場合のバッファ (ファイルと同じ配置)
+    const uint8_t* data{nullptr};
+    size_t data_size{0};
+    std::span<const CatalogRecord> records;
+    const char* strings_begin{nullptr};
+    size_t strings_size{0};
+};
+
+MeshCatalog::MeshCatalog() : pImpl(std::make_unique<Impl>()) {}
+
+MeshCatalog::MeshCatalog(const std::filesystem::path& path) : pImpl(std::make_unique<Impl>()) {
+    pImpl->file.emplace(path);
+    if (!pImpl->file->is_open() ||
+        !pImpl->attach(static_cast<const uint8_t*>(pImpl->file->data()), pImpl->file->size())) {
+        std::stringstream ss;
+        ss << "カタログを読み込めません: " << path.string();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+MeshCatalog::~MeshCatalog() = default;
+MeshCatalog::MeshCatalog(MeshCatalog&&) noexcept = default;
+MeshCatalog& MeshCatalog::operator=(MeshCatalog&&) noexcept = default;
+
+auto MeshCatalog::build(std::span<const std::filesystem::path> inputs, std::error_code& ec)
+    -> std::optional<MeshCatalog> {
+    // 入力ファイルを列挙 (結果が走査順に依存しないよう並べ替える)
+    std::vector<std::filesystem::path> sources;
+    for (const auto& input : inputs) {
+        if (std::filesystem::is_directory(input)) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file())
+                    sources.push_back(entry.path());
+            }
+        } else if (std::filesystem::exists(input)) {
+            sources.push_back(input);
+        }
+    }
+    std::sort(sources.begin(), sources.end());
+
+    std::vector<std::vector<PendingRecord>> per_source(sources.size());
+    tbb::parallel_for(size_t{0}, sources.size(), [&](size_t i) {
+        const auto name = sources[i].filename().string();
+        if (zip::is_zip_file(sources[i])) {
+            zip::ZipHandler handler(sources[i]);
+            scan_zip(handler, sources[i].string(), {}, 0, per_source[i]);
+        } else if (has_extension(name, ".xml")) {
+            scan_xml_file(sources[i], per_source[i]);
+        }
+    });
+
+    std::vector<PendingRecord> pending;
+    for (auto& list : per_source) {
+        std::move(list.begin(), list.end(), std::back_inserter(pending));
+    }
+    if (pending.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return std::nullopt;
+    }
+    std::sort(pending.begin(), pending.end(), record_less);
+
+    // 文字列表 (同じ文字列は1回だけ格納、オフセット0は空文字列)
+    std::string strings(1, '\0');
+    std::unordered_map<std::string, uint32_t> offsets{{std::string(), 0}};
+    auto intern = [&](const std::string& value) {
+        auto [it, inserted] = offsets.try_emplace(value, static_cast<uint32_t>(strings.size()));
+        if (inserted) {
+            strings.append(value);
+            strings.push_back('\0');
+        }
+        return it->second;
+    };
+    for (auto& p : pending) {
+        p.record.archive = intern(p.archive);
+        p.record.nested = intern(p.nested);
+        p.record.entry = intern(p.entry);
+    }
+    if (strings.size() > std::numeric_limits<uint32_t>::max()) {
+        ec = std::make_error_code(std::errc::value_too_large);
+        return std::nullopt;
+    }
+
+    MeshCatalog catalog;
+    auto& bytes = catalog.pImpl->owned;
+    bytes.assign(HEADER_SIZE + pending.size() * sizeof(CatalogRecord) + strings.size(), 0);
+    std::memcpy(bytes.data(), MAGIC.data(), MAGIC.size());
+    put(bytes, 8, VERSION);
+    put(bytes, 12, static_cast<uint32_t>(sizeof(CatalogRecord)));
+    put(bytes, 16, static_cast<uint64_t>(pending.size()));
+    put(bytes, 24, static_cast<uint64_t>(strings.size()));
+    for (size_t i = 0; i < pending.size(); ++i) {
+        std::memcpy(bytes.data() + HEADER_SIZE + i * sizeof(CatalogRecord), &pending[i].record,
+                    sizeof(CatalogRecord));
+    }
+    std::memcpy(bytes.data() + HEADER_SIZE + pending.size() * sizeof(CatalogRecord),
+                strings.data(), strings.size());
+    catalog.pImpl->attach(bytes.data(), bytes.size());
+    return catalog;
+}
+
+bool MeshCatalog::save(const std::filesystem::path& path, std::error_code& ec) const {
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ec);
+        if (ec)
+            return false;
+    }
+
+    // 読み込み中のプロセスがあっても壊れないよう、一意な一時ファイルから置き換える
+    auto temp = path;
+    temp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+            "-" +
+            std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(temp, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(pImpl->data),
+                   static_cast<std::streamsize>(pImpl->data_size));
+        if (!file) {
+            file.close();
+            std::filesystem::remove(temp, ec);
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::error_code ignored;
+        std::filesystem::remove(temp, ignored);
+        return false;
+    }
+    return true;
+}
+
+auto MeshCatalog::records() const noexcept -> std::span<const CatalogRecord> {
+    return pImpl->records;
+}
+
+auto MeshCatalog::find(std::string_view mesh_code) const -> std::span<const CatalogRecord> {
+    uint32_t code = 0;
+    if (mesh_code.empty() ||
+        std::from_chars(mesh_code.data(), mesh_code.data() + mesh_code.size(), code).ptr !=
+            mesh_code.data() + mesh_code.size()) {
+        return {};
+    }
+    const uint64_t key = code_key(static_cast<uint8_t>(mesh_code.size()), code);
+    auto records = pImpl->records;
+    auto first = std::lower_bound(records.begin(), records.end(), key,
+                                  [](const CatalogRecord& record, uint64_t value) {
+                                      return code_key(record.mesh_digits, record.mesh_code) < value;
+                                  });
+    auto last = std::upper_bound(first, records.end(), key,
+                                 [](uint64_t value, const CatalogRecord& record) {
+                                     return value < code_key(record.mesh_digits, record.mesh_code);
+                                 });
+    return records.subspan(static_cast<size_t>(first - records.begin()),
+                           static_cast<size_t>(last - first));
+}
+
+auto MeshCatalog::select(const std::optional<BoundsLatLng>& bounds) const
+    -> std::vector<const CatalogRecord*> {
+    std::vector<const CatalogRecord*> selected;
+    for (const auto& record : pImpl->records) {
+        // 辺が接するだけのメッシュは含めない
+        if (bounds && !(record.bounds.min_lat < bounds->max_lat &&
+                        record.bounds.max_lat > bounds->min_lat &&
+                        record.bounds.min_lng < bounds->max_lng &&
+                        record.bounds.max_lng > bounds->min_lng)) {
+            continue;
+        }
+        selected.push_back(&record);
+    }
+    return selected;
+}
+
+auto MeshCatalog::latest(std::span<const CatalogRecord* const> records) const
+    -> std::vector<const CatalogRecord*> {
+    // レコードは同じメッシュ・種別の中で日付の新しい順 (同じ日付はパス順) に並ぶため、
+    // 配列上で最も前にあるものが最新版
+    std::map<std::pair<uint64_t, std::string_view>, const CatalogRecord*> best;
+    for (const auto* record : records) {
+        auto key = std::make_pair(code_key(record->mesh_digits, record->mesh_code),
+                                  dem_type(*record));
+        auto [it, inserted] = best.try_emplace(key, record);
+        if (!inserted && record < it->second) {
+            it->second = record;
+        }
+    }
+
+    std::vector<const CatalogRecord*> kept;
+    kept.reserve(best.size());
+    for (const auto* record : records) {
+        auto key = std::make_pair(code_key(record->mesh_digits, record->mesh_code),
+                                  dem_type(*record));
+        if (best[key] == record) {
+            kept.push_back(record);
+        }
+    }
+    return kept;
+}
+
+auto MeshCatalog::sources(std::span<const CatalogRecord* const> records) const
+    -> std::vector<CatalogSource> {
+    std::map<std::pair<std::string_view, std::string_view>, std::vector<const CatalogRecord*>>
+        groups;
+    for (const auto* record : records) {
+        groups[{pImpl->string(record->archive), pImpl->string(record->nested)}].push_back(record);
+    }
+
+    std::vector<CatalogSource> result;
+    result.reserve(groups.size());
+    for (auto& [key, list] : groups) {
+        std::sort(list.begin(), list.end(), [this](const auto* a, const auto* b) {
+            return entry_name(*a) < entry_name(*b);
+        });
+        result.push_back({.archive = std::filesystem::path(key.first),
+                          .nested = std::string(key.second),
+                          .records = std::move(list)});
+    }
+    return result;
+}
+
+auto MeshCatalog::archive_path(const CatalogRecord& record) const -> std::filesystem::path {
+    return std::filesystem::path(pImpl->string(record.archive));
+}
+
+auto MeshCatalog::nested_name(const CatalogRecord& record) const -> std::string_view {
+    return pImpl->string(record.nested);
+}
+
+auto MeshCatalog::entry_name(const CatalogRecord& record) const -> std::string_view {
+    return pImpl->string(record.entry);
+}
+
+auto MeshCatalog::entry_info(const CatalogRecord& record) const -> zip::EntryInfo {
+    return {.name = std::string(entry_name(record)),
+            .crc32 = record.crc32,
+            .compressed_size = record.compressed_size,
+            .uncompressed_size = record.uncompressed_size,
+            .offset = record.offset};
+}
+
+auto MeshCatalog::mesh_code(const CatalogRecord& record) -> std::string {
+    std::string code = std::to_string(record.mesh_code);
+    if (code.size() < record.mesh_digits) {
+        code.insert(0, record.mesh_digits - code.size(), '0');
+    }
+    return code;
+}
+
+auto MeshCatalog::dem_type(const CatalogRecord& record) -> std::string_view {
+    return std::string_view(record.dem_type.data(),
+                            std::find(record.dem_type.begin(), record.dem_type.end(), '\0') -
+                                record.dem_type.begin());
+}
+
+}  // namespace fgd_converter
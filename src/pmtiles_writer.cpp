@@ -0,0 +1,351 @@
+#include "pmtiles_writer.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr size_t HEADER_SIZE = 127;
+constexpr size_t ROOT_LIMIT = 16384 - HEADER_SIZE;  // ヘッダーとルートは先頭16KiBに収める
+constexpr size_t MIN_LEAF_SIZE = 4096;
+
+// ヘッダーの列挙値 (PMTiles v3仕様)
+constexpr uint8_t COMPRESSION_NONE = 1;
+constexpr uint8_t COMPRESSION_GZIP = 2;
+constexpr uint8_t TILE_TYPE_PNG = 2;
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+template <typename T>
+void put_le(uint8_t* dst, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        dst[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+    }
+}
+
+inline int32_t to_e7(double degrees) { return static_cast<int32_t>(std::lround(degrees * 1e7)); }
+
+/**
+ * @brief 内容ハッシュ (FNV-1a 64bit)
+ */
+uint64_t content_hash(std::span<const uint8_t> data) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (uint8_t b : data) {
+        h ^= b;
+        h *= 0x100000001b3ULL;
+    }
+    return h ^ (static_cast<uint64_t>(data.size()) << 40);
+}
+
+/**
+ * @brief gzip形式で圧縮 (ディレクトリとメタデータ用)
+ */
+bool gzip_compress(const std::vector<uint8_t>& input, std::vector<uint8_t>& out) {
+    z_stream stream{};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    out.resize(deflateBound(&stream, static_cast<uLong>(input.size())) + 32);
+    stream.next_in = const_cast<Bytef*>(input.data());
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return rc == Z_STREAM_END;
+}
+
+/**
+ * @brief ディレクトリを列ごと (ID差分, run_length, 長さ, オフセット) にシリアライズして圧縮
+ */
+bool serialize_directory(std::span<const PmtilesWriter::Entry> entries, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> raw;
+    raw.reserve(entries.size() * 8 + 8);
+    put_varint(raw, entries.size());
+
+    uint64_t last_id = 0;
+    for (const auto& e : entries) {
+        put_varint(raw, e.tile_id - last_id);
+        last_id = e.tile_id;
+    }
+    for (const auto& e : entries) {
+        put_varint(raw, e.run_length);
+    }
+    for (const auto& e : entries) {
+        put_varint(raw, e.length);
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        // 直前のエントリの直後に続く場合は0、それ以外はオフセット+1
+        if (i > 0 && entries[i].offset == entries[i - 1].offset + entries[i - 1].length) {
+            put_varint(raw, 0);
+        } else {
+            put_varint(raw, entries[i].offset + 1);
+        }
+    }
+    return gzip_compress(raw, out);
+}
+
+/**
+ * @brief ルートディレクトリと (必要なら) リーフディレクトリを構築
+ */
+bool build_directories(std::span<const PmtilesWriter::Entry> entries, std::vector<uint8_t>& root,
+                       std::vector<uint8_t>& leaves) {
+    leaves.clear();
+    if (!serialize_directory(entries, root)) {
+        return false;
+    }
+    if (root.size() <= ROOT_LIMIT) {
+        return true;
+    }
+
+    // ルートに収まるまでリーフの大きさを増やす
+    size_t leaf_size = std::max(MIN_LEAF_SIZE, entries.size() / 3500);
+    while (true) {
+        leaves.clear();
+        std::vector<PmtilesWriter::Entry> root_entries;
+        std::vector<uint8_t> leaf;
+        for (size_t begin = 0; begin < entries.size(); begin += leaf_size) {
+            const size_t count = std::min(leaf_size, entries.size() - begin);
+            if (!serialize_directory(entries.subspan(begin, count), leaf)) {
+                return false;
+            }
+            root_entries.push_back({.tile_id = entries[begin].tile_id,
+                                    .offset = leaves.size(),
+                                    .length = static_cast<uint32_t>(leaf.size()),
+                                    .run_length = 0});
+            leaves.insert(leaves.end(), leaf.begin(), leaf.end());
+        }
+        if (!serialize_directory(root_entries, root)) {
+            return false;
+        }
+        if (root.size() <= ROOT_LIMIT) {
+            return true;
+        }
+        leaf_size += leaf_size / 5;
+    }
+}
+
+}  // namespace
+
+PmtilesWriter::PmtilesWriter(std::filesystem::path output_path, std::string metadata_json)
+    : output_path_(std::move(output_path)),
+      data_path_(output_path_.string() + ".tmp"),
+      metadata_json_(std::move(metadata_json)) {
+    if (output_path_.has_parent_path()) {
+        std::filesystem::create_directories(output_path_.parent_path());
+    }
+    data_file_.open(data_path_,
+                    std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!data_file_) {
+        throw std::runtime_error("一時ファイルを作成できません: " + data_path_.string());
+    }
+}
+
+PmtilesWriter::~PmtilesWriter() {
+    if (!finished_) {
+        data_file_.close();
+        std::error_code ec;
+        std::filesystem::remove(data_path_, ec);
+    }
+}
+
+uint64_t PmtilesWriter::tile_id(int z, uint32_t x, uint32_t y) noexcept {
+    // 下位ズームの全タイル数 (4^0 + ... + 4^(z-1)) にヒルベルト曲線上の位置を加える
+    uint64_t acc = ((uint64_t{1} << (2 * z)) - 1) / 3;
+    uint64_t d = 0;
+    uint64_t tx = x;
+    uint64_t ty = y;
+    for (uint64_t s = (uint64_t{1} << z) / 2; s > 0; s /= 2) {
+        const uint64_t rx = (tx & s) > 0 ? 1 : 0;
+        const uint64_t ry = (ty & s) > 0 ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                tx = s - 1 - tx;
+                ty = s - 1 - ty;
+            }
+            std::swap(tx, ty);
+        }
+    }
+    return acc + d;
+}
+
+bool PmtilesWriter::write(int z, uint32_t x, uint32_t y, std::span<const uint8_t> data,
+                          std::error_code& ec) {
+    const uint64_t id = tile_id(z, x, y);
+    const uint64_t hash = content_hash(data);
+
+    // タイル範囲の緯度経度 (ヘッダーの範囲に使用)
+    const double n = std::ldexp(1.0, z);
+    auto lat_of = [n](double ty) {
+        return std::atan(std::sinh(std::numbers::pi * (1.0 - 2.0 * ty / n))) * 180.0 /
+               std::numbers::pi;
+    };
+    const double west = x / n * 360.0 - 180.0;
+    const double east = (x + 1) / n * 360.0 - 180.0;
+    const double north = lat_of(y);
+    const double south = lat_of(y + 1.0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_) {
+        ec = std::make_error_code(std::errc::operation_not_permitted);
+        return false;
+    }
+
+    // ハッシュの衝突に備え、同じハッシュの内容はバイト列が一致した場合のみ共有する
+    Content content{};
+    bool found = false;
+    auto [first, last] = contents_.equal_range(hash);
+    for (auto it = first; it != last && !found; ++it) {
+        if (same_content(it->second, data)) {
+            content = it->second;
+            found = true;
+        }
+    }
+    if (!found) {
+        data_file_.write(reinterpret_cast<const char*>(data.data()),
+                         static_cast<std::streamsize>(data.size()));
+        if (!data_file_) {
+            ec = std::make_error_code(std::errc::io_error);
+            return false;
+        }
+        content = {.offset = data_size_, .length = static_cast<uint32_t>(data.size())};
+        contents_.emplace(hash, content);
+        data_size_ += data.size();
+    }
+    entries_.push_back(
+        {.tile_id = id, .offset = content.offset, .length = content.length, .run_length = 1});
+
+    min_zoom_ = std::min(min_zoom_, z);
+    max_zoom_ = std::max(max_zoom_, z);
+    min_lng_ = std::min(min_lng_, west);
+    max_lng_ = std::max(max_lng_, east);
+    min_lat_ = std::min(min_lat_, south);
+    max_lat_ = std::max(max_lat_, north);
+    return true;
+}
+
+bool PmtilesWriter::same_content(const Content& content, std::span<const uint8_t> data) {
+    if (content.length != data.size()) {
+        return false;
+    }
+    std::vector<char> stored(content.length);
+    data_file_.seekg(static_cast<std::streamoff>(content.offset));
+    data_file_.read(stored.data(), static_cast<std::streamsize>(stored.size()));
+    // 読み戻した後は末尾への追記位置に戻す (失敗時はストリームの状態で次の書き込みが失敗する)
+    data_file_.seekp(static_cast<std::streamoff>(data_size_));
+    return data_file_ && std::equal(stored.begin(), stored.end(),
+                                    reinterpret_cast<const char*>(data.data()));
+}
+
+bool PmtilesWriter::finish(std::error_code& ec) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_file_.close();
+    if (entries_.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return false;
+    }
+
+    // タイルID順に並べ、同じ内容が連続するIDをrun_lengthでまとめる
+    std::sort(entries_.begin(), entries_.end(),
+              [](const Entry& a, const Entry& b) { return a.tile_id < b.tile_id; });
+    std::vector<Entry> merged;
+    merged.reserve(entries_.size());
+    for (const auto& e : entries_) {
+        if (!merged.empty()) {
+            auto& last = merged.back();
+            if (last.offset == e.offset && last.tile_id + last.run_length == e.tile_id) {
+                ++last.run_length;
+                continue;
+            }
+        }
+        merged.push_back(e);
+    }
+
+    std::vector<uint8_t> root;
+    std::vector<uint8_t> leaves;
+    std::vector<uint8_t> metadata;
+    if (!build_directories(merged, root, leaves) ||
+        !gzip_compress(std::vector<uint8_t>(metadata_json_.begin(), metadata_json_.end()),
+                       metadata)) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return false;
+    }
+
+    const uint64_t root_offset = HEADER_SIZE;
+    const uint64_t metadata_offset = root_offset + root.size();
+    const uint64_t leaves_offset = metadata_offset + metadata.size();
+    const uint64_t data_offset = leaves_offset + leaves.size();
+
+    std::array<uint8_t, HEADER_SIZE> header{};
+    const char magic[] = "PMTiles";
+    std::copy(magic, magic + 7, header.begin());
+    header[7] = 3;
+    put_le<uint64_t>(&header[8], root_offset);
+    put_le<uint64_t>(&header[16], root.size());
+    put_le<uint64_t>(&header[24], metadata_offset);
+    put_le<uint64_t>(&header[32], metadata.size());
+    put_le<uint64_t>(&header[40], leaves_offset);
+    put_le<uint64_t>(&header[48], leaves.size());
+    put_le<uint64_t>(&header[56], data_offset);
+    put_le<uint64_t>(&header[64], data_size_);
+    put_le<uint64_t>(&header[72], entries_.size());   // アドレス付けされたタイル数
+    put_le<uint64_t>(&header[80], merged.size());     // タイルエントリ数
+    put_le<uint64_t>(&header[88], contents_.size());  // 異なるタイル内容の数
+    header[96] = 0;  // タイル本体は到着順 (ID順ではない)
+    header[97] = COMPRESSION_GZIP;
+    header[98] = COMPRESSION_NONE;  // PNGは圧縮済み
+    header[99] = TILE_TYPE_PNG;
+    header[100] = static_cast<uint8_t>(min_zoom_);
+    header[101] = static_cast<uint8_t>(max_zoom_);
+    put_le<int32_t>(&header[102], to_e7(min_lng_));
+    put_le<int32_t>(&header[106], to_e7(min_lat_));
+    put_le<int32_t>(&header[110], to_e7(max_lng_));
+    put_le<int32_t>(&header[114], to_e7(max_lat_));
+    header[118] = static_cast<uint8_t>(min_zoom_);
+    put_le<int32_t>(&header[119], to_e7((min_lng_ + max_lng_) / 2.0));
+    put_le<int32_t>(&header[123], to_e7((min_lat_ + max_lat_) / 2.0));
+
+    std::ofstream out(output_path_, std::ios::binary | std::ios::trunc);
+    std::ifstream data(data_path_, std::ios::binary);
+    if (!out || !data) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    out.write(reinterpret_cast<const char*>(root.data()),
+              static_cast<std::streamsize>(root.size()));
+    out.write(reinterpret_cast<const char*>(metadata.data()),
+              static_cast<std::streamsize>(metadata.size()));
+    out.write(reinterpret_cast<const char*>(leaves.data()),
+              static_cast<std::streamsize>(leaves.size()));
+    if (data_size_ > 0) {
+        out << data.rdbuf();
+    }
+    data.close();
+    if (!out) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    finished_ = true;
+    std::filesystem::remove(data_path_, ec);
+    return !ec;
+}
+
+}  // namespace fgd_converter
@@ -0,0 +1,145 @@
+#include "png_writer.hpp"
+
+#include <zlib.h>
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr std::array<uint8_t, 8> PNG_SIGNATURE = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr size_t CHANNELS = 3;
+constexpr int FILTER_COUNT = 5;
+
+void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief チャンク (長さ, 種別, データ, CRC32) を追加
+ */
+void put_chunk(std::vector<uint8_t>& out, const char (&type)[5], const uint8_t* data,
+               size_t size) {
+    put_u32(out, static_cast<uint32_t>(size));
+    const size_t type_pos = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (size > 0) {
+        out.insert(out.end(), data, data + size);
+    }
+    uLong crc = crc32(0L, out.data() + type_pos, static_cast<uInt>(size + 4));
+    put_u32(out, static_cast<uint32_t>(crc));
+}
+
+inline uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return static_cast<uint8_t>(a);
+    return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+/**
+ * @brief 1行に指定フィルタを適用し、選択用のコスト (絶対値和) を返す
+ *
+ * @param prev 前の行 (先頭行ではゼロ埋めの行)
+ */
+uint64_t apply_filter(int filter, const uint8_t* row, const uint8_t* prev, size_t row_bytes,
+                      uint8_t* dst) {
+    uint64_t cost = 0;
+    for (size_t i = 0; i < row_bytes; ++i) {
+        const int a = i >= CHANNELS ? row[i - CHANNELS] : 0;
+        const int b = prev[i];
+        const int c = i >= CHANNELS ? prev[i - CHANNELS] : 0;
+        int predicted = 0;
+        switch (filter) {
+            case 1:
+                predicted = a;
+                break;
+            case 2:
+                predicted = b;
+                break;
+            case 3:
+                predicted = (a + b) / 2;
+                break;
+            case 4:
+                predicted = paeth(a, b, c);
+                break;
+            default:
+                break;
+        }
+        const auto value = static_cast<uint8_t>(row[i] - predicted);
+        dst[i] = value;
+        cost += static_cast<uint64_t>(std::abs(static_cast<int8_t>(value)));
+    }
+    return cost;
+}
+
+}  // namespace
+
+bool encode_png_rgb(const uint8_t* rgb, int width, int height, std::vector<uint8_t>& out,
+                    std::error_code& ec) {
+    if (width <= 0 || height <= 0 || rgb == nullptr) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return false;
+    }
+
+    const size_t row_bytes = static_cast<size_t>(width) * CHANNELS;
+    const size_t stride = row_bytes + 1;  // 各行の先頭にフィルタ種別1バイト
+
+    std::vector<uint8_t> filtered(stride * static_cast<size_t>(height));
+    std::vector<uint8_t> candidate(row_bytes);
+    const std::vector<uint8_t> zero_row(row_bytes, 0);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgb + static_cast<size_t>(y) * row_bytes;
+        const uint8_t* prev = y > 0 ? row - row_bytes : zero_row.data();
+        uint8_t* dst = filtered.data() + static_cast<size_t>(y) * stride;
+
+        // Noneで初期化し、よりコストの低いフィルタが見つかれば置き換える
+        uint64_t best_cost = apply_filter(0, row, prev, row_bytes, dst + 1);
+        dst[0] = 0;
+        for (int filter = 1; filter < FILTER_COUNT; ++filter) {
+            uint64_t cost = apply_filter(filter, row, prev, row_bytes, candidate.data());
+            if (cost < best_cost) {
+                best_cost = cost;
+                dst[0] = static_cast<uint8_t>(filter);
+                std::memcpy(dst + 1, candidate.data(), row_bytes);
+            }
+        }
+    }
+
+    uLongf compressed_size = compressBound(static_cast<uLong>(filtered.size()));
+    std::vector<uint8_t> compressed(compressed_size);
+    if (compress2(compressed.data(), &compressed_size, filtered.data(),
+                  static_cast<uLong>(filtered.size()), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return false;
+    }
+
+    // IHDR: 幅, 高さ, ビット深度8, カラータイプ2 (RGB), 圧縮0, フィルタ0, インターレースなし
+    std::array<uint8_t, 13> ihdr{};
+    for (int i = 0; i < 4; ++i) {
+        ihdr[i] = static_cast<uint8_t>(static_cast<uint32_t>(width) >> (24 - 8 * i));
+        ihdr[4 + i] = static_cast<uint8_t>(static_cast<uint32_t>(height) >> (24 - 8 * i));
+    }
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+
+    out.clear();
+    out.reserve(PNG_SIGNATURE.size() + compressed_size + 64);
+    out.insert(out.end(), PNG_SIGNATURE.begin(), PNG_SIGNATURE.end());
+    put_chunk(out, "IHDR", ihdr.data(), ihdr.size());
+    put_chunk(out, "IDAT", compressed.data(), compressed_size);
+    put_chunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+}  // namespace fgd_converter
@@ -0,0 +1,655 @@
+#include "point_query.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "fast_fgd_parser.hpp"
+#include "mesh_catalog.hpp"
+#include "mesh_code.hpp"
+#include "zip_handler.hpp"
+
+namespace fs = std::filesystem;
+
+namespace fgd_converter {
+
+namespace {
+
+/**
+ * @brief 最近使用したものを保持する固定容量キャッシュ
+ */
+template <typename Value>
+class LruCache {
+   public:
+    explicit LruCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+    std::shared_ptr<const Value> get(const std::string& key) {
+        auto it = index_.find(key);
+        if (it == index_.end())
+            return nullptr;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->second;
+    }
+
+    void put(const std::string& key, std::shared_ptr<const Value> value) {
+        if (auto it = index_.find(key); it != index_.end()) {
+            it->second->second = std::move(value);
+            order_.splice(order_.begin(), order_, it->second);
+            return;
+        }
+        order_.emplace_front(key, std::move(value));
+        index_[key] = order_.begin();
+        if (order_.size() > capacity_) {
+            index_.erase(order_.back().first);
+            order_.pop_back();
+        }
+    }
+
+   private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Value>>;
+
+    size_t capacity_;
+    std::list<Entry> order_;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+};
+
+bool has_extension(const fs::path& path, std::string_view ext) {
+    auto e = path.extension().string();
+    std::transform(e.begin(), e.end(), e.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return e == ext;
+}
+
+bool read_binary_file(const fs::path& path, std::vector<uint8_t>& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+constexpr uint64_t INVALID_KEY = std::numeric_limits<uint64_t>::max();
+
+/**
+ * @brief メッシュコード→メッシュ内の行→列の順に並ぶ並べ替えキー
+ *
+ * 上位に3次メッシュコード (8桁の数値)、下位16bitに5m DEM格子 (225×150) 上の行・列を置く。
+ * 同一メッシュの地点が連続し、メッシュ内でも北から南へ走査する順に並ぶ。
+ */
+uint64_t locality_key(double lat, double lng) {
+    auto code = mesh::from_latlng(lat, lng, 3);
+    if (!code)
+        return INVALID_KEY;
+    auto b = mesh::bounds(*code);
+    if (!b)
+        return INVALID_KEY;
+
+    uint64_t code_value = 0;
+    for (char c : *code) {
+        code_value = code_value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    int row = static_cast<int>((b->max_lat - lat) / (mesh::LAT_3RD / 150.0));
+    int col = static_cast<int>((lng - b->min_lng) / (mesh::LNG_3RD / 225.0));
+    row = std::clamp(row, 0, 149);
+    col = std::clamp(col, 0, 224);
+    return (code_value << 16) | (static_cast<uint64_t>(row) << 8) | static_cast<uint64_t>(col);
+}
+
+}  // namespace
+
+float MeshGrid::bilinear(double lat, double lng) const noexcept {
+    if (x_length <= 0 || y_length <= 0 || lat < bounds.min_lat || lat > bounds.max_lat ||
+        lng < bounds.min_lng || lng > bounds.max_lng) {
+        return NO_DATA;
+    }
+
+    // ピクセル中心を格子点とする連続座標
+    double fx = (lng - bounds.min_lng) / pixel_width() - 0.5;
+    double fy = (bounds.max_lat - lat) / pixel_height() - 0.5;
+    fx = std::clamp(fx, 0.0, static_cast<double>(x_length - 1));
+    fy = std::clamp(fy, 0.0, static_cast<double>(y_length - 1));
+
+    int c0 = static_cast<int>(fx);
+    int r0 = static_cast<int>(fy);
+    int c1 = std::min(c0 + 1, x_length - 1);
+    int r1 = std::min(r0 + 1, y_length - 1);
+    double tx = fx - c0;
+    double ty = fy - r0;
+
+    float v00 = at(r0, c0);
+    float v01 = at(r0, c1);
+    float v10 = at(r1, c0);
+    float v11 = at(r1, c1);
+    if (v00 == NO_DATA || v01 == NO_DATA || v10 == NO_DATA || v11 == NO_DATA) {
+        return nearest(lat, lng);
+    }
+
+    double top = v00 + (v01 - v00) * tx;
+    double bottom = v10 + (v11 - v10) * tx;
+    return static_cast<float>(top + (bottom - top) * ty);
+}
+
+float MeshGrid::nearest(double lat, double lng) const noexcept {
+    if (x_length <= 0 || y_length <= 0 || lat < bounds.min_lat || lat > bounds.max_lat ||
+        lng < bounds.min_lng || lng > bounds.max_lng) {
+        return NO_DATA;
+    }
+    int col = static_cast<int>((lng - bounds.min_lng) / pixel_width());
+    int row = static_cast<int>((bounds.max_lat - lat) / pixel_height());
+    col = std::clamp(col, 0, x_length - 1);
+    row = std::clamp(row, 0, y_length - 1);
+    return at(row, col);
+}
+
+auto decode_mesh(std::string_view xml, std::string_view dem_type,
+                 bool sea_at_zero) -> std::optional<MeshGrid> {
+    auto parsed = xml::FastFGDParser::parse_all(xml, sea_at_zero);
+    if (!parsed || !parsed->has_lower_corner || !parsed->has_upper_corner ||
+        !parsed->has_grid_envelope) {
+        return std::nullopt;
+    }
+
+    MeshGrid grid;
+    grid.mesh_code = parsed->mesh_code;
+    grid.dem_type = std::string(dem_type);
+    // lowerCorner/upperCornerは (緯度, 経度) の順
+    grid.bounds = BoundsLatLng{.min_lat = parsed->lower_corner_x,
+                               .max_lat = parsed->upper_corner_x,
+                               .min_lng = parsed->lower_corner_y,
+                               .max_lng = parsed->upper_corner_y};
+    grid.x_length = parsed->grid_high_x - parsed->grid_low_x + 1;
+    grid.y_length = parsed->grid_high_y - parsed->grid_low_y + 1;
+    if (grid.x_length <= 0 || grid.y_length <= 0)
+        return std::nullopt;
+
+    grid.values.assign(static_cast<size_t>(grid.x_length) * grid.y_length, MeshGrid::NO_DATA);
+
+    // startPointより前のセルはtupleListに含まれない (Dem::get_np_arrayと同じ配置)
+    const auto& elevation = parsed->elevation_list;
+    size_t offset = static_cast<size_t>(std::max(0, static_cast<int>(parsed->start_y))) *
+                        grid.x_length +
+                    static_cast<size_t>(std::max(0, static_cast<int>(parsed->start_x)));
+    size_t available = grid.values.size() - std::min(offset, grid.values.size());
+    size_t count = std::min(elevation.size(), available);
+    for (size_t i = 0; i < count; ++i) {
+        grid.values[offset + i] = static_cast<float>(elevation[i]);
+    }
+    return grid;
+}
+
+class PointQueryEngine::Impl {
+   public:
+    /**
+     * @brief 索引の1エントリ (XMLの所在)
+     */
+    struct Location {
+        fs::path source;     // ZIPまたはXMLファイル
+        std::string nested;  // ネストしたZIPのエントリ名 (直下の場合は空)
+        std::string entry;   // XMLのエントリ名 (sourceがXMLの場合は空)
+        std::string dem_type;
+        std::string date;    // ファイル名の日付 (YYYYMMDD、ない場合は空)
+    };
+
+    /**
+     * @brief メッシュの読み込み結果 (復号中のメッシュを待つスレッドと共有)
+     */
+    struct LoadResult {
+        std::shared_ptr<const MeshGrid> grid;
+        std::error_code ec;
+    };
+
+    explicit Impl(Config config)
+        : config_(std::move(config)),
+          grid_cache_(config_.cache_capacity),
+          nested_cache_(NESTED_CACHE_CAPACITY) {
+        if (config_.catalog) {
+            add_catalog(*config_.catalog);
+        } else {
+            for (const auto& input : config_.inputs) {
+                if (fs::is_directory(input)) {
+                    for (const auto& entry : fs::recursive_directory_iterator(input)) {
+                        if (entry.is_regular_file())
+                            add_source(entry.path());
+                    }
+                } else {
+                    add_source(input);
+                }
+            }
+        }
+        if (index_.empty() && nested_.empty()) {
+            throw std::runtime_error("FGD DEMファイルが見つかりません");
+        }
+    }
+
+    auto query(double lat, double lng) -> Result {
+        Result result{
+            .lat = lat, .lng = lng, .elevation = std::nullopt, .mesh_code = {}, .dem_type = {}};
+
+        for (const auto& [code, type] : candidates(lat, lng)) {
+            std::error_code ec;
+            auto grid = load_grid(code, type, ec);
+            if (!grid)
+                continue;
+            if (result.mesh_code.empty()) {
+                result.mesh_code = code;
+                result.dem_type = type;
+            }
+            float value = grid->nearest(lat, lng);
+            if (value != MeshGrid::NO_DATA) {
+                result.elevation = value;
+                result.mesh_code = code;
+                result.dem_type = type;
+                break;
+            }
+        }
+        return result;
+    }
+
+    auto candidates(double lat, double lng) -> std::vector<std::pair<std::string, std::string>> {
+        std::vector<std::pair<std::string, std::string>> out;
+        // 5m DEM (3次メッシュ) → 10m DEM (2次メッシュ) の順
+        for (int level : {3, 2}) {
+            auto code = mesh::from_latlng(lat, lng, level);
+            if (!code)
+                continue;
+            std::lock_guard<std::mutex> lock(mutex_);
+            expand_nested_locked(*code);
+            auto it = index_.find(*code);
+            if (it == index_.end())
+                continue;
+            for (const auto& location : it->second) {
+                out.emplace_back(*code, location.dem_type);
+            }
+        }
+        return out;
+    }
+
+    auto load_grid(std::string_view mesh_code, std::string_view dem_type,
+                   std::error_code& ec) -> std::shared_ptr<const MeshGrid> {
+        Location location;
+        std::string key;
+        std::promise<LoadResult> promise;
+        std::shared_future<LoadResult> pending;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expand_nested_locked(std::string(mesh_code));
+            auto it = index_.find(std::string(mesh_code));
+            if (it == index_.end() || it->second.empty()) {
+                ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                return nullptr;
+            }
+            auto loc = it->second.begin();
+            if (!dem_type.empty()) {
+                loc = std::find_if(it->second.begin(), it->second.end(),
+                                   [&](const Location& l) { return l.dem_type == dem_type; });
+                if (loc == it->second.end()) {
+                    ec = std::make_error_code(std::errc::no_such_file_or_directory);
+                    return nullptr;
+                }
+            }
+            location = *loc;
+            key = std::string(mesh_code) + "/" + location.dem_type;
+            if (auto cached = grid_cache_.get(key))
+                return cached;
+
+            // 他のスレッドが復号中のメッシュはその結果を待つ (同一メッシュは1回だけ復号)
+            if (auto it = loading_.find(key); it != loading_.end()) {
+                pending = it->second;
+            } else {
+                loading_.emplace(key, promise.get_future().share());
+            }
+        }
+
+        if (pending.valid()) {
+            const LoadResult& result = pending.get();
+            ec = result.ec;
+            return result.grid;
+        }
+
+        // 読み込みと復号はロック外で行う
+        LoadResult result;
+        try {
+            result = read_grid(location);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                loading_.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (result.grid)
+                grid_cache_.put(key, result.grid);
+            loading_.erase(key);
+        }
+        promise.set_value(result);
+        ec = result.ec;
+        return result.grid;
+    }
+
+    auto sample(std::span<const std::pair<double, double>> points,
+                Interpolation interpolation) -> std::vector<std::optional<double>> {
+        const size_t n = points.size();
+        std::vector<std::optional<double>> results(n);
+        if (n == 0)
+            return results;
+
+        // 並べ替えキーを並列計算し、局所性の高い順に並べる
+        std::vector<uint64_t> keys(n);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, n),
+                          [&](const tbb::blocked_range<size_t>& r) {
+                              for (size_t i = r.begin(); i != r.end(); ++i) {
+                                  keys[i] = locality_key(points[i].first, points[i].second);
+                              }
+                          });
+
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), size_t{0});
+        tbb::parallel_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return keys[a] != keys[b] ? keys[a] < keys[b] : a < b;
+        });
+
+        // 3次メッシュ単位のバッチに分割 (範囲外の地点は末尾に集まるので除外)
+        std::vector<std::pair<size_t, size_t>> batches;
+        for (size_t begin = 0; begin < n;) {
+            uint64_t mesh_key = keys[order[begin]] >> 16;
+            if (keys[order[begin]] == INVALID_KEY)
+                break;
+            size_t end = begin + 1;
+            while (end < n && keys[order[end]] != INVALID_KEY &&
+                   (keys[order[end]] >> 16) == mesh_key) {
+                ++end;
+            }
+            batches.emplace_back(begin, end);
+            begin = end;
+        }
+
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, batches.size()),
+            [&](const tbb::blocked_range<size_t>& r) {
+                for (size_t b = r.begin(); b != r.end(); ++b) {
+                    auto [begin, end] = batches[b];
+                    const auto& first = points[order[begin]];
+
+                    // バッチ内の全地点が同じ候補メッシュ群に含まれる
+                    std::vector<std::shared_ptr<const MeshGrid>> grids;
+                    for (const auto& [code, type] : candidates(first.first, first.second)) {
+                        std::error_code ec;
+                        if (auto grid = load_grid(code, type, ec))
+                            grids.push_back(std::move(grid));
+                    }
+                    if (grids.empty())
+                        continue;
+
+                    for (size_t k = begin; k < end; ++k) {
+                        size_t i = order[k];
+                        for (const auto& grid : grids) {
+                            float value = grid->sample(points[i].first, points[i].second,
+                                                       interpolation);
+                            if (value != MeshGrid::NO_DATA) {
+                                results[i] = value;
+                                break;
+                            }
+                        }
+                    }
+                }
+            });
+
+        return results;
+    }
+
+    size_t indexed_mesh_count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index_.size();
+    }
+
+   private:
+    static constexpr size_t NESTED_CACHE_CAPACITY = 4;
+
+    /**
+     * @brief ネストしたZIPの所在 (中身は未索引)
+     */
+    struct NestedZip {
+        fs::path source;
+        std::string entry;
+        bool expanded{false};
+    };
+
+    void add_location(const std::string& code, Location location) {
+        auto& list = index_[code];
+        // 同一メッシュ・同一種別が複数ある場合は最新版を使用 (同じ日付は名前順で先のもの)
+        auto name = [](const Location& l) {
+            return l.entry.empty() ? l.source.filename().string() : l.entry;
+        };
+        for (auto& existing : list) {
+            if (existing.dem_type != location.dem_type)
+                continue;
+            if (std::make_tuple(location.date, name(existing)) >
+                std::make_tuple(existing.date, name(location)))
+                existing = std::move(location);
+            return;
+        }
+        list.push_back(std::move(location));
+        std::stable_sort(list.begin(), list.end(), [](const Location& a, const Location& b) {
+            return mesh::type_rank(a.dem_type) < mesh::type_rank(b.dem_type);
+        });
+    }
+
+    void add_source(const fs::path& path) {
+        if (has_extension(path, ".xml")) {
+            if (auto name = mesh::parse_file_name(path.filename().string())) {
+                add_location(name->mesh_code, {.source = path,
+                                               .nested = {},
+                                               .entry = {},
+                                               .dem_type = name->dem_type,
+                                               .date = name->date});
+            }
+            return;
+        }
+        if (!zip::is_zip_file(path))
+            return;
+
+        zip::ZipHandler handler(path);
+        std::error_code ec;
+        auto files = handler.list_files(ec);
+        if (!files)
+            return;
+
+        for (const auto& file : *files) {
+            auto name = mesh::parse_file_name(file);
+            if (!name)
+                continue;
+            if (has_extension(file, ".xml")) {
+                add_location(name->mesh_code, {.source = path,
+                                               .nested = {},
+                                               .entry = file,
+                                               .dem_type = name->dem_type,
+                                               .date = name->date});
+            } else if (has_extension(file, ".zip")) {
+                nested_[name->mesh_code].push_back(
+                    {.source = path, .entry = file, .expanded = false});
+            }
+        }
+    }
+
+    /**
+     * @brief カタログの全レコードを索引に追加 (ネストしたZIPも展開済みの扱い)
+     *
+     * レコードは同一メッシュ・同一種別の中で日付の新しい順に並ぶため、最新版が採用される。
+     */
+    void add_catalog(const MeshCatalog& catalog) {
+        for (const auto& record : catalog.records()) {
+            add_location(MeshCatalog::mesh_code(record),
+                         {.source = catalog.archive_path(record),
+                          .nested = std::string(catalog.nested_name(record)),
+                          .entry = std::string(catalog.entry_name(record)),
+                          .dem_type = std::string(MeshCatalog::dem_type(record)),
+                          .date = record.date ? std::to_string(record.date) : std::string()});
+        }
+    }
+
+    /**
+     * @brief メッシュコードを包含するネストZIPのエントリ一覧を索引に追加 (mutex_保持中に呼ぶ)
+     */
+    void expand_nested_locked(const std::string& code) {
+        for (size_t len : {size_t{4}, size_t{6}, size_t{8}}) {
+            if (code.size() < len)
+                break;
+            auto it = nested_.find(code.substr(0, len));
+            if (it == nested_.end())
+                continue;
+
+            for (auto& nested : it->second) {
+                if (nested.expanded)
+                    continue;
+                nested.expanded = true;
+
+                std::error_code ec;
+                auto buffer = nested_buffer_locked(nested.source, nested.entry, ec);
+                if (!buffer)
+                    continue;
+                zip::ZipHandler inner(std::span<const uint8_t>(buffer->data(), buffer->size()));
+                auto files = inner.list_files(ec);
+                if (!files)
+                    continue;
+                for (const auto& file : *files) {
+                    auto name = mesh::parse_file_name(file);
+                    if (name && has_extension(file, ".xml")) {
+                        add_location(name->mesh_code, {.source = nested.source,
+                                                       .nested = nested.entry,
+                                                       .entry = file,
+                                                       .dem_type = name->dem_type,
+                                                       .date = name->date});
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief ネストしたZIPの内容をメモリに読み込む (直近のものはキャッシュ)
+     */
+    auto nested_buffer_locked(const fs::path& source, const std::string& entry,
+                              std::error_code& ec) -> std::shared_ptr<const std::vector<uint8_t>> {
+        std::string key = source.string() + "!" + entry;
+        if (auto cached = nested_cache_.get(key))
+            return cached;
+
+        zip::ZipHandler outer(source);
+        auto data = outer.read_file(entry, ec);
+        if (!data)
+            return nullptr;
+        auto shared = std::make_shared<const std::vector<uint8_t>>(std::move(*data));
+        nested_cache_.put(key, shared);
+        return shared;
+    }
+
+    bool read_location(const Location& location, std::vector<uint8_t>& out, std::error_code& ec) {
+        if (location.entry.empty()) {
+            if (!read_binary_file(location.source, out)) {
+                ec = std::make_error_code(std::errc::io_error);
+                return false;
+            }
+            return true;
+        }
+
+        if (location.nested.empty()) {
+            zip::ZipHandler handler(location.source);
+            auto data = handler.read_file(location.entry, ec);
+            if (!data)
+                return false;
+            out = std::move(*data);
+            return true;
+        }
+
+        std::shared_ptr<const std::vector<uint8_t>> buffer;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffer = nested_buffer_locked(location.source, location.nested, ec);
+        }
+        if (!buffer)
+            return false;
+        zip::ZipHandler inner(std::span<const uint8_t>(buffer->data(), buffer->size()));
+        auto data = inner.read_file(location.entry, ec);
+        if (!data)
+            return false;
+        out = std::move(*data);
+        return true;
+    }
+
+    /**
+     * @brief 所在からXMLを読み込んで復号
+     */
+    auto read_grid(const Location& location) -> LoadResult {
+        LoadResult result;
+        std::vector<uint8_t> xml;
+        if (!read_location(location, xml, result.ec))
+            return result;
+
+        auto grid = decode_mesh(
+            std::string_view(reinterpret_cast<const char*>(xml.data()), xml.size()),
+            location.dem_type, config_.sea_at_zero);
+        if (!grid) {
+            result.ec = std::make_error_code(std::errc::invalid_argument);
+            return result;
+        }
+        result.grid = std::make_shared<const MeshGrid>(std::move(*grid));
+        return result;
+    }
+
+    Config config_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<Location>> index_;
+    std::unordered_map<std::string, std::vector<NestedZip>> nested_;
+    LruCache<MeshGrid> grid_cache_;
+    LruCache<std::vector<uint8_t>> nested_cache_;
+    // 復号中のメッシュ (キーは "メッシュコード/DEM種別")
+    std::unordered_map<std::string, std::shared_future<LoadResult>> loading_;
+};
+
+PointQueryEngine::PointQueryEngine(Config config)
+    : pImpl(std::make_unique<Impl>(std::move(config))) {}
+
+PointQueryEngine::~PointQueryEngine() = default;
+
+auto PointQueryEngine::query(double lat, double lng) -> Result { return pImpl->query(lat, lng); }
+
+auto PointQueryEngine::load_grid(std::string_view mesh_code, std::string_view dem_type,
+                                 std::error_code& ec) -> std::shared_ptr<const MeshGrid> {
+    return pImpl->load_grid(mesh_code, dem_type, ec);
+}
+
+auto PointQueryEngine::candidates(double lat, double lng)
+    -> std::vector<std::pair<std::string, std::string>> {
+    return pImpl->candidates(lat, lng);
+}
+
+auto PointQueryEngine::sample(std::span<const std::pair<double, double>> points,
+                              Interpolation interpolation) -> std::vector<std::optional<double>> {
+    return pImpl->sample(points, interpolation);
+}
+
+size_t PointQueryEngine::indexed_mesh_count() const {
+    return pImpl->indexed_mesh_count();
+}
+
+}  // namespace fgd_converter
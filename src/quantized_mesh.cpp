@@ -0,0 +1,485 @@
+#include "quantized_mesh.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <sstream>
+
+#include "rtin.hpp"
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr float NO_DATA = -9999.0f;
+constexpr int MAX_SUPPORTED_ZOOM = 24;
+constexpr double QUANTIZED_MAX = 32767.0;
+
+// WGS84楕円体
+constexpr double WGS84_A = 6378137.0;
+constexpr double WGS84_B = 6356752.3142451793;
+constexpr double WGS84_E2 = 6.69437999014e-3;
+
+using Vec3 = std::array<double, 3>;
+
+Vec3 to_ecef(double lng_deg, double lat_deg, double height) {
+    const double lng = lng_deg * std::numbers::pi / 180.0;
+    const double lat = lat_deg * std::numbers::pi / 180.0;
+    const double sin_lat = std::sin(lat);
+    const double n = WGS84_A / std::sqrt(1.0 - WGS84_E2 * sin_lat * sin_lat);
+    return {(n + height) * std::cos(lat) * std::cos(lng),
+            (n + height) * std::cos(lat) * std::sin(lng),
+            (n * (1.0 - WGS84_E2) + height) * sin_lat};
+}
+
+inline double dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+inline Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+inline double length(const Vec3& a) { return std::sqrt(dot(a, a)); }
+
+const Rtin& rtin_for(int grid_size) {
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<Rtin>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = cache[grid_size];
+    if (!entry) {
+        entry = std::make_unique<Rtin>(grid_size);
+    }
+    return *entry;
+}
+
+/**
+ * @brief 誤差がしきい値以下になるまで三角形を再帰的に分割してメッシュを抽出
+ *
+ * 頂点番号は三角形リストに初めて現れた順に振るため、インデックスはそのまま
+ * ハイウォーターマーク方式で符号化できる。三角形は (u, v) 平面で反時計回り。
+ */
+class MeshBuilder {
+   public:
+    MeshBuilder(const std::vector<float>& errors, int grid_size, double max_error)
+        : errors_(errors),
+          size_(grid_size),
+          max_error_(max_error),
+          vertex_index_(static_cast<size_t>(grid_size) * grid_size, 0) {}
+
+    void build() {
+        const int max = size_ - 1;
+        split(0, 0, max, max, max, 0);
+        split(max, max, 0, 0, 0, max);
+    }
+
+    std::vector<uint32_t> vertices;   // 格子上の位置 (y * grid_size + x)
+    std::vector<uint32_t> triangles;  // 頂点番号 ×3
+
+   private:
+    void split(int ax, int ay, int bx, int by, int cx, int cy) {
+        const int mx = (ax + bx) >> 1;
+        const int my = (ay + by) >> 1;
+        if (std::abs(ax - cx) + std::abs(ay - cy) > 1 &&
+            errors_[static_cast<size_t>(my) * size_ + mx] > max_error_) {
+            split(cx, cy, ax, ay, mx, my);
+            split(bx, by, cx, cy, mx, my);
+            return;
+        }
+
+        // 格子のyは南向きのため、(x, y) で時計回りなら (u, v) で反時計回り
+        const long orientation =
+            static_cast<long>(bx - ax) * (cy - ay) - static_cast<long>(by - ay) * (cx - ax);
+        add(ax, ay);
+        if (orientation < 0) {
+            add(bx, by);
+            add(cx, cy);
+        } else {
+            add(cx, cy);
+            add(bx, by);
+        }
+    }
+
+    void add(int x, int y) {
+        const size_t grid = static_cast<size_t>(y) * size_ + x;
+        if (vertex_index_[grid] == 0) {
+            vertices.push_back(static_cast<uint32_t>(grid));
+            vertex_index_[grid] = static_cast<uint32_t>(vertices.size());
+        }
+        triangles.push_back(vertex_index_[grid] - 1);
+    }
+
+    const std::vector<float>& errors_;
+    int size_;
+    double max_error_;
+    std::vector<uint32_t> vertex_index_;  // 格子位置 → 頂点番号 + 1 (0は未使用)
+};
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+inline uint16_t zig_zag(int value) {
+    return static_cast<uint16_t>((value << 1) ^ (value >> 31));
+}
+
+/**
+ * @brief 値の並びをジグザグ差分で書き込む
+ */
+void put_delta_encoded(std::vector<uint8_t>& out, const std::vector<uint16_t>& values) {
+    int previous = 0;
+    for (uint16_t value : values) {
+        put<uint16_t>(out, zig_zag(static_cast<int>(value) - previous));
+        previous = value;
+    }
+}
+
+template <typename Index>
+void put_indices(std::vector<uint8_t>& out, const std::vector<uint32_t>& triangles,
+                 const std::array<std::vector<uint32_t>, 4>& edges) {
+    // 各インデックスのアライメントに合わせる
+    while (out.size() % sizeof(Index) != 0) {
+        out.push_back(0);
+    }
+
+    put<uint32_t>(out, static_cast<uint32_t>(triangles.size() / 3));
+    uint32_t highest = 0;
+    for (uint32_t index : triangles) {
+        const uint32_t code = highest - index;
+        put<Index>(out, static_cast<Index>(code));
+        if (code == 0) {
+            ++highest;
+        }
+    }
+
+    for (const auto& edge : edges) {
+        put<uint32_t>(out, static_cast<uint32_t>(edge.size()));
+        for (uint32_t index : edge) {
+            put<Index>(out, static_cast<Index>(index));
+        }
+    }
+}
+
+/**
+ * @brief 地平線遮蔽点 (楕円体でスケーリングした座標系) を計算
+ *
+ * Cesium の EllipsoidalOccluder と同じ方法で、中心方向の直線上に全頂点を
+ * 地平線の下に隠す最も近い点を求める。
+ */
+Vec3 horizon_occlusion_point(const std::vector<Vec3>& positions, const Vec3& direction) {
+    const Vec3 inv_radii = {1.0 / WGS84_A, 1.0 / WGS84_A, 1.0 / WGS84_B};
+    Vec3 scaled_direction = {direction[0] * inv_radii[0], direction[1] * inv_radii[1],
+                             direction[2] * inv_radii[2]};
+    const double norm = length(scaled_direction);
+    for (auto& c : scaled_direction) {
+        c /= norm;
+    }
+
+    double magnitude_max = 0.0;
+    for (const auto& p : positions) {
+        const Vec3 scaled = {p[0] * inv_radii[0], p[1] * inv_radii[1], p[2] * inv_radii[2]};
+        double magnitude_squared = dot(scaled, scaled);
+        double magnitude = std::sqrt(magnitude_squared);
+        const Vec3 unit = {scaled[0] / magnitude, scaled[1] / magnitude, scaled[2] / magnitude};
+
+        // 楕円体より下の点は楕円体上にあるとみなす
+        magnitude_squared = std::max(1.0, magnitude_squared);
+        magnitude = std::max(1.0, magnitude);
+
+        const double cos_alpha = dot(unit, scaled_direction);
+        const double sin_alpha = length(cross(unit, scaled_direction));
+        const double cos_beta = 1.0 / magnitude;
+        const double sin_beta = std::sqrt(magnitude_squared - 1.0) * cos_beta;
+        magnitude_max =
+            std::max(magnitude_max, 1.0 / (cos_alpha * cos_beta - sin_alpha * sin_beta));
+    }
+    return {scaled_direction[0] * magnitude_max, scaled_direction[1] * magnitude_max,
+            scaled_direction[2] * magnitude_max};
+}
+
+/**
+ * @brief タイル格子を入力ラスターから標本化 (データなしは標高0m)
+ */
+std::vector<float> sample_grid(std::span<const Mosaic* const> sources, int grid_size,
+                               double west, double north, double span_deg) {
+    const size_t size = static_cast<size_t>(grid_size);
+    std::vector<float> heights(size * size, 0.0f);
+    const double step = span_deg / (grid_size - 1);
+
+    for (int gy = 0; gy < grid_size; ++gy) {
+        const double lat = north - gy * step;
+        for (int gx = 0; gx < grid_size; ++gx) {
+            const double lng = west + gx * step;
+            for (const Mosaic* source : sources) {
+                const float v = sample_mosaic(*source, lat, lng);
+                if (v > NO_DATA) {
+                    heights[gy * size + gx] = v;
+                    break;
+                }
+            }
+        }
+    }
+
+    return heights;
+}
+
+}  // namespace
+
+auto encode_quantized_mesh(std::span<const float> heights, int grid_size, double max_error,
+                           double west, double south, double east, double north)
+    -> std::vector<uint8_t> {
+    const Rtin& rtin = rtin_for(grid_size);
+    const auto errors = rtin.compute_errors(heights);
+
+    MeshBuilder builder(errors, grid_size, max_error);
+    builder.build();
+    const auto& vertices = builder.vertices;
+    const size_t vertex_count = vertices.size();
+    const int max = grid_size - 1;
+
+    float min_height = heights[vertices[0]];
+    float max_height = min_height;
+    for (uint32_t grid : vertices) {
+        min_height = std::min(min_height, heights[grid]);
+        max_height = std::max(max_height, heights[grid]);
+    }
+    const double height_range = static_cast<double>(max_height) - min_height;
+
+    // 量子化座標と辺上の頂点
+    std::vector<uint16_t> us(vertex_count), vs(vertex_count), hs(vertex_count);
+    std::array<std::vector<uint32_t>, 4> edges;  // 西, 南, 東, 北
+    std::vector<Vec3> positions(vertex_count);
+    for (size_t i = 0; i < vertex_count; ++i) {
+        const int gx = static_cast<int>(vertices[i] % grid_size);
+        const int gy = static_cast<int>(vertices[i] / grid_size);
+        const double h = heights[vertices[i]];
+        us[i] = static_cast<uint16_t>(std::lround(gx * QUANTIZED_MAX / max));
+        vs[i] = static_cast<uint16_t>(std::lround((max - gy) * QUANTIZED_MAX / max));
+        hs[i] = height_range > 0.0 ? static_cast<uint16_t>(std::lround(
+                                         (h - min_height) / height_range * QUANTIZED_MAX))
+                                   : 0;
+
+        if (gx == 0)
+            edges[0].push_back(static_cast<uint32_t>(i));
+        if (gy == max)
+            edges[1].push_back(static_cast<uint32_t>(i));
+        if (gx == max)
+            edges[2].push_back(static_cast<uint32_t>(i));
+        if (gy == 0)
+            edges[3].push_back(static_cast<uint32_t>(i));
+
+        positions[i] =
+            to_ecef(west + (east - west) * gx / max, north - (north - south) * gy / max, h);
+    }
+    // 西・東の辺は南から北、南・北の辺は西から東の順
+    auto by_v = [&](uint32_t a, uint32_t b) { return vs[a] < vs[b]; };
+    auto by_u = [&](uint32_t a, uint32_t b) { return us[a] < us[b]; };
+    std::sort(edges[0].begin(), edges[0].end(), by_v);
+    std::sort(edges[1].begin(), edges[1].end(), by_u);
+    std::sort(edges[2].begin(), edges[2].end(), by_v);
+    std::sort(edges[3].begin(), edges[3].end(), by_u);
+
+    // 境界球: 頂点のAABB中心から最も遠い頂点までの距離
+    Vec3 lo = positions[0], hi = positions[0];
+    for (const auto& p : positions) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], p[k]);
+            hi[k] = std::max(hi[k], p[k]);
+        }
+    }
+    const Vec3 sphere_center = {(lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2};
+    double radius = 0.0;
+    for (const auto& p : positions) {
+        const Vec3 d = {p[0] - sphere_center[0], p[1] - sphere_center[1], p[2] - sphere_center[2]};
+        radius = std::max(radius, length(d));
+    }
+
+    const Vec3 center = to_ecef((west + east) / 2, (south + north) / 2,
+                                (static_cast<double>(min_height) + max_height) / 2);
+    const Vec3 occlusion = horizon_occlusion_point(positions, sphere_center);
+
+    std::vector<uint8_t> out;
+    out.reserve(88 + vertex_count * 6 + builder.triangles.size() * 4 + 64);
+
+    // ヘッダー (88バイト)
+    for (double c : center)
+        put<double>(out, c);
+    put<float>(out, min_height);
+    put<float>(out, max_height);
+    for (double c : sphere_center)
+        put<double>(out, c);
+    put<double>(out, radius);
+    for (double c : occlusion)
+        put<double>(out, c);
+
+    // 頂点データ
+    put<uint32_t>(out, static_cast<uint32_t>(vertex_count));
+    put_delta_encoded(out, us);
+    put_delta_encoded(out, vs);
+    put_delta_encoded(out, hs);
+
+    // インデックスデータと辺の頂点 (65536頂点を超える場合は32bit)
+    if (vertex_count > 65536) {
+        put_indices<uint32_t>(out, builder.triangles, edges);
+    } else {
+        put_indices<uint16_t>(out, builder.triangles, edges);
+    }
+    return out;
+}
+
+auto write_quantized_mesh(std::span<const Mosaic> sources, const QuantizedMeshConfig& config,
+                          TileWriter& writer, std::error_code& ec)
+    -> std::optional<QuantizedMeshLayer> {
+    const int cells = config.grid_size - 1;
+    if (config.min_zoom < 0 || config.min_zoom > config.max_zoom ||
+        config.max_zoom > MAX_SUPPORTED_ZOOM || cells < 2 || cells > 4096 ||
+        (cells & (cells - 1)) != 0 || config.max_error < 0.0) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return std::nullopt;
+    }
+
+    std::vector<const Mosaic*> valid_sources;
+    for (const auto& source : sources) {
+        if (source.x_length > 0 && source.y_length > 0) {
+            valid_sources.push_back(&source);
+        }
+    }
+    if (valid_sources.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return std::nullopt;
+    }
+
+    QuantizedMeshLayer layer;
+    layer.available.resize(static_cast<size_t>(config.max_zoom) + 1);
+
+    std::mutex error_mutex;
+    std::atomic<bool> failed{false};
+    std::error_code first_error;
+
+    for (int z = config.min_zoom; z <= config.max_zoom && !failed.load(); ++z) {
+        const double span_deg = 180.0 / std::ldexp(1.0, z);
+        const auto tiles_x = static_cast<uint32_t>(std::ldexp(2.0, z));
+        const auto tiles_y = static_cast<uint32_t>(std::ldexp(1.0, z));
+        // タイル単位の座標を範囲内のタイル番号へ (終端はタイル境界ちょうどなら手前のタイル)
+        auto first_tile = [](double t, uint32_t count) {
+            return static_cast<uint32_t>(std::clamp(std::floor(t), 0.0, count - 1.0));
+        };
+        auto last_tile = [](double t, uint32_t count) {
+            return static_cast<uint32_t>(std::clamp(std::ceil(t) - 1.0, 0.0, count - 1.0));
+        };
+
+        // このズームで入力と重なるタイル (yの昇順、同じyではxの昇順)
+        // ズーム0の2枚はCesiumがルートとして要求するため常に出力する
+        std::vector<std::pair<uint32_t, uint32_t>> tiles;  // (y, x)
+        if (z == 0) {
+            tiles = {{0, 0}, {0, 1}};
+        }
+        for (const Mosaic* source : valid_sources) {
+            const auto& gt = source->geo_transform;
+            const double west = (gt[0] + 180.0) / span_deg;
+            const double east = (gt[0] + gt[1] * source->x_length + 180.0) / span_deg;
+            const double north = (gt[3] + 90.0) / span_deg;
+            const double south = (gt[3] + gt[5] * source->y_length + 90.0) / span_deg;
+            for (uint32_t y = first_tile(south, tiles_y); y <= last_tile(north, tiles_y); ++y) {
+                for (uint32_t x = first_tile(west, tiles_x); x <= last_tile(east, tiles_x); ++x) {
+                    tiles.emplace_back(y, x);
+                }
+            }
+        }
+        std::sort(tiles.begin(), tiles.end());
+        tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+        const double max_error = config.max_error * std::ldexp(1.0, config.max_zoom - z);
+        std::vector<uint8_t> written(tiles.size(), 0);
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, tiles.size()),
+                          [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                if (failed.load(std::memory_order_relaxed))
+                    return;
+                const auto [y, x] = tiles[i];
+                const double west = -180.0 + x * span_deg;
+                const double south = -90.0 + y * span_deg;
+                auto heights = sample_grid(valid_sources, config.grid_size, west,
+                                           south + span_deg, span_deg);
+
+                auto mesh = encode_quantized_mesh(heights, config.grid_size, max_error, west,
+                                                  south, west + span_deg, south + span_deg);
+                std::error_code tile_ec;
+                if (!writer.write(z, x, y, mesh, tile_ec)) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!failed.exchange(true)) {
+                        first_error = tile_ec;
+                    }
+                    return;
+                }
+                written[i] = 1;
+            }
+        });
+
+        // 出力したタイルを行ごとの連続区間にまとめる
+        auto& ranges = layer.available[static_cast<size_t>(z)];
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (!written[i])
+                continue;
+            ++layer.tile_count;
+            const auto [y, x] = tiles[i];
+            if (!ranges.empty() && ranges.back().start_y == y && ranges.back().end_x + 1 == x) {
+                ranges.back().end_x = x;
+            } else {
+                ranges.push_back({.start_x = x, .start_y = y, .end_x = x, .end_y = y});
+            }
+        }
+    }
+
+    if (failed.load()) {
+        ec = first_error;
+        return std::nullopt;
+    }
+    if (!writer.finish(ec)) {
+        return std::nullopt;
+    }
+    return layer;
+}
+
+auto make_layer_json(const QuantizedMeshLayer& layer, const QuantizedMeshConfig& config)
+    -> std::string {
+    std::ostringstream ss;
+    ss << "{\n"
+       << "  \"tilejson\": \"2.1.0\",\n"
+       << "  \"name\": \"fgd_dem\",\n"
+       << "  \"version\": \"1.0.0\",\n"
+       << "  \"format\": \"quantized-mesh-1.0\",\n"
+       << "  \"scheme\": \"tms\",\n"
+       << "  \"tiles\": [\"{z}/{x}/{y}.terrain?v={version}\"],\n"
+       << "  \"projection\": \"EPSG:4326\",\n"
+       << "  \"bounds\": [-180, -90, 180, 90],\n"
+       << "  \"minzoom\": " << config.min_zoom << ",\n"
+       << "  \"maxzoom\": " << config.max_zoom << ",\n"
+       << "  \"available\": [";
+    for (size_t z = 0; z < layer.available.size(); ++z) {
+        ss << (z == 0 ? "\n    [" : ",\n    [");
+        const auto& ranges = layer.available[z];
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            const auto& r = ranges[i];
+            ss << (i == 0 ? "" : ", ") << "{\"startX\": " << r.start_x
+               << ", \"startY\": " << r.start_y << ", \"endX\": " << r.end_x
+               << ", \"endY\": " << r.end_y << "}";
+        }
+        ss << "]";
+    }
+    ss << "\n  ]\n}\n";
+    return ss.str();
+}
+
+}  // namespace fgd_converter
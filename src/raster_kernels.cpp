@@ -0,0 +1,112 @@
+#include "raster_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cpu_features.hpp"
+#include "kernel_variants.hpp"
+
+namespace fgd_converter {
+
+auto parse_rgb_encoding(std::string_view name) -> std::optional<RgbEncoding> {
+    if (name == "mapbox")
+        return RgbEncoding::Mapbox;
+    if (name == "terrarium")
+        return RgbEncoding::Terrarium;
+    return std::nullopt;
+}
+
+namespace kernels {
+
+namespace {
+
+inline int32_t quantize(double height, const EncodingParams& p) {
+    if (height <= NO_DATA)
+        return p.offset;  // データなしは標高0m
+    double scaled = height * p.scale;
+    if (p.use_floor)
+        scaled = std::floor(scaled);
+    scaled = std::clamp(scaled, -RGB_SCALED_LIMIT, RGB_SCALED_LIMIT);
+    return std::clamp(static_cast<int32_t>(scaled) + p.offset, 0, RGB_MAX_VALUE);
+}
+
+inline void store_rgb(int32_t q, uint8_t* rgb) {
+    rgb[0] = static_cast<uint8_t>(q >> 16);
+    rgb[1] = static_cast<uint8_t>((q >> 8) & 0xFF);
+    rgb[2] = static_cast<uint8_t>(q & 0xFF);
+}
+
+template <typename T>
+void encode_rgb_impl(const T* heights, size_t count, RgbEncoding encoding, uint8_t* out) {
+    const EncodingParams p = params_for(encoding);
+    size_t i = 0;
+
+#if FGD_DEM_X86_KERNELS
+    switch (cpu::active()) {
+        case cpu::Level::Avx512:
+            i = avx512::encode_rgb(heights, count, p, out);
+            break;
+        case cpu::Level::Avx2:
+            i = avx2::encode_rgb(heights, count, p, out);
+            break;
+        case cpu::Level::Sse42:
+            i = sse42::encode_rgb(heights, count, p, out);
+            break;
+        case cpu::Level::Scalar:
+            break;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        store_rgb(quantize(static_cast<double>(heights[i]), p), out + i * 3);
+    }
+}
+
+}  // namespace
+
+void encode_rgb(const double* heights, size_t count, RgbEncoding encoding, uint8_t* out) noexcept {
+    encode_rgb_impl(heights, count, encoding, out);
+}
+
+void encode_rgb(const float* heights, size_t count, RgbEncoding encoding, uint8_t* out) noexcept {
+    encode_rgb_impl(heights, count, encoding, out);
+}
+
+void resample_bilinear_row(const float* src, int src_width, int src_height,
+                           const double* src_cols, const double* src_rows, size_t count,
+                           bool has_nodata, float nodata, float* dst) noexcept {
+    size_t i = 0;
+#if FGD_DEM_X86_KERNELS
+    if (cpu::active() >= cpu::Level::Avx2) {
+        i = avx2::resample_bilinear_row(src, src_width, src_height, src_cols, src_rows, count,
+                                        has_nodata, nodata, dst);
+    }
+#endif
+
+    for (; i < count; ++i) {
+        const double col_f = src_cols[i];
+        const double row_f = src_rows[i];
+        const int col0 = static_cast<int>(std::floor(col_f));
+        const int row0 = static_cast<int>(std::floor(row_f));
+        if (col0 < 0 || col0 + 1 >= src_width || row0 < 0 || row0 + 1 >= src_height)
+            continue;
+
+        const float* top = src + static_cast<size_t>(row0) * src_width + col0;
+        const float* bottom = top + src_width;
+        const float v00 = top[0];
+        const float v01 = top[1];
+        const float v10 = bottom[0];
+        const float v11 = bottom[1];
+        if (has_nodata && (v00 == nodata || v01 == nodata || v10 == nodata || v11 == nodata))
+            continue;  // NODATAのままにする
+
+        const double dx = col_f - col0;
+        const double dy = row_f - row0;
+        dst[i] = static_cast<float>((1 - dx) * (1 - dy) * v00 + dx * (1 - dy) * v01 +
+                                    (1 - dx) * dy * v10 + dx * dy * v11);
+    }
+}
+
+}  // namespace kernels
+
+}  // namespace fgd_converter
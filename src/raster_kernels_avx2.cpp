@@ -0,0 +1,205 @@
+#include "kernel_variants.hpp"
+#include "terrain.hpp"
+
+// AVX2版カーネル (CMakeLists.txtでこのファイルのみ -mavx2 -mfma を付けてコンパイル)
+#if FGD_DEM_X86_KERNELS
+
+#    include <immintrin.h>
+
+namespace fgd_converter::kernels::avx2 {
+
+namespace {
+
+inline __m256d load4(const double* p) { return _mm256_loadu_pd(p); }
+inline __m256d load4(const float* p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+
+template <typename T>
+size_t encode_rgb_impl(const T* heights, size_t count, const EncodingParams& p, uint8_t* out) {
+    const __m256d nodata = _mm256_set1_pd(NO_DATA);
+    const __m256d scale = _mm256_set1_pd(p.scale);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d lower = _mm256_set1_pd(-RGB_SCALED_LIMIT);
+    const __m256d upper = _mm256_set1_pd(RGB_SCALED_LIMIT);
+    const __m128i offset = _mm_set1_epi32(p.offset);
+    const __m128i min_q = _mm_setzero_si128();
+    const __m128i max_q = _mm_set1_epi32(RGB_MAX_VALUE);
+    // 各32bitレーン (リトルエンディアンで B, G, R, 0) を R, G, B の3バイトに詰める
+    // 末尾4バイトは0 (0x80 = ゼロ埋め)
+    const __m128i interleave =
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -128, -128, -128, -128);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d h = load4(heights + i);
+        __m256d missing = _mm256_cmp_pd(h, nodata, _CMP_LE_OQ);
+        __m256d scaled = _mm256_mul_pd(h, scale);
+        if (p.use_floor)
+            scaled = _mm256_floor_pd(scaled);
+        scaled = _mm256_blendv_pd(scaled, zero, missing);
+        scaled = _mm256_min_pd(_mm256_max_pd(scaled, lower), upper);
+
+        __m128i q = _mm_add_epi32(_mm256_cvttpd_epi32(scaled), offset);
+        q = _mm_min_epi32(_mm_max_epi32(q, min_q), max_q);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), _mm_shuffle_epi8(q, interleave));
+    }
+    return i;
+}
+
+}  // namespace
+
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+size_t resample_bilinear_row(const float* src, int src_width, int src_height,
+                             const double* src_cols, const double* src_rows, size_t count,
+                             bool has_nodata, float nodata, float* dst) noexcept {
+    // ギャザーの添字はint32のため、右下の近傍まで32bitに収まる場合のみ
+    const auto pixels = static_cast<int64_t>(src_width) * src_height;
+    if (pixels + src_width + 1 > INT32_MAX)
+        return 0;
+
+    const __m128i width = _mm_set1_epi32(src_width);
+    const __m128i last_col = _mm_set1_epi32(src_width - 1);
+    const __m128i last_row = _mm_set1_epi32(src_height - 1);
+    const __m128i minus_one = _mm_set1_epi32(-1);
+    const __m128 vnodata = _mm_set1_ps(nodata);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const float* right = src + 1;
+    const float* below = src + src_width;
+    const float* below_right = below + 1;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d col_f = _mm256_loadu_pd(src_cols + i);
+        const __m256d row_f = _mm256_loadu_pd(src_rows + i);
+        const __m256d col0_f = _mm256_floor_pd(col_f);
+        const __m256d row0_f = _mm256_floor_pd(row_f);
+        const __m128i col0 = _mm256_cvttpd_epi32(col0_f);
+        const __m128i row0 = _mm256_cvttpd_epi32(row0_f);
+
+        // 0 <= col0 && col0 + 1 < width && 0 <= row0 && row0 + 1 < height
+        __m128i inside = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi32(col0, minus_one), _mm_cmpgt_epi32(last_col, col0)),
+            _mm_and_si128(_mm_cmpgt_epi32(row0, minus_one), _mm_cmpgt_epi32(last_row, row0)));
+        __m128 keep = _mm_castsi128_ps(inside);
+        if (_mm_movemask_ps(keep) == 0)
+            continue;
+
+        const __m128i index = _mm_add_epi32(_mm_mullo_epi32(row0, width), col0);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 v00 = _mm_mask_i32gather_ps(zero, src, index, keep, 4);
+        const __m128 v01 = _mm_mask_i32gather_ps(zero, right, index, keep, 4);
+        const __m128 v10 = _mm_mask_i32gather_ps(zero, below, index, keep, 4);
+        const __m128 v11 = _mm_mask_i32gather_ps(zero, below_right, index, keep, 4);
+        if (has_nodata) {
+            __m128 missing = _mm_or_ps(
+                _mm_or_ps(_mm_cmpeq_ps(v00, vnodata), _mm_cmpeq_ps(v01, vnodata)),
+                _mm_or_ps(_mm_cmpeq_ps(v10, vnodata), _mm_cmpeq_ps(v11, vnodata)));
+            keep = _mm_andnot_ps(missing, keep);  // NODATAのままにする
+        }
+
+        // スカラー版と同じ式・同じ順序で補間
+        const __m256d dx = _mm256_sub_pd(col_f, col0_f);
+        const __m256d dy = _mm256_sub_pd(row_f, row0_f);
+        const __m256d rx = _mm256_sub_pd(one, dx);
+        const __m256d ry = _mm256_sub_pd(one, dy);
+        __m256d value = _mm256_mul_pd(_mm256_mul_pd(rx, ry), _mm256_cvtps_pd(v00));
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_mul_pd(dx, ry), _mm256_cvtps_pd(v01)));
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_mul_pd(rx, dy), _mm256_cvtps_pd(v10)));
+        value = _mm256_add_pd(value, _mm256_mul_pd(_mm256_mul_pd(dx, dy), _mm256_cvtps_pd(v11)));
+
+        const __m128 previous = _mm_loadu_ps(dst + i);
+        _mm_storeu_ps(dst + i, _mm_blendv_ps(previous, _mm256_cvtpd_ps(value), keep));
+    }
+    return i;
+}
+
+int row_gradients(const double* up, const double* mid, const double* down, int x, int width,
+                  double inv_8dx, double inv_8dy, double* gx, double* gy,
+                  uint8_t* valid) noexcept {
+    // 内部ピクセルを4つずつ処理 (x-1, x, x+1の非整列ロードで3×3近傍を構成)
+    const __m256d nodata = _mm256_set1_pd(NO_DATA);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d vdx = _mm256_set1_pd(inv_8dx);
+    const __m256d vdy = _mm256_set1_pd(inv_8dy);
+
+    for (; x + 4 <= width - 1; x += 4) {
+        __m256d a = _mm256_loadu_pd(up + x - 1);
+        __m256d b = _mm256_loadu_pd(up + x);
+        __m256d c = _mm256_loadu_pd(up + x + 1);
+        __m256d d = _mm256_loadu_pd(mid + x - 1);
+        __m256d e = _mm256_loadu_pd(mid + x);
+        __m256d f = _mm256_loadu_pd(mid + x + 1);
+        __m256d g = _mm256_loadu_pd(down + x - 1);
+        __m256d h = _mm256_loadu_pd(down + x);
+        __m256d i = _mm256_loadu_pd(down + x + 1);
+
+        __m256d missing = _mm256_or_pd(
+            _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(a, nodata, _CMP_EQ_OQ),
+                                      _mm256_cmp_pd(b, nodata, _CMP_EQ_OQ)),
+                         _mm256_or_pd(_mm256_cmp_pd(c, nodata, _CMP_EQ_OQ),
+                                      _mm256_cmp_pd(d, nodata, _CMP_EQ_OQ))),
+            _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(e, nodata, _CMP_EQ_OQ),
+                                      _mm256_cmp_pd(f, nodata, _CMP_EQ_OQ)),
+                         _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(g, nodata, _CMP_EQ_OQ),
+                                                   _mm256_cmp_pd(h, nodata, _CMP_EQ_OQ)),
+                                      _mm256_cmp_pd(i, nodata, _CMP_EQ_OQ))));
+
+        // (c + 2f + i) - (a + 2d + g)
+        __m256d east = _mm256_fmadd_pd(two, f, _mm256_add_pd(c, i));
+        __m256d west = _mm256_fmadd_pd(two, d, _mm256_add_pd(a, g));
+        // (g + 2h + i) - (a + 2b + c)
+        __m256d south = _mm256_fmadd_pd(two, h, _mm256_add_pd(g, i));
+        __m256d north = _mm256_fmadd_pd(two, b, _mm256_add_pd(a, c));
+
+        _mm256_storeu_pd(gx + x, _mm256_mul_pd(_mm256_sub_pd(east, west), vdx));
+        _mm256_storeu_pd(gy + x, _mm256_mul_pd(_mm256_sub_pd(south, north), vdy));
+
+        int mask = _mm256_movemask_pd(missing);
+        valid[x + 0] = (mask & 1) ? 0 : 1;
+        valid[x + 1] = (mask & 2) ? 0 : 1;
+        valid[x + 2] = (mask & 4) ? 0 : 1;
+        valid[x + 3] = (mask & 8) ? 0 : 1;
+    }
+    return x;
+}
+
+int row_hillshade(const double* gx, const double* gy, const uint8_t* valid, int width,
+                  const Illumination& light, float* out) noexcept {
+    const __m256d cos_zen = _mm256_set1_pd(light.cos_zenith);
+    const __m256d sin_zen = _mm256_set1_pd(light.sin_zenith);
+    const __m256d cos_az = _mm256_set1_pd(light.cos_azimuth);
+    const __m256d sin_az = _mm256_set1_pd(light.sin_azimuth);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d scale = _mm256_set1_pd(255.0);
+    const __m256d zero = _mm256_setzero_pd();
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m256d vx = _mm256_loadu_pd(gx + x);
+        __m256d vy = _mm256_loadu_pd(gy + x);
+        __m256d p2 = _mm256_fmadd_pd(vx, vx, _mm256_mul_pd(vy, vy));
+        __m256d dir = _mm256_fmsub_pd(sin_az, vy, _mm256_mul_pd(cos_az, vx));
+        __m256d num = _mm256_fmadd_pd(sin_zen, dir, cos_zen);
+        __m256d norm = _mm256_sqrt_pd(_mm256_add_pd(one, p2));
+        __m256d hs = _mm256_max_pd(_mm256_div_pd(_mm256_mul_pd(scale, num), norm), zero);
+        _mm_storeu_ps(out + x, _mm256_cvtpd_ps(hs));
+
+        for (int k = 0; k < 4; ++k) {
+            if (!valid[x + k])
+                out[x + k] = TerrainBands::NO_DATA;
+        }
+    }
+    return x;
+}
+
+}  // namespace fgd_converter::kernels::avx2
+
+#endif
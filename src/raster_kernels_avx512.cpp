@@ -0,0 +1,66 @@
+#include "kernel_variants.hpp"
+
+// AVX-512版カーネル (CMakeLists.txtでこのファイルのみ -mavx512f -mavx512bw -mavx512vl
+// -mavx512dq を付けてコンパイル)
+#if FGD_DEM_X86_KERNELS
+
+#    include <immintrin.h>
+
+namespace fgd_converter::kernels::avx512 {
+
+namespace {
+
+inline __m512d load8(const double* p) { return _mm512_loadu_pd(p); }
+inline __m512d load8(const float* p) { return _mm512_cvtps_pd(_mm256_loadu_ps(p)); }
+
+template <typename T>
+size_t encode_rgb_impl(const T* heights, size_t count, const EncodingParams& p, uint8_t* out) {
+    const __m512d nodata = _mm512_set1_pd(NO_DATA);
+    const __m512d scale = _mm512_set1_pd(p.scale);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d lower = _mm512_set1_pd(-RGB_SCALED_LIMIT);
+    const __m512d upper = _mm512_set1_pd(RGB_SCALED_LIMIT);
+    const __m256i offset = _mm256_set1_epi32(p.offset);
+    const __m256i min_q = _mm256_setzero_si256();
+    const __m256i max_q = _mm256_set1_epi32(RGB_MAX_VALUE);
+    // 各32bitレーン (リトルエンディアンで B, G, R, 0) を R, G, B の3バイトに詰める
+    const __m128i interleave =
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -128, -128, -128, -128);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d h = load8(heights + i);
+        __mmask8 missing = _mm512_cmp_pd_mask(h, nodata, _CMP_LE_OQ);
+        __m512d scaled = _mm512_mul_pd(h, scale);
+        if (p.use_floor)
+            scaled = _mm512_roundscale_pd(scaled, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+        scaled = _mm512_mask_blend_pd(missing, scaled, zero);
+        scaled = _mm512_min_pd(_mm512_max_pd(scaled, lower), upper);
+
+        __m256i q = _mm256_add_epi32(_mm512_cvttpd_epi32(scaled), offset);
+        q = _mm256_min_epi32(_mm256_max_epi32(q, min_q), max_q);
+        // 4画素 (12バイト) ずつ2回ストアし、2回目で1回目の末尾の0を上書きする
+        uint8_t* dst = out + i * 3;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                         _mm_shuffle_epi8(_mm256_castsi256_si128(q), interleave));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 12),
+                         _mm_shuffle_epi8(_mm256_extracti128_si256(q, 1), interleave));
+    }
+    return i;
+}
+
+}  // namespace
+
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+}  // namespace fgd_converter::kernels::avx512
+
+#endif
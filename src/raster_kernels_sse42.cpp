@@ -0,0 +1,66 @@
+#include "kernel_variants.hpp"
+
+// SSE4.2版カーネル (CMakeLists.txtでこのファイルのみ -msse4.2 を付けてコンパイル)
+#if FGD_DEM_X86_KERNELS
+
+#    include <immintrin.h>
+
+namespace fgd_converter::kernels::sse42 {
+
+namespace {
+
+inline __m128d load2(const double* p) { return _mm_loadu_pd(p); }
+inline __m128d load2(const float* p) {
+    return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+}
+
+template <typename T>
+size_t encode_rgb_impl(const T* heights, size_t count, const EncodingParams& p, uint8_t* out) {
+    const __m128d nodata = _mm_set1_pd(NO_DATA);
+    const __m128d scale = _mm_set1_pd(p.scale);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d lower = _mm_set1_pd(-RGB_SCALED_LIMIT);
+    const __m128d upper = _mm_set1_pd(RGB_SCALED_LIMIT);
+    const __m128i offset = _mm_set1_epi32(p.offset);
+    const __m128i min_q = _mm_setzero_si128();
+    const __m128i max_q = _mm_set1_epi32(RGB_MAX_VALUE);
+    // 各32bitレーン (リトルエンディアンで B, G, R, 0) を R, G, B の3バイトに詰める
+    const __m128i interleave =
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -128, -128, -128, -128);
+
+    auto quantize2 = [&](__m128d h) {
+        __m128d missing = _mm_cmple_pd(h, nodata);
+        __m128d scaled = _mm_mul_pd(h, scale);
+        if (p.use_floor)
+            scaled = _mm_floor_pd(scaled);
+        scaled = _mm_blendv_pd(scaled, zero, missing);
+        scaled = _mm_min_pd(_mm_max_pd(scaled, lower), upper);
+        return _mm_cvttpd_epi32(scaled);  // 下位2レーンのみ
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i q = _mm_unpacklo_epi64(quantize2(load2(heights + i)),
+                                       quantize2(load2(heights + i + 2)));
+        q = _mm_add_epi32(q, offset);
+        q = _mm_min_epi32(_mm_max_epi32(q, min_q), max_q);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), _mm_shuffle_epi8(q, interleave));
+    }
+    return i;
+}
+
+}  // namespace
+
+size_t encode_rgb(const double* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+size_t encode_rgb(const float* heights, size_t count, const EncodingParams& p,
+                  uint8_t* out) noexcept {
+    return encode_rgb_impl(heights, count, p, out);
+}
+
+}  // namespace fgd_converter::kernels::sse42
+
+#endif
@@ -0,0 +1,341 @@
+#include "server.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "converter.hpp"
+#include "simple_json.hpp"
+
+#ifndef _WIN32
+#    include <poll.h>
+#    include <signal.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#endif
+
+namespace fgd_converter {
+
+class ConversionServer::Impl {
+   public:
+    explicit Impl(Config config) : config_(std::move(config)) {}
+
+    Config config_;
+    std::atomic<bool> stop_requested_{false};
+
+#ifndef _WIN32
+    /**
+     * @brief 1接続分の送信チャネル (進捗行の書き込みを直列化)
+     */
+    class Connection {
+       public:
+        explicit Connection(int fd) : fd_(fd) {}
+        ~Connection() { close(fd_); }
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        int fd() const { return fd_; }
+
+        bool send_line(const std::string& line) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::string payload = line + "\n";
+            const char* ptr = payload.data();
+            size_t remaining = payload.size();
+            while (remaining > 0) {
+                ssize_t written = ::send(fd_, ptr, remaining, 0);
+                if (written <= 0)
+                    return false;
+                ptr += written;
+                remaining -= static_cast<size_t>(written);
+            }
+            return true;
+        }
+
+       private:
+        int fd_;
+        std::mutex mutex_;
+    };
+
+    /**
+     * @brief 前回の異常終了で残ったソケットファイルのみを削除
+     *
+     * ソケット以外のファイルや、接続を受け付けるソケット (稼働中のデーモン) は削除せず失敗する。
+     */
+    static bool remove_stale_socket(const sockaddr_un& addr, std::error_code& ec) {
+        struct stat st{};
+        if (::lstat(addr.sun_path, &st) < 0) {
+            if (errno == ENOENT)
+                return true;
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+        if (!S_ISSOCK(st.st_mode)) {
+            ec = std::make_error_code(std::errc::file_exists);
+            return false;
+        }
+
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) {
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+        const int rc = ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+        const int connect_errno = errno;
+        ::close(probe);
+        if (rc == 0) {
+            ec = std::make_error_code(std::errc::address_in_use);
+            return false;
+        }
+        if (connect_errno != ECONNREFUSED) {
+            ec = std::error_code(connect_errno, std::generic_category());
+            return false;
+        }
+
+        if (::unlink(addr.sun_path) < 0 && errno != ENOENT) {
+            ec = std::error_code(errno, std::generic_category());
+            return false;
+        }
+        return true;
+    }
+
+    static std::string event_line(const std::string& id, std::string_view event,
+                                  std::string_view extra = {}) {
+        std::stringstream ss;
+        ss << "{\"id\":" << json::quote(id) << ",\"event\":" << json::quote(event);
+        if (!extra.empty()) {
+            ss << "," << extra;
+        }
+        ss << "}";
+        return ss.str();
+    }
+
+    /**
+     * @brief 1ジョブを実行し、進捗と結果を接続へストリーミング
+     */
+    void handle_job(Connection& conn, const json::Object& job) {
+        std::string id = json::get_string(job, "id").value_or("");
+
+        auto input = json::get_string(job, "input");
+        if (!input) {
+            conn.send_line(event_line(id, "error", "\"message\":\"input is required\""));
+            return;
+        }
+
+        Converter::Config config{
+            .import_path = *input,
+            .output_path = json::get_string(job, "output")
+                               .value_or(config_.default_output_path.string()),
+            .output_epsg = json::get_string(job, "epsg").value_or(config_.default_epsg),
+            .output_format = parse_output_format(json::get_string(job, "format").value_or(""))
+                                 .value_or(OutputFormat::GeoTiff),
+            .file_name = json::get_string(job, "file_name"),
+            .rgbify = json::get_bool(job, "rgbify").value_or(false),
+            .rgb_encoding = parse_rgb_encoding(json::get_string(job, "rgb_encoding").value_or(""))
+                                .value_or(RgbEncoding::Mapbox),
+            .sea_at_zero = json::get_bool(job, "sea_at_zero").value_or(true),
+            .terrain = {.slope = json::get_bool(job, "slope").value_or(false),
+                        .aspect = json::get_bool(job, "aspect").value_or(false),
+                        .hillshade = json::get_bool(job, "hillshade").value_or(false)},
+            .surface_class = json::get_bool(job, "surface_class").value_or(false),
+            .mesh_cache = config_.mesh_cache,
+            .entries = std::nullopt,
+            .on_progress =
+                [&conn, &id](std::string_view stage) {
+                    conn.send_line(event_line(id, "progress",
+                                              "\"stage\":" + json::quote(stage)));
+                }};
+
+        conn.send_line(event_line(id, "accepted"));
+        auto started = std::chrono::steady_clock::now();
+
+        try {
+            Converter converter(std::move(config));
+            std::error_code ec;
+            if (!converter.run(ec)) {
+                conn.send_line(
+                    event_line(id, "error", "\"message\":" + json::quote(ec.message())));
+                return;
+            }
+
+            double elapsed_ms = std::chrono::duration<double, std::milli>(
+                                    std::chrono::steady_clock::now() - started)
+                                    .count();
+            std::stringstream extra;
+            extra << "\"output\":" << json::quote(converter.output_file().string())
+                  << ",\"elapsed_ms\":" << elapsed_ms;
+            conn.send_line(event_line(id, "done", extra.str()));
+        } catch (const std::exception& e) {
+            conn.send_line(event_line(id, "error", "\"message\":" + json::quote(e.what())));
+        }
+    }
+
+    /**
+     * @brief 接続ごとの受信ループ (改行区切りでジョブを逐次処理)
+     */
+    void serve_connection(int fd) {
+        Connection conn(fd);
+        std::string pending;
+        char buffer[4096];
+
+        while (!stop_requested_.load(std::memory_order_relaxed)) {
+            pollfd pfd{conn.fd(), POLLIN, 0};
+            int ready = ::poll(&pfd, 1, 200);
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            if (ready == 0)
+                continue;
+
+            ssize_t n = ::recv(conn.fd(), buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            pending.append(buffer, static_cast<size_t>(n));
+
+            size_t newline;
+            while ((newline = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                if (line.find_first_not_of(" \t\r") == std::string::npos)
+                    continue;
+
+                auto job = json::parse_flat_object(line);
+                if (!job) {
+                    conn.send_line("{\"event\":\"error\",\"message\":\"invalid JSON\"}");
+                    continue;
+                }
+
+                if (auto command = json::get_string(*job, "command")) {
+                    if (*command == "ping") {
+                        conn.send_line("{\"event\":\"pong\"}");
+                    } else if (*command == "shutdown") {
+                        conn.send_line("{\"event\":\"shutdown\"}");
+                        stop_requested_.store(true, std::memory_order_relaxed);
+                        return;
+                    } else {
+                        conn.send_line("{\"event\":\"error\",\"message\":\"unknown command\"}");
+                    }
+                    continue;
+                }
+
+                handle_job(conn, *job);
+            }
+        }
+    }
+#endif
+};
+
+ConversionServer::ConversionServer(Config config)
+    : pImpl(std::make_unique<Impl>(std::move(config))) {}
+
+ConversionServer::~ConversionServer() = default;
+
+void ConversionServer::stop() noexcept { pImpl->stop_requested_.store(true); }
+
+bool ConversionServer::run(std::error_code& ec) {
+#ifdef _WIN32
+    std::cerr << "常駐モードはこのプラットフォームでは未対応です\n";
+    ec = std::make_error_code(std::errc::operation_not_supported);
+    return false;
+#else
+    const std::string socket_path = pImpl->config_.socket_path.string();
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        ec = std::make_error_code(std::errc::filename_too_long);
+        return false;
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    // クライアント切断時のSIGPIPEでプロセスが終了しないようにする
+    ::signal(SIGPIPE, SIG_IGN);
+
+    // 前回の異常終了で残ったソケットファイルのみ削除 (通常のファイルや稼働中のデーモンは残す)
+    if (!Impl::remove_stale_socket(addr, ec)) {
+        std::cerr << "ソケットを作成できません: " << socket_path << " (" << ec.message() << ")\n";
+        return false;
+    }
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        ec = std::error_code(errno, std::generic_category());
+        return false;
+    }
+
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd, 16) < 0) {
+        ec = std::error_code(errno, std::generic_category());
+        ::close(listen_fd);
+        return false;
+    }
+
+    std::cout << "常駐モード: " << socket_path << " で待機中\n";
+
+    // 接続ごとのスレッド (終了したものは待機ループで回収する)
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+    std::vector<Worker> workers;
+    auto reap_finished = [&workers] {
+        std::erase_if(workers, [](Worker& worker) {
+            if (!worker.finished->load(std::memory_order_acquire))
+                return false;
+            worker.thread.join();
+            return true;
+        });
+    };
+
+    while (!pImpl->stop_requested_.load(std::memory_order_relaxed)) {
+        reap_finished();
+
+        pollfd pfd{listen_fd, POLLIN, 0};
+        int ready = ::poll(&pfd, 1, 200);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            ec = std::error_code(errno, std::generic_category());
+            break;
+        }
+        if (ready == 0)
+            continue;
+
+        int client_fd = ::accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0)
+            continue;
+
+        // 接続ごとにスレッドを割り当て、変換自体は共有のTBBプールで並列化される
+        auto finished = std::make_shared<std::atomic<bool>>(false);
+        std::thread thread([this, client_fd, finished] {
+            pImpl->serve_connection(client_fd);
+            finished->store(true, std::memory_order_release);
+        });
+        workers.push_back({.thread = std::move(thread), .finished = std::move(finished)});
+    }
+
+    for (auto& worker : workers) {
+        worker.thread.join();
+    }
+
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+    std::cout << "常駐モードを終了しました\n";
+    return !ec;
+#endif
+}
+
+}  // namespace fgd_converter
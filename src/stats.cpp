@@ -0,0 +1,416 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "simple_json.hpp"
+#include "trace.hpp"
+
+namespace fgd_converter::stats {
+
+namespace {
+
+void update_peak(std::atomic<int64_t>& peak, int64_t value) noexcept {
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current &&
+           !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief 段階・カウンター・バッファ確保量の加算先 (全体用とアーカイブ用で共通)
+ */
+struct Accumulator {
+    std::array<std::atomic<uint64_t>, STAGE_COUNT> stage_ns{};
+    std::array<std::atomic<uint64_t>, STAGE_COUNT> stage_calls{};
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+    std::array<std::atomic<int64_t>, MEMORY_COUNT> memory_current{};
+    std::array<std::atomic<int64_t>, MEMORY_COUNT> memory_peak{};
+    std::atomic<int64_t> memory_total{0};
+    std::atomic<int64_t> memory_total_peak{0};
+
+    void record_stage(size_t index, uint64_t ns) noexcept {
+        stage_ns[index].fetch_add(ns, std::memory_order_relaxed);
+        stage_calls[index].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void charge(size_t index, int64_t delta) noexcept {
+        const int64_t current =
+            memory_current[index].fetch_add(delta, std::memory_order_relaxed) + delta;
+        const int64_t total = memory_total.fetch_add(delta, std::memory_order_relaxed) + delta;
+        if (delta > 0) {
+            update_peak(memory_peak[index], current);
+            update_peak(memory_total_peak, total);
+        }
+    }
+
+    [[nodiscard]] auto load() const noexcept -> Totals {
+        Totals totals;
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            totals.stage_ns[i] = stage_ns[i].load(std::memory_order_relaxed);
+            totals.stage_calls[i] = stage_calls[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            totals.counters[i] = counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < MEMORY_COUNT; ++i) {
+            totals.memory_peak[i] =
+                static_cast<uint64_t>(memory_peak[i].load(std::memory_order_relaxed));
+        }
+        totals.memory_peak_total =
+            static_cast<uint64_t>(memory_total_peak.load(std::memory_order_relaxed));
+        return totals;
+    }
+
+    void clear() noexcept {
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            stage_ns[i].store(0, std::memory_order_relaxed);
+            stage_calls[i].store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        // 計上中のバッファは残るため、最大値は現在値から数え直す
+        for (size_t i = 0; i < MEMORY_COUNT; ++i) {
+            memory_peak[i].store(memory_current[i].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        }
+        memory_total_peak.store(memory_total.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+    }
+};
+
+}  // namespace
+
+struct ArchiveRecord {
+    explicit ArchiveRecord(std::string_view archive_name) : name(archive_name) {}
+
+    std::string name;
+    Accumulator accumulator;
+    std::atomic<uint64_t> wall_ns{0};
+    std::atomic<uint64_t> rss_bytes{0};
+};
+
+namespace {
+
+struct Registry {
+    Accumulator global;
+    std::atomic<uint64_t> start_ns{0};
+    std::mutex mutex;                    // archives への追加・列挙を保護
+    std::deque<ArchiveRecord> archives;  // 要素のアドレスを固定するためdeque
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local ArchiveRecord* t_archive = nullptr;
+
+constexpr std::array<std::string_view, STAGE_COUNT> STAGE_NAMES = {
+    "unzip", "read_xml", "parse", "placement", "combine", "encode", "resample"};
+
+constexpr std::array<std::string_view, COUNTER_COUNT> COUNTER_NAMES = {
+    "zip_entries",   "bytes_inflated",  "xml_files",         "xml_bytes",
+    "values_parsed", "meshes_placed",   "tiles_encoded",     "proj_calls",
+    "bytes_written", "mesh_cache_hits", "mesh_cache_misses", "superseded"};
+
+constexpr std::array<std::string_view, MEMORY_COUNT> MEMORY_NAMES = {
+    "xml_buffers",  "elevation_list",  "mesh_grids",   "mosaic",
+    "geotiff_copy", "resample_source", "resample_dest"};
+
+std::string format_ms(uint64_t ns) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << static_cast<double>(ns) / 1e6 << " ms";
+    return ss.str();
+}
+
+std::string format_mib(uint64_t bytes) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << static_cast<double>(bytes) / (1024.0 * 1024.0)
+       << " MiB";
+    return ss.str();
+}
+
+uint64_t current_rss() {
+    auto memory = process_memory();
+    return memory ? memory->rss_bytes : 0;
+}
+
+void write_totals_json(std::ostream& out, const Totals& totals, std::string_view indent) {
+    out << "{\n" << indent << "  \"stages\": {";
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        out << (i ? ", " : "") << json::quote(STAGE_NAMES[i]) << ": {\"ns\": " << totals.stage_ns[i]
+            << ", \"calls\": " << totals.stage_calls[i] << "}";
+    }
+    out << "},\n" << indent << "  \"counters\": {";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        out << (i ? ", " : "") << json::quote(COUNTER_NAMES[i]) << ": " << totals.counters[i];
+    }
+    out << "},\n" << indent << "  \"memory_peak\": {";
+    for (size_t i = 0; i < MEMORY_COUNT; ++i) {
+        out << (i ? ", " : "") << json::quote(MEMORY_NAMES[i]) << ": " << totals.memory_peak[i];
+    }
+    out << ", \"total\": " << totals.memory_peak_total << "}\n" << indent << "}";
+}
+
+}  // namespace
+
+auto stage_name(Stage stage) noexcept -> std::string_view {
+    const auto index = static_cast<size_t>(stage);
+    return index < STAGE_COUNT ? STAGE_NAMES[index] : "unknown";
+}
+
+auto counter_name(Counter counter) noexcept -> std::string_view {
+    const auto index = static_cast<size_t>(counter);
+    return index < COUNTER_COUNT ? COUNTER_NAMES[index] : "unknown";
+}
+
+auto memory_name(Memory memory) noexcept -> std::string_view {
+    const auto index = static_cast<size_t>(memory);
+    return index < MEMORY_COUNT ? MEMORY_NAMES[index] : "unknown";
+}
+
+namespace detail {
+
+void set_flag(uint32_t flag, bool value) noexcept {
+    if (value) {
+        g_flags.fetch_or(flag, std::memory_order_relaxed);
+    } else {
+        g_flags.fetch_and(~flag, std::memory_order_relaxed);
+    }
+}
+
+void finish_stage(Stage stage, uint64_t start_ns, uint64_t end_ns) noexcept {
+    const uint32_t active = flags();
+    const auto index = static_cast<size_t>(stage);
+    if (active & FLAG_STATS) {
+        registry().global.record_stage(index, end_ns - start_ns);
+        if (t_archive) {
+            t_archive->accumulator.record_stage(index, end_ns - start_ns);
+        }
+    }
+    if (active & FLAG_TRACE) {
+        trace::detail::add_span(STAGE_NAMES[index], "stage", {}, start_ns, end_ns);
+    }
+}
+
+void add_counter(Counter counter, uint64_t value) noexcept {
+    const auto index = static_cast<size_t>(counter);
+    registry().global.counters[index].fetch_add(value, std::memory_order_relaxed);
+    if (t_archive) {
+        t_archive->accumulator.counters[index].fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+void charge_memory(Memory memory, ArchiveRecord* archive, int64_t delta) noexcept {
+    const auto index = static_cast<size_t>(memory);
+    registry().global.charge(index, delta);
+    if (archive) {
+        archive->accumulator.charge(index, delta);
+    }
+}
+
+}  // namespace detail
+
+void set_enabled(bool value) noexcept {
+    if (value) {
+        registry().start_ns.store(detail::now_ns(), std::memory_order_relaxed);
+    }
+    detail::set_flag(detail::FLAG_STATS, value);
+}
+
+void reset() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.global.clear();
+    reg.archives.clear();
+    reg.start_ns.store(detail::now_ns(), std::memory_order_relaxed);
+}
+
+auto current_archive() noexcept -> ArchiveRecord* { return t_archive; }
+
+auto archive_name(const ArchiveRecord* record) noexcept -> std::string_view {
+    return record ? std::string_view(record->name) : std::string_view();
+}
+
+ArchiveScope::ArchiveScope(std::string_view name) {
+    if (detail::flags() == 0)
+        return;
+    auto& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        record_ = &reg.archives.emplace_back(name);
+    }
+    previous_ = t_archive;
+    t_archive = record_;
+    start_ = detail::now_ns();
+}
+
+ArchiveScope::~ArchiveScope() {
+    if (!record_)
+        return;
+    const uint64_t end = detail::now_ns();
+    record_->wall_ns.store(end - start_, std::memory_order_relaxed);
+    if (enabled()) {
+        try {
+            record_->rss_bytes.store(current_rss(), std::memory_order_relaxed);
+        } catch (...) {
+            // 常駐メモリが取得できなくても集計は続ける
+        }
+    }
+    if (trace::enabled()) {
+        trace::detail::add_span(record_->name, "archive", {}, start_, end);
+    }
+    t_archive = previous_;
+}
+
+ArchiveBinding::ArchiveBinding(ArchiveRecord* record) noexcept : previous_(t_archive) {
+    t_archive = record;
+}
+
+ArchiveBinding::~ArchiveBinding() { t_archive = previous_; }
+
+auto process_memory() -> std::optional<ProcessMemory> {
+#if defined(__linux__)
+    // VmRSS / VmHWM は "VmRSS:     1234 kB" の形式
+    std::ifstream status("/proc/self/status");
+    if (!status)
+        return std::nullopt;
+    ProcessMemory memory;
+    bool found = false;
+    std::string line;
+    while (std::getline(status, line)) {
+        uint64_t* target = nullptr;
+        if (line.starts_with("VmRSS:")) {
+            target = &memory.rss_bytes;
+        } else if (line.starts_with("VmHWM:")) {
+            target = &memory.peak_rss_bytes;
+        } else {
+            continue;
+        }
+        *target = std::stoull(line.substr(6)) * 1024;
+        found = true;
+    }
+    if (!found)
+        return std::nullopt;
+    return memory;
+#elif defined(__unix__) || defined(__APPLE__)
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return std::nullopt;
+#if defined(__APPLE__)
+    const auto peak = static_cast<uint64_t>(usage.ru_maxrss);  // バイト単位
+#else
+    const auto peak = static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // KiB単位
+#endif
+    return ProcessMemory{.rss_bytes = 0, .peak_rss_bytes = peak};
+#else
+    return std::nullopt;
+#endif
+}
+
+auto snapshot() -> Report {
+    auto& reg = registry();
+    Report report;
+    const uint64_t start = reg.start_ns.load(std::memory_order_relaxed);
+    report.wall_ns = start ? detail::now_ns() - start : 0;
+    report.process = process_memory().value_or(ProcessMemory{});
+    report.global = reg.global.load();
+
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    report.archives.reserve(reg.archives.size());
+    for (const auto& archive : reg.archives) {
+        report.archives.push_back({.name = archive.name,
+                                   .wall_ns = archive.wall_ns.load(std::memory_order_relaxed),
+                                   .rss_bytes = archive.rss_bytes.load(std::memory_order_relaxed),
+                                   .totals = archive.accumulator.load()});
+    }
+    return report;
+}
+
+void write_text(std::ostream& out, const Report& report) {
+    const auto& g = report.global;
+    out << "=== 処理統計 (経過時間 " << format_ms(report.wall_ns) << ") ===\n";
+    out << std::left << std::setw(12) << "stage" << std::right << std::setw(16) << "time"
+        << std::setw(12) << "calls" << "\n";
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+        if (g.stage_calls[i] == 0)
+            continue;
+        out << std::left << std::setw(12) << STAGE_NAMES[i] << std::right << std::setw(16)
+            << format_ms(g.stage_ns[i]) << std::setw(12) << g.stage_calls[i] << "\n";
+    }
+    out << "(段階の時間は全スレッドの合計)\n";
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        out << std::left << std::setw(16) << COUNTER_NAMES[i] << std::right << std::setw(16)
+            << g.counters[i] << "\n";
+    }
+    out << "memory peak (同時に確保していた量の最大値)\n";
+    for (size_t i = 0; i < MEMORY_COUNT; ++i) {
+        if (g.memory_peak[i] == 0)
+            continue;
+        out << "  " << std::left << std::setw(16) << MEMORY_NAMES[i] << std::right
+            << std::setw(14) << format_mib(g.memory_peak[i]) << "\n";
+    }
+    out << "  " << std::left << std::setw(16) << "total" << std::right << std::setw(14)
+        << format_mib(g.memory_peak_total) << "\n";
+    if (report.process.peak_rss_bytes != 0) {
+        out << "process rss " << format_mib(report.process.rss_bytes) << ", peak "
+            << format_mib(report.process.peak_rss_bytes) << "\n";
+    }
+
+    if (report.archives.empty())
+        return;
+
+    // 遅いアーカイブの特定用に経過時間の長い順で出力
+    std::vector<const ArchiveReport*> order;
+    for (const auto& archive : report.archives) {
+        order.push_back(&archive);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto* a, const auto* b) { return a->wall_ns > b->wall_ns; });
+
+    out << "--- アーカイブ別 (" << report.archives.size() << " 件、経過時間の長い順) ---\n";
+    for (const auto* archive : order) {
+        const auto& t = archive->totals;
+        out << archive->name << ": " << format_ms(archive->wall_ns);
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            if (t.stage_calls[i] != 0)
+                out << ", " << STAGE_NAMES[i] << " " << format_ms(t.stage_ns[i]);
+        }
+        out << ", values "
+            << t.counters[static_cast<size_t>(Counter::ValuesParsed)] << ", written "
+            << t.counters[static_cast<size_t>(Counter::BytesWritten)] << " B, memory peak "
+            << format_mib(t.memory_peak_total);
+        if (archive->rss_bytes != 0)
+            out << ", rss " << format_mib(archive->rss_bytes);
+        out << "\n";
+    }
+}
+
+void write_json(std::ostream& out, const Report& report) {
+    out << "{\n  \"wall_ns\": " << report.wall_ns << ",\n  \"process\": {\"rss_bytes\": "
+        << report.process.rss_bytes << ", \"peak_rss_bytes\": " << report.process.peak_rss_bytes
+        << "},\n  \"global\": ";
+    write_totals_json(out, report.global, "  ");
+    out << ",\n  \"archives\": [";
+    for (size_t i = 0; i < report.archives.size(); ++i) {
+        const auto& archive = report.archives[i];
+        out << (i ? "," : "") << "\n    {\"name\": " << json::quote(archive.name)
+            << ", \"wall_ns\": " << archive.wall_ns << ", \"rss_bytes\": " << archive.rss_bytes
+            << ", \"totals\": ";
+        write_totals_json(out, archive.totals, "    ");
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}  // namespace fgd_converter::stats
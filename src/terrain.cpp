@@ -0,0 +1,251 @@
+#include "terrain.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+
+#include "cpu_features.hpp"
+#include "kernel_variants.hpp"
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double RAD_TO_DEG = 180.0 / PI;
+constexpr double NO_DATA = -9999.0;
+
+// 緯度1度・経度1度 (赤道上) あたりの距離 (メートル)
+constexpr double METERS_PER_DEG_LAT = 110574.0;
+constexpr double METERS_PER_DEG_LNG = 111320.0;
+
+// 並列化の行バンド単位
+constexpr size_t ROW_GRAIN = 32;
+
+using kernels::Illumination;
+
+/**
+ * @brief 陰影起伏の光源パラメータを事前計算
+ */
+Illumination make_illumination(const TerrainConfig& config) {
+    double zenith = (90.0 - config.altitude) / RAD_TO_DEG;
+    // 地理方位 (北から時計回り) を数学的角度 (東から反時計回り) へ変換
+    double azimuth = std::fmod(360.0 - config.azimuth + 90.0, 360.0) / RAD_TO_DEG;
+    return {.cos_zenith = std::cos(zenith),
+            .sin_zenith = std::sin(zenith),
+            .cos_azimuth = std::cos(azimuth),
+            .sin_azimuth = std::sin(azimuth)};
+}
+
+/**
+ * @brief Horn法による1ピクセルの勾配 (近傍にデータなしを含む場合はfalse)
+ */
+inline bool horn_gradient(const double* up, const double* mid, const double* down, int xl, int x,
+                          int xr, double inv_8dx, double inv_8dy, double& gx, double& gy) {
+    double a = up[xl], b = up[x], c = up[xr];
+    double d = mid[xl], e = mid[x], f = mid[xr];
+    double g = down[xl], h = down[x], i = down[xr];
+    if (a == NO_DATA || b == NO_DATA || c == NO_DATA || d == NO_DATA || e == NO_DATA ||
+        f == NO_DATA || g == NO_DATA || h == NO_DATA || i == NO_DATA) {
+        return false;
+    }
+    gx = ((c + 2.0 * f + i) - (a + 2.0 * d + g)) * inv_8dx;
+    gy = ((g + 2.0 * h + i) - (a + 2.0 * b + c)) * inv_8dy;
+    return true;
+}
+
+/**
+ * @brief 勾配から陰影起伏を計算
+ *
+ * cos(傾斜)=1/√(1+p²), sin(傾斜)=p/√(1+p²) と方位の余弦・正弦を勾配成分で表し、
+ * 三角関数を使わずに求める (SIMD版と同じ式)。
+ */
+inline double shade(double gx, double gy, const Illumination& light) {
+    double p2 = gx * gx + gy * gy;
+    double num = light.cos_zenith +
+                 light.sin_zenith * (light.sin_azimuth * gy - light.cos_azimuth * gx);
+    return std::max(0.0, 255.0 * num / std::sqrt(1.0 + p2));
+}
+
+inline double slope_degrees(double gx, double gy) {
+    return std::atan(std::sqrt(gx * gx + gy * gy)) * RAD_TO_DEG;
+}
+
+inline double aspect_degrees(double gx, double gy) {
+    if (gx == 0.0 && gy == 0.0)
+        return -1.0;  // 平坦
+    double a = std::atan2(gy, -gx) * RAD_TO_DEG;
+    double aspect = a < 0.0 ? 90.0 - a : (a > 90.0 ? 450.0 - a : 90.0 - a);
+    return aspect >= 360.0 ? aspect - 360.0 : aspect;
+}
+
+/**
+ * @brief 1行の [x_begin, x_end) の勾配を計算 (valid[x]==0はデータなし)
+ */
+void row_gradients(const double* up, const double* mid, const double* down, int width,
+                   int x_begin, int x_end, double inv_8dx, double inv_8dy, double* gx, double* gy,
+                   uint8_t* valid) {
+    int x = x_begin;
+
+    // 左端 (端の値を複製)
+    auto scalar_at = [&](int col) {
+        int xl = std::max(col - 1, 0);
+        int xr = std::min(col + 1, width - 1);
+        valid[col] = horn_gradient(up, mid, down, xl, col, xr, inv_8dx, inv_8dy, gx[col], gy[col])
+                         ? 1
+                         : 0;
+    };
+
+    if (x == 0 && x < x_end) {
+        scalar_at(0);
+        x = 1;
+    }
+
+#if FGD_DEM_X86_KERNELS
+    if (cpu::active() >= cpu::Level::Avx2) {
+        // カーネルは右隣 (x+1) が範囲内かつ右端より手前の内部ピクセルだけを処理する
+        const int limit = std::min(x_end, width - 1) + 1;
+        x = kernels::avx2::row_gradients(up, mid, down, x, limit, inv_8dx, inv_8dy, gx, gy,
+                                         valid);
+    }
+#endif
+
+    // 残りと右端
+    for (; x < x_end; ++x) {
+        scalar_at(x);
+    }
+}
+
+/**
+ * @brief マスク行のワードkのうち、左右の近傍 (画像端は自身) も有効なピクセルのビット
+ */
+uint64_t horizontal_neighbours(std::span<const uint64_t> bits, int k, int width) {
+    const int last = static_cast<int>(bits.size()) - 1;
+    const uint64_t w = bits[k];
+    uint64_t left = (w << 1) | (k > 0 ? bits[k - 1] >> 63 : w & 1);
+    uint64_t right = (w >> 1) | (k < last ? bits[k + 1] << 63 : 0);
+    if (k == last)
+        right |= w & (uint64_t{1} << ((width - 1) % ValidityMask::WORD_BITS));
+    return w & left & right;
+}
+
+/**
+ * @brief 1行分の陰影起伏を計算 (データなしの画素は書き換えない)
+ */
+void row_hillshade(const double* gx, const double* gy, const uint8_t* valid, int width,
+                   const Illumination& light, float* out) {
+    int x = 0;
+#if FGD_DEM_X86_KERNELS
+    if (cpu::active() >= cpu::Level::Avx2) {
+        x = kernels::avx2::row_hillshade(gx, gy, valid, width, light, out);
+    }
+#endif
+    for (; x < width; ++x) {
+        if (valid[x])
+            out[x] = static_cast<float>(shade(gx[x], gy[x], light));
+    }
+}
+
+}  // namespace
+
+auto compute_terrain(const std::vector<std::vector<double>>& elevation, int width, int height,
+                     const std::array<double, 6>& geo_transform,
+                     const TerrainConfig& config, const ValidityMask* valid_mask) -> TerrainBands {
+    TerrainBands bands;
+    if (!config.any() || width <= 0 || height <= 0)
+        return bands;
+
+    // 寸法が一致しないマスクは使わない
+    if (valid_mask != nullptr &&
+        (valid_mask->width() != width || valid_mask->height() != height)) {
+        valid_mask = nullptr;
+    }
+
+    const size_t total = static_cast<size_t>(width) * height;
+    if (config.slope)
+        bands.slope.assign(total, TerrainBands::NO_DATA);
+    if (config.aspect)
+        bands.aspect.assign(total, TerrainBands::NO_DATA);
+    if (config.hillshade)
+        bands.hillshade.assign(total, TerrainBands::NO_DATA);
+
+    const Illumination light = make_illumination(config);
+    const double pixel_lng = std::abs(geo_transform[1]);
+    const double pixel_lat = std::abs(geo_transform[5]);
+    const double dy = pixel_lat * METERS_PER_DEG_LAT;
+
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, height, ROW_GRAIN), [&](const tbb::blocked_range<int>& range) {
+            std::vector<double> gx(width);
+            std::vector<double> gy(width);
+            std::vector<uint8_t> valid(width);
+
+            for (int row = range.begin(); row != range.end(); ++row) {
+                // 行中心の緯度で経度方向のピクセル間隔を補正
+                double lat = geo_transform[3] + (row + 0.5) * geo_transform[5];
+                double dx = pixel_lng * METERS_PER_DEG_LNG * std::cos(lat / RAD_TO_DEG);
+                double inv_8dx = config.z_factor / (8.0 * dx);
+                double inv_8dy = config.z_factor / (8.0 * dy);
+
+                // ハロー行 (画像端は端の行を複製)
+                const double* up = elevation[std::max(row - 1, 0)].data();
+                const double* mid = elevation[row].data();
+                const double* down = elevation[std::min(row + 1, height - 1)].data();
+
+                if (valid_mask == nullptr) {
+                    row_gradients(up, mid, down, width, 0, width, inv_8dx, inv_8dy, gx.data(),
+                                  gy.data(), valid.data());
+                } else {
+                    // 3×3近傍がすべて有効なピクセルを64ピクセル単位で求め、0のワードは計算しない
+                    const auto bits_up = valid_mask->row(std::max(row - 1, 0));
+                    const auto bits_mid = valid_mask->row(row);
+                    const auto bits_down = valid_mask->row(std::min(row + 1, height - 1));
+                    for (int k = 0; k < valid_mask->words_per_row(); ++k) {
+                        const int x_begin = k * ValidityMask::WORD_BITS;
+                        const int x_end = std::min(x_begin + ValidityMask::WORD_BITS, width);
+                        const uint64_t bits = horizontal_neighbours(bits_up, k, width) &
+                                              horizontal_neighbours(bits_mid, k, width) &
+                                              horizontal_neighbours(bits_down, k, width);
+                        if (bits == 0) {
+                            std::fill(valid.begin() + x_begin, valid.begin() + x_end, 0);
+                            continue;
+                        }
+                        row_gradients(up, mid, down, width, x_begin, x_end, inv_8dx, inv_8dy,
+                                      gx.data(), gy.data(), valid.data());
+                        for (int x = x_begin; x < x_end; ++x) {
+                            valid[x] &= static_cast<uint8_t>((bits >> (x - x_begin)) & 1);
+                        }
+                    }
+                }
+
+                const size_t offset = static_cast<size_t>(row) * width;
+
+                if (config.hillshade) {
+                    row_hillshade(gx.data(), gy.data(), valid.data(), width, light,
+                                  bands.hillshade.data() + offset);
+                }
+
+                // 傾斜・方位は逆三角関数を含むためスカラーで計算
+                if (config.slope || config.aspect) {
+                    for (int x = 0; x < width; ++x) {
+                        if (!valid[x])
+                            continue;
+                        if (config.slope)
+                            bands.slope[offset + x] =
+                                static_cast<float>(slope_degrees(gx[x], gy[x]));
+                        if (config.aspect)
+                            bands.aspect[offset + x] =
+                                static_cast<float>(aspect_degrees(gx[x], gy[x]));
+                    }
+                }
+            }
+        });
+
+    return bands;
+}
+
+}  // namespace fgd_converter
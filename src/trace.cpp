@@ -0,0 +1,142 @@
+#include "trace.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include "simple_json.hpp"
+
+namespace fgd_converter::trace {
+
+namespace {
+
+struct Event {
+    std::string_view name;
+    std::string_view category;
+    std::string_view archive;
+    std::string detail;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+/**
+ * @brief スレッドごとのスパンのバッファ (所有スレッドのみが追加する)
+ */
+struct ThreadBuffer {
+    uint32_t tid;
+    std::vector<Event> events;
+};
+
+struct Registry {
+    std::atomic<uint64_t> origin_ns{0};
+    std::mutex mutex;                  // buffers への追加・列挙を保護
+    std::deque<ThreadBuffer> buffers;  // 要素のアドレスを固定するためdeque
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+ThreadBuffer& local_buffer() {
+    if (!t_buffer) {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        auto tid = static_cast<uint32_t>(reg.buffers.size() + 1);
+        t_buffer = &reg.buffers.emplace_back(ThreadBuffer{.tid = tid, .events = {}});
+    }
+    return *t_buffer;
+}
+
+// Chrome traceの時刻はマイクロ秒
+std::string format_us(uint64_t ns) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(ns) / 1000.0);
+    return buffer;
+}
+
+}  // namespace
+
+void start() {
+    registry().origin_ns.store(stats::detail::now_ns(), std::memory_order_relaxed);
+    local_buffer();  // 呼び出したスレッドを tid 1 ("main") にする
+    stats::detail::set_flag(stats::detail::FLAG_TRACE, true);
+}
+
+void stop() noexcept { stats::detail::set_flag(stats::detail::FLAG_TRACE, false); }
+
+namespace detail {
+
+void add_span(std::string_view name, std::string_view category, std::string_view detail,
+              uint64_t start_ns, uint64_t end_ns) noexcept {
+    try {
+        local_buffer().events.push_back(
+            Event{.name = name,
+                  .category = category,
+                  .archive = stats::archive_name(stats::current_archive()),
+                  .detail = std::string(detail),
+                  .start_ns = start_ns,
+                  .end_ns = end_ns});
+    } catch (...) {
+        // メモリ不足時はスパンを捨てる (計測のために処理を止めない)
+    }
+}
+
+}  // namespace detail
+
+void write_json(std::ostream& out) {
+    auto& reg = registry();
+    const uint64_t origin = reg.origin_ns.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto& buffer : reg.buffers) {
+        // スレッド名のメタデータ
+        out << (first ? "" : ",") << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            << "\"tid\": " << buffer.tid << ", \"args\": {\"name\": \""
+            << (buffer.tid == 1 ? std::string("main") : "worker " + std::to_string(buffer.tid))
+            << "\"}}";
+        first = false;
+
+        for (const auto& event : buffer.events) {
+            const uint64_t start = event.start_ns > origin ? event.start_ns - origin : 0;
+            out << ",\n{\"name\": " << json::quote(event.name)
+                << ", \"cat\": " << json::quote(event.category)
+                << ", \"ph\": \"X\", \"ts\": " << format_us(start)
+                << ", \"dur\": " << format_us(event.end_ns - event.start_ns)
+                << ", \"pid\": 1, \"tid\": " << buffer.tid << ", \"args\": {";
+            bool has_arg = false;
+            if (!event.archive.empty()) {
+                out << "\"archive\": " << json::quote(event.archive);
+                has_arg = true;
+            }
+            if (!event.detail.empty()) {
+                out << (has_arg ? ", " : "") << "\"detail\": " << json::quote(event.detail);
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool write_file(const std::filesystem::path& path, std::error_code& ec) {
+    std::ofstream file(path);
+    if (!file) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    write_json(file);
+    if (!file) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace fgd_converter::trace
@@ -3,16 +3,20 @@
 #include <filesystem>
 
 #include "fast_fgd_parser.hpp"
+#include "stats.hpp"
 
 namespace fgd_converter::xml {
 
 class XmlParser::Impl {
    public:
-    explicit Impl(std::string_view xml_content) {
+    Impl(std::string_view xml_content, bool sea_at_zero, bool surface_classes)
+        : with_classes(surface_classes) {
         // 超高速1パスパーサーを使用
-        auto parsed = FastFGDParser::parse_all(xml_content, true);
+        auto parsed = FastFGDParser::parse_all(xml_content, sea_at_zero, surface_classes);
         if (parsed) {
             data = *parsed;
+            elevation_charge.assign(stats::Memory::ElevationList,
+                                    stats::bytes_of(data.elevation_list));
         } else {
             // パースに失敗した場合は例外をスロー
             throw std::runtime_error("XMLコンテンツの解析に失敗しました");
@@ -20,9 +24,12 @@ class XmlParser::Impl {
     }
 
     FastFGDParser::ParsedData data;
+    bool with_classes;
+    stats::MemoryCharge elevation_charge;  // data.elevation_list の確保量 (--stats)
 };
 
-XmlParser::XmlParser(std::string_view xml_content) : pImpl(std::make_unique<Impl>(xml_content)) {}
+XmlParser::XmlParser(std::string_view xml_content, bool sea_at_zero, bool surface_classes)
+    : pImpl(std::make_unique<Impl>(xml_content, sea_at_zero, surface_classes)) {}
 
 XmlParser::~XmlParser() = default;
 XmlParser::XmlParser(XmlParser &&) noexcept = default;
@@ -81,6 +88,13 @@ auto XmlParser::get_dem_type() const -> std::optional<std::string> {
     return std::nullopt;
 }
 
+auto XmlParser::get_surface_classes() const -> std::optional<std::vector<uint8_t>> {
+    if (pImpl->with_classes && pImpl->data.has_tuple_list) {
+        return pImpl->data.surface_classes;
+    }
+    return std::nullopt;
+}
+
 auto XmlParser::extract_file_name(std::string_view xml_path) -> std::string {
     std::filesystem::path path(xml_path);
     return path.stem().string();
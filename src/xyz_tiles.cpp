@@ -0,0 +1,331 @@
+#include "xyz_tiles.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <unordered_map>
+#include <vector>
+
+#include "png_writer.hpp"
+
+namespace fgd_converter {
+
+DirectoryTileWriter::DirectoryTileWriter(std::filesystem::path root, std::string extension)
+    : root_(std::move(root)), extension_(std::move(extension)) {}
+
+bool DirectoryTileWriter::write(int z, uint32_t x, uint32_t y, std::span<const uint8_t> data,
+                                std::error_code& ec) {
+    const auto dir = root_ / std::to_string(z) / std::to_string(x);
+    {
+        std::lock_guard<std::mutex> lock(directory_mutex_);
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            return false;
+        }
+    }
+
+    std::ofstream file(dir / (std::to_string(y) + extension_), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+constexpr float NO_DATA = -9999.0f;
+constexpr double MAX_LATITUDE = 85.0511287798066;  // Web Mercatorの緯度範囲
+constexpr int MAX_SUPPORTED_ZOOM = 24;
+
+/**
+ * @brief 標高タイル (データがない場合は data が空)
+ */
+struct ElevationTile {
+    uint32_t x{};
+    uint32_t y{};
+    std::vector<float> data;
+};
+
+inline uint64_t tile_key(uint32_t x, uint32_t y) { return (static_cast<uint64_t>(x) << 32) | y; }
+
+/**
+ * @brief 入力ラスターの緯度経度範囲
+ */
+struct SourceBounds {
+    double min_lat, max_lat, min_lng, max_lng;
+};
+
+SourceBounds bounds_of(const Mosaic& m) {
+    const auto& gt = m.geo_transform;
+    return {.min_lat = gt[3] + gt[5] * m.y_length,
+            .max_lat = gt[3],
+            .min_lng = gt[0],
+            .max_lng = gt[0] + gt[1] * m.x_length};
+}
+
+uint32_t lng_to_tile(double lng, int z) {
+    const double n = std::ldexp(1.0, z);
+    double t = std::floor((lng + 180.0) / 360.0 * n);
+    return static_cast<uint32_t>(std::clamp(t, 0.0, n - 1.0));
+}
+
+uint32_t lat_to_tile(double lat, int z) {
+    const double n = std::ldexp(1.0, z);
+    const double rad = std::clamp(lat, -MAX_LATITUDE, MAX_LATITUDE) * std::numbers::pi / 180.0;
+    double t = std::floor((1.0 - std::asinh(std::tan(rad)) / std::numbers::pi) / 2.0 * n);
+    return static_cast<uint32_t>(std::clamp(t, 0.0, n - 1.0));
+}
+
+/**
+ * @brief ワールドピクセル座標 (0〜world) から経度・緯度へ (Web Mercatorの逆変換)
+ */
+inline double pixel_to_lng(double px, double world) { return px / world * 360.0 - 180.0; }
+
+inline double pixel_to_lat(double py, double world) {
+    const double n = std::numbers::pi * (1.0 - 2.0 * py / world);
+    return std::atan(std::sinh(n)) * 180.0 / std::numbers::pi;
+}
+
+/**
+ * @brief 最大ズームのタイルを入力ラスターから直接描画
+ */
+void render_tile(std::span<const Mosaic* const> sources, int z, int tile_size,
+                 ElevationTile& tile) {
+    const double world = std::ldexp(static_cast<double>(tile_size), z);
+    const double origin_x = static_cast<double>(tile.x) * tile_size;
+    const double origin_y = static_cast<double>(tile.y) * tile_size;
+
+    // 経度は列ごと、緯度は行ごとに1度だけ計算
+    std::vector<double> lngs(static_cast<size_t>(tile_size));
+    for (int px = 0; px < tile_size; ++px) {
+        lngs[px] = pixel_to_lng(origin_x + px + 0.5, world);
+    }
+
+    std::vector<float> data(static_cast<size_t>(tile_size) * tile_size, NO_DATA);
+    bool has_data = false;
+    for (int py = 0; py < tile_size; ++py) {
+        const double lat = pixel_to_lat(origin_y + py + 0.5, world);
+        float* row = data.data() + static_cast<size_t>(py) * tile_size;
+        for (int px = 0; px < tile_size; ++px) {
+            for (const Mosaic* source : sources) {
+                const float v = sample_mosaic(*source, lat, lngs[px]);
+                if (v > NO_DATA) {
+                    row[px] = v;
+                    has_data = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (has_data) {
+        tile.data = std::move(data);
+    }
+}
+
+/**
+ * @brief 子タイル4枚 (左上, 右上, 左下, 右下、欠けはnullptr) から親タイルを2×2平均で作成
+ */
+void downsample_tile(const std::array<const ElevationTile*, 4>& children, int tile_size,
+                     ElevationTile& parent) {
+    const int half = tile_size / 2;
+    std::vector<float> data(static_cast<size_t>(tile_size) * tile_size, NO_DATA);
+    bool has_data = false;
+
+    for (int q = 0; q < 4; ++q) {
+        if (children[q] == nullptr || children[q]->data.empty())
+            continue;
+        const float* src = children[q]->data.data();
+        const int ox = (q & 1) * half;
+        const int oy = (q >> 1) * half;
+
+        for (int r = 0; r < half; ++r) {
+            const float* top = src + static_cast<size_t>(2 * r) * tile_size;
+            const float* bottom = top + tile_size;
+            float* dst = data.data() + static_cast<size_t>(oy + r) * tile_size + ox;
+            for (int c = 0; c < half; ++c) {
+                const float v[4] = {top[2 * c], top[2 * c + 1], bottom[2 * c],
+                                    bottom[2 * c + 1]};
+                float sum = 0.0f;
+                int count = 0;
+                for (float e : v) {
+                    if (e > NO_DATA) {
+                        sum += e;
+                        ++count;
+                    }
+                }
+                if (count > 0) {
+                    dst[c] = sum / static_cast<float>(count);
+                    has_data = true;
+                }
+            }
+        }
+    }
+
+    if (has_data) {
+        parent.data = std::move(data);
+    }
+}
+
+/**
+ * @brief 並列処理中の最初のエラーを保持
+ */
+class FirstError {
+   public:
+    void set(const std::error_code& ec) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!failed_.load(std::memory_order_relaxed)) {
+            ec_ = ec;
+            failed_.store(true, std::memory_order_relaxed);
+        }
+    }
+    [[nodiscard]] bool failed() const { return failed_.load(std::memory_order_relaxed); }
+    [[nodiscard]] const std::error_code& code() const { return ec_; }
+
+   private:
+    std::mutex mutex_;
+    std::atomic<bool> failed_{false};
+    std::error_code ec_;
+};
+
+/**
+ * @brief 標高タイルをTerrain-RGB PNGへエンコードして書き出す
+ */
+bool emit_tile(const ElevationTile& tile, int z, const XyzTileConfig& config, TileWriter& writer,
+               std::vector<uint8_t>& rgb, std::vector<uint8_t>& png, std::error_code& ec) {
+    kernels::encode_rgb(tile.data.data(), tile.data.size(), config.encoding, rgb.data());
+    if (!encode_png_rgb(rgb.data(), config.tile_size, config.tile_size, png, ec)) {
+        return false;
+    }
+    return writer.write(z, tile.x, tile.y, png, ec);
+}
+
+}  // namespace
+
+auto write_xyz_tiles(std::span<const Mosaic> sources, const XyzTileConfig& config,
+                     TileWriter& writer, std::error_code& ec) -> std::optional<size_t> {
+    if ((config.tile_size != 256 && config.tile_size != 512) || config.min_zoom < 0 ||
+        config.min_zoom > config.max_zoom || config.max_zoom > MAX_SUPPORTED_ZOOM) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return std::nullopt;
+    }
+
+    std::vector<const Mosaic*> valid_sources;
+    for (const auto& source : sources) {
+        if (source.x_length > 0 && source.y_length > 0) {
+            valid_sources.push_back(&source);
+        }
+    }
+    if (valid_sources.empty()) {
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return std::nullopt;
+    }
+
+    // 最大ズームで各入力ラスターが覆うタイルを列挙
+    const int max_zoom = config.max_zoom;
+    std::vector<uint64_t> keys;
+    for (const Mosaic* source : valid_sources) {
+        const auto b = bounds_of(*source);
+        for (uint32_t y = lat_to_tile(b.max_lat, max_zoom); y <= lat_to_tile(b.min_lat, max_zoom);
+             ++y) {
+            for (uint32_t x = lng_to_tile(b.min_lng, max_zoom);
+                 x <= lng_to_tile(b.max_lng, max_zoom); ++x) {
+                keys.push_back(tile_key(x, y));
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<ElevationTile> level(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        level[i].x = static_cast<uint32_t>(keys[i] >> 32);
+        level[i].y = static_cast<uint32_t>(keys[i] & 0xFFFFFFFFu);
+    }
+
+    FirstError error;
+    std::atomic<size_t> written{0};
+    const size_t rgb_bytes =
+        static_cast<size_t>(config.tile_size) * config.tile_size * 3 + kernels::RGB_PADDING;
+
+    // 1ズーム分のタイルを並列に作成・出力する
+    auto process_level = [&](int z, auto&& make_tile) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, level.size()),
+                          [&](const tbb::blocked_range<size_t>& range) {
+                              std::vector<uint8_t> rgb(rgb_bytes);
+                              std::vector<uint8_t> png;
+                              for (size_t i = range.begin(); i != range.end(); ++i) {
+                                  if (error.failed())
+                                      return;
+                                  make_tile(level[i]);
+                                  if (level[i].data.empty())
+                                      continue;
+                                  std::error_code tile_ec;
+                                  if (!emit_tile(level[i], z, config, writer, rgb, png,
+                                                 tile_ec)) {
+                                      error.set(tile_ec);
+                                      return;
+                                  }
+                                  written.fetch_add(1, std::memory_order_relaxed);
+                              }
+                          });
+    };
+
+    process_level(max_zoom, [&](ElevationTile& tile) {
+        render_tile(valid_sources, max_zoom, config.tile_size, tile);
+    });
+
+    for (int z = max_zoom - 1; z >= config.min_zoom && !error.failed(); --z) {
+        // 空のタイルを除いた子タイルを索引化し、親タイルを列挙
+        std::vector<ElevationTile> children = std::move(level);
+        std::erase_if(children, [](const ElevationTile& t) { return t.data.empty(); });
+
+        std::unordered_map<uint64_t, size_t> child_index;
+        child_index.reserve(children.size());
+        std::vector<uint64_t> parent_keys;
+        parent_keys.reserve(children.size());
+        for (size_t i = 0; i < children.size(); ++i) {
+            child_index.emplace(tile_key(children[i].x, children[i].y), i);
+            parent_keys.push_back(tile_key(children[i].x / 2, children[i].y / 2));
+        }
+        std::sort(parent_keys.begin(), parent_keys.end());
+        parent_keys.erase(std::unique(parent_keys.begin(), parent_keys.end()), parent_keys.end());
+
+        level.assign(parent_keys.size(), ElevationTile{});
+        for (size_t i = 0; i < parent_keys.size(); ++i) {
+            level[i].x = static_cast<uint32_t>(parent_keys[i] >> 32);
+            level[i].y = static_cast<uint32_t>(parent_keys[i] & 0xFFFFFFFFu);
+        }
+
+        process_level(z, [&](ElevationTile& parent) {
+            std::array<const ElevationTile*, 4> quad{};
+            for (int q = 0; q < 4; ++q) {
+                const uint32_t cx = parent.x * 2 + static_cast<uint32_t>(q & 1);
+                const uint32_t cy = parent.y * 2 + static_cast<uint32_t>(q >> 1);
+                auto it = child_index.find(tile_key(cx, cy));
+                quad[q] = it != child_index.end() ? &children[it->second] : nullptr;
+            }
+            downsample_tile(quad, config.tile_size, parent);
+        });
+    }
+
+    if (error.failed()) {
+        ec = error.code();
+        return std::nullopt;
+    }
+    if (!writer.finish(ec)) {
+        return std::nullopt;
+    }
+    return written.load();
+}
+
+}  // namespace fgd_converter
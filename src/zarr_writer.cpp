@@ -0,0 +1,186 @@
+#include "zarr_writer.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fgd_converter {
+
+namespace {
+
+constexpr float NO_DATA = -9999.0f;
+constexpr size_t ELEMENT_SIZE = sizeof(float);
+
+bool write_text_file(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+    return static_cast<bool>(file);
+}
+
+std::string make_zarray_json(int width, int height, const ZarrOptions& options) {
+    std::ostringstream ss;
+    ss << "{\n"
+       << "    \"zarr_format\": 2,\n"
+       << "    \"shape\": [" << height << ", " << width << "],\n"
+       << "    \"chunks\": [" << options.chunk_size << ", " << options.chunk_size << "],\n"
+       << "    \"dtype\": \"<f4\",\n"
+       << "    \"fill_value\": " << NO_DATA << ",\n"
+       << "    \"order\": \"C\",\n"
+       << "    \"filters\": [{\"id\": \"shuffle\", \"elementsize\": " << ELEMENT_SIZE << "}],\n"
+       << "    \"compressor\": {\"id\": \"zlib\", \"level\": " << options.compression_level
+       << "},\n"
+       << "    \"dimension_separator\": \".\"\n"
+       << "}\n";
+    return ss.str();
+}
+
+std::string make_zattrs_json(const std::array<double, 6>& geo_transform) {
+    std::ostringstream ss;
+    ss.precision(17);
+    ss << "{\n"
+       << "    \"_ARRAY_DIMENSIONS\": [\"y\", \"x\"],\n"
+       << "    \"crs\": \"EPSG:4326\",\n"
+       << "    \"geo_transform\": [";
+    for (size_t i = 0; i < geo_transform.size(); ++i) {
+        ss << (i == 0 ? "" : ", ") << geo_transform[i];
+    }
+    ss << "],\n"
+       << "    \"nodata\": " << NO_DATA << "\n"
+       << "}\n";
+    return ss.str();
+}
+
+/**
+ * @brief 出力先を用意 (既存のZarrストアは削除、Zarr以外の既存パスはエラー)
+ *
+ * 途中で失敗したストアは .zattrs のみを持つため、それもZarrストアとして扱う。
+ */
+bool prepare_store(const std::filesystem::path& store_path, std::error_code& ec) {
+    if (std::filesystem::exists(store_path, ec)) {
+        if (!std::filesystem::exists(store_path / ".zarray") &&
+            !std::filesystem::exists(store_path / ".zattrs")) {
+            ec = std::make_error_code(std::errc::file_exists);
+            return false;
+        }
+        std::filesystem::remove_all(store_path, ec);
+        if (ec) {
+            return false;
+        }
+    }
+    ec.clear();
+    std::filesystem::create_directories(store_path, ec);
+    return !ec;
+}
+
+}  // namespace
+
+void byte_shuffle(const uint8_t* src, size_t count, size_t element_size, uint8_t* dst) noexcept {
+    for (size_t b = 0; b < element_size; ++b) {
+        uint8_t* plane = dst + b * count;
+        const uint8_t* in = src + b;
+        for (size_t i = 0; i < count; ++i) {
+            plane[i] = in[i * element_size];
+        }
+    }
+}
+
+bool write_zarr(const std::filesystem::path& store_path,
+                const std::vector<std::vector<double>>& data, int width, int height,
+                const std::array<double, 6>& geo_transform, const ZarrOptions& options,
+                std::error_code& ec) {
+    if (width <= 0 || height <= 0 || options.chunk_size <= 0 ||
+        static_cast<int>(data.size()) < height) {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return false;
+    }
+    if (!prepare_store(store_path, ec)) {
+        return false;
+    }
+    if (!write_text_file(store_path / ".zattrs", make_zattrs_json(geo_transform))) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    const int chunk = options.chunk_size;
+    const int chunks_x = (width + chunk - 1) / chunk;
+    const int chunks_y = (height + chunk - 1) / chunk;
+    const size_t chunk_pixels = static_cast<size_t>(chunk) * chunk;
+    const size_t chunk_bytes = chunk_pixels * ELEMENT_SIZE;
+
+    std::atomic<bool> failed{false};
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, static_cast<size_t>(chunks_x) * chunks_y),
+        [&](const tbb::blocked_range<size_t>& range) {
+            // 端のチャンクもchunk_size四方で保存する (範囲外はfill_value)
+            std::vector<float> values(chunk_pixels);
+            std::vector<uint8_t> shuffled(chunk_bytes);
+            std::vector<uint8_t> compressed(compressBound(static_cast<uLong>(chunk_bytes)));
+
+            for (size_t c = range.begin(); c != range.end(); ++c) {
+                if (failed.load(std::memory_order_relaxed))
+                    return;
+                const int cy = static_cast<int>(c / chunks_x);
+                const int cx = static_cast<int>(c % chunks_x);
+                const int x0 = cx * chunk;
+                const int y0 = cy * chunk;
+                const int w = std::min(chunk, width - x0);
+                const int h = std::min(chunk, height - y0);
+
+                std::fill(values.begin(), values.end(), NO_DATA);
+                bool has_data = false;
+                for (int r = 0; r < h; ++r) {
+                    const auto& row = data[y0 + r];
+                    float* dst = values.data() + static_cast<size_t>(r) * chunk;
+                    for (int col = 0; col < w; ++col) {
+                        const double v = row[x0 + col];
+                        if (v > NO_DATA) {
+                            dst[col] = static_cast<float>(v);
+                            has_data = true;
+                        }
+                    }
+                }
+                if (!has_data)
+                    continue;
+
+                byte_shuffle(reinterpret_cast<const uint8_t*>(values.data()), chunk_pixels,
+                             ELEMENT_SIZE, shuffled.data());
+                uLongf compressed_size = static_cast<uLongf>(compressed.size());
+                if (compress2(compressed.data(), &compressed_size, shuffled.data(),
+                              static_cast<uLong>(chunk_bytes),
+                              options.compression_level) != Z_OK) {
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+
+                std::ofstream file(store_path / (std::to_string(cy) + "." + std::to_string(cx)),
+                                   std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char*>(compressed.data()),
+                           static_cast<std::streamsize>(compressed_size));
+                if (!file) {
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+            }
+        });
+
+    if (failed.load()) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+
+    // 配列メタデータはチャンクの書き込み完了後に出力 (途中で失敗したストアを有効に見せない)
+    if (!write_text_file(store_path / ".zarray", make_zarray_json(width, height, options))) {
+        ec = std::make_error_code(std::errc::io_error);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace fgd_converter
@@ -4,30 +4,122 @@
 #include <mz_strm.h>
 #include <mz_zip.h>
 #include <mz_zip_rw.h>
+#include <zlib.h>
 
 #include <algorithm>
+#include <climits>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
+#include "stats.hpp"
+
 namespace fgd_converter::zip {
 
+namespace {
+
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr size_t LOCAL_HEADER_SIZE = 30;
+constexpr uint16_t METHOD_STORE = 0;
+constexpr uint16_t METHOD_DEFLATE = 8;
+
+uint16_t get_le16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+uint32_t get_le32(const uint8_t *p) {
+    return static_cast<uint32_t>(get_le16(p)) | (static_cast<uint32_t>(get_le16(p + 2)) << 16);
+}
+
+/**
+ * @brief エントリのデータ部を展開 (out は展開後のサイズで確保済み)
+ */
+bool inflate_entry(std::span<const uint8_t> src, uint16_t method, std::vector<uint8_t> &out) {
+    if (method == METHOD_STORE) {
+        if (src.size() != out.size()) {
+            return false;
+        }
+        std::copy(src.begin(), src.end(), out.begin());
+        return true;
+    }
+    if (method != METHOD_DEFLATE || src.size() > UINT_MAX || out.size() > UINT_MAX) {
+        return false;
+    }
+
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = const_cast<Bytef *>(src.data());
+    stream.avail_in = static_cast<uInt>(src.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int ret = inflate(&stream, Z_FINISH);
+    const bool ok = ret == Z_STREAM_END && stream.total_out == out.size();
+    inflateEnd(&stream);
+    return ok;
+}
+
+}  // namespace
+
 class ZipHandler::Impl {
    public:
     explicit Impl(const std::filesystem::path &zip_path) : zip_path_(zip_path) {}
+    explicit Impl(std::span<const uint8_t> buffer) : buffer_(buffer), from_buffer_(true) {}
+
+    /**
+     * @brief ファイルまたはメモリバッファからZIPリーダーを開く
+     */
+    int32_t open_reader(void *reader) const {
+        if (from_buffer_) {
+            // copy=0: 呼び出し元のバッファを直接参照する
+            return mz_zip_reader_open_buffer(reader, const_cast<uint8_t *>(buffer_.data()),
+                                             static_cast<int32_t>(buffer_.size()), 0);
+        }
+        auto abs_zip_path = std::filesystem::absolute(zip_path_).make_preferred();
+        return mz_zip_reader_open_file(reader, abs_zip_path.string().c_str());
+    }
+
+    /**
+     * @brief アーカイブ内の指定位置からバイト列を読み込む (file はファイルから開いた場合のみ使用)
+     */
+    bool read_at(std::ifstream &file, uint64_t offset, uint8_t *dst, size_t size) const {
+        if (from_buffer_) {
+            if (offset > buffer_.size() || size > buffer_.size() - offset) {
+                return false;
+            }
+            std::memcpy(dst, buffer_.data() + offset, size);
+            return true;
+        }
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char *>(dst), static_cast<std::streamsize>(size));
+        return static_cast<bool>(file);
+    }
+
+    /**
+     * @brief ログ出力用の名前
+     */
+    std::string display_name() const {
+        if (from_buffer_) {
+            return "<memory>";
+        }
+        return std::filesystem::absolute(zip_path_).make_preferred().string();
+    }
 
     std::filesystem::path zip_path_;
+    std::span<const uint8_t> buffer_;
+    bool from_buffer_{false};
 };
 
 ZipHandler::ZipHandler(std::filesystem::path zip_path) : pImpl(std::make_unique<Impl>(zip_path)) {}
 
+ZipHandler::ZipHandler(std::span<const uint8_t> buffer) : pImpl(std::make_unique<Impl>(buffer)) {}
+
 ZipHandler::~ZipHandler() = default;
 ZipHandler::ZipHandler(ZipHandler &&) noexcept = default;
 ZipHandler &ZipHandler::operator=(ZipHandler &&) noexcept = default;
 
 auto ZipHandler::extract(const std::filesystem::path &output_dir,
                          std::error_code &ec) -> std::optional<std::vector<std::filesystem::path>> {
-    auto abs_zip_path = std::filesystem::absolute(pImpl->zip_path_).make_preferred();
+    stats::ScopedTimer timer(stats::Stage::Unzip);
     auto abs_output_dir = std::filesystem::absolute(output_dir).make_preferred();
 
     void *reader = mz_zip_reader_create();
@@ -38,9 +130,9 @@ auto ZipHandler::extract(const std::filesystem::path &output_dir,
 
     std::vector<std::filesystem::path> extracted_files;
 
-    int32_t err = mz_zip_reader_open_file(reader, abs_zip_path.string().c_str());
+    int32_t err = pImpl->open_reader(reader);
     if (err != MZ_OK) {
-        std::cout << "ZIPファイルを開けませんでした: " << abs_zip_path.string()
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
                   << " (エラー: " << err << ")" << std::endl;
         mz_zip_reader_delete(&reader);
         ec = std::make_error_code(std::errc::io_error);
@@ -76,6 +168,9 @@ auto ZipHandler::extract(const std::filesystem::path &output_dir,
         err = mz_zip_reader_entry_save_file(reader, output_path.string().c_str());
         if (err == MZ_OK) {
             extracted_files.push_back(output_path);
+            stats::add(stats::Counter::ZipEntries, 1);
+            stats::add(stats::Counter::BytesInflated,
+                       static_cast<uint64_t>(file_info->uncompressed_size));
         } else {
             std::cout << "展開に失敗しました: " << filename << " (エラー: " << err << ")"
                       << std::endl;
@@ -98,7 +193,7 @@ auto ZipHandler::extract(const std::filesystem::path &output_dir,
 auto ZipHandler::extract_specific(
     const std::filesystem::path &output_dir, std::span<const std::string_view> file_patterns,
     std::error_code &ec) -> std::optional<std::vector<std::filesystem::path>> {
-    auto abs_zip_path = std::filesystem::absolute(pImpl->zip_path_).make_preferred();
+    stats::ScopedTimer timer(stats::Stage::Unzip);
     auto abs_output_dir = std::filesystem::absolute(output_dir).make_preferred();
 
     void *reader = mz_zip_reader_create();
@@ -109,9 +204,9 @@ auto ZipHandler::extract_specific(
 
     std::vector<std::filesystem::path> extracted_files;
 
-    int32_t err = mz_zip_reader_open_file(reader, abs_zip_path.string().c_str());
+    int32_t err = pImpl->open_reader(reader);
     if (err != MZ_OK) {
-        std::cout << "ZIPファイルを開けませんでした: " << abs_zip_path.string()
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
                   << " (エラー: " << err << ")" << std::endl;
         mz_zip_reader_delete(&reader);
         ec = std::make_error_code(std::errc::io_error);
@@ -161,6 +256,9 @@ auto ZipHandler::extract_specific(
         err = mz_zip_reader_entry_save_file(reader, output_path.string().c_str());
         if (err == MZ_OK) {
             extracted_files.push_back(output_path);
+            stats::add(stats::Counter::ZipEntries, 1);
+            stats::add(stats::Counter::BytesInflated,
+                       static_cast<uint64_t>(file_info->uncompressed_size));
         } else {
             std::cout << "展開に失敗しました: " << filename << " (エラー: " << err << ")"
                       << std::endl;
@@ -180,7 +278,6 @@ auto ZipHandler::extract_specific(
 }
 
 auto ZipHandler::list_files(std::error_code &ec) const -> std::optional<std::vector<std::string>> {
-    auto abs_zip_path = std::filesystem::absolute(pImpl->zip_path_).make_preferred();
 
     void *reader = mz_zip_reader_create();
     if (!reader) {
@@ -188,9 +285,9 @@ auto ZipHandler::list_files(std::error_code &ec) const -> std::optional<std::vec
         return std::nullopt;
     }
 
-    int32_t err = mz_zip_reader_open_file(reader, abs_zip_path.string().c_str());
+    int32_t err = pImpl->open_reader(reader);
     if (err != MZ_OK) {
-        std::cout << "ZIPファイルを開けませんでした: " << abs_zip_path.string()
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
                   << " (エラー: " << err << ")" << std::endl;
         mz_zip_reader_delete(&reader);
         ec = std::make_error_code(std::errc::io_error);
@@ -221,9 +318,55 @@ auto ZipHandler::list_files(std::error_code &ec) const -> std::optional<std::vec
     return filenames;
 }
 
+auto ZipHandler::list_entries(std::error_code &ec) const
+    -> std::optional<std::vector<EntryInfo>> {
+    void *reader = mz_zip_reader_create();
+    if (!reader) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return std::nullopt;
+    }
+
+    int32_t err = pImpl->open_reader(reader);
+    if (err != MZ_OK) {
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
+                  << " (エラー: " << err << ")" << std::endl;
+        mz_zip_reader_delete(&reader);
+        ec = std::make_error_code(std::errc::io_error);
+        return std::nullopt;
+    }
+
+    std::vector<EntryInfo> entries;
+
+    err = mz_zip_reader_goto_first_entry(reader);
+    while (err == MZ_OK) {
+        mz_zip_file *file_info = nullptr;
+        err = mz_zip_reader_entry_get_info(reader, &file_info);
+        if (err != MZ_OK) {
+            break;
+        }
+
+        // ディレクトリをスキップ
+        if (mz_zip_reader_entry_is_dir(reader) != MZ_OK) {
+            entries.push_back({.name = file_info->filename,
+                               .crc32 = file_info->crc,
+                               .compressed_size = static_cast<uint64_t>(file_info->compressed_size),
+                               .uncompressed_size =
+                                   static_cast<uint64_t>(file_info->uncompressed_size),
+                               .offset = static_cast<uint64_t>(file_info->disk_offset)});
+        }
+
+        err = mz_zip_reader_goto_next_entry(reader);
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    return entries;
+}
+
 auto ZipHandler::read_file(std::string_view filename,
                            std::error_code &ec) const -> std::optional<std::vector<uint8_t>> {
-    auto abs_zip_path = std::filesystem::absolute(pImpl->zip_path_).make_preferred();
+    stats::ScopedTimer timer(stats::Stage::Unzip);
 
     void *reader = mz_zip_reader_create();
     if (!reader) {
@@ -231,9 +374,9 @@ auto ZipHandler::read_file(std::string_view filename,
         return std::nullopt;
     }
 
-    int32_t err = mz_zip_reader_open_file(reader, abs_zip_path.string().c_str());
+    int32_t err = pImpl->open_reader(reader);
     if (err != MZ_OK) {
-        std::cout << "ZIPファイルを開けませんでした: " << abs_zip_path.string()
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
                   << " (エラー: " << err << ")" << std::endl;
         mz_zip_reader_delete(&reader);
         ec = std::make_error_code(std::errc::io_error);
@@ -283,9 +426,173 @@ auto ZipHandler::read_file(std::string_view filename,
     }
 
     buffer.resize(static_cast<size_t>(bytes_read));
+    stats::add(stats::Counter::ZipEntries, 1);
+    stats::add(stats::Counter::BytesInflated, buffer.size());
     return buffer;
 }
 
+auto ZipHandler::read_all(const std::function<bool(std::string_view)> &filter,
+                          std::error_code &ec) const -> std::optional<std::vector<FileData>> {
+    stats::ScopedTimer timer(stats::Stage::Unzip);
+    void *reader = mz_zip_reader_create();
+    if (!reader) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return std::nullopt;
+    }
+
+    int32_t err = pImpl->open_reader(reader);
+    if (err != MZ_OK) {
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
+                  << " (エラー: " << err << ")" << std::endl;
+        mz_zip_reader_delete(&reader);
+        ec = std::make_error_code(std::errc::io_error);
+        return std::nullopt;
+    }
+
+    std::vector<FileData> files;
+
+    err = mz_zip_reader_goto_first_entry(reader);
+    while (err == MZ_OK) {
+        mz_zip_file *file_info = nullptr;
+        err = mz_zip_reader_entry_get_info(reader, &file_info);
+        if (err != MZ_OK) {
+            break;
+        }
+
+        if (mz_zip_reader_entry_is_dir(reader) != MZ_OK && filter(file_info->filename)) {
+            FileData file;
+            file.name = file_info->filename;
+            file.data.resize(static_cast<size_t>(file_info->uncompressed_size));
+
+            // エントリ全体を一括で展開
+            int32_t save_err = mz_zip_reader_entry_save_buffer(
+                reader, file.data.data(), static_cast<int32_t>(file.data.size()));
+            if (save_err == MZ_OK) {
+                stats::add(stats::Counter::ZipEntries, 1);
+                stats::add(stats::Counter::BytesInflated, file.data.size());
+                files.push_back(std::move(file));
+            } else {
+                std::cout << "展開に失敗しました: " << file.name << " (エラー: " << save_err << ")"
+                          << std::endl;
+            }
+        }
+
+        err = mz_zip_reader_goto_next_entry(reader);
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    return files;
+}
+
+auto ZipHandler::read_entries(std::span<const EntryInfo> entries, std::error_code &ec) const
+    -> std::optional<std::vector<FileData>> {
+    stats::ScopedTimer timer(stats::Stage::Unzip);
+    std::ifstream file;
+    if (!pImpl->from_buffer_) {
+        file.open(pImpl->zip_path_, std::ios::binary);
+        if (!file) {
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+            return std::nullopt;
+        }
+    }
+
+    std::vector<FileData> files;
+    files.reserve(entries.size());
+    std::vector<uint8_t> compressed;
+    for (const auto &entry : entries) {
+        // ローカルヘッダー (固定長部分) を読み、データ部の位置と圧縮方式を得る
+        uint8_t header[LOCAL_HEADER_SIZE];
+        if (!pImpl->read_at(file, entry.offset, header, sizeof(header)) ||
+            get_le32(header) != LOCAL_HEADER_SIGNATURE || (get_le16(header + 6) & 0x1) != 0) {
+            ec = std::make_error_code(std::errc::illegal_byte_sequence);
+            return std::nullopt;
+        }
+        const uint16_t method = get_le16(header + 8);
+        const uint64_t data_offset =
+            entry.offset + LOCAL_HEADER_SIZE + get_le16(header + 26) + get_le16(header + 28);
+
+        // サイズとCRC-32はセントラルディレクトリ由来の値を使う (データ記述子付きでも有効)
+        compressed.resize(static_cast<size_t>(entry.compressed_size));
+        FileData out{.name = entry.name,
+                     .data = std::vector<uint8_t>(static_cast<size_t>(entry.uncompressed_size))};
+        if (!pImpl->read_at(file, data_offset, compressed.data(), compressed.size()) ||
+            !inflate_entry(compressed, method, out.data) ||
+            crc32_z(0, out.data.data(), out.data.size()) != entry.crc32) {
+            ec = std::make_error_code(std::errc::io_error);
+            return std::nullopt;
+        }
+
+        stats::add(stats::Counter::ZipEntries, 1);
+        stats::add(stats::Counter::BytesInflated, out.data.size());
+        files.push_back(std::move(out));
+    }
+    return files;
+}
+
+auto ZipHandler::read_heads(const std::function<bool(std::string_view)> &filter, size_t max_bytes,
+                            std::error_code &ec) const -> std::optional<std::vector<FileData>> {
+    stats::ScopedTimer timer(stats::Stage::Unzip);
+    void *reader = mz_zip_reader_create();
+    if (!reader) {
+        ec = std::make_error_code(std::errc::not_enough_memory);
+        return std::nullopt;
+    }
+
+    int32_t err = pImpl->open_reader(reader);
+    if (err != MZ_OK) {
+        std::cout << "ZIPファイルを開けませんでした: " << pImpl->display_name()
+                  << " (エラー: " << err << ")" << std::endl;
+        mz_zip_reader_delete(&reader);
+        ec = std::make_error_code(std::errc::io_error);
+        return std::nullopt;
+    }
+
+    std::vector<FileData> files;
+
+    err = mz_zip_reader_goto_first_entry(reader);
+    while (err == MZ_OK) {
+        mz_zip_file *file_info = nullptr;
+        err = mz_zip_reader_entry_get_info(reader, &file_info);
+        if (err != MZ_OK) {
+            break;
+        }
+
+        if (mz_zip_reader_entry_is_dir(reader) != MZ_OK && filter(file_info->filename) &&
+            mz_zip_reader_entry_open(reader) == MZ_OK) {
+            FileData file;
+            file.name = file_info->filename;
+            const auto size = static_cast<uint64_t>(file_info->uncompressed_size);
+            file.data.resize(static_cast<size_t>(std::min<uint64_t>(max_bytes, size)));
+
+            // 必要なバイト数に達した時点で展開を打ち切る
+            size_t filled = 0;
+            while (filled < file.data.size()) {
+                int32_t n = mz_zip_reader_entry_read(
+                    reader, file.data.data() + filled,
+                    static_cast<int32_t>(file.data.size() - filled));
+                if (n <= 0) {
+                    break;
+                }
+                filled += static_cast<size_t>(n);
+            }
+            mz_zip_reader_entry_close(reader);
+
+            file.data.resize(filled);
+            stats::add(stats::Counter::BytesInflated, filled);
+            files.push_back(std::move(file));
+        }
+
+        err = mz_zip_reader_goto_next_entry(reader);
+    }
+
+    mz_zip_reader_close(reader);
+    mz_zip_reader_delete(&reader);
+
+    return files;
+}
+
 auto extract_all_zips(const std::filesystem::path &directory,
                       const std::filesystem::path &output_dir,
                       std::error_code &ec) -> std::optional<std::vector<std::filesystem::path>> {
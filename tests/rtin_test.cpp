@@ -0,0 +1,84 @@
+// RTIN三角形表 (quantized-mesh の誤差計算) の単体テスト
+
+#include <cstdio>
+#include <vector>
+
+#include "rtin.hpp"
+
+using fgd_converter::Rtin;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, const char* what, int grid_size, int x, int y) {
+    if (!condition) {
+        std::fprintf(stderr, "失敗: %s (grid_size=%d, x=%d, y=%d)\n", what, grid_size, x, y);
+        ++failures;
+    }
+}
+
+bool is_corner(int x, int y, int max) { return (x == 0 || x == max) && (y == 0 || y == max); }
+
+/**
+ * @brief 四隅以外のすべての格子点が、いずれかの三角形の斜辺の中点になっている
+ */
+void test_every_point_is_split(int grid_size) {
+    const Rtin rtin(grid_size);
+    const int max = grid_size - 1;
+    std::vector<bool> split(static_cast<size_t>(grid_size) * grid_size, false);
+    for (size_t i = 0; i < rtin.num_triangles; ++i) {
+        const int ax = rtin.coords[i * 4];
+        const int ay = rtin.coords[i * 4 + 1];
+        const int bx = rtin.coords[i * 4 + 2];
+        const int by = rtin.coords[i * 4 + 3];
+        expect(ax <= max && ay <= max && bx <= max && by <= max, "頂点が格子の範囲内", grid_size,
+               ax, ay);
+        split[static_cast<size_t>((ay + by) >> 1) * grid_size + ((ax + bx) >> 1)] = true;
+    }
+    for (int y = 0; y <= max; ++y) {
+        for (int x = 0; x <= max; ++x) {
+            if (!is_corner(x, y, max)) {
+                expect(split[static_cast<size_t>(y) * grid_size + x], "三角形の分割点", grid_size,
+                       x, y);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 1点だけ突出した標高は、その格子点の誤差として現れる
+ */
+void test_spike_raises_error(int grid_size) {
+    const Rtin rtin(grid_size);
+    const int max = grid_size - 1;
+    const float spike = 100.0f;
+    for (int y = 0; y <= max; ++y) {
+        for (int x = 0; x <= max; ++x) {
+            if (is_corner(x, y, max))
+                continue;
+            std::vector<float> heights(static_cast<size_t>(grid_size) * grid_size, 0.0f);
+            heights[static_cast<size_t>(y) * grid_size + x] = spike;
+            const std::vector<float> errors = rtin.compute_errors(heights);
+            expect(errors[static_cast<size_t>(y) * grid_size + x] >= spike, "突出点の誤差",
+                   grid_size, x, y);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    for (int grid_size : {3, 5, 9, 17, 65}) {
+        test_every_point_is_split(grid_size);
+        test_spike_raises_error(grid_size);
+    }
+    // quantized-mesh の既定の格子サイズ
+    test_every_point_is_split(257);
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d 件の失敗\n", failures);
+        return 1;
+    }
+    return 0;
+}